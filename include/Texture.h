@@ -52,6 +52,17 @@ public:
      * this texture does not have a valid size.
      */
     virtual std::size_t getHeight() const = 0;
+
+    /**
+     * \brief
+     * Returns false if this texture is still being loaded in the background.
+     * The dimensions of such a texture are not known yet, querying them
+     * blocks until the texture has been loaded.
+     */
+    virtual bool isLoaded() const
+    {
+        return true;
+    }
 };
 typedef std::shared_ptr<Texture> TexturePtr;
 
@@ -3,6 +3,7 @@
 #include <memory>
 #include "imodule.h"
 #include <list>
+#include <string_view>
 
 #include "math/Plane3.h"
 #include "math/Vector3.h"
@@ -109,6 +110,13 @@ public:
      * Load the AAS file contents from the given stream. 
      */
     virtual IAasFilePtr loadFromStream(std::istream& stream) = 0;
+
+    /**
+     * Load the AAS file contents from the given text in memory, e.g. the
+     * mapped data of an ArchiveTextFile. The text is not copied and doesn't
+     * need to be null-terminated, it only needs to stay valid during this call.
+     */
+    virtual IAasFilePtr loadFromBuffer(std::string_view contents) = 0;
 };
 typedef std::shared_ptr<IAasFileLoader> IAasFileLoaderPtr;
 
@@ -14,6 +14,7 @@
 #include "itextstream.h"
 
 #include <string>
+#include <string_view>
 
 class InputStream;
 
@@ -53,6 +54,17 @@ public:
 	/// The stream may be read forwards until it is exhausted.
 	/// The stream remains valid for the lifetime of the file.
 	virtual InputStream& getInputStream() = 0;
+
+	/// \brief Returns a pointer to the whole file data (size() bytes) if it is
+	/// directly accessible in memory, e.g. because the file is memory-mapped.
+	/// Returns nullptr if the data needs to be read through getInputStream().
+	/// The data remains valid for the lifetime of the file and is not null-terminated.
+	/// Mapped files should only be held while parsing them: if the file on disk is
+	/// truncated by another process meanwhile, accessing the lost pages raises SIGBUS.
+	virtual const unsigned char* getMappedData() const
+	{
+		return nullptr;
+	}
 };
 typedef std::shared_ptr<ArchiveFile> ArchiveFilePtr;
 
@@ -72,6 +84,16 @@ public:
 	/// The stream may be read forwards until it is exhausted.
 	/// The stream remains valid for the lifetime of the file.
 	virtual TextInputStream& getInputStream() = 0;
+
+	/// \brief Returns the whole file contents if they are directly accessible
+	/// in memory, e.g. because the file is memory-mapped. Returns an empty view
+	/// if the contents need to be read through getInputStream().
+	/// The data remains valid for the lifetime of the file and is not null-terminated.
+	/// Mapped files should only be held while parsing them, see ArchiveFile::getMappedData().
+	virtual std::string_view getMappedData() const
+	{
+		return std::string_view();
+	}
 };
 typedef std::shared_ptr<ArchiveTextFile> ArchiveTextFilePtr;
 
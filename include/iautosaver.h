@@ -29,6 +29,10 @@ public:
     // for the currently loaded map, regardless whether it is due for a save or not.
     // Call the "runAutosaveCheck" method to see if an autosave is overdue.
     virtual void performAutosave() = 0;
+
+    // The files of an automatic save are written in the background.
+    // This blocks until the files of the most recent save are on disk.
+    virtual void waitForPendingSave() = 0;
 };
 
 constexpr const char* const RKEY_AUTOSAVE_SNAPSHOTS_ENABLED = "user/ui/map/autoSaveSnapshots";
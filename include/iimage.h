@@ -87,6 +87,22 @@ public:
 
     /// Return the OpenGL format for this image
     virtual GLenum getGLFormat() const = 0;
+
+    /**
+     * \brief Upload the pixel data into an existing OpenGL texture object.
+     *
+     * Replaces the contents of the given texture, which keeps its texture number.
+     * This is used to fill in textures which have been allocated before their
+     * image was available. Returns false if the data could not be uploaded.
+     *
+     * \param skipLevels
+     * Number of top mipmap levels to leave out, which reduces the resolution of
+     * the uploaded texture without touching the pixel data on the CPU. This is
+     * only applicable to images providing their own mipmaps (see getLevels()),
+     * images with a single level ignore this value.
+     */
+    virtual bool uploadTexture(GLuint textureNum, Role role = Role::COLOUR,
+                               std::size_t skipLevels = 0) const = 0;
 };
 typedef std::shared_ptr<Image> ImagePtr;
 
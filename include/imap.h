@@ -13,6 +13,15 @@
 // Registry setting for suppressing the map load progress dialog
 const char* const RKEY_MAP_SUPPRESS_LOAD_STATUS_DIALOG = "user/ui/map/suppressMapLoadDialog";
 
+// Whether map files should be parsed using multiple worker threads
+const char* const RKEY_MAP_PARALLEL_LOADING = "user/ui/map/parallelLoading";
+
+// Whether large entities should be formatted using multiple worker threads when saving
+const char* const RKEY_MAP_PARALLEL_SAVING = "user/ui/map/parallelSaving";
+
+// Whether a binary cache of the loaded scene should be kept next to map files, speeding up the next load
+const char* const RKEY_MAP_BINARY_CACHE = "user/ui/map/binaryCache";
+
 // Whether to load the most recently used map on app startup
 const char* const RKEY_LOAD_LAST_MAP = "user/ui/map/loadLastMap";
 
@@ -3,6 +3,8 @@
 #include "imodule.h"
 #include "imodel.h"
 #include "inode.h"
+#include <set>
+#include <functional>
 #include <sigc++/signal.h>
 
 namespace model 
@@ -33,10 +35,46 @@ public:
 	 * so calling this with the same path twice will return the same
 	 * IModelPtr to save memory.
 	 *
+	 * If the model is currently being loaded by another thread, this waits
+	 * for that load to finish instead of loading it a second time.
+	 *
 	 * This method is primarily used by the ModelLoaders to acquire their model data.
 	 */
 	virtual IModelPtr getModel(const std::string& modelPath) = 0;
 
+	/**
+	 * Starts loading the given models on a pool of worker threads and returns
+	 * immediately. Models which are already cached or currently being loaded are
+	 * skipped, as are paths without a matching model importer.
+	 * The paths have to refer to actual VFS files, like in getModelNode().
+	 */
+	virtual void prefetchModels(const std::set<std::string>& modelPaths) = 0;
+
+	/**
+	 * Returns true if the given model is still being loaded in the background,
+	 * or if it has been loaded but signal_modelsLoaded() has not been emitted
+	 * for it yet. Callers can use a placeholder meanwhile instead of waiting in
+	 * getModelNode(). Models failing to load are not announced, their placeholder
+	 * is what getModelNode() would return for them anyway.
+	 *
+	 * This is always false as long as no main thread dispatcher is set.
+	 */
+	virtual bool isLoadingInBackground(const std::string& modelPath) = 0;
+
+	// Blocks until all models requested through prefetchModels() are loaded
+	virtual void waitForBackgroundLoads() = 0;
+
+	// Function running the given action on the main thread at a later point
+	using MainThreadDispatcher = std::function<void(const std::function<void()>&)>;
+
+	/**
+	 * Sets the function used to announce models loaded in the background on
+	 * the main thread, pass an empty function to unset it. Without a dispatcher
+	 * (e.g. in headless mode) background loads are only announced to callers
+	 * waiting for them in getModel() or getModelNode().
+	 */
+	virtual void setMainThreadDispatcher(const MainThreadDispatcher& dispatcher) = 0;
+
     // Loads a model from the static resources in DarkRadiant's runtime data/resources folder
     virtual scene::INodePtr getModelNodeForStaticResource(const std::string& resourcePath) = 0;
 
@@ -54,6 +92,12 @@ public:
 
 	/// Signal emitted after models are reloaded
 	virtual sigc::signal<void> signal_modelsReloaded() = 0;
+
+	/// Signal emitted on the main thread when models loaded in the background
+	/// are available, passing the VFS paths of all models finished since the
+	/// last emission. Models which failed to load are not included.
+	/// See isLoadingInBackground().
+	virtual sigc::signal<void, const std::set<std::string>&> signal_modelsLoaded() = 0;
 };
 
 } // namespace model
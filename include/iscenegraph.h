@@ -84,6 +84,18 @@ public:
 	// A specific node has changed its bounds
 	virtual void nodeBoundsChanged(const scene::INodePtr& node) = 0;
 
+	/**
+	 * Starts collecting bounds changes instead of processing them right away.
+	 * Until the matching endBoundsChangeBatch() call, nodeBoundsChanged() calls are
+	 * recorded once per node and boundsChanged() doesn't emit its signal. Calls can be nested,
+	 * the outermost end call applies the changes to the space partition in one go and
+	 * emits the boundsChanged signal at most once.
+	 * Volume traversals happening in between might not see the latest node positions.
+	 * Prefer the ScopedBoundsChangeBatch helper over calling these methods directly.
+	 */
+	virtual void beginBoundsChangeBatch() = 0;
+	virtual void endBoundsChangeBatch() = 0;
+
 	// A walker class to be used in "foreachNodeInVolume"
 	class Walker
 	{
@@ -92,6 +104,16 @@ public:
 
 		// Called for each visited node, returns TRUE if traversal should continue
 		virtual bool visit(const INodePtr& node) = 0;
+
+		// Walkers returning true here allow the scenegraph to cull the space partition
+		// on several threads before visiting the nodes. visit() is still invoked on the
+		// calling thread and in the same order as a sequential traversal, but the set of
+		// visited nodes is determined up front: changes to the visibility of nodes made
+		// by the walker itself don't affect the running traversal.
+		virtual bool supportsParallelCulling() const
+		{
+			return false;
+		}
 	};
 
 	// Visit each scene node in the given volume using the given walker class, even hidden ones
@@ -118,6 +140,26 @@ public:
 typedef std::shared_ptr<Graph> GraphPtr;
 typedef std::weak_ptr<Graph> GraphWeakPtr;
 
+// Collects all bounds changes of the given graph during the lifetime of this object
+// to process them in a single batch, see Graph::beginBoundsChangeBatch()
+class ScopedBoundsChangeBatch
+{
+private:
+	Graph& _graph;
+
+public:
+	ScopedBoundsChangeBatch(Graph& graph) :
+		_graph(graph)
+	{
+		_graph.beginBoundsChangeBatch();
+	}
+
+	~ScopedBoundsChangeBatch()
+	{
+		_graph.endBoundsChangeBatch();
+	}
+};
+
 class Cloneable
 {
 public:
@@ -11,6 +11,8 @@
 
 #include <ostream>
 #include <vector>
+#include <chrono>
+#include <functional>
 
 #include "Texture.h"
 #include "ishaderlayer.h"
@@ -645,6 +647,31 @@ public:
 
     // Reload the textures used by the active shaders
     virtual void reloadImages() = 0;
+
+    /**
+     * Image maps are decoded on worker threads, their textures show a placeholder
+     * until the decoded image has been uploaded to OpenGL. This uploads the images
+     * which are ready, spending at most the given time (at least one image is
+     * uploaded per call). Must be called with the shared GL context being current,
+     * the render system does this at the start of each frame.
+     *
+     * Returns true if any texture has been uploaded, more images might be ready.
+     */
+    virtual bool uploadPendingTextures(std::chrono::milliseconds budget) = 0;
+
+    // A function running the given action on the main thread
+    using MainThreadDispatcher = std::function<void(const std::function<void()>&)>;
+
+    /**
+     * Sets the dispatcher used to announce images decoded in the background on
+     * the main thread, pass an empty function to unset it. Without a dispatcher
+     * the decoded images are only uploaded when the views are redrawn anyway.
+     */
+    virtual void setMainThreadDispatcher(const MainThreadDispatcher& dispatcher) = 0;
+
+    // Emitted on the main thread after images have been decoded in the background,
+    // their dimensions are known and they're ready to be uploaded
+    virtual sigc::signal<void>& signal_texturesDecoded() = 0;
 };
 
 inline IMaterialManager& GlobalMaterialManager()
@@ -1,7 +1,7 @@
 #ifndef _ISPACE_PARTITION_H_
 #define _ISPACE_PARTITION_H_
 
-#include <list>
+#include <cstddef>
 #include <vector>
 #include "imodule.h"
 
@@ -15,10 +15,6 @@ namespace scene
 class INode;
 typedef std::shared_ptr<INode> INodePtr;
 
-class ISPNode;
-typedef std::shared_ptr<ISPNode> ISPNodePtr;
-typedef std::weak_ptr<ISPNode> ISPNodeWeakPtr;
-
 /**
  * greebo: This is the abstract definition of a SpacePartition node.
  *
@@ -34,34 +30,36 @@ typedef std::weak_ptr<ISPNode> ISPNodeWeakPtr;
  * It is the task of the ISpacePartitionSystem to allocate and manage these nodes.
  * scene::INodes are "linked" to the correct ISPNodes through the ISPacePartition's
  * link() methods - and are unlinked through the unlink() method of the latter.
+ *
+ * ISPNodes are owned by the ISpacePartitionSystem, references to them are only
+ * valid until the next link/unlink operation.
  */
 class ISPNode
 {
 public:
 	virtual ~ISPNode() {}
 
-	// The child nodes
-	typedef std::vector<ISPNodePtr> NodeList;
-
 	// The members
-	typedef std::list<INodePtr> MemberList;
+	typedef std::vector<INodePtr> MemberList;
 
 	// Get the parent node (can be NULL for the root node)
-	virtual ISPNodePtr getParent() const = 0;
+	virtual const ISPNode* getParent() const = 0;
 
 	// The maximum bounds of this node
 	virtual const AABB& getBounds() const = 0;
 
-	// The child nodes of this node (either 8 or 0)
-	virtual const NodeList& getChildNodes() const = 0;
+	// The number of child nodes of this node
+	virtual std::size_t getNumChildNodes() const = 0;
+
+	// Returns the child node with the given index in the range [0..getNumChildNodes())
+	virtual const ISPNode& getChildNode(std::size_t index) const = 0;
 
 	// Returns true if no more child nodes are below this one
 	virtual bool isLeaf() const = 0;
 
-	// Get a list of members
+	// Get a list of members, in no particular order
 	virtual const MemberList& getMembers() const = 0;
 };
-typedef std::shared_ptr<ISPNode> ISPNodePtr;
 
 /**
  * greebo: The SpacePartitionSystem interface is a simple one. All it needs
@@ -88,8 +86,13 @@ public:
 	// (node had been linked before)
 	virtual bool unlink(const scene::INodePtr& sceneNode) = 0;
 
+	// Moves an already linked node to the place matching its current bounds,
+	// to be called after the bounds of the node changed. Equivalent to an unlink()
+	// followed by link(), but usually cheaper. Returns false if the node was not linked.
+	virtual bool relink(const scene::INodePtr& sceneNode) = 0;
+
 	// Returns the root node of this SP tree (the largest one, encompassing everything)
-	virtual ISPNodePtr getRoot() const = 0;
+	virtual const ISPNode& getRoot() const = 0;
 };
 typedef std::shared_ptr<ISpacePartitionSystem> ISpacePartitionSystemPtr;
 
@@ -18,6 +18,14 @@ class IUndoMemento
 {
 public:
     virtual ~IUndoMemento() {}
+
+    // Returns the approximate number of bytes occupied by this memento, used to
+    // report the memory consumption of the undo history. Mementos holding
+    // more than a few bytes should override this to include their data.
+    virtual std::size_t getMemoryUsage() const
+    {
+        return sizeof(IUndoMemento);
+    }
 };
 typedef std::shared_ptr<IUndoMemento> IUndoMementoPtr;
 
@@ -42,6 +50,17 @@ public:
     // May be used by Undoable objects to perform a post-undo cleanup.
     virtual void onOperationRestored()
     {}
+
+    // Optional method invoked when the operation holding the given memento
+    // (as returned by exportState()) has been recorded. The Undoable may return
+    // a more compact memento storing just the parts differing from its current
+    // state, or an empty pointer if nothing has changed at all.
+    // The returned memento is passed to importState() at a time the Undoable
+    // is back in its current state, since operations are restored in order.
+    virtual IUndoMementoPtr getStateDelta(const IUndoMementoPtr& state) const
+    {
+        return state;
+    }
 };
 
 /**
@@ -86,6 +105,10 @@ public:
 	// it immediately from the stack, therefore it never existed.
 	virtual void cancel() = 0;
 
+	// Returns the approximate number of bytes occupied by the
+	// recorded undo and redo operations
+	virtual std::size_t getMemoryUsage() const = 0;
+
     enum class EventType
     {
         OperationRecorded,
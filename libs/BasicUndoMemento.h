@@ -1,10 +1,98 @@
 #pragma once
 
 #include "iundo.h"
+#include "inode.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace undo
 {
 
+namespace detail
+{
+
+// Rough number of bytes occupied by a scene node including its attached
+// data (brush faces, windings, render objects, key values)
+constexpr std::size_t ESTIMATED_NODE_SIZE = 2048;
+
+// Returns the approximate number of bytes a value is holding on the heap,
+// in addition to its own sizeof(). Plain values don't hold anything.
+template<typename T>
+inline std::size_t getPayloadSize(const T&)
+{
+	return 0;
+}
+
+template<typename T>
+inline std::size_t getPayloadSize(const std::shared_ptr<T>& ptr);
+
+template<typename First, typename Second>
+inline std::size_t getPayloadSize(const std::pair<First, Second>& pair);
+
+template<typename T>
+inline std::size_t getPayloadSize(const std::vector<T>& vector);
+
+template<typename T>
+inline std::size_t getPayloadSize(const std::list<T>& list);
+
+inline std::size_t getPayloadSize(const std::string& str)
+{
+	// Short strings are stored in place
+	return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+}
+
+// A node which is referenced by nothing but the memento (e.g. after it has been
+// deleted from the scene) is kept alive by it, which is counted as a whole
+inline std::size_t getPayloadSize(const scene::INodePtr& node)
+{
+	return node && node.use_count() == 1 ? ESTIMATED_NODE_SIZE : 0;
+}
+
+template<typename T>
+inline std::size_t getPayloadSize(const std::shared_ptr<T>& ptr)
+{
+	return ptr && ptr.use_count() == 1 ? sizeof(T) + getPayloadSize(*ptr) : 0;
+}
+
+template<typename First, typename Second>
+inline std::size_t getPayloadSize(const std::pair<First, Second>& pair)
+{
+	return getPayloadSize(pair.first) + getPayloadSize(pair.second);
+}
+
+template<typename T>
+inline std::size_t getPayloadSize(const std::vector<T>& vector)
+{
+	std::size_t size = vector.capacity() * sizeof(T);
+
+	for (const auto& element : vector)
+	{
+		size += getPayloadSize(element);
+	}
+
+	return size;
+}
+
+template<typename T>
+inline std::size_t getPayloadSize(const std::list<T>& list)
+{
+	// Each list node is holding two extra pointers
+	std::size_t size = list.size() * (sizeof(T) + 2 * sizeof(void*));
+
+	for (const auto& element : list)
+	{
+		size += getPayloadSize(element);
+	}
+
+	return size;
+}
+
+} // namespace
+
 /**
  * An UndoMemento implementation capable of holding a single
  * copyable object, which is stored by value.
@@ -23,6 +111,11 @@ public:
 	{
 		return _data;
 	}
+
+	std::size_t getMemoryUsage() const override
+	{
+		return sizeof(BasicUndoMemento) + detail::getPayloadSize(_data);
+	}
 };
 
 } // namespace
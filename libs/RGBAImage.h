@@ -58,10 +58,22 @@ public:
     {
 		GLuint textureNum;
 
-        debug::assertNoGlErrors();
-
 		// Allocate a new texture number and store it into the Texture structure
 		glGenTextures(1, &textureNum);
+		uploadTexture(textureNum, role, 0);
+
+        // Construct texture object
+        BasicTexture2DPtr tex2DObject(new BasicTexture2D(textureNum, name));
+        tex2DObject->setWidth(getWidth());
+        tex2DObject->setHeight(getHeight());
+
+		return tex2DObject;
+	}
+
+    bool uploadTexture(GLuint textureNum, Role role, std::size_t /* skipLevels */) const override
+    {
+        debug::assertNoGlErrors();
+
 		glBindTexture(GL_TEXTURE_2D, textureNum);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -81,14 +93,9 @@ public:
         // Un-bind the texture
 		glBindTexture(GL_TEXTURE_2D, 0);
 
-        // Construct texture object
-        BasicTexture2DPtr tex2DObject(new BasicTexture2D(textureNum, name));
-        tex2DObject->setWidth(getWidth());
-        tex2DObject->setHeight(getHeight());
-
         debug::assertNoGlErrors();
 
-		return tex2DObject;
+		return true;
 	}
 
 	bool isPrecompressed() const override
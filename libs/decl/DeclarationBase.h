@@ -162,7 +162,8 @@ protected:
         try
         {
             // Set up a tokeniser to let the subclass implementation parse the contents
-            parser::BasicDefTokeniser<std::string> tokeniser(getBlockSyntax().contents,
+            // The buffer tokeniser references the block contents without copying the tokens' characters
+            parser::BasicDefTokeniser<std::string_view> tokeniser(getBlockSyntax().contents,
                 getWhitespaceDelimiters(), getKeptDelimiters());
             parseFromTokens(tokeniser);
         }
@@ -0,0 +1,1014 @@
+#pragma once
+
+#include <cmath>
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Pixel processing kernels working on RGBA8 images, used by the TextureManipulator
+ * and the map expressions (heightmap, addnormals, scale, etc.).
+ *
+ * Each kernel has a scalar implementation and, on builds targeting SSE2
+ * (which every x86-64 CPU supports), a vectorised implementation producing
+ * exactly the same output. The implementation is picked at runtime, see
+ * setInstructionSet(). All kernels expect tightly packed pixel rows.
+ */
+namespace image
+{
+
+namespace kernels
+{
+
+enum class InstructionSet
+{
+    Scalar,
+    SSE2,
+};
+
+// The best instruction set supported by this build
+inline InstructionSet getSupportedInstructionSet()
+{
+#ifdef IMAGE_KERNELS_SSE2
+    return InstructionSet::SSE2;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
+
+namespace detail
+{
+
+inline std::atomic<InstructionSet>& activeInstructionSet()
+{
+    static std::atomic<InstructionSet> _instructionSet(getSupportedInstructionSet());
+    return _instructionSet;
+}
+
+inline bool useSSE2()
+{
+    return activeInstructionSet().load(std::memory_order_relaxed) == InstructionSet::SSE2;
+}
+
+} // namespace
+
+inline InstructionSet getInstructionSet()
+{
+    return detail::activeInstructionSet().load();
+}
+
+// Selects the kernel implementation, an instruction set not supported by this
+// build falls back to the scalar kernels. Used to compare the implementations.
+inline void setInstructionSet(InstructionSet instructionSet)
+{
+    detail::activeInstructionSet().store(
+        instructionSet == InstructionSet::SSE2 ? getSupportedInstructionSet() : InstructionSet::Scalar);
+}
+
+namespace scalar
+{
+
+inline void blendRows(const uint8_t* row1, const uint8_t* row2, uint8_t* out, std::size_t numBytes, std::size_t lerp)
+{
+    for (std::size_t i = 0; i < numBytes; ++i)
+    {
+        out[i] = static_cast<uint8_t>((((row2[i] - row1[i]) * lerp) >> 16) + row1[i]);
+    }
+}
+
+// Continues a line started by lerpLine() at the given output pixel and position
+inline void lerpLine(const uint8_t* in, uint8_t* out, std::size_t outWidth, std::size_t endx,
+    std::size_t fstep, std::size_t j, std::size_t f)
+{
+    for (; j < outWidth; ++j, f += fstep)
+    {
+        auto xi = f >> 16;
+        const auto* pixel = in + xi * 4;
+        auto* target = out + j * 4;
+
+        if (xi < endx)
+        {
+            std::size_t lerp = f & 0xFFFF;
+            target[0] = static_cast<uint8_t>((((pixel[4] - pixel[0]) * lerp) >> 16) + pixel[0]);
+            target[1] = static_cast<uint8_t>((((pixel[5] - pixel[1]) * lerp) >> 16) + pixel[1]);
+            target[2] = static_cast<uint8_t>((((pixel[6] - pixel[2]) * lerp) >> 16) + pixel[2]);
+            target[3] = static_cast<uint8_t>((((pixel[7] - pixel[3]) * lerp) >> 16) + pixel[3]);
+        }
+        else // last pixel of the line has no pixel to lerp to
+        {
+            target[0] = pixel[0];
+            target[1] = pixel[1];
+            target[2] = pixel[2];
+            target[3] = pixel[3];
+        }
+    }
+}
+
+inline void lerpLine(const uint8_t* in, uint8_t* out, std::size_t inWidth, std::size_t outWidth)
+{
+    auto fstep = static_cast<std::size_t>(inWidth * 65536.0f / outWidth);
+    lerpLine(in, out, outWidth, inWidth - 1, fstep, 0, 0);
+}
+
+inline void mipReduce(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height,
+    bool reduceWidth, bool reduceHeight)
+{
+    std::size_t nextrow = width << 2;
+
+    if (reduceWidth && reduceHeight)
+    {
+        for (std::size_t y = 0; y < (height >> 1); ++y)
+        {
+            for (std::size_t x = 0; x < (width >> 1); ++x)
+            {
+                out[0] = static_cast<uint8_t>((in[0] + in[4] + in[nextrow    ] + in[nextrow + 4]) >> 2);
+                out[1] = static_cast<uint8_t>((in[1] + in[5] + in[nextrow + 1] + in[nextrow + 5]) >> 2);
+                out[2] = static_cast<uint8_t>((in[2] + in[6] + in[nextrow + 2] + in[nextrow + 6]) >> 2);
+                out[3] = static_cast<uint8_t>((in[3] + in[7] + in[nextrow + 3] + in[nextrow + 7]) >> 2);
+                out += 4;
+                in += 8;
+            }
+            in += nextrow; // skip a line
+        }
+    }
+    else if (reduceWidth)
+    {
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < (width >> 1); ++x)
+            {
+                out[0] = static_cast<uint8_t>((in[0] + in[4]) >> 1);
+                out[1] = static_cast<uint8_t>((in[1] + in[5]) >> 1);
+                out[2] = static_cast<uint8_t>((in[2] + in[6]) >> 1);
+                out[3] = static_cast<uint8_t>((in[3] + in[7]) >> 1);
+                out += 4;
+                in += 8;
+            }
+        }
+    }
+    else if (reduceHeight)
+    {
+        for (std::size_t y = 0; y < (height >> 1); ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+            {
+                out[0] = static_cast<uint8_t>((in[0] + in[nextrow    ]) >> 1);
+                out[1] = static_cast<uint8_t>((in[1] + in[nextrow + 1]) >> 1);
+                out[2] = static_cast<uint8_t>((in[2] + in[nextrow + 2]) >> 1);
+                out[3] = static_cast<uint8_t>((in[3] + in[nextrow + 3]) >> 1);
+                out += 4;
+                in += 4;
+            }
+            in += nextrow; // skip a line
+        }
+    }
+}
+
+inline void applyGammaTable(uint8_t* pixels, std::size_t numPixels, const uint8_t* table)
+{
+    for (std::size_t i = 0; i < numPixels * 4; i += 4)
+    {
+        pixels[i    ] = table[pixels[i    ]];
+        pixels[i + 1] = table[pixels[i + 1]];
+        pixels[i + 2] = table[pixels[i + 2]];
+    }
+}
+
+inline void scaleChannels(const uint8_t* in, uint8_t* out, std::size_t numPixels,
+    float red, float green, float blue, float alpha)
+{
+    const float scale[4] = { red, green, blue, alpha };
+
+    for (std::size_t i = 0; i < numPixels * 4; ++i)
+    {
+        // Negative scales are rejected by the caller, only check for values >255
+        auto value = static_cast<int>(std::lrint(static_cast<float>(in[i]) * scale[i & 3]));
+        out[i] = value > 255 ? 255 : static_cast<uint8_t>(value);
+    }
+}
+
+inline void addChannels(const uint8_t* in1, const uint8_t* in2, uint8_t* out, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels * 4; ++i)
+    {
+        out[i] = static_cast<uint8_t>(std::lrint((static_cast<float>(in1[i]) + in2[i]) * 0.5f));
+    }
+}
+
+inline void addNormals(const uint8_t* in1, const uint8_t* in2, uint8_t* out, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels * 4; i += 4)
+    {
+        // Take the mean value of the two vectors
+        out[i    ] = static_cast<uint8_t>(std::lrint((static_cast<double>(in1[i    ]) + in2[i    ]) * 0.5));
+        out[i + 1] = static_cast<uint8_t>(std::lrint((static_cast<double>(in1[i + 1]) + in2[i + 1]) * 0.5));
+        out[i + 2] = static_cast<uint8_t>(std::lrint((static_cast<double>(in1[i + 2]) + in2[i + 2]) * 0.5));
+        out[i + 3] = 255;
+    }
+}
+
+inline void invertColour(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels * 4; i += 4)
+    {
+        out[i    ] = 255 - in[i    ];
+        out[i + 1] = 255 - in[i + 1];
+        out[i + 2] = 255 - in[i + 2];
+        out[i + 3] = in[i + 3];
+    }
+}
+
+inline void invertAlpha(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels * 4; i += 4)
+    {
+        out[i    ] = in[i    ];
+        out[i + 1] = in[i + 1];
+        out[i + 2] = in[i + 2];
+        out[i + 3] = 255 - in[i + 3];
+    }
+}
+
+inline void makeIntensity(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels * 4; i += 4)
+    {
+        out[i    ] = in[i];
+        out[i + 1] = in[i];
+        out[i + 2] = in[i];
+        out[i + 3] = in[i];
+    }
+}
+
+inline void makeAlpha(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels * 4; i += 4)
+    {
+        out[i    ] = 255;
+        out[i + 1] = 255;
+        out[i + 2] = 255;
+        out[i + 3] = static_cast<uint8_t>((in[i] + in[i + 1] + in[i + 2]) / 3);
+    }
+}
+
+// Writes the normal for the given height gradient
+inline void writeNormal(uint8_t* out, float du, float dv, float scale)
+{
+    float nx = -du * scale;
+    float ny = -dv * scale;
+    float nz = 1.0f;
+
+    // Normalize
+    float norm = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+    out[0] = static_cast<uint8_t>(std::lrint(((nx * norm) + 1) * 127.5));
+    out[1] = static_cast<uint8_t>(std::lrint(((ny * norm) + 1) * 127.5));
+    out[2] = static_cast<uint8_t>(std::lrint(((nz * norm) + 1) * 127.5));
+    out[3] = 255;
+}
+
+// Converts the heightmap in the red channel to a normalmap at the given pixel,
+// using a 3x3 Prewitt filter. The neighbours wrap around at the borders.
+inline void heightmapToNormal(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height,
+    std::size_t x, std::size_t y, float scale)
+{
+    auto red = [&](std::size_t dx, std::size_t dy)
+    {
+        // dx and dy are in the range [0..2] for offsets of [-1..1]
+        return in[((((y + dy + height - 1) % height) * width) + ((x + dx + width - 1) % width)) * 4] / 255.0f;
+    };
+
+    // if you want to understand the code below, read http://en.wikipedia.org/wiki/Edge_detection
+    float du = 0;
+    du += red(0, 2) * -1.0f;
+    du += red(0, 1) * -1.0f;
+    du += red(0, 0) * -1.0f;
+    du += red(2, 2) * 1.0f;
+    du += red(2, 1) * 1.0f;
+    du += red(2, 0) * 1.0f;
+
+    float dv = 0;
+    dv += red(0, 2) * 1.0f;
+    dv += red(1, 2) * 1.0f;
+    dv += red(2, 2) * 1.0f;
+    dv += red(0, 0) * -1.0f;
+    dv += red(1, 0) * -1.0f;
+    dv += red(2, 0) * -1.0f;
+
+    writeNormal(out + (y * width + x) * 4, du, dv, scale);
+}
+
+inline void heightmapToNormalmap(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height, float scale)
+{
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            heightmapToNormal(in, out, width, height, x, y, scale);
+        }
+    }
+}
+
+// Averages the normal at the given pixel with its 8 neighbours, wrapping around at the borders
+inline void smoothNormal(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height,
+    std::size_t x, std::size_t y)
+{
+    double sum[3] = { 0, 0, 0 };
+
+    for (std::size_t dy = 0; dy < 3; ++dy)
+    {
+        for (std::size_t dx = 0; dx < 3; ++dx)
+        {
+            const auto* pixel = in + ((((y + dy + height - 1) % height) * width) + ((x + dx + width - 1) % width)) * 4;
+
+            sum[0] += pixel[0];
+            sum[1] += pixel[1];
+            sum[2] += pixel[2];
+        }
+    }
+
+    const float perKernelSize = 1.0f / 9;
+
+    auto* target = out + (y * width + x) * 4;
+    target[0] = static_cast<uint8_t>(std::lrint(sum[0] * perKernelSize));
+    target[1] = static_cast<uint8_t>(std::lrint(sum[1] * perKernelSize));
+    target[2] = static_cast<uint8_t>(std::lrint(sum[2] * perKernelSize));
+    target[3] = 255;
+}
+
+inline void smoothNormals(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height)
+{
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            smoothNormal(in, out, width, height, x, y);
+        }
+    }
+}
+
+} // namespace scalar
+
+#ifdef IMAGE_KERNELS_SSE2
+
+namespace sse2
+{
+
+inline __m128i load(const uint8_t* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void store(uint8_t* p, __m128i value)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), value);
+}
+
+inline __m128i loadHalf(const uint8_t* p)
+{
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void storeHalf(uint8_t* p, __m128i value)
+{
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), value);
+}
+
+// Returns (difference * lerp) >> 16 for 16 bit lanes holding signed differences of
+// bytes and lerp values in [0..0xFFFF]. mulhi works on signed lanes, lerp values
+// above 0x7FFF are off by 0x10000, which needs to be compensated for.
+inline __m128i lerpDifference(__m128i difference, __m128i lerp, __m128i lerpIsLarge)
+{
+    return _mm_add_epi16(_mm_mulhi_epi16(difference, lerp), _mm_and_si128(difference, lerpIsLarge));
+}
+
+inline void blendRows(const uint8_t* row1, const uint8_t* row2, uint8_t* out, std::size_t numBytes, std::size_t lerp)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto lerpVec = _mm_set1_epi16(static_cast<short>(lerp));
+    const auto lerpIsLarge = _mm_set1_epi16(lerp > 0x7FFF ? -1 : 0);
+
+    std::size_t i = 0;
+
+    for (; i + 16 <= numBytes; i += 16)
+    {
+        auto a = load(row1 + i);
+        auto b = load(row2 + i);
+
+        auto aLow = _mm_unpacklo_epi8(a, zero);
+        auto aHigh = _mm_unpackhi_epi8(a, zero);
+
+        auto low = _mm_add_epi16(aLow, lerpDifference(_mm_sub_epi16(_mm_unpacklo_epi8(b, zero), aLow), lerpVec, lerpIsLarge));
+        auto high = _mm_add_epi16(aHigh, lerpDifference(_mm_sub_epi16(_mm_unpackhi_epi8(b, zero), aHigh), lerpVec, lerpIsLarge));
+
+        store(out + i, _mm_packus_epi16(low, high));
+    }
+
+    scalar::blendRows(row1 + i, row2 + i, out + i, numBytes - i, lerp);
+}
+
+inline void lerpLine(const uint8_t* in, uint8_t* out, std::size_t inWidth, std::size_t outWidth)
+{
+    const auto zero = _mm_setzero_si128();
+
+    auto fstep = static_cast<std::size_t>(inWidth * 65536.0f / outWidth);
+    auto endx = inWidth - 1;
+
+    std::size_t j = 0;
+    std::size_t f = 0;
+
+    // Two output pixels per iteration, as long as both have a right neighbour to lerp to
+    for (; j + 2 <= outWidth && ((f + fstep) >> 16) < endx; j += 2, f += fstep * 2)
+    {
+        auto f2 = f + fstep;
+
+        // Each load fetches the source pixel and its right neighbour
+        // which puts both source pixels in the low half and their neighbours in the high half
+        auto pixels = _mm_unpacklo_epi32(loadHalf(in + (f >> 16) * 4), loadHalf(in + (f2 >> 16) * 4));
+
+        auto left = _mm_unpacklo_epi8(pixels, zero);
+        auto right = _mm_unpackhi_epi8(pixels, zero);
+
+        auto lerp1 = static_cast<short>(f & 0xFFFF);
+        auto lerp2 = static_cast<short>(f2 & 0xFFFF);
+        auto large1 = static_cast<short>((f & 0xFFFF) > 0x7FFF ? -1 : 0);
+        auto large2 = static_cast<short>((f2 & 0xFFFF) > 0x7FFF ? -1 : 0);
+
+        auto lerp = _mm_set_epi16(lerp2, lerp2, lerp2, lerp2, lerp1, lerp1, lerp1, lerp1);
+        auto lerpIsLarge = _mm_set_epi16(large2, large2, large2, large2, large1, large1, large1, large1);
+
+        auto result = _mm_add_epi16(left, lerpDifference(_mm_sub_epi16(right, left), lerp, lerpIsLarge));
+
+        storeHalf(out + j * 4, _mm_packus_epi16(result, result));
+    }
+
+    scalar::lerpLine(in, out, outWidth, endx, fstep, j, f);
+}
+
+// Adds each pair of horizontally adjacent pixels of the two registers holding
+// two pixels each (in 16 bit lanes), returns the four sums in one register
+inline __m128i addPixelPairs(__m128i first, __m128i second)
+{
+    auto firstSum = _mm_add_epi16(first, _mm_srli_si128(first, 8));
+    auto secondSum = _mm_add_epi16(second, _mm_srli_si128(second, 8));
+
+    return _mm_unpacklo_epi64(firstSum, secondSum);
+}
+
+inline void mipReduce(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height,
+    bool reduceWidth, bool reduceHeight)
+{
+    const auto zero = _mm_setzero_si128();
+    std::size_t nextrow = width << 2;
+
+    // The output rows are written in place of the input rows that have been read already,
+    // each iteration reads its pixels before writing anything. The rows are advanced
+    // like in the scalar version, which skips width2 pixel pairs (not the full row) per row.
+    if (reduceWidth && reduceHeight)
+    {
+        std::size_t width2 = width >> 1;
+
+        for (std::size_t y = 0; y < (height >> 1); ++y)
+        {
+            const auto* row = in + y * (width2 * 8 + nextrow);
+            auto* target = out + y * width2 * 4;
+            std::size_t x = 0;
+
+            for (; x + 2 <= width2; x += 2)
+            {
+                auto upper = load(row + x * 8);
+                auto lower = load(row + x * 8 + nextrow);
+
+                auto low = _mm_add_epi16(_mm_unpacklo_epi8(upper, zero), _mm_unpacklo_epi8(lower, zero));
+                auto high = _mm_add_epi16(_mm_unpackhi_epi8(upper, zero), _mm_unpackhi_epi8(lower, zero));
+
+                auto result = _mm_srli_epi16(addPixelPairs(low, high), 2);
+                storeHalf(target + x * 4, _mm_packus_epi16(result, result));
+            }
+
+            for (; x < width2; ++x)
+            {
+                const auto* pixel = row + x * 8;
+
+                for (std::size_t c = 0; c < 4; ++c)
+                {
+                    target[x * 4 + c] = static_cast<uint8_t>(
+                        (pixel[c] + pixel[c + 4] + pixel[nextrow + c] + pixel[nextrow + c + 4]) >> 2);
+                }
+            }
+        }
+    }
+    else if (reduceWidth)
+    {
+        std::size_t width2 = width >> 1;
+
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            const auto* row = in + y * width2 * 8;
+            auto* target = out + y * width2 * 4;
+            std::size_t x = 0;
+
+            for (; x + 2 <= width2; x += 2)
+            {
+                auto pixels = load(row + x * 8);
+
+                auto result = _mm_srli_epi16(addPixelPairs(_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero)), 1);
+                storeHalf(target + x * 4, _mm_packus_epi16(result, result));
+            }
+
+            for (; x < width2; ++x)
+            {
+                const auto* pixel = row + x * 8;
+
+                for (std::size_t c = 0; c < 4; ++c)
+                {
+                    target[x * 4 + c] = static_cast<uint8_t>((pixel[c] + pixel[c + 4]) >> 1);
+                }
+            }
+        }
+    }
+    else if (reduceHeight)
+    {
+        for (std::size_t y = 0; y < (height >> 1); ++y)
+        {
+            const auto* row = in + y * 2 * nextrow;
+            auto* target = out + y * nextrow;
+            std::size_t i = 0;
+
+            for (; i + 16 <= nextrow; i += 16)
+            {
+                auto upper = load(row + i);
+                auto lower = load(row + i + nextrow);
+
+                auto low = _mm_add_epi16(_mm_unpacklo_epi8(upper, zero), _mm_unpacklo_epi8(lower, zero));
+                auto high = _mm_add_epi16(_mm_unpackhi_epi8(upper, zero), _mm_unpackhi_epi8(lower, zero));
+
+                store(target + i, _mm_packus_epi16(_mm_srli_epi16(low, 1), _mm_srli_epi16(high, 1)));
+            }
+
+            for (; i < nextrow; ++i)
+            {
+                target[i] = static_cast<uint8_t>((row[i] + row[i + nextrow]) >> 1);
+            }
+        }
+    }
+}
+
+inline void scaleChannels(const uint8_t* in, uint8_t* out, std::size_t numPixels,
+    float red, float green, float blue, float alpha)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto scale = _mm_set_ps(alpha, blue, green, red);
+
+    auto scalePixel = [&](__m128i channels)
+    {
+        // The conversion rounds to nearest even like lrint, saturation clamps the values to 255
+        return _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(channels), scale));
+    };
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= numPixels; i += 4)
+    {
+        auto pixels = load(in + i * 4);
+
+        auto low = _mm_unpacklo_epi8(pixels, zero);
+        auto high = _mm_unpackhi_epi8(pixels, zero);
+
+        auto first = _mm_packs_epi32(scalePixel(_mm_unpacklo_epi16(low, zero)), scalePixel(_mm_unpackhi_epi16(low, zero)));
+        auto second = _mm_packs_epi32(scalePixel(_mm_unpacklo_epi16(high, zero)), scalePixel(_mm_unpackhi_epi16(high, zero)));
+
+        store(out + i * 4, _mm_packus_epi16(first, second));
+    }
+
+    scalar::scaleChannels(in + i * 4, out + i * 4, numPixels - i, red, green, blue, alpha);
+}
+
+// Returns (a + b) / 2 for 16 bit lanes, rounding halves to even like lrint does
+inline __m128i averageRoundHalfEven(__m128i a, __m128i b)
+{
+    auto sum = _mm_add_epi16(a, b);
+    auto half = _mm_srli_epi16(sum, 1);
+
+    return _mm_add_epi16(half, _mm_and_si128(_mm_and_si128(sum, half), _mm_set1_epi16(1)));
+}
+
+inline void addChannels(const uint8_t* in1, const uint8_t* in2, uint8_t* out, std::size_t numPixels,
+    bool opaque)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto alphaMask = _mm_set1_epi32(opaque ? static_cast<int>(0xFF000000) : 0);
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= numPixels; i += 4)
+    {
+        auto a = load(in1 + i * 4);
+        auto b = load(in2 + i * 4);
+
+        auto low = averageRoundHalfEven(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        auto high = averageRoundHalfEven(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+        store(out + i * 4, _mm_or_si128(_mm_packus_epi16(low, high), alphaMask));
+    }
+
+    if (opaque)
+    {
+        scalar::addNormals(in1 + i * 4, in2 + i * 4, out + i * 4, numPixels - i);
+    }
+    else
+    {
+        scalar::addChannels(in1 + i * 4, in2 + i * 4, out + i * 4, numPixels - i);
+    }
+}
+
+inline void xorPixels(const uint8_t* in, uint8_t* out, std::size_t numPixels, uint32_t mask)
+{
+    const auto maskVec = _mm_set1_epi32(static_cast<int>(mask));
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= numPixels; i += 4)
+    {
+        store(out + i * 4, _mm_xor_si128(load(in + i * 4), maskVec));
+    }
+
+    for (; i < numPixels; ++i)
+    {
+        for (std::size_t c = 0; c < 4; ++c)
+        {
+            out[i * 4 + c] = in[i * 4 + c] ^ static_cast<uint8_t>(mask >> (c * 8));
+        }
+    }
+}
+
+inline void makeIntensity(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+    const auto redMask = _mm_set1_epi32(0xFF);
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= numPixels; i += 4)
+    {
+        auto red = _mm_and_si128(load(in + i * 4), redMask);
+        red = _mm_or_si128(red, _mm_slli_epi32(red, 8));
+        red = _mm_or_si128(red, _mm_slli_epi32(red, 16));
+
+        store(out + i * 4, red);
+    }
+
+    scalar::makeIntensity(in + i * 4, out + i * 4, numPixels - i);
+}
+
+inline void makeAlpha(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto byteMask = _mm_set1_epi32(0xFF);
+    const auto white = _mm_set1_epi32(0x00FFFFFF);
+
+    // floor(sum / 3) == (sum * 0xAAAB) >> 17 for all sums up to 765
+    const auto oneThird = _mm_set1_epi16(static_cast<short>(0xAAAB));
+
+    auto sumChannels = [&](__m128i pixels)
+    {
+        auto sum = _mm_and_si128(pixels, byteMask);
+        sum = _mm_add_epi32(sum, _mm_and_si128(_mm_srli_epi32(pixels, 8), byteMask));
+        return _mm_add_epi32(sum, _mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask));
+    };
+
+    std::size_t i = 0;
+
+    for (; i + 8 <= numPixels; i += 8)
+    {
+        auto sums = _mm_packs_epi32(sumChannels(load(in + i * 4)), sumChannels(load(in + i * 4 + 16)));
+        auto averages = _mm_srli_epi16(_mm_mulhi_epu16(sums, oneThird), 1);
+
+        store(out + i * 4, _mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(averages, zero), 24), white));
+        store(out + i * 4 + 16, _mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(averages, zero), 24), white));
+    }
+
+    scalar::makeAlpha(in + i * 4, out + i * 4, numPixels - i);
+}
+
+inline void heightmapToNormalmap(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height, float scale)
+{
+    const auto redMask = _mm_set1_epi32(0xFF);
+    const auto toUnit = _mm_set1_ps(255.0f);
+    const auto negativeOne = _mm_set1_ps(-1.0f);
+    const auto positiveOne = _mm_set1_ps(1.0f);
+    const auto signBit = _mm_set1_ps(-0.0f);
+    const auto scaleVec = _mm_set1_ps(scale);
+    const auto halfRange = _mm_set1_pd(127.5);
+    const auto opaque = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+    // Heights of four consecutive pixels, divided by 255 like the scalar code does
+    auto heights = [&](const uint8_t* pixels)
+    {
+        return _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(load(pixels), redMask)), toUnit);
+    };
+
+    // ((n * norm) + 1) * 127.5 rounded to integers, the last step is done in double precision
+    auto toByte = [&](__m128 n)
+    {
+        auto lowHalf = _mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtps_pd(n), halfRange));
+        auto highHalf = _mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(n, n)), halfRange));
+        return _mm_unpacklo_epi64(lowHalf, highHalf);
+    };
+
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        const auto* above = in + ((y + height - 1) % height) * width * 4;
+        const auto* below = in + ((y + 1) % height) * width * 4;
+
+        std::size_t x = 0;
+
+        // The border pixels are wrapping around, they're processed by the scalar code
+        if (width > 0)
+        {
+            scalar::heightmapToNormal(in, out, width, height, x++, y, scale);
+        }
+
+        for (; x + 4 < width; x += 4)
+        {
+            auto leftAbove = heights(above + (x - 1) * 4);
+            auto centreAbove = heights(above + x * 4);
+            auto rightAbove = heights(above + (x + 1) * 4);
+            auto leftBelow = heights(below + (x - 1) * 4);
+            auto centreBelow = heights(below + x * 4);
+            auto rightBelow = heights(below + (x + 1) * 4);
+            auto left = heights(in + (y * width + x - 1) * 4);
+            auto right = heights(in + (y * width + x + 1) * 4);
+
+            // Same order of operations as the scalar code to get the same rounding
+            auto du = _mm_setzero_ps();
+            du = _mm_add_ps(du, _mm_mul_ps(leftBelow, negativeOne));
+            du = _mm_add_ps(du, _mm_mul_ps(left, negativeOne));
+            du = _mm_add_ps(du, _mm_mul_ps(leftAbove, negativeOne));
+            du = _mm_add_ps(du, _mm_mul_ps(rightBelow, positiveOne));
+            du = _mm_add_ps(du, _mm_mul_ps(right, positiveOne));
+            du = _mm_add_ps(du, _mm_mul_ps(rightAbove, positiveOne));
+
+            auto dv = _mm_setzero_ps();
+            dv = _mm_add_ps(dv, _mm_mul_ps(leftBelow, positiveOne));
+            dv = _mm_add_ps(dv, _mm_mul_ps(centreBelow, positiveOne));
+            dv = _mm_add_ps(dv, _mm_mul_ps(rightBelow, positiveOne));
+            dv = _mm_add_ps(dv, _mm_mul_ps(leftAbove, negativeOne));
+            dv = _mm_add_ps(dv, _mm_mul_ps(centreAbove, negativeOne));
+            dv = _mm_add_ps(dv, _mm_mul_ps(rightAbove, negativeOne));
+
+            auto nx = _mm_mul_ps(_mm_xor_ps(du, signBit), scaleVec);
+            auto ny = _mm_mul_ps(_mm_xor_ps(dv, signBit), scaleVec);
+            auto nz = positiveOne;
+
+            auto lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+            auto norm = _mm_div_ps(positiveOne, _mm_sqrt_ps(lengthSquared));
+
+            auto red = toByte(_mm_add_ps(_mm_mul_ps(nx, norm), positiveOne));
+            auto green = toByte(_mm_add_ps(_mm_mul_ps(ny, norm), positiveOne));
+            auto blue = toByte(_mm_add_ps(_mm_mul_ps(nz, norm), positiveOne));
+
+            auto pixels = _mm_or_si128(red, _mm_slli_epi32(green, 8));
+            pixels = _mm_or_si128(pixels, _mm_slli_epi32(blue, 16));
+
+            store(out + (y * width + x) * 4, _mm_or_si128(pixels, opaque));
+        }
+
+        for (; x < width; ++x)
+        {
+            scalar::heightmapToNormal(in, out, width, height, x, y, scale);
+        }
+    }
+}
+
+inline void smoothNormals(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height)
+{
+    if (width < 4)
+    {
+        scalar::smoothNormals(in, out, width, height);
+        return;
+    }
+
+    const auto zero = _mm_setzero_si128();
+    const auto rounding = _mm_set1_epi16(4);
+
+    // round(sum / 9) == ((sum + 4) * 7282) >> 16 for all sums up to 2295
+    const auto oneNinth = _mm_set1_epi16(7282);
+    const auto opaque = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    const auto colourMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+    // The sums of each pixel with its left and right neighbour, per channel
+    std::size_t rowLength = width * 4;
+    std::vector<uint16_t> rowSums(rowLength * 3);
+
+    auto calculateRowSums = [&](std::size_t y, uint16_t* sums)
+    {
+        const auto* row = in + y * rowLength;
+
+        for (std::size_t c = 0; c < 4; ++c)
+        {
+            sums[c] = row[rowLength - 4 + c] + row[c] + row[4 + c];
+            sums[rowLength - 4 + c] = row[rowLength - 8 + c] + row[rowLength - 4 + c] + row[c];
+        }
+
+        std::size_t x = 1;
+
+        for (; x + 3 <= width; x += 2)
+        {
+            auto left = _mm_unpacklo_epi8(loadHalf(row + (x - 1) * 4), zero);
+            auto centre = _mm_unpacklo_epi8(loadHalf(row + x * 4), zero);
+            auto right = _mm_unpacklo_epi8(loadHalf(row + (x + 1) * 4), zero);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + x * 4), _mm_add_epi16(_mm_add_epi16(left, centre), right));
+        }
+
+        for (; x + 1 < width; ++x)
+        {
+            for (std::size_t c = 0; c < 4; ++c)
+            {
+                sums[x * 4 + c] = row[(x - 1) * 4 + c] + row[x * 4 + c] + row[(x + 1) * 4 + c];
+            }
+        }
+    };
+
+    auto* above = rowSums.data();
+    auto* centre = above + rowLength;
+    auto* below = centre + rowLength;
+
+    calculateRowSums(height - 1, above);
+    calculateRowSums(0, centre);
+
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        // Move the window down by one row, only the row below is new
+        if (y > 0)
+        {
+            std::swap(above, centre);
+            std::swap(centre, below);
+        }
+
+        calculateRowSums((y + 1) % height, below);
+
+        auto* target = out + y * rowLength;
+        std::size_t i = 0;
+
+        for (; i + 8 <= rowLength; i += 8)
+        {
+            auto sum = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(centre + i)));
+            sum = _mm_add_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i)));
+
+            auto average = _mm_mulhi_epu16(_mm_add_epi16(sum, rounding), oneNinth);
+            average = _mm_or_si128(_mm_and_si128(average, colourMask), opaque);
+
+            storeHalf(target + i, _mm_packus_epi16(average, average));
+        }
+
+        for (; i < rowLength; i += 4)
+        {
+            scalar::smoothNormal(in, out, width, height, i / 4, y);
+        }
+    }
+}
+
+} // namespace sse2
+
+#endif
+
+/**
+ * Blends two rows of bytes: out = row1 + (row2 - row1) * lerp / 65536,
+ * with lerp in the range [0..0xFFFF]. Used for the vertical part of resampling.
+ */
+inline void blendRows(const uint8_t* row1, const uint8_t* row2, uint8_t* out, std::size_t numBytes, std::size_t lerp)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::blendRows(row1, row2, out, numBytes, lerp);
+#endif
+    scalar::blendRows(row1, row2, out, numBytes, lerp);
+}
+
+// Resamples a line of RGBA pixels to the given width, linearly interpolating neighbouring pixels
+inline void lerpLine(const uint8_t* in, uint8_t* out, std::size_t inWidth, std::size_t outWidth)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::lerpLine(in, out, inWidth, outWidth);
+#endif
+    scalar::lerpLine(in, out, inWidth, outWidth);
+}
+
+/**
+ * Halves the width and/or height of the RGBA image by averaging 2x2, 2x1 or 1x2 pixel
+ * boxes. The output can be written to the input buffer.
+ */
+inline void mipReduce(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height,
+    bool reduceWidth, bool reduceHeight)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::mipReduce(in, out, width, height, reduceWidth, reduceHeight);
+#endif
+    scalar::mipReduce(in, out, width, height, reduceWidth, reduceHeight);
+}
+
+/**
+ * Maps the RGB channels through the given 256-entry table, alpha is untouched.
+ * Table lookups have no SSE2 equivalent, this is always using the scalar code.
+ */
+inline void applyGammaTable(uint8_t* pixels, std::size_t numPixels, const uint8_t* table)
+{
+    scalar::applyGammaTable(pixels, numPixels, table);
+}
+
+// Multiplies each channel with the given non-negative factor, clamping at 255
+inline void scaleChannels(const uint8_t* in, uint8_t* out, std::size_t numPixels,
+    float red, float green, float blue, float alpha)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::scaleChannels(in, out, numPixels, red, green, blue, alpha);
+#endif
+    scalar::scaleChannels(in, out, numPixels, red, green, blue, alpha);
+}
+
+// Averages the channels of the two images
+inline void addChannels(const uint8_t* in1, const uint8_t* in2, uint8_t* out, std::size_t numPixels)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::addChannels(in1, in2, out, numPixels, false);
+#endif
+    scalar::addChannels(in1, in2, out, numPixels);
+}
+
+// Averages the normal vectors of the two images, the output is opaque
+inline void addNormals(const uint8_t* in1, const uint8_t* in2, uint8_t* out, std::size_t numPixels)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::addChannels(in1, in2, out, numPixels, true);
+#endif
+    scalar::addNormals(in1, in2, out, numPixels);
+}
+
+inline void invertColour(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::xorPixels(in, out, numPixels, 0x00FFFFFF);
+#endif
+    scalar::invertColour(in, out, numPixels);
+}
+
+inline void invertAlpha(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::xorPixels(in, out, numPixels, 0xFF000000);
+#endif
+    scalar::invertAlpha(in, out, numPixels);
+}
+
+// Copies the red channel to all four channels
+inline void makeIntensity(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::makeIntensity(in, out, numPixels);
+#endif
+    scalar::makeIntensity(in, out, numPixels);
+}
+
+// Produces white pixels with the average of the RGB channels as alpha
+inline void makeAlpha(const uint8_t* in, uint8_t* out, std::size_t numPixels)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::makeAlpha(in, out, numPixels);
+#endif
+    scalar::makeAlpha(in, out, numPixels);
+}
+
+/**
+ * Converts the heightmap stored in the red channel into an opaque normalmap,
+ * using a 3x3 Prewitt filter. The input and output buffers must not overlap.
+ */
+inline void heightmapToNormalmap(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height, float scale)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::heightmapToNormalmap(in, out, width, height, scale);
+#endif
+    scalar::heightmapToNormalmap(in, out, width, height, scale);
+}
+
+/**
+ * Averages each normal with its 8 neighbours, wrapping around at the borders.
+ * The output is opaque, input and output buffers must not overlap.
+ */
+inline void smoothNormals(const uint8_t* in, uint8_t* out, std::size_t width, std::size_t height)
+{
+#ifdef IMAGE_KERNELS_SSE2
+    if (detail::useSSE2()) return sse2::smoothNormals(in, out, width, height);
+#endif
+    scalar::smoothNormals(in, out, width, height);
+}
+
+} // namespace kernels
+
+} // namespace image
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include "util/Noncopyable.h"
+
+#ifdef WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace os
+{
+
+/**
+ * Read-only memory mapping of a file on disk. The whole file is mapped
+ * on construction and unmapped on destruction, the data pointer stays
+ * valid for the lifetime of this object.
+ *
+ * Check failed() after construction, empty files can't be mapped either.
+ *
+ * The data is not null-terminated. The mapping is private, but changes to the
+ * file on disk might still show through. If the file is truncated while it's mapped,
+ * accessing the pages past the new end raises SIGBUS on POSIX systems, so keep
+ * instances around only as long as the data is being parsed.
+ */
+class MappedFile :
+    public util::Noncopyable
+{
+private:
+    const unsigned char* _data;
+    std::size_t _size;
+
+#ifdef WIN32
+    HANDLE _mapping;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path) :
+        _data(nullptr),
+        _size(0)
+#ifdef WIN32
+        , _mapping(nullptr)
+#endif
+    {
+#ifdef WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER size;
+
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+            if (_mapping != nullptr)
+            {
+                _data = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+                _size = _data != nullptr ? static_cast<std::size_t>(size.QuadPart) : 0;
+            }
+        }
+
+        // The mapping keeps its own reference to the file
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd == -1) return;
+
+        struct stat st;
+
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            void* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+                // Clients are usually parsing the data front to back
+                ::madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+
+                _data = static_cast<const unsigned char*>(data);
+                _size = static_cast<std::size_t>(st.st_size);
+            }
+        }
+
+        // The mapping stays valid after closing the descriptor
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef WIN32
+        if (_data != nullptr)
+        {
+            UnmapViewOfFile(_data);
+        }
+
+        if (_mapping != nullptr)
+        {
+            CloseHandle(_mapping);
+        }
+#else
+        if (_data != nullptr)
+        {
+            ::munmap(const_cast<unsigned char*>(_data), _size);
+        }
+#endif
+    }
+
+    bool failed() const
+    {
+        return _data == nullptr;
+    }
+
+    const unsigned char* data() const
+    {
+        return _data;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+};
+
+}
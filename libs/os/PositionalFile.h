@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "util/Noncopyable.h"
+
+#ifdef WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace os
+{
+
+/**
+ * Read-only file handle supporting reads at arbitrary offsets. There is no
+ * shared file position, so several threads can read from the same instance
+ * at the same time without having to lock each other out.
+ *
+ * Check failed() after construction.
+ */
+class PositionalFile :
+    public util::Noncopyable
+{
+private:
+#ifdef WIN32
+    HANDLE _file;
+#else
+    int _fd;
+#endif
+
+public:
+    explicit PositionalFile(const std::string& path)
+    {
+#ifdef WIN32
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+#else
+        _fd = ::open(path.c_str(), O_RDONLY);
+#endif
+    }
+
+    ~PositionalFile()
+    {
+#ifdef WIN32
+        if (_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(_file);
+        }
+#else
+        if (_fd != -1)
+        {
+            ::close(_fd);
+        }
+#endif
+    }
+
+    bool failed() const
+    {
+#ifdef WIN32
+        return _file == INVALID_HANDLE_VALUE;
+#else
+        return _fd == -1;
+#endif
+    }
+
+    // Reads up to length bytes starting at the given offset into the buffer.
+    // Returns the number of bytes read, which is less than length at the end of the file.
+    std::size_t read(std::size_t offset, unsigned char* buffer, std::size_t length) const
+    {
+        if (failed()) return 0;
+
+        std::size_t totalRead = 0;
+
+        while (totalRead < length)
+        {
+#ifdef WIN32
+            auto position = static_cast<std::uint64_t>(offset + totalRead);
+
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+            auto chunkSize = static_cast<DWORD>(std::min<std::size_t>(length - totalRead, 0x40000000));
+            DWORD bytesRead = 0;
+
+            if (!ReadFile(_file, buffer + totalRead, chunkSize, &bytesRead, &overlapped) || bytesRead == 0)
+            {
+                break; // error or end of file
+            }
+#else
+            auto bytesRead = ::pread(_fd, buffer + totalRead, length - totalRead,
+                static_cast<off_t>(offset + totalRead));
+
+            if (bytesRead == -1 && errno == EINTR) continue;
+
+            if (bytesRead <= 0)
+            {
+                break; // error or end of file
+            }
+#endif
+            totalRead += static_cast<std::size_t>(bytesRead);
+        }
+
+        return totalRead;
+    }
+};
+
+}
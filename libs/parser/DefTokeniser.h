@@ -6,6 +6,7 @@
 #include <iostream>
 #include <ios>
 #include <string>
+#include <string_view>
 #include "string/tokeniser.h"
 
 namespace parser
@@ -30,32 +31,17 @@ class DefTokeniserFunc
         STAR            // asterisk, possibly indicates end of comment (*/)
     } _state;
 
-    // List of delimiters to skip
-    const char* _delims;
-
-    // List of delimiters to keep
-    const char* _keptDelims;
+    // Lookup table for the delimiters to skip and the ones to keep
+    string::CharacterClassTable _table;
 
     // Test if a character is a delimiter
-    bool isDelim(char c) {
-        const char* curDelim = _delims;
-        while (*curDelim != 0) {
-            if (*(curDelim++) == c) {
-                return true;
-            }
-        }
-        return false;
+    bool isDelim(char c) const {
+        return _table.isDelimiter(c);
     }
 
     // Test if a character is a kept delimiter
-    bool isKeptDelim(char c) {
-        const char* curDelim = _keptDelims;
-        while (*curDelim != 0) {
-            if (*(curDelim++) == c) {
-                return true;
-            }
-        }
-        return false;
+    bool isKeptDelim(char c) const {
+        return _table.isKeptDelimiter(c);
     }
 
 
@@ -63,8 +49,12 @@ public:
 
     // Constructor
     DefTokeniserFunc(const char* delims, const char* keptDelims)
-    : _state(SEARCHING), _delims(delims), _keptDelims(keptDelims)
-    {}
+    : _state(SEARCHING)
+    {
+        // Delimiters take precedence over kept delimiters, assign them last
+        _table.assign(keptDelims, string::CharacterClassTable::KeptDelimiter);
+        _table.assign(delims, string::CharacterClassTable::Delimiter);
+    }
 
     /* REQUIRED. Operator() is called by the tokeniser. This function
      * must search for a token between the two iterators next and end, and if
@@ -488,7 +478,10 @@ public:
 	{
 		if (hasMoreTokens())
 		{
-			return *(_tokIter++);
+			// Don't use the postfix operator, it's copying the whole iterator
+			std::string token = *_tokIter;
+			++_tokIter;
+			return token;
 		}
 
         throw ParseException("DefTokeniser: no more tokens");
@@ -588,7 +581,10 @@ public:
 	{
 		if (hasMoreTokens())
 		{
-			return *(_tokIter++);
+			// Don't use the postfix operator, it's copying the whole iterator
+			std::string token = *_tokIter;
+			++_tokIter;
+			return token;
 		}
         
 		throw ParseException("DefTokeniser: no more tokens");
@@ -610,4 +606,270 @@ public:
 	}
 };
 
+/**
+ * Specialisation of DefTokeniser working on a contiguous character buffer,
+ * like a memory-mapped file or a ScopedArchiveBuffer. The buffer is not copied,
+ * so it needs to outlive the tokeniser.
+ *
+ * In addition to the DefTokeniser interface, tokens can be retrieved as
+ * std::string_view using nextTokenView(), which is pointing right into the source
+ * buffer. The only exception are quoted tokens containing escape sequences or string
+ * continuations, these are assembled in an internal buffer. Either way, the view
+ * stays valid until the next call to nextTokenView().
+ *
+ * The tokenisation rules are the same as the ones of DefTokeniserFunc.
+ */
+template<>
+class BasicDefTokeniser<std::string_view> :
+	public DefTokeniser
+{
+private:
+    const char* _pos;
+    const char* _end;
+
+    string::CharacterClassTable _table;
+
+    // Storage for tokens that can't be referenced in the source buffer
+    std::string _scratch;
+
+public:
+    /**
+     * Construct a DefTokeniser on top of the given character range.
+     *
+     * @param buffer
+     * The characters to tokenise, these are not copied.
+     *
+     * @param delims
+     * The list of characters to use as delimiters.
+     *
+     * @param keptDelims
+     * String of characters to treat as delimiters but return as tokens in their
+     * own right.
+     */
+    BasicDefTokeniser(std::string_view buffer,
+                      const char* delims = WHITESPACE,
+                      const char* keptDelims = "{}(),") :
+        _pos(buffer.data()),
+        _end(buffer.data() + buffer.size())
+    {
+        // Delimiters take precedence over kept delimiters
+        _table.assign(keptDelims, string::CharacterClassTable::KeptDelimiter);
+        _table.assign(delims, string::CharacterClassTable::Delimiter);
+    }
+
+    BasicDefTokeniser(const char* data, std::size_t length,
+                      const char* delims = WHITESPACE,
+                      const char* keptDelims = "{}(),") :
+        BasicDefTokeniser(std::string_view(data, length), delims, keptDelims)
+    {}
+
+    bool hasMoreTokens() const override
+    {
+        return skipDelimsAndComments(_pos) != _end;
+    }
+
+    /**
+     * Returns the next token as view, without copying its characters.
+     * The view is invalidated by the next call to nextTokenView().
+     */
+    std::string_view nextTokenView()
+    {
+        _pos = skipDelimsAndComments(_pos);
+
+        if (_pos == _end)
+        {
+            throw ParseException("DefTokeniser: no more tokens");
+        }
+
+        return readToken(_pos, _scratch);
+    }
+
+    std::string nextToken() override
+    {
+        return std::string(nextTokenView());
+    }
+
+    void assertNextToken(const std::string& val) override
+    {
+        auto tok = nextTokenView();
+
+        if (tok != val)
+        {
+            throw ParseException("DefTokeniser: Assertion failed: Required \""
+                + val + "\", found \"" + std::string(tok) + "\"");
+        }
+    }
+
+    void skipTokens(unsigned int n) override
+    {
+        for (unsigned int i = 0; i < n; i++)
+        {
+            nextTokenView();
+        }
+    }
+
+    std::string peek() const override
+    {
+        const char* pos = skipDelimsAndComments(_pos);
+
+        if (pos == _end)
+        {
+            throw ParseException("DefTokeniser: no more tokens");
+        }
+
+        std::string scratch;
+        return std::string(readToken(pos, scratch));
+    }
+
+private:
+    bool startsComment(const char* pos) const
+    {
+        return *pos == '/' && pos + 1 != _end && (pos[1] == '/' || pos[1] == '*');
+    }
+
+    // Returns the position of the next token's first character (or _end)
+    const char* skipDelimsAndComments(const char* pos) const
+    {
+        while (pos != _end)
+        {
+            if (_table.isDelimiter(*pos))
+            {
+                ++pos;
+            }
+            else if (!_table.isKeptDelimiter(*pos) && startsComment(pos))
+            {
+                if (pos[1] == '/')
+                {
+                    // Line comment, skip to the end of the line
+                    while (pos != _end && *pos != '\r' && *pos != '\n') ++pos;
+                }
+                else
+                {
+                    // Delimited comment, skip past the closing */
+                    for (pos += 2; pos != _end; ++pos)
+                    {
+                        if (*pos == '*' && pos + 1 != _end && pos[1] == '/')
+                        {
+                            pos += 2;
+                            break;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        return pos;
+    }
+
+    // Reads the token starting at pos, which must not point to a delimiter or comment.
+    // Advances pos to the first character after the token.
+    std::string_view readToken(const char*& pos, std::string& scratch) const
+    {
+        if (_table.isKeptDelimiter(*pos))
+        {
+            return std::string_view(pos++, 1);
+        }
+
+        if (*pos == '"')
+        {
+            return readQuotedToken(pos, scratch);
+        }
+
+        // Regular token, ends at delimiters, quotes and comments
+        const char* start = pos;
+
+        while (pos != _end && _table.get(*pos) == string::CharacterClassTable::Regular &&
+               *pos != '"' && !startsComment(pos))
+        {
+            ++pos;
+        }
+
+        return std::string_view(start, pos - start);
+    }
+
+    std::string_view readQuotedToken(const char*& pos, std::string& scratch) const
+    {
+        // Skip the opening quote
+        const char* start = ++pos;
+
+        // Fast path: no escape sequences and no continuation, point into the buffer
+        while (pos != _end && *pos != '"' && *pos != '\\') ++pos;
+
+        if (pos == _end)
+        {
+            return std::string_view(start, pos - start);
+        }
+
+        if (*pos == '"' && !isContinuedAfterQuote(pos + 1))
+        {
+            return std::string_view(start, pos++ - start);
+        }
+
+        // Slow path: assemble the token in the scratch buffer
+        scratch.assign(start, pos - start);
+
+        while (pos != _end)
+        {
+            if (*pos == '"')
+            {
+                ++pos;
+
+                if (!isContinuedAfterQuote(pos))
+                {
+                    break;
+                }
+
+                // Skip the delimiters up to the backslash
+                while (*pos != '\\') ++pos;
+
+                // Search for the opening quote of the continued string
+                for (++pos; pos != _end && _table.isDelimiter(*pos); ++pos) {}
+
+                if (pos == _end || *pos != '"')
+                {
+                    throw ParseException("Could not find opening double quote after backslash.");
+                }
+
+                ++pos;
+            }
+            else if (*pos == '\\')
+            {
+                if (++pos == _end) break;
+
+                switch (*pos)
+                {
+                case 'n': scratch += '\n'; break;
+                case 't': scratch += '\t'; break;
+                case '"': scratch += '"'; break;
+                default:
+                    // No special escape sequence, keep the backslash
+                    scratch += '\\';
+                    scratch += *pos;
+                }
+
+                ++pos;
+            }
+            else
+            {
+                scratch += *pos++;
+            }
+        }
+
+        return scratch;
+    }
+
+    // Returns true if the given position after a closing quote is followed
+    // by a backslash (with only delimiters in between)
+    bool isContinuedAfterQuote(const char* pos) const
+    {
+        while (pos != _end && _table.isDelimiter(*pos)) ++pos;
+
+        return pos != _end && *pos == '\\';
+    }
+};
+
 } // namespace parser
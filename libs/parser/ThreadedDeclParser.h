@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <thread>
 #include "ifilesystem.h"
 #include "itextstream.h"
 #include "idecltypes.h"
@@ -23,15 +25,20 @@ private:
     std::string _baseDir;
     std::string _extension;
     std::size_t _depth;
+    std::size_t _maxWorkers;
 
 protected:
     // Construct a parser traversing all files matching the given extension in the given VFS path
     // Subclasses need to implement the parse(std::istream) overload for this scenario
-    ThreadedDeclParser(decl::Type declType, const std::string& baseDir, const std::string& extension, std::size_t depth = 1) :
+    // If maxWorkers is larger than 1, the files are distributed across that many threads
+    // and parse() is going to be invoked concurrently for different files.
+    ThreadedDeclParser(decl::Type declType, const std::string& baseDir, const std::string& extension,
+        std::size_t depth = 1, std::size_t maxWorkers = 1) :
         ThreadedDefLoader<ReturnType>(std::bind(&ThreadedDeclParser::doParse, this)),
         _baseDir(baseDir),
         _extension(extension),
         _depth(depth),
+        _maxWorkers(std::max(maxWorkers, static_cast<std::size_t>(1))),
         _declType(declType)
     {}
 
@@ -70,8 +77,18 @@ protected:
         }
     }
 
-    // Parse all decls found in the given stream, to be implemented by subclasses
-    virtual void parse(std::istream& stream, const vfs::FileInfo& fileInfo, const std::string& modDir) = 0;
+    // Invoked once the files have been collected and sorted, before any of them is processed
+    virtual void onBeginParsingFiles(std::size_t numFiles) {}
+
+    // Parse all decls found in the given stream, to be implemented by subclasses.
+    // The fileIndex refers to the position of the file in the sorted list, results
+    // should be kept per file and merged in this order to be independent of threading.
+    virtual void parse(std::istream& stream, const vfs::FileInfo& fileInfo,
+        const std::string& modDir, std::size_t fileIndex) = 0;
+
+    // Invoked before a file is opened, subclasses can return true to signal
+    // that the file contents have been acquired elsewhere and parse() is not needed
+    virtual bool tryLoadFromCache(const vfs::FileInfo& fileInfo, std::size_t fileIndex) { return false; }
 
     void processFiles()
     {
@@ -92,25 +109,89 @@ protected:
             return a.name < b.name;
         });
 
-        // Dispatch the sorted list to the protected parse() method
-        for (const auto& fileInfo : _incomingFiles)
+        onBeginParsingFiles(_incomingFiles.size());
+
+        auto numWorkers = std::min(_maxWorkers, _incomingFiles.size());
+
+        if (numWorkers <= 1)
         {
-            auto file = GlobalFileSystem().openTextFile(fileInfo.fullPath());
+            for (std::size_t i = 0; i < _incomingFiles.size(); ++i)
+            {
+                processFile(_incomingFiles[i], i);
+            }
+
+            return;
+        }
 
-            if (!file) continue;
+        // Workers are grabbing the next unprocessed file until the list is exhausted
+        std::atomic<std::size_t> nextFile(0);
+
+        auto worker = [&]()
+        {
+            for (auto i = nextFile++; i < _incomingFiles.size(); i = nextFile++)
+            {
+                processFile(_incomingFiles[i], i);
+            }
+        };
+
+        std::vector<std::future<void>> workers;
+
+        for (std::size_t i = 1; i < numWorkers; ++i)
+        {
+            workers.emplace_back(std::async(std::launch::async, worker));
+        }
+
+        // The calling thread is doing its share of the work too
+        std::exception_ptr exception;
+
+        try
+        {
+            worker();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
 
+        // Wait for all workers before propagating any exception
+        for (auto& future : workers)
+        {
             try
             {
-                // Parse entity defs from the file
-                std::istream stream(&file->getInputStream());
-                parse(stream, fileInfo, file->getModName());
+                future.get();
             }
-            catch (ParseException& e)
+            catch (...)
             {
-                rError() << "[DeclParser] Failed to parse " << fileInfo.fullPath()
-                    << " (" << e.what() << ")" << std::endl;
+                if (!exception) exception = std::current_exception();
             }
         }
+
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    // Dispatch a single file to the protected parse() method
+    void processFile(const vfs::FileInfo& fileInfo, std::size_t fileIndex)
+    {
+        if (tryLoadFromCache(fileInfo, fileIndex)) return;
+
+        auto file = GlobalFileSystem().openTextFile(fileInfo.fullPath());
+
+        if (!file) return;
+
+        try
+        {
+            // Parse entity defs from the file
+            std::istream stream(&file->getInputStream());
+            parse(stream, fileInfo, file->getModName(), fileIndex);
+        }
+        catch (ParseException& e)
+        {
+            rError() << "[DeclParser] Failed to parse " << fileInfo.fullPath()
+                << " (" << e.what() << ")" << std::endl;
+        }
     }
 };
 
@@ -118,7 +118,10 @@ public:
 	{
 		if (hasMoreTokens())
 		{
-			return *(_tokIter++);
+			// Don't use the postfix operator, it's copying the whole iterator
+			std::string token = *_tokIter;
+			++_tokIter;
+			return token;
 		}
 
         throw ParseException("Tokeniser: no more tokens");
@@ -150,7 +153,7 @@ public:
 		{
             if (hasMoreTokens())
 			{
-                _tokIter++;
+                ++_tokIter;
 				continue;
             }
             
@@ -232,7 +235,10 @@ public:
     {
         if (hasMoreTokens())
         {
-            return *(_tokIter++);
+            // Don't use the postfix operator, it's copying the whole iterator
+            std::string token = *_tokIter;
+            ++_tokIter;
+            return token;
         }
 
         throw ParseException("Tokeniser: no more tokens");
@@ -264,7 +270,7 @@ public:
         {
             if (hasMoreTokens())
             {
-                _tokIter++;
+                ++_tokIter;
                 continue;
             }
 
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <stack>
+#include <set>
+#include <map>
 #include <limits>
 #include <vector>
+#include <algorithm>
+#include <functional>
 #include "igeometrystore.h"
 #include "itextstream.h"
 
@@ -30,6 +35,11 @@ struct BufferTransaction
  *
  * Use the allocate/deallocate methods to acquire or release a chunk of
  * a certain size. The chunk size is fixed and cannot be changed.
+ *
+ * Free chunks are kept in a size-ordered set to find the best fitting one
+ * on allocation, and in an offset-ordered map to merge released chunks
+ * with their free neighbours. Use compact() to move all occupied chunks
+ * to the start of the buffer, getting rid of any fragmentation.
  */
 template<typename ElementType>
 class ContinuousBuffer
@@ -39,6 +49,23 @@ public:
 
     using Handle = std::uint32_t;
 
+    // Fragmentation information about the buffer, all sizes in number of elements
+    struct Stats
+    {
+        std::size_t bufferSize;
+        std::size_t allocatedElements;
+        std::size_t numOccupiedSlots;
+        std::size_t numFreeSlots;
+        std::size_t freeElements;
+        std::size_t largestFreeSlot;
+
+        // 0 if all the free space is in a single block, approaching 1 the more it's scattered
+        double getFragmentation() const
+        {
+            return freeElements > 0 ? 1.0 - static_cast<double>(largestFreeSlot) / freeElements : 0.0;
+        }
+    };
+
 private:
     static constexpr std::size_t GrowthRate = 1; // 100% growth each time
 
@@ -71,6 +98,10 @@ private:
     // A stack of slots that can be re-used instead
     std::stack<Handle> _emptySlots;
 
+    // The unoccupied slots, ordered by size (for best-fit allocation) and by offset (for merging)
+    std::set<std::pair<std::size_t, Handle>> _freeSlotsBySize;
+    std::map<std::size_t, Handle> _freeSlotsByOffset;
+
     // Last data size that was synced to the buffer object
     std::size_t _lastSyncedBufferSize;
 
@@ -113,9 +144,14 @@ public:
         memcpy(_slots.data(), other._slots.data(), other._slots.size() * sizeof(SlotInfo));
 
         _emptySlots = other._emptySlots;
+        _freeSlotsBySize = other._freeSlotsBySize;
+        _freeSlotsByOffset = other._freeSlotsByOffset;
         _unsyncedModifications = other._unsyncedModifications;
         _allocatedElements = other._allocatedElements;
 
+        // Whatever buffer object we're synced to, it doesn't hold the copied data
+        _lastSyncedBufferSize = 0;
+
         return *this;
     }
 
@@ -158,6 +194,26 @@ public:
         return _allocatedElements;
     }
 
+    Stats getStats() const
+    {
+        Stats stats{ _buffer.size(), _allocatedElements, 0, _freeSlotsBySize.size(), 0, 0 };
+
+        for (const auto& [size, _] : _freeSlotsBySize)
+        {
+            stats.freeElements += size;
+        }
+
+        if (!_freeSlotsBySize.empty())
+        {
+            stats.largestFreeSlot = _freeSlotsBySize.rbegin()->first;
+        }
+
+        // Recycled handles are not part of either list
+        stats.numOccupiedSlots = _slots.size() - _emptySlots.size() - _freeSlotsBySize.size();
+
+        return stats;
+    }
+
     // The amount of memory used by this instance, in bytes
     std::size_t getBufferSizeInBytes() const
     {
@@ -166,6 +222,8 @@ public:
         total += _buffer.capacity() * sizeof(ElementType);
         total += _slots.capacity() * sizeof(SlotInfo);
         total += _emptySlots.size() * sizeof(Handle);
+        total += _freeSlotsBySize.size() * (sizeof(std::pair<std::size_t, Handle>) + 4 * sizeof(void*));
+        total += _freeSlotsByOffset.size() * (sizeof(std::pair<std::size_t, Handle>) + 4 * sizeof(void*));
         total += _unsyncedModifications.capacity() * sizeof(ModifiedMemoryChunk);
         total += sizeof(ContinuousBuffer<ElementType>);
 
@@ -229,35 +287,96 @@ public:
 
         _allocatedElements -= releasedSlot.Size;
 
-        // Check if the slot can merge with an adjacent one
-        Handle slotIndexToMerge = std::numeric_limits<Handle>::max();
-        if (findLeftFreeSlot(releasedSlot, slotIndexToMerge))
+        // Check if the slot can merge with the free slot to the left
+        auto candidate = _freeSlotsByOffset.lower_bound(releasedSlot.Offset);
+
+        if (candidate != _freeSlotsByOffset.begin())
         {
+            auto slotIndexToMerge = std::prev(candidate)->second;
             auto& slotToMerge = _slots[slotIndexToMerge];
 
-            releasedSlot.Offset = slotToMerge.Offset;
-            releasedSlot.Size += slotToMerge.Size;
+            if (slotToMerge.Offset + slotToMerge.Size == releasedSlot.Offset)
+            {
+                releasedSlot.Offset = slotToMerge.Offset;
+                releasedSlot.Size += slotToMerge.Size;
 
-            // The merged handle goes to recycling, block it against future use
-            slotToMerge.Size = 0;
-            slotToMerge.Used = 0;
-            slotToMerge.Occupied = true;
-            _emptySlots.push(slotIndexToMerge);
+                recycleSlot(slotIndexToMerge);
+            }
         }
 
         // Try to find an adjacent free slot to the right
-        if (findRightFreeSlot(releasedSlot, slotIndexToMerge))
+        candidate = _freeSlotsByOffset.find(releasedSlot.Offset + releasedSlot.Size);
+
+        if (candidate != _freeSlotsByOffset.end())
         {
-            auto& slotToMerge = _slots[slotIndexToMerge];
+            auto slotIndexToMerge = candidate->second;
 
-            releasedSlot.Size += slotToMerge.Size;
+            releasedSlot.Size += _slots[slotIndexToMerge].Size;
 
-            // The merged handle goes to recycling, block it against future use
-            slotToMerge.Size = 0;
-            slotToMerge.Used = 0;
-            slotToMerge.Occupied = true;
-            _emptySlots.push(slotIndexToMerge);
+            recycleSlot(slotIndexToMerge);
         }
+
+        addFreeSlot(handle);
+    }
+
+    /**
+     * Defragments the buffer by moving all occupied slots to the start of the buffer,
+     * keeping their order. All the free space is merged into a single slot at the end.
+     * The handles remain valid, but their offsets are changing, so the whole buffer
+     * needs to be uploaded to the buffer object again on the next sync.
+     */
+    void compact()
+    {
+        std::vector<Handle> occupiedSlots;
+        occupiedSlots.reserve(_slots.size());
+
+        for (Handle slotIndex = 0; slotIndex < _slots.size(); ++slotIndex)
+        {
+            const auto& slot = _slots[slotIndex];
+
+            // Recycled handles are marked as occupied, but have zero size
+            if (slot.Occupied && slot.Size > 0)
+            {
+                occupiedSlots.push_back(slotIndex);
+            }
+        }
+
+        std::sort(occupiedSlots.begin(), occupiedSlots.end(), [&](Handle a, Handle b)
+        {
+            return _slots[a].Offset < _slots[b].Offset;
+        });
+
+        // Move the data towards the start, the target is never behind the source
+        std::size_t offset = 0;
+
+        for (auto slotIndex : occupiedSlots)
+        {
+            auto& slot = _slots[slotIndex];
+
+            if (slot.Offset != offset)
+            {
+                std::copy(_buffer.begin() + slot.Offset, _buffer.begin() + slot.Offset + slot.Size,
+                    _buffer.begin() + offset);
+                slot.Offset = offset;
+            }
+
+            offset += slot.Size;
+        }
+
+        // Release the free slots, replacing them with a single one at the end
+        while (!_freeSlotsByOffset.empty())
+        {
+            recycleSlot(_freeSlotsByOffset.begin()->second);
+        }
+
+        if (offset < _buffer.size())
+        {
+            createSlotInfo(offset, _buffer.size() - offset);
+        }
+
+        // Force a full upload on the next sync
+        _lastSyncedBufferSize = 0;
+        _unsyncedModifications.clear();
     }
 
     void applyTransactions(const std::vector<detail::BufferTransaction>& transactions, const ContinuousBuffer<ElementType>& other,
@@ -304,6 +423,8 @@ public:
 
         _allocatedElements = other._allocatedElements;
         _emptySlots = other._emptySlots;
+        _freeSlotsBySize = other._freeSlotsBySize;
+        _freeSlotsByOffset = other._freeSlotsByOffset;
     }
 
     // Copies the updated memory to the given buffer object
@@ -385,132 +506,124 @@ public:
     }
 
 private:
-    bool findLeftFreeSlot(const SlotInfo& slotToTouch, Handle& found)
+    void addFreeSlot(Handle handle)
     {
-        auto numSlots = _slots.size();
-
-        for (Handle slotIndex = 0; slotIndex < numSlots; ++slotIndex)
-        {
-            const auto& candidate = _slots[slotIndex];
-
-            if (candidate.Offset + candidate.Size == slotToTouch.Offset)
-            {
-                // The slot coordinates match, return true if this block is free
-                found = slotIndex;
-                return !candidate.Occupied;
-            }
-        }
+        const auto& slot = _slots[handle];
 
-        return false;
+        _freeSlotsBySize.emplace(slot.Size, handle);
+        _freeSlotsByOffset.emplace(slot.Offset, handle);
     }
 
-    bool findRightFreeSlot(const SlotInfo& slotToTouch, Handle& found)
+    void removeFreeSlot(Handle handle)
     {
-        auto numSlots = _slots.size();
-        auto offsetToMatch = slotToTouch.Offset + slotToTouch.Size;
+        const auto& slot = _slots[handle];
 
-        for (Handle slotIndex = 0; slotIndex < numSlots; ++slotIndex)
-        {
-            const auto& candidate = _slots[slotIndex];
+        _freeSlotsBySize.erase({ slot.Size, handle });
+        _freeSlotsByOffset.erase(slot.Offset);
+    }
 
-            if (candidate.Offset == offsetToMatch)
-            {
-                // The slot coordinates match, return true if this block is free
-                found = slotIndex;
-                return !candidate.Occupied;
-            }
-        }
+    // Removes the given free slot and blocks its handle until it's re-used by createSlotInfo
+    void recycleSlot(Handle handle)
+    {
+        removeFreeSlot(handle);
 
-        return false;
+        auto& slot = _slots[handle];
+        slot.Size = 0;
+        slot.Used = 0;
+        slot.Occupied = true;
+        _emptySlots.push(handle);
     }
 
     Handle getNextFreeSlotForSize(std::size_t requiredSize)
     {
-        auto numSlots = _slots.size();
-        Handle rightmostFreeSlotIndex = static_cast<Handle>(numSlots);
-        std::size_t rightmostFreeOffset = 0;
-        std::size_t rightmostFreeSize = 0;
+        // Pick the smallest free slot that is large enough
+        auto bestFit = _freeSlotsBySize.lower_bound({ requiredSize, 0 });
 
-        for (Handle slotIndex = 0; slotIndex < numSlots; ++slotIndex)
+        if (bestFit == _freeSlotsBySize.end())
         {
-            auto& slot = _slots[slotIndex];
+            // No space wherever, we need to expand the buffer
+            expandBuffer(requiredSize);
 
-            if (slot.Occupied) continue;
+            bestFit = _freeSlotsBySize.lower_bound({ requiredSize, 0 });
+            assert(bestFit != _freeSlotsBySize.end()); // otherwise we've run wrong above
+        }
 
-            // Keep track of the highest slot, we need that when re-allocating
-            if (slot.Offset > rightmostFreeOffset)
-            {
-                rightmostFreeOffset = slot.Offset;
-                rightmostFreeSize = slot.Size;
-                rightmostFreeSlotIndex = slotIndex;
-            }
+        auto slotIndex = bestFit->second;
+        removeFreeSlot(slotIndex);
 
-            if (slot.Size < requiredSize) continue; // this slot is no use for us
+        auto& slot = _slots[slotIndex];
 
-            // Calculate the remaining size before assignment
-            auto remainingSize = slot.Size - requiredSize;
-            slot.Size = requiredSize;
-            slot.Occupied = true;
+        // Calculate the remaining size before assignment
+        auto remainingSize = slot.Size - requiredSize;
+        auto remainingOffset = slot.Offset + requiredSize;
 
-            if (remainingSize > 0)
-            {
-                // Allocate a new free slot with the remaining space
-                createSlotInfo(slot.Offset + requiredSize, remainingSize);
-            }
+        slot.Size = requiredSize;
+        slot.Occupied = true;
 
-            return slotIndex;
+        if (remainingSize > 0)
+        {
+            // Allocate a new free slot with the remaining space
+            createSlotInfo(remainingOffset, remainingSize);
         }
 
-        // No space wherever, we need to expand the buffer
+        return slotIndex;
+    }
 
+    void expandBuffer(std::size_t requiredSize)
+    {
         // Allocate more memory
         auto oldBufferSize = _buffer.size();
         auto additionalSize = std::max(oldBufferSize * GrowthRate, requiredSize);
-        auto newSize = oldBufferSize + additionalSize;
-        _buffer.resize(newSize);
+        _buffer.resize(oldBufferSize + additionalSize);
 
-        // Ensure that the rightmost free slot is at the end of the buffer, otherwise allocate a new one
-        if (rightmostFreeSlotIndex == numSlots || rightmostFreeOffset + rightmostFreeSize != oldBufferSize)
+        // Extend the free slot at the end of the buffer, if there is one, otherwise allocate a new one
+        if (!_freeSlotsByOffset.empty())
         {
-            // Create a free slot with 0 size at the end of the storage
-            _slots.emplace_back(oldBufferSize, 0, false);
+            auto rightmostFreeSlotIndex = _freeSlotsByOffset.rbegin()->second;
+            auto& rightmostFreeSlot = _slots[rightmostFreeSlotIndex];
 
-            // Adjust rightMostFreeSlotIndex to always point at this new slot
-            rightmostFreeSlotIndex = static_cast<Handle>(numSlots);
+            if (rightmostFreeSlot.Offset + rightmostFreeSlot.Size == oldBufferSize)
+            {
+                removeFreeSlot(rightmostFreeSlotIndex);
+                rightmostFreeSlot.Size += additionalSize;
+                addFreeSlot(rightmostFreeSlotIndex);
+                return;
+            }
         }
 
-        // Use the right most slot for our requirement, then cut up the rest of the space
-        auto& rightmostFreeSlot = _slots[rightmostFreeSlotIndex];
-
-        assert(rightmostFreeSlot.Size < requiredSize); // otherwise we've run wrong above
-
-        auto remainingSize = rightmostFreeSlot.Size + additionalSize - requiredSize;
-
-        rightmostFreeSlot.Occupied = true;
-        rightmostFreeSlot.Size = requiredSize;
-
-        createSlotInfo(rightmostFreeSlot.Offset + rightmostFreeSlot.Size, remainingSize);
-
-        return rightmostFreeSlotIndex;
+        createSlotInfo(oldBufferSize, additionalSize);
     }
 
-    SlotInfo& createSlotInfo(std::size_t offset, std::size_t size, bool occupied = false)
+    // Creates a new slot (or re-uses a recycled one), free slots are registered in the free lists
+    Handle createSlotInfo(std::size_t offset, std::size_t size, bool occupied = false)
     {
+        Handle handle;
+
         if (_emptySlots.empty())
         {
-            return _slots.emplace_back(offset, size, occupied);
+            handle = static_cast<Handle>(_slots.size());
+            _slots.emplace_back(offset, size, occupied);
         }
+        else
+        {
+            // Re-use an old slot
+            handle = _emptySlots.top();
+            _emptySlots.pop();
 
-        // Re-use an old slot
-        auto& slot = _slots.at(_emptySlots.top());
-        _emptySlots.pop();
+            auto& slot = _slots.at(handle);
 
-        slot.Occupied = occupied;
-        slot.Offset = offset;
-        slot.Size = size;
-        slot.Used = 0;
+            slot.Occupied = occupied;
+            slot.Offset = offset;
+            slot.Size = size;
+            slot.Used = 0;
+        }
 
-        return slot;
+        if (!occupied)
+        {
+            addFreeSlot(handle);
+        }
+
+        return handle;
     }
 };
 
@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
 #include "igeometrystore.h"
 #include "itextstream.h"
 #include "ContinuousBuffer.h"
@@ -24,8 +25,13 @@ private:
         IndexRemap = 1,
     };
 
-    static constexpr auto NumFrameBuffers = 1;
+public:
+    // Number of frame buffers used if nothing else is specified. With a single buffer,
+    // every frame has to wait for the GPU to finish the previous one before writing.
+    static constexpr std::size_t DefaultNumFrameBuffers = 2;
+    static constexpr std::size_t MaxNumFrameBuffers = 3;
 
+private:
     // Represents the storage for a single frame
     struct FrameBuffer
     {
@@ -77,11 +83,15 @@ private:
     ISyncObjectProvider& _syncObjectProvider;
 
 public:
-    GeometryStore(ISyncObjectProvider& syncObjectProvider, IBufferObjectProvider& bufferObjectProvider) :
+    // The number of frame buffers is clamped to [1..MaxNumFrameBuffers]. While the GPU is
+    // still busy reading from one buffer, the next frame can already write to another one.
+    // Modifications are replayed from one buffer to the next when switching frames.
+    GeometryStore(ISyncObjectProvider& syncObjectProvider, IBufferObjectProvider& bufferObjectProvider,
+                  std::size_t numFrameBuffers = DefaultNumFrameBuffers) :
         _currentBuffer(0),
         _syncObjectProvider(syncObjectProvider)
     {
-        _frameBuffers.resize(NumFrameBuffers);
+        _frameBuffers.resize(std::max<std::size_t>(std::min(numFrameBuffers, MaxNumFrameBuffers), 1));
 
         // Assign (empty) buffer objects to the frames
         for (auto& frameBuffer : _frameBuffers)
@@ -91,10 +101,17 @@ public:
         }
     }
 
+    std::size_t getNumFrameBuffers() const
+    {
+        return _frameBuffers.size();
+    }
+
     // Marks the beginning of a frame, switches to the next writing buffers
     void onFrameStart()
     {
-        _currentBuffer = (_currentBuffer + 1) % NumFrameBuffers;
+        auto numFrameBuffers = static_cast<unsigned int>(_frameBuffers.size());
+
+        _currentBuffer = (_currentBuffer + 1) % numFrameBuffers;
         auto& current = getCurrentBuffer();
 
         // Wait for this buffer to become available
@@ -106,9 +123,9 @@ public:
 
         // Replay any modifications of all other buffers onto this one,
         // in the order they are switched through
-        for (auto bufferIndex = (_currentBuffer + 1) % NumFrameBuffers;
+        for (auto bufferIndex = (_currentBuffer + 1) % numFrameBuffers;
              bufferIndex != _currentBuffer;
-             bufferIndex = (bufferIndex + 1) % NumFrameBuffers)
+             bufferIndex = (bufferIndex + 1) % numFrameBuffers)
         {
             current.applyTransactions(_frameBuffers[bufferIndex]);
         }
@@ -292,12 +309,36 @@ public:
         return bounds;
     }
 
+    // Defragments the vertex and index buffers of all frames, slot IDs remain valid.
+    // Must not be called while a frame is being rendered.
+    void compact()
+    {
+        auto& current = getCurrentBuffer();
+
+        current.vertices.compact();
+        current.indices.compact();
+
+        // Since the layout changed, the other frame buffers cannot be patched using
+        // the transaction logs anymore, replace them with the current state instead
+        for (auto& frameBuffer : _frameBuffers)
+        {
+            if (&frameBuffer != &current)
+            {
+                frameBuffer.vertices = current.vertices;
+                frameBuffer.indices = current.indices;
+            }
+
+            frameBuffer.vertexTransactionLog.clear();
+            frameBuffer.indexTransactionLog.clear();
+        }
+    }
+
     void printMemoryStats()
     {
         rMessage() << "-- Geometry Store Memory --" << std::endl;
-        rMessage() << "Number of Frame Buffers: " << NumFrameBuffers << std::endl;
+        rMessage() << "Number of Frame Buffers: " << _frameBuffers.size() << std::endl;
 
-        for (auto i = 0; i < NumFrameBuffers; ++i)
+        for (std::size_t i = 0; i < _frameBuffers.size(); ++i)
         {
             rMessage() << "Frame Buffer " << i << std::endl;
             rMessage() << "  Vertices: " << string::getFormattedByteSize(_frameBuffers[i].vertices.getBufferSizeInBytes()) << std::endl;
@@ -305,10 +346,22 @@ public:
 
             auto logSize = _frameBuffers[i].vertexTransactionLog.capacity() + _frameBuffers[i].indexTransactionLog.capacity();
             rMessage() << "  Transaction Logs: " << string::getFormattedByteSize(logSize * sizeof(detail::BufferTransaction)) << std::endl;
+
+            printFragmentationStats("Vertex", _frameBuffers[i].vertices.getStats());
+            printFragmentationStats("Index", _frameBuffers[i].indices.getStats());
         }
     }
 
 private:
+    template<typename StatsType>
+    static void printFragmentationStats(const std::string& bufferName, const StatsType& stats)
+    {
+        rMessage() << "  " << bufferName << " Slots: " << stats.numOccupiedSlots << " occupied (" <<
+            stats.allocatedElements << " of " << stats.bufferSize << " elements), " <<
+            stats.numFreeSlots << " free (largest: " << stats.largestFreeSlot << " elements), " <<
+            "Fragmentation: " << static_cast<int>(stats.getFragmentation() * 100) << "%" << std::endl;
+    }
+
     FrameBuffer& getCurrentBuffer()
     {
         return _frameBuffers[_currentBuffer];
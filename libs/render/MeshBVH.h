@@ -0,0 +1,275 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "math/AABB.h"
+#include "math/Ray.h"
+#include "math/Frustum.h"
+#include "render/MeshVertex.h"
+
+namespace render
+{
+
+/**
+ * Bounding volume hierarchy over the triangles of an indexed mesh, in mesh space.
+ *
+ * It is meant to be built once per surface and kept as long as the vertices
+ * don't move, to avoid testing every triangle in ray intersection and
+ * selection tests. The hierarchy is built by splitting the triangles at the
+ * median of their centroids along the longest axis.
+ *
+ * The triangles are stored in a re-ordered copy of the index array, such that
+ * the triangles below any node form one contiguous range.
+ */
+class MeshBVH
+{
+public:
+    // Nodes with this many triangles or less are not split any further
+    static constexpr std::size_t MaxTrianglesPerLeaf = 4;
+
+private:
+    struct Node
+    {
+        AABB bounds;
+
+        // The range of triangles below this node
+        std::uint32_t firstTriangle;
+        std::uint32_t numTriangles;
+
+        // The first child is stored right after its parent, this is
+        // the index of the second one, 0 for leaf nodes
+        std::uint32_t secondChild;
+    };
+
+    std::vector<Node> _nodes;
+    std::vector<unsigned int> _indices;
+
+public:
+    MeshBVH(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        auto numTriangles = indices.size() / 3;
+
+        if (numTriangles == 0) return;
+
+        std::vector<std::uint32_t> triangles(numTriangles);
+        std::vector<AABB> triangleBounds(numTriangles);
+
+        for (std::size_t i = 0; i < numTriangles; ++i)
+        {
+            triangles[i] = static_cast<std::uint32_t>(i);
+
+            for (std::size_t corner = 0; corner < 3; ++corner)
+            {
+                triangleBounds[i].includePoint(vertices[indices[i * 3 + corner]].vertex);
+            }
+        }
+
+        _nodes.reserve(numTriangles * 2 / MaxTrianglesPerLeaf + 1);
+        buildNode(triangles, triangleBounds, 0, static_cast<std::uint32_t>(numTriangles));
+
+        _indices.reserve(numTriangles * 3);
+
+        for (auto triangle : triangles)
+        {
+            _indices.insert(_indices.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+        }
+    }
+
+    bool isEmpty() const
+    {
+        return _nodes.empty();
+    }
+
+    std::size_t getNumNodes() const
+    {
+        return _nodes.size();
+    }
+
+    /**
+     * Find the intersection of the given ray with the mesh which is closest to the
+     * ray origin. Ray and vertices are expected to be in mesh space, the direction
+     * of the ray doesn't need to be normalised. Hits at the ray origin are ignored.
+     * Returns false if there is no intersection.
+     */
+    bool getIntersection(const std::vector<MeshVertex>& vertices, const Ray& ray, Vector3& intersection) const
+    {
+        if (_nodes.empty()) return false;
+
+        auto directionLengthSquared = ray.direction.getLengthSquared();
+
+        if (directionLengthSquared == 0) return false;
+
+        // The closest hit so far, as multiple of the ray direction
+        auto bestDistance = std::numeric_limits<double>::max();
+        Vector3 triIntersection;
+
+        std::uint32_t stack[64];
+        std::size_t stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0)
+        {
+            const auto& node = _nodes[stack[--stackSize]];
+
+            if (!rayIntersectsBounds(ray, node.bounds, bestDistance)) continue;
+
+            if (node.secondChild != 0)
+            {
+                stack[stackSize++] = node.secondChild;
+                stack[stackSize++] = static_cast<std::uint32_t>(&node - _nodes.data()) + 1;
+                continue;
+            }
+
+            for (auto i = node.firstTriangle * 3; i < (node.firstTriangle + node.numTriangles) * 3; i += 3)
+            {
+                if (ray.intersectTriangle(vertices[_indices[i]].vertex, vertices[_indices[i + 1]].vertex,
+                    vertices[_indices[i + 2]].vertex, triIntersection) != Ray::POINT)
+                {
+                    continue;
+                }
+
+                auto distance = (triIntersection - ray.origin).dot(ray.direction) / directionLengthSquared;
+
+                if (distance > 0 && distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    intersection = triIntersection;
+                }
+            }
+        }
+
+        return bestDistance != std::numeric_limits<double>::max();
+    }
+
+    /**
+     * Invoke the given functor for the triangles whose bounds are not fully outside the given
+     * frustum, which is expected to be in mesh space. The functor is called with a pointer
+     * to the re-ordered index array and the number of indices in the range:
+     * void(const unsigned int* indices, std::size_t numIndices)
+     * Adjacent ranges are merged before they are passed to the functor.
+     */
+    template<typename Functor>
+    void foreachTriangleRangeInFrustum(const Frustum& frustum, const Functor& functor) const
+    {
+        if (_nodes.empty()) return;
+
+        std::uint32_t rangeStart = 0;
+        std::uint32_t rangeEnd = 0;
+
+        std::uint32_t stack[64];
+        std::size_t stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0)
+        {
+            auto nodeIndex = stack[--stackSize];
+            const auto& node = _nodes[nodeIndex];
+
+            auto intersection = frustum.testIntersection(node.bounds);
+
+            if (intersection == VOLUME_OUTSIDE) continue;
+
+            if (intersection == VOLUME_PARTIAL && node.secondChild != 0)
+            {
+                stack[stackSize++] = node.secondChild;
+                stack[stackSize++] = nodeIndex + 1;
+                continue;
+            }
+
+            // The nodes are visited in index order, extend the current range if possible
+            if (node.firstTriangle != rangeEnd && rangeEnd > rangeStart)
+            {
+                functor(_indices.data() + rangeStart * 3, static_cast<std::size_t>(rangeEnd - rangeStart) * 3);
+                rangeStart = node.firstTriangle;
+            }
+            else if (rangeEnd == rangeStart)
+            {
+                rangeStart = node.firstTriangle;
+            }
+
+            rangeEnd = node.firstTriangle + node.numTriangles;
+        }
+
+        if (rangeEnd > rangeStart)
+        {
+            functor(_indices.data() + rangeStart * 3, static_cast<std::size_t>(rangeEnd - rangeStart) * 3);
+        }
+    }
+
+private:
+    std::uint32_t buildNode(std::vector<std::uint32_t>& triangles, const std::vector<AABB>& triangleBounds,
+        std::uint32_t first, std::uint32_t count)
+    {
+        auto nodeIndex = static_cast<std::uint32_t>(_nodes.size());
+        _nodes.push_back(Node{ AABB(), first, count, 0 });
+
+        AABB bounds;
+        AABB centroidBounds;
+
+        for (auto i = first; i < first + count; ++i)
+        {
+            bounds.includeAABB(triangleBounds[triangles[i]]);
+            centroidBounds.includePoint(triangleBounds[triangles[i]].getOrigin());
+        }
+
+        _nodes[nodeIndex].bounds = bounds;
+
+        if (count <= MaxTrianglesPerLeaf) return nodeIndex;
+
+        // Split at the median along the longest axis of the centroids
+        const auto& extents = centroidBounds.getExtents();
+        auto axis = extents.x() >= extents.y() && extents.x() >= extents.z() ? 0 : extents.y() >= extents.z() ? 1 : 2;
+
+        auto begin = triangles.begin() + first;
+        auto middle = begin + count / 2;
+
+        std::nth_element(begin, middle, begin + count, [&](std::uint32_t a, std::uint32_t b)
+        {
+            return triangleBounds[a].getOrigin()[axis] < triangleBounds[b].getOrigin()[axis];
+        });
+
+        // Splitting at the median keeps the tree depth at log2(count), well below the stack size
+        buildNode(triangles, triangleBounds, first, count / 2);
+        auto secondChild = buildNode(triangles, triangleBounds, first + count / 2, count - count / 2);
+
+        _nodes[nodeIndex].secondChild = secondChild;
+
+        return nodeIndex;
+    }
+
+    // Slab test, returns true if the ray enters the bounds before the given distance
+    static bool rayIntersectsBounds(const Ray& ray, const AABB& bounds, double maxDistance)
+    {
+        auto min = bounds.getOrigin() - bounds.getExtents();
+        auto max = bounds.getOrigin() + bounds.getExtents();
+
+        double entry = 0;
+        double exit = maxDistance;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            if (ray.direction[i] == 0)
+            {
+                if (ray.origin[i] < min[i] || ray.origin[i] > max[i]) return false;
+                continue;
+            }
+
+            auto t1 = (min[i] - ray.origin[i]) / ray.direction[i];
+            auto t2 = (max[i] - ray.origin[i]) / ray.direction[i];
+
+            if (t1 > t2) std::swap(t1, t2);
+
+            entry = std::max(entry, t1);
+            exit = std::min(exit, t2);
+
+            if (entry > exit) return false;
+        }
+
+        return true;
+    }
+};
+
+}
@@ -11,9 +11,31 @@ namespace render
  * Scenegraph walker class that finds all renderable objects and adds them to a
  * given RenderableCollector.
  */
-class RenderableCollectionWalker
+class RenderableCollectionWalker :
+    public scene::Graph::Walker
 {
+private:
+    RenderableCollectorBase& _collector;
+    const VolumeTest& _volume;
+
+    RenderableCollectionWalker(RenderableCollectorBase& collector, const VolumeTest& volume) :
+        _collector(collector),
+        _volume(volume)
+    {}
+
 public:
+    bool visit(const scene::INodePtr& node) override
+    {
+        _collector.processNode(node, _volume);
+        return true;
+    }
+
+    // The scene is large, let the scenegraph cull it on several threads
+    bool supportsParallelCulling() const override
+    {
+        return true;
+    }
+
     /**
      * \brief
      * Use a RenderableCollectionWalker to find all renderables in the global
@@ -22,11 +44,8 @@ public:
     static void CollectRenderablesInScene(RenderableCollectorBase& collector, const VolumeTest& volume)
     {
         // Submit renderables from scene graph
-        GlobalSceneGraph().foreachVisibleNodeInVolume(volume, [&](const scene::INodePtr& node)
-        {
-            collector.processNode(node, volume);
-            return true;
-        });
+        RenderableCollectionWalker walker(collector, volume);
+        GlobalSceneGraph().foreachVisibleNodeInVolume(volume, walker);
 
         // Prepare any renderables that have been directly attached to the RenderSystem
 		// without belonging to an actual scene object
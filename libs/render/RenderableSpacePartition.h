@@ -86,24 +86,24 @@ public:
 	}
 
 private:
-	void accumulateBoundingBoxes(const scene::ISPNodePtr& node)
+	void accumulateBoundingBoxes(const scene::ISPNode& node)
 	{
-		const auto& members = node->getMembers();
+		const auto& members = node.getMembers();
 
 		float shade = members.size() > 2 ? 1 : (members.size() > 0 ? 0.6f : 0);
 
         _nodeColours.emplace_back(shade, shade, shade, 1);
 
-		AABB rb(node->getBounds());
+		AABB rb(node.getBounds());
 
 		// Extend the renderbounds *slightly* so that the lines don't overlap
 		rb.extents *= 1.02f;
 
         _spacePartitionNodes.push_back(rb);
 
-		for (auto child : node->getChildNodes())
+		for (std::size_t i = 0; i < node.getNumChildNodes(); ++i)
 		{
-			accumulateBoundingBoxes(child);
+			accumulateBoundingBoxes(node.getChildNode(i));
 		}
 	}
 };
@@ -30,6 +30,11 @@ public:
         node->onPreRender(_volume);
 		return true;
 	}
+
+	bool supportsParallelCulling() const override
+	{
+		return true;
+	}
 };
 
 } // namespace render
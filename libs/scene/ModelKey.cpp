@@ -3,6 +3,7 @@
 #include <functional>
 
 #include "entitylib.h"
+#include "imodel.h"
 #include "imodelcache.h"
 #include "modelskin.h"
 #include "string/replace.h"
@@ -80,9 +81,22 @@ void ModelKey::attachModelNode()
         subscribeToModelDef(modelDef);
     }
 
-	// We have a non-empty model key, send the request to
-	// the model cache to acquire a new child node
-	_model.node = GlobalModelCache().getModelNode(actualModelPath);
+	if (GlobalModelCache().isLoadingInBackground(actualModelPath))
+	{
+		// Show a placeholder instead of waiting for the model, it's replaced once it's available
+		_pendingModelPath = actualModelPath;
+		_modelLoaded = GlobalModelCache().signal_modelsLoaded().connect(
+			sigc::mem_fun(this, &ModelKey::onModelsLoaded)
+		);
+
+		_model.node = GlobalModelFormatManager().getImporter("")->loadModel(actualModelPath);
+	}
+	else
+	{
+		// We have a non-empty model key, send the request to
+		// the model cache to acquire a new child node
+		_model.node = GlobalModelCache().getModelNode(actualModelPath);
+	}
 
 	// The model loader should not return NULL, but a sanity check is always ok
     if (!_model.node) return;
@@ -122,6 +136,9 @@ void ModelKey::detachModelNode()
 {
     unsubscribeFromModelDef();
 
+    _modelLoaded.disconnect();
+    _pendingModelPath.clear();
+
     if (!_model.node) return; // nothing to do
 
     _parentNode.removeChildNode(_model.node);
@@ -133,6 +150,14 @@ void ModelKey::onModelDefChanged()
     attachModelNodeKeepingSkin();
 }
 
+void ModelKey::onModelsLoaded(const std::set<std::string>& modelPaths)
+{
+    if (modelPaths.count(_pendingModelPath) == 0) return;
+
+    // Replace the placeholder, the model is in the cache now
+    attachModelNodeKeepingSkin();
+}
+
 void ModelKey::attachModelNodeKeepingSkin()
 {
     if (_model.node)
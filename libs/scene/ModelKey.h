@@ -1,5 +1,6 @@
 #pragma once
 
+#include <set>
 #include <string>
 #include "inode.h"
 #include "ieclass.h"
@@ -37,6 +38,10 @@ private:
 
     sigc::connection _modelDefChanged;
 
+    // Set while a placeholder is shown for a model loaded in the background
+    std::string _pendingModelPath;
+    sigc::connection _modelLoaded;
+
 public:
 	ModelKey(scene::INode& parentNode);
 
@@ -64,6 +69,7 @@ public:
 
 private:
     void onModelDefChanged();
+    void onModelsLoaded(const std::set<std::string>& modelPaths);
 
 	// Loads the model node and attaches it to the parent node
     void attachModelNode();
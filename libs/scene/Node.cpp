@@ -555,6 +555,6 @@ void Node::setRenderState(RenderState state)
     }
 }
 
-unsigned long Node::_maxNodeId = 0;
+std::atomic<unsigned long> Node::_maxNodeId(0);
 
 } // namespace scene
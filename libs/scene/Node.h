@@ -4,6 +4,7 @@
 #include "ipath.h"
 #include "irender.h"
 #include <list>
+#include <atomic>
 #include "TraversableNodeSet.h"
 #include "math/AABB.h"
 #include "math/Matrix4.h"
@@ -35,7 +36,8 @@ private:
 	unsigned long _id;
 
 	// Auto-incrementing ID (contains the largest ID in use)
-	static unsigned long _maxNodeId;
+	// Nodes might be constructed on more than one thread
+	static std::atomic<unsigned long> _maxNodeId;
 
 	TraversableNodeSet _children;
 
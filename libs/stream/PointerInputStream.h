@@ -1,43 +1,58 @@
 #pragma once
 
 #include "idatastream.h"
+#include <algorithm>
 
 namespace stream
 {
 
 /**
- * A class implementing the InputStream interface around a simple byte pointer. 
- * No bounds or validity checking is performed on the given pointer.
+ * A class implementing the InputStream interface around a simple byte pointer.
+ * No validity checking is performed on the given pointer. If a length is given,
+ * reads are not going past the end of the buffer, the missing bytes are zeroed.
  */
 class PointerInputStream : 
 	public InputStream
 {
 private:
-	const byte* _curPos;
+	const byte_type* _curPos;
+	const byte_type* _end;
 
 public:
-	PointerInputStream(const byte* pointer) : 
-		_curPos(pointer)
+	PointerInputStream(const byte_type* pointer) : 
+		_curPos(pointer),
+		_end(nullptr)
 	{}
 
-	std::size_t read(byte* buffer, std::size_t length) override
+	PointerInputStream(const byte_type* pointer, std::size_t length) :
+		_curPos(pointer),
+		_end(pointer + length)
+	{}
+
+	std::size_t read(byte_type* buffer, std::size_t length) override
 	{
-		const byte* end = _curPos + length;
+		std::size_t available = _end == nullptr ? length :
+			std::min(length, static_cast<std::size_t>(_end - _curPos));
+
+		const byte_type* end = _curPos + available;
 
 		while (_curPos != end)
 		{
 			*buffer++ = *_curPos++;
 		}
 
-		return length;
+		std::fill(buffer, buffer + (length - available), byte_type(0));
+
+		return available;
 	}
 
 	void seek(std::size_t offset)
 	{
-		_curPos += offset;
+		_curPos = _end == nullptr ? _curPos + offset :
+			_curPos + std::min(offset, static_cast<std::size_t>(_end - _curPos));
 	}
 
-	const byte* get()
+	const byte_type* get()
 	{
 		return _curPos;
 	}
@@ -31,4 +31,32 @@ public:
 	}
 };
 
+/**
+ * Read-only variant of the ScopedArchiveBuffer. If the given ArchiveFile
+ * exposes its data in memory (e.g. memory-mapped files), no copy is made,
+ * otherwise the file is read into an internal buffer.
+ * The data is not null-terminated, clients must not read past length.
+ */
+class ScopedArchiveData
+{
+private:
+	std::unique_ptr<InputStream::byte_type[]> _ownedData;
+
+public:
+	const InputStream::byte_type* data;
+	std::size_t length;
+
+	ScopedArchiveData(ArchiveFile& file) :
+		data(file.getMappedData()),
+		length(file.size())
+	{
+		if (data == nullptr)
+		{
+			_ownedData.reset(new InputStream::byte_type[file.size()]);
+			length = file.getInputStream().read(_ownedData.get(), file.size());
+			data = _ownedData.get();
+		}
+	}
+};
+
 }
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <unordered_set>
+
+namespace string
+{
+
+/**
+ * Returns a reference to a pooled copy of the given string. Equal strings share
+ * the same copy, which stays valid for the lifetime of the application.
+ *
+ * This is meant for a limited set of names stored many times over, like the
+ * material names in the undo mementos of brush faces, which can then be stored
+ * and compared as plain pointers.
+ */
+inline const std::string& intern(const std::string& input)
+{
+	static std::unordered_set<std::string> _pool;
+	static std::mutex _lock;
+
+	std::lock_guard<std::mutex> lock(_lock);
+
+	// The elements of an unordered_set don't move on rehash
+	return *_pool.insert(input).first;
+}
+
+}
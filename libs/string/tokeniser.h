@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <array>
+#include <cstdint>
 #include <cassert>
 
 namespace string
@@ -122,28 +124,71 @@ public:
 	}
 };
 
+/**
+* Lookup table assigning a class to each of the 256 possible char values,
+* used by the tokeniser functions to classify delimiters in constant time.
+*/
+class CharacterClassTable
+{
+public:
+	enum Class : std::uint8_t
+	{
+		Regular = 0,
+		Delimiter = 1,
+		KeptDelimiter = 2,
+	};
+
+private:
+	std::array<std::uint8_t, 256> _classes;
+
+public:
+	CharacterClassTable()
+	{
+		_classes.fill(Regular);
+	}
+
+	// Assigns the given class to every character in the given string
+	void assign(const char* characters, Class cls)
+	{
+		for (const char* c = characters; *c != 0; ++c)
+		{
+			_classes[static_cast<unsigned char>(*c)] = cls;
+		}
+	}
+
+	Class get(char c) const
+	{
+		return static_cast<Class>(_classes[static_cast<unsigned char>(c)]);
+	}
+
+	bool isDelimiter(char c) const
+	{
+		return get(c) == Delimiter;
+	}
+
+	bool isKeptDelimiter(char c) const
+	{
+		return get(c) == KeptDelimiter;
+	}
+};
+
 class CharTokeniserFunc 
 {
-	// List of delimiters
-	const char* _delims;
+	// Delimiter lookup table
+	CharacterClassTable _table;
 
 	// Test if a character is a delimiter
-	bool isDelim(char c)
+	bool isDelim(char c) const
 	{
-		const char* curDelim = _delims;
-		while (*curDelim != 0) {
-			if (*(curDelim++) == c) {
-				return true;
-			}
-		}
-		return false;
+		return _table.isDelimiter(c);
 	}
 
 public:
 	// Constructor
-	CharTokeniserFunc(const char* delims) : 
-		_delims(delims)
-	{}
+	CharTokeniserFunc(const char* delims)
+	{
+		_table.assign(delims, CharacterClassTable::Delimiter);
+	}
 
 	/* REQUIRED. Operator() is called by the string::tokeniser. This function
 	* must search for a token between the two iterators next and end, and if
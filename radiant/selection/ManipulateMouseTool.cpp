@@ -168,8 +168,11 @@ void ManipulateMouseTool::handleMouseMove(const render::View& view, const Vector
     }
 
 	// Get the component of the currently active manipulator (done by selection test)
-	// and call the transform method
-	activeManipulator->getActiveComponent()->transform(_pivot2worldStart, view, devicePoint, constraintFlag);
+	// and call the transform method, collecting the bounds changes of all affected nodes
+	{
+		scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+		activeManipulator->getActiveComponent()->transform(_pivot2worldStart, view, devicePoint, constraintFlag);
+	}
 
     onManipulationChanged();
 }
@@ -20,6 +20,7 @@
 #include "ieditstopwatch.h"
 #include "icounter.h"
 #include "icameraview.h"
+#include "imodelcache.h"
 
 #include "wxutil/menu/CommandMenuItem.h"
 #include "wxutil/MultiMonitor.h"
@@ -127,6 +128,8 @@ const StringSet& UserInterfaceModule::getDependencies() const
         MODULE_EDITING_STOPWATCH,
         MODULE_COUNTER,
         MODULE_CLIPPER,
+        MODULE_MODELCACHE,
+        MODULE_SHADERSYSTEM,
     };
 
 	return _dependencies;
@@ -252,6 +255,20 @@ void UserInterfaceModule::initialiseModule(const IApplicationContext& ctx)
     _reloadMaterialsConn = GlobalDeclarationManager().signal_DeclsReloaded(decl::Type::Material)
         .connect([this]() { dispatch([]() { GlobalMainFrame().updateAllWindows(); }); });
 
+    // Models and textures loaded in the background are swapped in on the main thread
+    // Both are announcing their loads in batches, the views are redrawn once per batch
+    auto mainThreadDispatcher = [this](const std::function<void()>& action)
+    {
+        dispatch([action]()
+        {
+            action();
+            GlobalMainFrame().updateAllWindows();
+        });
+    };
+
+    GlobalModelCache().setMainThreadDispatcher(mainThreadDispatcher);
+    GlobalMaterialManager().setMainThreadDispatcher(mainThreadDispatcher);
+
     registerControl(std::make_shared<ConsoleControl>());
     registerControl(std::make_shared<SurfaceInspectorControl>());
     registerControl(std::make_shared<LayerControl>());
@@ -313,6 +330,9 @@ void UserInterfaceModule::shutdownModule()
     _userControls.clear();
     _autosaveTimer.reset();
 
+    GlobalModelCache().setMainThreadDispatcher(model::IModelCache::MainThreadDispatcher());
+    GlobalMaterialManager().setMainThreadDispatcher(IMaterialManager::MainThreadDispatcher());
+
 	wxTheApp->Unbind(DISPATCH_EVENT, &UserInterfaceModule::onDispatchEvent, this);
 
 	GlobalRadiantCore().getMessageBus().removeListener(_execFailedListener);
@@ -77,9 +77,18 @@ void AasFileControl::ensureAasFileLoaded()
 
         if (loader && loader->canLoad(stream))
         {
-            stream.seekg(0, std::ios_base::beg);
-
-            _aasFile = loader->loadFromStream(stream);
+            // Large files are memory-mapped, these can be parsed in place
+            auto mappedData = file->getMappedData();
+
+            if (!mappedData.empty())
+            {
+                _aasFile = loader->loadFromBuffer(mappedData);
+            }
+            else
+            {
+                stream.seekg(0, std::ios_base::beg);
+                _aasFile = loader->loadFromStream(stream);
+            }
 
             // Construct a renderable to attach to the rendersystem
             _renderable.setAasFile(_aasFile);
@@ -49,6 +49,12 @@ namespace
 
     constexpr int VIEWPORT_BORDER = 12;
     constexpr int TILE_BORDER = 2;
+
+    // Time spent per redraw uploading textures decoded in the background
+    constexpr std::chrono::milliseconds TEXTURE_UPLOAD_BUDGET(8);
+
+    // Unscaled size of the tiles of textures which are not decoded yet
+    constexpr int PLACEHOLDER_TEXTURE_SIZE = 128;
 }
 
 class TextureThumbnailBrowser::TextureTile
@@ -230,6 +236,11 @@ TextureThumbnailBrowser::TextureThumbnailBrowser(wxWindow* parent, bool showTool
 
     loadScaleFromRegistry();
 
+    // Tiles of textures decoded in the background get their real size now
+    GlobalMaterialManager().signal_texturesDecoded().connect(
+        sigc::mem_fun(this, &TextureThumbnailBrowser::queueUpdate)
+    );
+
     _shader = texdef_name_default();
 
     _shaderLabel = new wxutil::IconTextMenuItem(_("No shader"), TEXTURE_ICON);
@@ -422,6 +433,12 @@ void TextureThumbnailBrowser::keyChanged()
 // Return the display width of a texture in the texture browser
 int TextureThumbnailBrowser::getTextureWidth(const Texture& tex) const
 {
+    // Don't wait for textures still being decoded, lay them out as squares
+    if (!tex.isLoaded())
+    {
+        return getPlaceholderSize();
+    }
+
     if (!_useUniformScale)
     {
         // Don't use uniform scale
@@ -443,6 +460,11 @@ int TextureThumbnailBrowser::getTextureWidth(const Texture& tex) const
 
 int TextureThumbnailBrowser::getTextureHeight(const Texture& tex) const
 {
+    if (!tex.isLoaded())
+    {
+        return getPlaceholderSize();
+    }
+
     if (!_useUniformScale)
     {
         // Don't use uniform scale
@@ -463,6 +485,12 @@ int TextureThumbnailBrowser::getTextureHeight(const Texture& tex) const
     }
 }
 
+int TextureThumbnailBrowser::getPlaceholderSize() const
+{
+    return _useUniformScale ? _uniformTextureSize :
+        static_cast<int>(PLACEHOLDER_TEXTURE_SIZE * (static_cast<float>(_textureScale) / 100));
+}
+
 const std::string& TextureThumbnailBrowser::getSelectedShader() const
 {
     return _shader;
@@ -709,6 +737,13 @@ void TextureThumbnailBrowser::draw()
 		return;
 	}
 
+    // Fill in the thumbnails which finished decoding in the background, keep
+    // refreshing (without forcing an immediate paint) while there are some left
+    if (GlobalMaterialManager().uploadPendingTextures(TEXTURE_UPLOAD_BUDGET))
+    {
+        _wxGLWidget->Refresh(false);
+    }
+
 	glPushAttrib(GL_ALL_ATTRIB_BITS);
 
     debug::assertNoGlErrors();
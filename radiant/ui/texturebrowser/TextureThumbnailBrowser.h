@@ -164,6 +164,9 @@ private:
     int getTextureWidth(const Texture& tex) const;
     int getTextureHeight(const Texture& tex) const;
 
+    // The display size of textures whose dimensions are not known yet
+    int getPlaceholderSize() const;
+
     // Get a new position for the given texture, and advance the CurrentPosition
     // state object.
     Vector2i getNextPositionForTexture(const Texture& texture);
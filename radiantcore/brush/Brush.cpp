@@ -340,6 +340,20 @@ void Brush::importState(const IUndoMementoPtr& state)
     }
 }
 
+IUndoMementoPtr Brush::getStateDelta(const IUndoMementoPtr& state) const
+{
+    const auto& memento = static_cast<const BrushUndoMemento&>(*state);
+
+    // The faces are saving their own state, the brush memento only
+    // needs to be kept if the face list or the detail flag changed
+    if (memento._detailFlag == _detailFlag && memento._faces == m_faces)
+    {
+        return IUndoMementoPtr();
+    }
+
+    return state;
+}
+
 /// \brief Appends a copy of \p face to the end of the face list.
 FacePtr Brush::addFace(const Face& face) {
     if (m_faces.size() == brush::c_brush_maxFaces) {
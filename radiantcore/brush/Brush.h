@@ -155,6 +155,11 @@ public:
 
 		Faces _faces;
 		DetailFlag _detailFlag;
+
+		std::size_t getMemoryUsage() const override
+		{
+			return sizeof(BrushUndoMemento) + _faces.capacity() * sizeof(FacePtr);
+		}
 	};
 
 	static double m_maxWorldCoord;
@@ -238,6 +243,7 @@ public:
 	void undoSave() override;
 	IUndoMementoPtr exportState() const override;
 	void importState(const IUndoMementoPtr& state) override;
+	IUndoMementoPtr getStateDelta(const IUndoMementoPtr& state) const override;
 
 	/// \brief Appends a copy of \p face to the end of the face list.
 	FacePtr addFace(const Face& face);
@@ -10,6 +10,7 @@
 #include "texturelib.h"
 #include "Winding.h"
 #include "selection/algorithm/Texturing.h"
+#include "string/intern.h"
 
 #include "Brush.h"
 #include "BrushNode.h"
@@ -22,13 +23,42 @@ class Face::SavedState final :
 public:
     FacePlane::SavedState _planeState;
     TextureProjection _texdefState;
-    std::string _materialName;
+
+    // Most faces of a map share a few materials, keep a pooled name
+    const std::string& _materialName;
 
     SavedState(const Face& face) :
         _planeState(face.getPlane()),
         _texdefState(face.getProjection()),
-        _materialName(face.getShader())
+        _materialName(string::intern(face.getShader()))
     {}
+
+    std::size_t getMemoryUsage() const override
+    {
+        return sizeof(SavedState);
+    }
+};
+
+// The parts of a face state changed by an undoable operation. The plane is
+// changed by almost every operation, texture and material are stored only
+// if they differ from the face's state after the operation.
+class Face::StateDelta final :
+    public IUndoMemento
+{
+public:
+    FacePlane::SavedState _planeState;
+    std::unique_ptr<TextureProjection> _texdefState;
+    const std::string* _materialName;
+
+    StateDelta(const SavedState& state) :
+        _planeState(state._planeState),
+        _materialName(nullptr)
+    {}
+
+    std::size_t getMemoryUsage() const override
+    {
+        return sizeof(StateDelta) + (_texdefState ? sizeof(TextureProjection) : 0);
+    }
 };
 
 Face::Face(Brush& owner) :
@@ -208,11 +238,29 @@ void Face::importState(const IUndoMementoPtr& data)
 {
     undoSave();
 
-    auto state = std::static_pointer_cast<SavedState>(data);
+    if (auto delta = std::dynamic_pointer_cast<StateDelta>(data); delta)
+    {
+        delta->_planeState.exportState(getPlane());
 
-    state->_planeState.exportState(getPlane());
-    setShader(state->_materialName);
-    _texdef = state->_texdefState;
+        // Assigning the material rescales the texture, restore the texdef afterwards
+        if (delta->_materialName)
+        {
+            setShader(*delta->_materialName);
+        }
+
+        if (delta->_texdefState)
+        {
+            _texdef = *delta->_texdefState;
+        }
+    }
+    else
+    {
+        auto state = std::static_pointer_cast<SavedState>(data);
+
+        state->_planeState.exportState(getPlane());
+        setShader(state->_materialName);
+        _texdef = state->_texdefState;
+    }
 
     planeChanged();
     _owner.onFaceConnectivityChanged();
@@ -220,6 +268,36 @@ void Face::importState(const IUndoMementoPtr& data)
     _owner.onFaceShaderChanged();
 }
 
+IUndoMementoPtr Face::getStateDelta(const IUndoMementoPtr& data) const
+{
+    const auto& state = static_cast<const SavedState&>(*data);
+    const auto& plane = state._planeState.m_plane;
+
+    // Plane3::operator== is using an epsilon, the restored state needs to be exact
+    bool planeChanged = plane.normal() != getPlane3().normal() || plane.dist() != getPlane3().dist();
+    bool materialChanged = state._materialName != getShader();
+    bool texdefChanged = materialChanged || state._texdefState.getMatrix() != _texdef.getMatrix();
+
+    if (!planeChanged && !texdefChanged)
+    {
+        return IUndoMementoPtr(); // nothing to restore
+    }
+
+    auto delta = std::make_shared<StateDelta>(state);
+
+    if (texdefChanged)
+    {
+        delta->_texdefState = std::make_unique<TextureProjection>(state._texdefState);
+    }
+
+    if (materialChanged)
+    {
+        delta->_materialName = &state._materialName;
+    }
+
+    return delta;
+}
+
 void Face::flipWinding() {
     m_plane.reverse();
     planeChanged();
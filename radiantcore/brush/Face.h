@@ -33,6 +33,9 @@ private:
     // The structure which is saved to the undo stack
     class SavedState;
 
+    // The changed parts of a saved state, see getStateDelta()
+    class StateDelta;
+
 public:
 	PlanePoints m_move_planepts;
 	PlanePoints m_move_planeptsTransformed;
@@ -99,6 +102,7 @@ public:
 	// undoable
 	IUndoMementoPtr exportState() const override;
 	void importState(const IUndoMementoPtr& data) override;
+	IUndoMementoPtr getStateDelta(const IUndoMementoPtr& data) const override;
 
     /// Translate the face by the given vector
     void translate(const Vector3& translation);
@@ -4,6 +4,9 @@
 #include "parser/DefBlockSyntaxParser.h"
 #include "string/trim.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace decl
 {
 
@@ -25,24 +28,87 @@ namespace
 
         return syntax;
     }
+
+    // Upper limit of threads used by a single folder parser, several folders are parsed at once
+    constexpr std::size_t MAX_WORKERS_PER_FOLDER = 4;
+
+    std::size_t getNumWorkers()
+    {
+        auto numCores = static_cast<std::size_t>(std::thread::hardware_concurrency());
+        return std::clamp(numCores, static_cast<std::size_t>(1), MAX_WORKERS_PER_FOLDER);
+    }
 }
 
 DeclarationFolderParser::DeclarationFolderParser(DeclarationManager& owner, Type declType, 
     const std::string& baseDir, const std::string& extension,
-    const std::map<std::string, Type, string::ILess>& typeMapping) :
-    ThreadedDeclParser<void>(declType, baseDir, extension, 1),
+    const std::map<std::string, Type, string::ILess>& typeMapping, DeclarationParseCache* cache) :
+    ThreadedDeclParser<void>(declType, baseDir, extension, 1, getNumWorkers()),
     _owner(owner),
     _typeMapping(typeMapping),
-    _defaultDeclType(declType)
+    _defaultDeclType(declType),
+    _cache(cache)
 {}
 
-void DeclarationFolderParser::parse(std::istream& stream, const vfs::FileInfo& fileInfo, const std::string& modDir)
+void DeclarationFolderParser::onBeginParsingFiles(std::size_t numFiles)
+{
+    _blocksByFile.clear();
+    _blocksByFile.resize(numFiles);
+
+    _stampsByFile.clear();
+    _stampsByFile.resize(numFiles);
+}
+
+bool DeclarationFolderParser::tryLoadFromCache(const vfs::FileInfo& fileInfo, std::size_t fileIndex)
+{
+    if (!_cache) return false;
+
+    // Determine the stamp before the file is opened, should the file be changed
+    // in the meantime the stored entry will just be outdated on the next run
+    DeclarationParseCache::FileStamp stamp;
+
+    if (!DeclarationParseCache::GetFileStamp(fileInfo, stamp)) return false;
+
+    std::string modName;
+    std::vector<DeclarationParseCache::Block> cachedBlocks;
+
+    if (!_cache->tryGetBlocks(fileInfo.fullPath(), stamp, modName, cachedBlocks))
+    {
+        // Remember the stamp to store the parse result afterwards
+        _stampsByFile[fileIndex] = std::move(stamp);
+        return false;
+    }
+
+    auto& blocks = _blocksByFile[fileIndex];
+    blocks.reserve(cachedBlocks.size());
+
+    for (auto& cachedBlock : cachedBlocks)
+    {
+        auto& syntax = blocks.emplace_back();
+
+        syntax.typeName = std::move(cachedBlock.typeName);
+        syntax.name = std::move(cachedBlock.name);
+        syntax.contents = std::move(cachedBlock.contents);
+        syntax.modName = modName;
+        syntax.fileInfo = fileInfo;
+    }
+
+    return true;
+}
+
+void DeclarationFolderParser::parse(std::istream& stream, const vfs::FileInfo& fileInfo,
+    const std::string& modDir, std::size_t fileIndex)
 {
     // Parse the incoming stream into syntax blocks
     parser::DefBlockSyntaxParser<std::istream> parser(stream);
 
     auto syntaxTree = parser.parse();
 
+    const auto& stamp = _stampsByFile[fileIndex];
+    std::vector<DeclarationParseCache::Block> blocksToCache;
+
+    // Only this thread is accessing the slot of this file
+    auto& blocks = _blocksByFile[fileIndex];
+
     for (const auto& node : syntaxTree->getRoot()->getChildren())
     {
         if (node->getType() != parser::DefSyntaxNode::Type::DeclBlock)
@@ -53,17 +119,40 @@ void DeclarationFolderParser::parse(std::istream& stream, const vfs::FileInfo& f
         const auto& blockNode = static_cast<const parser::DefBlockSyntax&>(*node);
 
         // Convert the incoming block to a DeclarationBlockSyntax
-        auto blockSyntax = createBlock(blockNode, fileInfo, modDir);
+        auto& blockSyntax = blocks.emplace_back(createBlock(blockNode, fileInfo, modDir));
 
-        // Move the block in the correct bucket
-        auto declType = determineBlockType(blockSyntax);
-        auto& blockList = _parsedBlocks.try_emplace(declType).first->second;
-        blockList.emplace_back(std::move(blockSyntax));
+        if (stamp)
+        {
+            blocksToCache.emplace_back(DeclarationParseCache::Block{
+                blockSyntax.typeName, blockSyntax.name, blockSyntax.contents
+            });
+        }
+    }
+
+    if (stamp)
+    {
+        _cache->storeBlocks(fileInfo.fullPath(), *stamp, modDir, std::move(blocksToCache));
     }
 }
 
 void DeclarationFolderParser::onFinishParsing()
 {
+    // Merge the per-file results in file order, such that later blocks
+    // override earlier ones regardless of which thread parsed them
+    for (auto& blocks : _blocksByFile)
+    {
+        for (auto& block : blocks)
+        {
+            // Move the block in the correct bucket
+            auto declType = determineBlockType(block);
+            auto& blockList = _parsedBlocks.try_emplace(declType).first->second;
+            blockList.emplace_back(std::move(block));
+        }
+    }
+
+    _blocksByFile.clear();
+    _stampsByFile.clear();
+
     // Submit all parsed declarations to the decl manager
     _owner.onParserFinished(_defaultDeclType, _parsedBlocks);
 }
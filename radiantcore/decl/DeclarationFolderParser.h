@@ -1,8 +1,10 @@
 #pragma once
 
 #include <map>
+#include <optional>
 #include "ideclmanager.h"
 #include "DeclarationFile.h"
+#include "DeclarationParseCache.h"
 
 #include "parser/ThreadedDeclParser.h"
 #include "string/string.h"
@@ -28,13 +30,24 @@ private:
     // Holds all the identified blocks of all visited files
     ParseResult _parsedBlocks;
 
+    // Files may be parsed concurrently, each file gets its own slot for its blocks
+    // The slots are merged into _parsedBlocks in file order once all are done
+    std::vector<std::vector<DeclarationBlockSyntax>> _blocksByFile;
+
     // The default type to assign to untyped blocks
     Type _defaultDeclType;
 
+    // Optional cache to look up unchanged files and store freshly parsed ones
+    DeclarationParseCache* _cache;
+
+    // Stamps of the files about to be parsed, determined in tryLoadFromCache
+    std::vector<std::optional<DeclarationParseCache::FileStamp>> _stampsByFile;
+
 public:
     DeclarationFolderParser(DeclarationManager& owner, Type declType,
         const std::string& baseDir, const std::string& extension,
-        const std::map<std::string, Type, string::ILess>& typeMapping);
+        const std::map<std::string, Type, string::ILess>& typeMapping,
+        DeclarationParseCache* cache = nullptr);
 
     ~DeclarationFolderParser() override
     {
@@ -43,7 +56,10 @@ public:
     }
 
 protected:
-    void parse(std::istream& stream, const vfs::FileInfo& fileInfo, const std::string& modDir) override;
+    void onBeginParsingFiles(std::size_t numFiles) override;
+    void parse(std::istream& stream, const vfs::FileInfo& fileInfo,
+        const std::string& modDir, std::size_t fileIndex) override;
+    bool tryLoadFromCache(const vfs::FileInfo& fileInfo, std::size_t fileIndex) override;
     void onFinishParsing() override;
 
 private:
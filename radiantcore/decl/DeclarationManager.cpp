@@ -69,7 +69,8 @@ void DeclarationManager::registerDeclFolder(Type defaultType, const std::string&
     auto& decls = _declarationsByType.try_emplace(defaultType, Declarations()).first->second;
 
     // Start the parser thread
-    decls.parser = std::make_unique<DeclarationFolderParser>(*this, defaultType, vfsPath, extension, getTypenameMapping());
+    decls.parser = std::make_unique<DeclarationFolderParser>(*this, defaultType, vfsPath, extension,
+        getTypenameMapping(), &_parseCache);
     decls.parser->start();
 }
 
@@ -363,7 +364,8 @@ void DeclarationManager::runParsersForAllFolders()
         for (const auto& folder : _registeredFolders)
         {
             auto& parser = parsers.emplace_back(
-                std::make_unique<DeclarationFolderParser>(*this, folder.defaultType, folder.folder, folder.extension, typeMapping)
+                std::make_unique<DeclarationFolderParser>(*this, folder.defaultType, folder.folder,
+                    folder.extension, typeMapping, &_parseCache)
             );
             parser->start();
         }
@@ -974,6 +976,9 @@ void DeclarationManager::initialiseModule(const IApplicationContext& ctx)
     _parseStamp = 0;
     _reparseInProgress = false;
 
+    _parseCachePath = ctx.getCacheDataPath() + "declcache.bin";
+    _parseCache.loadFromFile(_parseCachePath);
+
     _vfsInitialisedConn = GlobalFileSystem().signal_Initialised().connect(
         sigc::mem_fun(*this, &DeclarationManager::onFilesystemInitialised)
     );
@@ -994,6 +999,9 @@ void DeclarationManager::shutdownModule()
     waitForTypedParsersToFinish();
     waitForSignalInvokersToFinish();
 
+    _parseCache.saveToFile(_parseCachePath);
+    _parseCache.clear();
+
     // All parsers and tasks have finished, clear all structures, no need to lock anything
     _parserCleanupTasks.clear();
     _registeredFolders.clear();
@@ -10,6 +10,7 @@
 
 #include "DeclarationFile.h"
 #include "DeclarationFolderParser.h"
+#include "DeclarationParseCache.h"
 
 namespace decl
 {
@@ -76,6 +77,10 @@ private:
     // Access allowed if the _declarationAndCreatorLock is owned
     std::vector<std::shared_ptr<std::shared_future<void>>> _parserCleanupTasks;
 
+    // Parsed blocks of unchanged files are taken from this cache, persisted between sessions
+    DeclarationParseCache _parseCache;
+    std::string _parseCachePath;
+
 public:
     void registerDeclType(const std::string& typeName, const IDeclarationCreator::Ptr& parser) override;
     void unregisterDeclType(const std::string& typeName) override;
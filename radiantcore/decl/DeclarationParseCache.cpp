@@ -0,0 +1,274 @@
+#include "DeclarationParseCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include "itextstream.h"
+#include "os/fs.h"
+#include "os/path.h"
+#include "stream/utils.h"
+
+namespace decl
+{
+
+namespace
+{
+    constexpr char CACHE_MAGIC[4] = { 'D', 'R', 'D', 'C' };
+
+    // Increase this whenever the binary layout or the block parsing changes
+    constexpr std::uint32_t CACHE_VERSION = 1;
+
+    // Upper bound for string lengths, anything above is considered corrupt
+    constexpr std::uint32_t MAX_STRING_LENGTH = 64 * 1024 * 1024;
+
+    void writeString(std::ostream& stream, const std::string& value)
+    {
+        stream::writeLittleEndian<std::uint32_t>(stream, static_cast<std::uint32_t>(value.size()));
+        stream.write(value.data(), value.size());
+    }
+
+    template<typename ValueType>
+    ValueType readValue(std::istream& stream)
+    {
+        ValueType value = 0;
+        stream.read(reinterpret_cast<char*>(&value), sizeof(ValueType));
+
+        if (!stream)
+        {
+            throw std::runtime_error("Unexpected end of file");
+        }
+
+#ifdef __BIG_ENDIAN__
+        std::reverse(reinterpret_cast<char*>(&value), reinterpret_cast<char*>(&value) + sizeof(ValueType));
+#endif
+        return value;
+    }
+
+    std::string readString(std::istream& stream)
+    {
+        auto length = readValue<std::uint32_t>(stream);
+
+        if (length > MAX_STRING_LENGTH)
+        {
+            throw std::runtime_error("Invalid string length");
+        }
+
+        std::string value(length, '\0');
+        stream.read(value.data(), length);
+
+        if (!stream)
+        {
+            throw std::runtime_error("Unexpected end of file");
+        }
+
+        return value;
+    }
+}
+
+bool DeclarationParseCache::GetFileStamp(const vfs::FileInfo& fileInfo, FileStamp& stamp)
+{
+    stamp.archivePath = fileInfo.getArchivePath();
+
+    if (stamp.archivePath.empty())
+    {
+        return false;
+    }
+
+    // Physical files carry their own timestamp, files in PK4s use the one of the archive
+    fs::path path = fileInfo.getIsPhysicalFile() ?
+        fs::path(os::standardPathWithSlash(stamp.archivePath) + fileInfo.fullPath()) :
+        fs::path(stamp.archivePath);
+
+    std::error_code ec;
+    auto modificationTime = fs::last_write_time(path, ec);
+
+    if (ec)
+    {
+        return false;
+    }
+
+    stamp.size = fileInfo.getSize();
+    stamp.modificationTime = static_cast<std::int64_t>(modificationTime.time_since_epoch().count());
+
+    return true;
+}
+
+bool DeclarationParseCache::tryGetBlocks(const std::string& vfsPath, const FileStamp& stamp,
+    std::string& modName, std::vector<Block>& blocks)
+{
+    std::lock_guard lock(_lock);
+
+    auto entry = _entries.find(vfsPath);
+
+    if (entry == _entries.end() || !(entry->second.stamp == stamp))
+    {
+        return false;
+    }
+
+    entry->second.used = true;
+
+    modName = entry->second.modName;
+    blocks = entry->second.blocks;
+
+    return true;
+}
+
+void DeclarationParseCache::storeBlocks(const std::string& vfsPath, const FileStamp& stamp,
+    const std::string& modName, std::vector<Block> blocks)
+{
+    std::lock_guard lock(_lock);
+
+    auto& entry = _entries[vfsPath];
+
+    entry.stamp = stamp;
+    entry.modName = modName;
+    entry.blocks = std::move(blocks);
+    entry.used = true;
+
+    _changed = true;
+}
+
+void DeclarationParseCache::loadFromFile(const std::string& path)
+{
+    std::lock_guard lock(_lock);
+
+    _entries.clear();
+    _changed = false;
+
+    std::ifstream stream(path, std::ios::binary);
+
+    if (!stream)
+    {
+        return;
+    }
+
+    try
+    {
+        char magic[sizeof(CACHE_MAGIC)];
+        stream.read(magic, sizeof(magic));
+
+        if (!stream || !std::equal(magic, magic + sizeof(magic), CACHE_MAGIC) ||
+            readValue<std::uint32_t>(stream) != CACHE_VERSION)
+        {
+            rMessage() << "[DeclParseCache] Ignoring outdated cache file " << path << std::endl;
+            return;
+        }
+
+        auto numEntries = readValue<std::uint32_t>(stream);
+
+        for (std::uint32_t i = 0; i < numEntries; ++i)
+        {
+            auto vfsPath = readString(stream);
+            auto& entry = _entries[vfsPath];
+
+            entry.stamp.archivePath = readString(stream);
+            entry.stamp.size = readValue<std::uint64_t>(stream);
+            entry.stamp.modificationTime = readValue<std::int64_t>(stream);
+            entry.modName = readString(stream);
+
+            auto numBlocks = readValue<std::uint32_t>(stream);
+
+            for (std::uint32_t b = 0; b < numBlocks; ++b)
+            {
+                auto& block = entry.blocks.emplace_back();
+
+                block.typeName = readString(stream);
+                block.name = readString(stream);
+                block.contents = readString(stream);
+            }
+        }
+
+        rMessage() << "[DeclParseCache] Loaded " << _entries.size() << " cached files" << std::endl;
+    }
+    catch (const std::runtime_error& ex)
+    {
+        rWarning() << "[DeclParseCache] Discarding corrupt cache file " << path
+            << ": " << ex.what() << std::endl;
+        _entries.clear();
+    }
+}
+
+void DeclarationParseCache::saveToFile(const std::string& path)
+{
+    std::lock_guard lock(_lock);
+
+    // Drop all entries of files that haven't been visited since loading
+    for (auto entry = _entries.begin(); entry != _entries.end();)
+    {
+        if (!entry->second.used)
+        {
+            _changed = true;
+            _entries.erase(entry++);
+            continue;
+        }
+
+        ++entry;
+    }
+
+    if (!_changed)
+    {
+        return;
+    }
+
+    // Write to a temporary file first, a half-written cache is worse than none
+    auto temporaryPath = path + ".tmp";
+
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary);
+
+        if (!stream)
+        {
+            rWarning() << "[DeclParseCache] Cannot open " << temporaryPath << " for writing" << std::endl;
+            return;
+        }
+
+        stream.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        stream::writeLittleEndian<std::uint32_t>(stream, CACHE_VERSION);
+        stream::writeLittleEndian<std::uint32_t>(stream, static_cast<std::uint32_t>(_entries.size()));
+
+        for (const auto& [vfsPath, entry] : _entries)
+        {
+            writeString(stream, vfsPath);
+            writeString(stream, entry.stamp.archivePath);
+            stream::writeLittleEndian<std::uint64_t>(stream, entry.stamp.size);
+            stream::writeLittleEndian<std::int64_t>(stream, entry.stamp.modificationTime);
+            writeString(stream, entry.modName);
+
+            stream::writeLittleEndian<std::uint32_t>(stream, static_cast<std::uint32_t>(entry.blocks.size()));
+
+            for (const auto& block : entry.blocks)
+            {
+                writeString(stream, block.typeName);
+                writeString(stream, block.name);
+                writeString(stream, block.contents);
+            }
+        }
+
+        if (!stream)
+        {
+            rWarning() << "[DeclParseCache] Failed to write " << temporaryPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temporaryPath, path, ec);
+
+    if (ec)
+    {
+        rWarning() << "[DeclParseCache] Failed to replace " << path << ": " << ec.message() << std::endl;
+        fs::remove(temporaryPath, ec);
+        return;
+    }
+
+    _changed = false;
+}
+
+void DeclarationParseCache::clear()
+{
+    std::lock_guard lock(_lock);
+
+    _entries.clear();
+    _changed = false;
+}
+
+}
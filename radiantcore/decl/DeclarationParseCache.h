@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ifilesystem.h"
+
+namespace decl
+{
+
+/**
+ * Persistent cache of the declaration blocks found in each decl file.
+ *
+ * Entries are keyed by the file's VFS path and are only valid as long as the
+ * stamp (containing archive, file size and modification time) matches the
+ * file currently visible in the VFS. Files with an up-to-date entry can be
+ * processed by the folder parsers without tokenising their contents.
+ *
+ * All public methods are thread-safe, the cache is shared by all parsers.
+ */
+class DeclarationParseCache
+{
+public:
+    // Identifies one specific version of a VFS file
+    struct FileStamp
+    {
+        std::string archivePath;
+        std::uint64_t size = 0;
+        std::int64_t modificationTime = 0;
+
+        bool operator==(const FileStamp& other) const
+        {
+            return size == other.size && modificationTime == other.modificationTime &&
+                archivePath == other.archivePath;
+        }
+    };
+
+    // The parts of a DeclarationBlockSyntax that are derived from the file contents
+    struct Block
+    {
+        std::string typeName;
+        std::string name;
+        std::string contents;
+    };
+
+private:
+    struct Entry
+    {
+        FileStamp stamp;
+        std::string modName;
+        std::vector<Block> blocks;
+
+        // Whether this entry has been requested or stored since loading the cache
+        bool used = false;
+    };
+
+    std::map<std::string, Entry> _entries;
+    std::mutex _lock;
+
+    // True if entries have been changed since the last save
+    bool _changed = false;
+
+public:
+    // Determines the stamp of the given file. Returns false if the file
+    // (or its containing archive) can't be inspected on disk
+    static bool GetFileStamp(const vfs::FileInfo& fileInfo, FileStamp& stamp);
+
+    // Looks up the blocks of the given file, returns true if an entry with
+    // a matching stamp was found, false otherwise.
+    bool tryGetBlocks(const std::string& vfsPath, const FileStamp& stamp,
+        std::string& modName, std::vector<Block>& blocks);
+
+    // Stores the blocks found in the given file, replacing any previous entry
+    void storeBlocks(const std::string& vfsPath, const FileStamp& stamp,
+        const std::string& modName, std::vector<Block> blocks);
+
+    // Replaces the cache contents with the data found in the given file.
+    // A missing or malformed file will leave the cache empty.
+    void loadFromFile(const std::string& path);
+
+    // Writes all entries that have been used since loading to the given file.
+    // Does nothing if no entry has been changed.
+    void saveToFile(const std::string& path);
+
+    void clear();
+};
+
+}
@@ -1,6 +1,7 @@
 #include "BasicFilterSystem.h"
 
 #include <functional>
+#include <algorithm>
 
 #include "iradiant.h"
 #include "itextstream.h"
@@ -8,6 +9,10 @@
 #include "iregistry.h"
 #include "igame.h"
 #include "ishaders.h"
+#include "ieclass.h"
+#include "scene/Entity.h"
+#include "string/case_conv.h"
+#include "string/predicate.h"
 
 #include "module/StaticModule.h"
 #include "InstanceUpdateWalker.h"
@@ -43,7 +48,7 @@ void BasicFilterSystem::setAllFilterStates(bool state)
 
 	// Invalidate the visibility cache to force new values to be
 	// loaded from the filters themselves
-	_visibilityCache.clear();
+	invalidateVisibilityCache();
 
 	// Update the scenegraph instances
 	update();
@@ -51,7 +56,7 @@ void BasicFilterSystem::setAllFilterStates(bool state)
 	_filterConfigChangedSignal.emit();
 
 	// Trigger an immediate scene redraw
-	GlobalSceneGraph().sceneChanged();
+	notifySceneChanged();
 }
 
 void BasicFilterSystem::setAllFilterStatesCmd(const cmd::ArgumentList& args)
@@ -165,6 +170,13 @@ void BasicFilterSystem::initialiseModule(const IApplicationContext& ctx)
 	// user-defined filters
 	addFiltersFromXML(userFilters, false);
 
+	invalidateVisibilityCache();
+
+	// Keep track of the filterable nodes in the scene
+	_nodeIndex = std::make_unique<FilterNodeIndex>(
+		std::bind(&BasicFilterSystem::onEntityKeyChanged, this, std::placeholders::_1, std::placeholders::_2));
+	GlobalSceneGraph().addSceneObserver(_nodeIndex.get());
+
 	// Add the (de-)activate all commands
 	GlobalCommandSystem().addCommand("SetAllFilterStates",
 		std::bind(&BasicFilterSystem::setAllFilterStatesCmd, this, std::placeholders::_1), { cmd::ARGTYPE_INT });
@@ -271,6 +283,9 @@ XmlFilterEventAdapter::Ptr BasicFilterSystem::ensureEventAdapter(XMLFilter& filt
 // Shut down the Filters module, saving active filters to registry
 void BasicFilterSystem::shutdownModule()
 {
+	GlobalSceneGraph().removeSceneObserver(_nodeIndex.get());
+	_nodeIndex.reset();
+
 	// Remove the existing set of active filter nodes
 	GlobalRegistry().deleteXPath(RKEY_USER_ACTIVE_FILTERS);
 
@@ -324,6 +339,7 @@ void BasicFilterSystem::shutdownModule()
 	}
 
 	_visibilityCache.clear();
+	_entityKeysInUse.clear();
 	_eventAdapters.clear();
 	_activeFilters.clear();
 	_availableFilters.clear();
@@ -377,10 +393,12 @@ void BasicFilterSystem::setFilterState(const std::string& filter, bool state)
 {
 	assert(!_availableFilters.empty());
 
+	auto toggledFilter = _availableFilters.find(filter)->second;
+
 	if (state)
 	{
 		// Copy the filter to the active filters list
-		_activeFilters.emplace(filter, _availableFilters.find(filter)->second);
+		_activeFilters.emplace(filter, toggledFilter);
 	}
 	else
 	{
@@ -391,15 +409,15 @@ void BasicFilterSystem::setFilterState(const std::string& filter, bool state)
 
 	// Invalidate the visibility cache to force new values to be
 	// loaded from the filters themselves
-	_visibilityCache.clear();
+	invalidateVisibilityCache();
 
-	// Update the scenegraph instances
-	update();
+	// Update the scenegraph instances affected by this filter
+	updateAffectedNodes(*toggledFilter);
 
 	_filterConfigChangedSignal.emit();
 
 	// Trigger an immediate scene redraw
-	GlobalSceneGraph().sceneChanged();
+	notifySceneChanged();
 }
 
 bool BasicFilterSystem::filterIsReadOnly(const std::string& filter)
@@ -454,6 +472,9 @@ bool BasicFilterSystem::removeFilter(const std::string& filter)
 		_activeFilters.erase(found);
 	}
 
+	// Keep the filter alive until its nodes have been updated
+	auto removedFilter = f->second;
+
 	// Now remove the object from the available filters too
 	_availableFilters.erase(f);
 
@@ -462,11 +483,11 @@ bool BasicFilterSystem::removeFilter(const std::string& filter)
 	if (wasActive)
 	{
 		// Clear the cache, the rules have changed
-		_visibilityCache.clear();
+		invalidateVisibilityCache();
 
 		_filterConfigChangedSignal.emit();
 
-		update();
+		updateAffectedNodes(*removedFilter);
 	}
 
 	return true;
@@ -540,9 +561,10 @@ bool BasicFilterSystem::isVisible(const FilterRule::Type type, const std::string
 {
 	// Check if this item is in the visibility cache, returning
 	// its cached value if found
-	auto cacheIter = _visibilityCache.find(name);
+	auto& cache = _visibilityCache[type];
+	auto cacheIter = cache.find(name);
 
-	if (cacheIter != _visibilityCache.end())
+	if (cacheIter != cache.end())
 	{
 		return cacheIter->second;
 	}
@@ -564,13 +586,42 @@ bool BasicFilterSystem::isVisible(const FilterRule::Type type, const std::string
 	}
 
 	// Cache the result and return to caller
-	_visibilityCache.emplace(name, visFlag);
+	cache.emplace(name, visFlag);
 
 	return visFlag;
 }
 
 bool BasicFilterSystem::isEntityVisible(const FilterRule::Type type, const Entity& entity)
 {
+	// Entityclass rules only look at the class name, which can share the cache with the other items
+	if (type == FilterRule::TYPE_ENTITYCLASS)
+	{
+		return isVisible(type, entity.getEntityClass()->getDeclName());
+	}
+
+	if (type != FilterRule::TYPE_ENTITYKEYVALUE)
+	{
+		return true; // no entity rules for other types
+	}
+
+	// The result only depends on the values of the spawnargs referenced by the active rules,
+	// changed spawnargs are resulting in a different cache key
+	std::string cacheKey;
+
+	for (const auto& key : _entityKeysInUse)
+	{
+		cacheKey += entity.getKeyValue(key);
+		cacheKey += '\0';
+	}
+
+	auto& cache = _visibilityCache[type];
+	auto cacheIter = cache.find(cacheKey);
+
+	if (cacheIter != cache.end())
+	{
+		return cacheIter->second;
+	}
+
 	// Otherwise, walk the list of active filters to find a value for
 	// this item.
 	bool visFlag = true; // default if no filters modify it
@@ -587,9 +638,29 @@ bool BasicFilterSystem::isEntityVisible(const FilterRule::Type type, const Entit
 		}
 	}
 
+	cache.emplace(std::move(cacheKey), visFlag);
+
 	return visFlag;
 }
 
+void BasicFilterSystem::invalidateVisibilityCache()
+{
+	_visibilityCache.clear();
+	_entityKeysInUse.clear();
+
+	for (const auto& active : _activeFilters)
+	{
+		for (const auto& rule : active.second->getRuleSet())
+		{
+			if (rule.type == FilterRule::TYPE_ENTITYKEYVALUE &&
+				std::find(_entityKeysInUse.begin(), _entityKeysInUse.end(), rule.entityKey) == _entityKeysInUse.end())
+			{
+				_entityKeysInUse.push_back(rule.entityKey);
+			}
+		}
+	}
+}
+
 FilterRules BasicFilterSystem::getRuleSet(const std::string& filter)
 {
 	auto f = _availableFilters.find(filter);
@@ -607,7 +678,7 @@ bool BasicFilterSystem::setFilterRules(const std::string& filter, const FilterRu
 		f->second->setRules(ruleSet);
 
 		// Clear the cache, the ruleset has changed
-		_visibilityCache.clear();
+		invalidateVisibilityCache();
 
 		_filterConfigChangedSignal.emit();
 
@@ -654,6 +725,175 @@ void BasicFilterSystem::updateShaders()
     });
 }
 
+std::set<std::string> BasicFilterSystem::updateShaders(const XMLFilter& filter)
+{
+	std::set<std::string> affectedMaterials;
+
+	GlobalMaterialManager().foreachMaterial([&](const MaterialPtr& material)
+	{
+		auto name = material->getName();
+
+		// The visibility of materials not matched by this filter is unchanged
+		if (!filter.hasMatchingRule(FilterRule::TYPE_TEXTURE, name)) return;
+
+		material->setVisible(isVisible(FilterRule::TYPE_TEXTURE, name));
+		affectedMaterials.emplace(string::to_lower_copy(name));
+	});
+
+	return affectedMaterials;
+}
+
+void BasicFilterSystem::updateAffectedNodes(const XMLFilter& filter)
+{
+	if (!_nodeIndex)
+	{
+		update();
+		return;
+	}
+
+	bool texturesAffected = filter.hasRules(FilterRule::TYPE_TEXTURE);
+	std::set<std::string> affectedMaterials;
+
+	if (texturesAffected)
+	{
+		affectedMaterials = updateShaders(filter);
+	}
+
+	auto rootNode = GlobalSceneGraph().root();
+
+	if (!rootNode) return;
+
+	// Collect the nodes this filter can apply to
+	FilterNodeIndex::NodeSet entities;
+	FilterNodeIndex::NodeSet primitives;
+
+	if (filter.hasRules(FilterRule::TYPE_ENTITYCLASS))
+	{
+		_nodeIndex->foreachEntityClass([&](const std::string& className, const FilterNodeIndex::NodeSet& nodes)
+		{
+			if (filter.hasMatchingRule(FilterRule::TYPE_ENTITYCLASS, className))
+			{
+				entities.insert(nodes.begin(), nodes.end());
+			}
+		});
+	}
+
+	for (const auto& rule : filter.getRuleSet())
+	{
+		if (rule.type != FilterRule::TYPE_ENTITYKEYVALUE) continue;
+
+		// A rule matching the empty value applies to the entities lacking the spawnarg too
+		const auto& nodes = filter.hasMatchingKeyValueRule(rule.entityKey, std::string()) ?
+			_nodeIndex->getEntities() : _nodeIndex->getEntitiesWithKey(rule.entityKey);
+
+		entities.insert(nodes.begin(), nodes.end());
+
+		// Entities lacking the spawnarg might still inherit a value from their entityDef
+		_nodeIndex->foreachEntityClass([&](const std::string& className, const FilterNodeIndex::NodeSet& classNodes)
+		{
+			if (classNodes.empty()) return;
+
+			auto eclass = Node_getEntity((*classNodes.begin())->getSelf())->getEntityClass();
+
+			if (!eclass->getAttributeValue(rule.entityKey).empty())
+			{
+				entities.insert(classNodes.begin(), classNodes.end());
+			}
+		});
+	}
+
+	if (filter.hasMatchingRule(FilterRule::TYPE_OBJECT, "brush"))
+	{
+		primitives.insert(_nodeIndex->getBrushes().begin(), _nodeIndex->getBrushes().end());
+	}
+
+	if (filter.hasMatchingRule(FilterRule::TYPE_OBJECT, "patch"))
+	{
+		primitives.insert(_nodeIndex->getPatches().begin(), _nodeIndex->getPatches().end());
+	}
+
+	if (texturesAffected)
+	{
+		_nodeIndex->foreachMaterial([&](const std::string& material, const FilterNodeIndex::NodeSet& nodes)
+		{
+			// Names without a material definition are checked against the rules directly
+			if (affectedMaterials.count(material) > 0 || filter.hasMatchingRule(FilterRule::TYPE_TEXTURE, material))
+			{
+				primitives.insert(nodes.begin(), nodes.end());
+			}
+		});
+	}
+
+	InstanceUpdateWalker walker(*this);
+	FiltersChangedNotifier notifier;
+
+	for (auto* entity : entities)
+	{
+		entity->traverse(walker);
+
+		if (!texturesAffected)
+		{
+			entity->traverse(notifier);
+		}
+	}
+
+	for (auto* primitive : primitives)
+	{
+		auto parent = primitive->getParent();
+
+		// Skip the primitives updated along with their entity, and
+		// the ones staying hidden since their entity is filtered
+		if (parent && (entities.count(parent.get()) > 0 || parent->isFiltered())) continue;
+
+		primitive->traverse(walker);
+
+		if (!texturesAffected)
+		{
+			primitive->traverse(notifier);
+		}
+	}
+
+	// Changed material visibility can affect the surfaces of any node
+	if (texturesAffected)
+	{
+		rootNode->onFiltersChanged();
+	}
+}
+
+void BasicFilterSystem::onEntityKeyChanged(const scene::INodePtr& entityNode, const std::string& key)
+{
+	// Only the spawnargs referenced by the active rules can change the entity's visibility
+	if (std::none_of(_entityKeysInUse.begin(), _entityKeysInUse.end(),
+		[&](const std::string& keyInUse) { return string::iequals(keyInUse, key); }))
+	{
+		return;
+	}
+
+	// This is called during the entity's observer notification, leave the selection alone.
+	// The entity stays visible as long as it's selected.
+	InstanceUpdateWalker walker(*this, false);
+	entityNode->traverse(walker);
+
+	FiltersChangedNotifier notifier;
+	entityNode->traverse(notifier);
+}
+
+void BasicFilterSystem::notifySceneChanged()
+{
+	// Changing the filter state doesn't alter any materials of the indexed primitives
+	if (_nodeIndex)
+	{
+		_nodeIndex->setIgnoreSceneChanges(true);
+	}
+
+	GlobalSceneGraph().sceneChanged();
+
+	if (_nodeIndex)
+	{
+		_nodeIndex->setIgnoreSceneChanges(false);
+	}
+}
+
 // RegisterableModule implementation
 const std::string& BasicFilterSystem::getName() const
 {
@@ -670,6 +910,7 @@ const StringSet& BasicFilterSystem::getDependencies() const
 		_dependencies.insert(MODULE_XMLREGISTRY);
 		_dependencies.insert(MODULE_GAMEMANAGER);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
+		_dependencies.insert(MODULE_SCENEGRAPH);
 	}
 
 	return _dependencies;
@@ -5,6 +5,9 @@
 #include "icommandsystem.h"
 
 #include <map>
+#include <set>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -12,6 +15,7 @@
 #include "xmlutil/Node.h"
 #include "XMLFilter.h"
 #include "XmlFilterEventAdapter.h"
+#include "FilterNodeIndex.h"
 
 namespace filters
 {
@@ -29,10 +33,17 @@ private:
 	// Second table containing just the active filters
 	FilterTable _activeFilters;
 
-	// Cache of visibility flags for item names, to avoid having to
+	// Cache of visibility flags for item names (per rule type), to avoid having to
 	// traverse the active filter list for each lookup
-	typedef std::map<std::string, bool> StringFlagCache;
-	StringFlagCache _visibilityCache;
+	typedef std::unordered_map<std::string, bool> StringFlagCache;
+	std::map<FilterRule::Type, StringFlagCache> _visibilityCache;
+
+	// The spawnargs referenced by the entitykeyvalue rules of the active filters,
+	// their values are forming the cache key of an entity
+	std::vector<std::string> _entityKeysInUse;
+
+	// The filterable nodes of the scene, indexed by the names the rules are matched against
+	std::unique_ptr<FilterNodeIndex> _nodeIndex;
 
     sigc::signal<void> _filterConfigChangedSignal;
     sigc::signal<void> _filterCollectionChangedSignal;
@@ -48,6 +59,23 @@ private:
 
 	void updateShaders();
 
+	// Updates the materials matched by the rules of the given filter,
+	// returns their (lowercase) names
+	std::set<std::string> updateShaders(const XMLFilter& filter);
+
+	// Re-evaluates the nodes the given filter has been (or is now) applying to,
+	// to be called after the filter has been toggled
+	void updateAffectedNodes(const XMLFilter& filter);
+
+	// Re-evaluates a single entity after one of its spawnargs has changed
+	void onEntityKeyChanged(const scene::INodePtr& entityNode, const std::string& key);
+
+	// Triggers a scene redraw, without invalidating the node index
+	void notifySceneChanged();
+
+	// Clears the cached visibility flags, to be called when the active rules change
+	void invalidateVisibilityCache();
+
 	void addFiltersFromXML(const xml::NodeList& nodes, bool readOnly);
 
 	XmlFilterEventAdapter::Ptr ensureEventAdapter(XMLFilter& filter);
@@ -0,0 +1,276 @@
+#include "FilterNodeIndex.h"
+
+#include "ibrush.h"
+#include "ipatch.h"
+#include "ieclass.h"
+#include "scene/EntityNode.h"
+#include "string/case_conv.h"
+
+namespace filters
+{
+
+namespace
+{
+	const FilterNodeIndex::NodeSet EMPTY_NODE_SET;
+
+	inline void removeFromIndex(std::unordered_map<std::string, FilterNodeIndex::NodeSet>& index,
+		const std::string& name, scene::INode* node)
+	{
+		auto found = index.find(name);
+
+		if (found == index.end()) return;
+
+		found->second.erase(node);
+
+		if (found->second.empty())
+		{
+			index.erase(found);
+		}
+	}
+}
+
+// Maintains the spawnarg index of a single entity and reports changed spawnargs
+class FilterNodeIndex::EntityObserver :
+	public Entity::Observer
+{
+private:
+	FilterNodeIndex& _owner;
+	scene::INodeWeakPtr _node;
+
+	// The keys reported while attaching or detaching the observer are no changes
+	bool _enabled;
+
+public:
+	EntityObserver(FilterNodeIndex& owner, const scene::INodePtr& node) :
+		_owner(owner),
+		_node(node),
+		_enabled(false)
+	{}
+
+	void attach(Entity& entity)
+	{
+		entity.attachObserver(this);
+		_enabled = true;
+	}
+
+	void detach()
+	{
+		_enabled = false;
+
+		if (auto node = _node.lock(); node)
+		{
+			Node_getEntity(node)->detachObserver(this);
+		}
+	}
+
+	void onKeyInsert(const std::string& key, EntityKeyValue& value) override
+	{
+		_owner.onEntityKeyInsert(_node.lock().get(), key);
+		notifyKeyChanged(key);
+	}
+
+	void onKeyChange(const std::string& key, const std::string& value) override
+	{
+		notifyKeyChanged(key);
+	}
+
+	void onKeyErase(const std::string& key, EntityKeyValue& value) override
+	{
+		_owner.onEntityKeyErase(_node.lock().get(), key);
+		notifyKeyChanged(key);
+	}
+
+private:
+	void notifyKeyChanged(const std::string& key)
+	{
+		auto node = _node.lock();
+
+		if (_enabled && node && _owner._onEntityKeyChanged)
+		{
+			_owner._onEntityKeyChanged(node, key);
+		}
+	}
+};
+
+FilterNodeIndex::FilterNodeIndex(const KeyChangedCallback& onEntityKeyChanged) :
+	_onEntityKeyChanged(onEntityKeyChanged),
+	_materialIndexNeedsRebuild(false),
+	_ignoreSceneChanges(false)
+{}
+
+FilterNodeIndex::~FilterNodeIndex()
+{
+	clear();
+}
+
+void FilterNodeIndex::clear()
+{
+	for (const auto& pair : _entityObservers)
+	{
+		pair.second->detach();
+	}
+
+	_entityObservers.clear();
+	_entities.clear();
+	_entitiesByClass.clear();
+	_entitiesByKey.clear();
+	_brushes.clear();
+	_patches.clear();
+	_primitivesByMaterial.clear();
+	_materialIndexNeedsRebuild = false;
+}
+
+void FilterNodeIndex::onSceneGraphChange()
+{
+	if (!_ignoreSceneChanges)
+	{
+		_materialIndexNeedsRebuild = true;
+	}
+}
+
+void FilterNodeIndex::onSceneNodeInsert(const scene::INodePtr& node)
+{
+	if (Node_isEntity(node))
+	{
+		addEntity(node);
+	}
+	else if (Node_isBrush(node))
+	{
+		_brushes.insert(node.get());
+		_materialIndexNeedsRebuild = true;
+	}
+	else if (Node_isPatch(node))
+	{
+		_patches.insert(node.get());
+		_materialIndexNeedsRebuild = true;
+	}
+}
+
+void FilterNodeIndex::onSceneNodeErase(const scene::INodePtr& node)
+{
+	if (Node_isEntity(node))
+	{
+		removeEntity(node);
+	}
+	else if (_brushes.erase(node.get()) > 0 || _patches.erase(node.get()) > 0)
+	{
+		_materialIndexNeedsRebuild = true;
+	}
+}
+
+void FilterNodeIndex::setIgnoreSceneChanges(bool ignore)
+{
+	_ignoreSceneChanges = ignore;
+}
+
+const FilterNodeIndex::NodeSet& FilterNodeIndex::getEntities() const
+{
+	return _entities;
+}
+
+const FilterNodeIndex::NodeSet& FilterNodeIndex::getEntitiesWithKey(const std::string& key) const
+{
+	auto found = _entitiesByKey.find(string::to_lower_copy(key));
+
+	return found != _entitiesByKey.end() ? found->second : EMPTY_NODE_SET;
+}
+
+void FilterNodeIndex::foreachEntityClass(const std::function<void(const std::string&, const NodeSet&)>& func) const
+{
+	for (const auto& pair : _entitiesByClass)
+	{
+		func(pair.first, pair.second);
+	}
+}
+
+const FilterNodeIndex::NodeSet& FilterNodeIndex::getBrushes() const
+{
+	return _brushes;
+}
+
+const FilterNodeIndex::NodeSet& FilterNodeIndex::getPatches() const
+{
+	return _patches;
+}
+
+void FilterNodeIndex::foreachMaterial(const std::function<void(const std::string&, const NodeSet&)>& func)
+{
+	if (_materialIndexNeedsRebuild)
+	{
+		rebuildMaterialIndex();
+	}
+
+	for (const auto& pair : _primitivesByMaterial)
+	{
+		func(pair.first, pair.second);
+	}
+}
+
+void FilterNodeIndex::addEntity(const scene::INodePtr& node)
+{
+	if (_entityObservers.count(node.get()) > 0) return; // already indexed
+
+	auto* entity = Node_getEntity(node);
+
+	_entities.insert(node.get());
+	_entitiesByClass[entity->getEntityClass()->getDeclName()].insert(node.get());
+
+	// Attaching the observer reports the existing spawnargs, which fills the key index
+	auto observer = std::make_unique<EntityObserver>(*this, node);
+	observer->attach(*entity);
+
+	_entityObservers.emplace(node.get(), std::move(observer));
+}
+
+void FilterNodeIndex::removeEntity(const scene::INodePtr& node)
+{
+	auto found = _entityObservers.find(node.get());
+
+	if (found == _entityObservers.end()) return;
+
+	// Detaching reports all spawnargs as erased, which cleans up the key index
+	found->second->detach();
+
+	_entityObservers.erase(found);
+	_entities.erase(node.get());
+	removeFromIndex(_entitiesByClass, Node_getEntity(node)->getEntityClass()->getDeclName(), node.get());
+}
+
+void FilterNodeIndex::onEntityKeyInsert(scene::INode* node, const std::string& key)
+{
+	if (node == nullptr) return;
+
+	_entitiesByKey[string::to_lower_copy(key)].insert(node);
+}
+
+void FilterNodeIndex::onEntityKeyErase(scene::INode* node, const std::string& key)
+{
+	if (node == nullptr) return;
+
+	removeFromIndex(_entitiesByKey, string::to_lower_copy(key), node);
+}
+
+void FilterNodeIndex::rebuildMaterialIndex()
+{
+	_primitivesByMaterial.clear();
+	_materialIndexNeedsRebuild = false;
+
+	for (auto* node : _brushes)
+	{
+		auto* brush = Node_getIBrush(node->getSelf());
+
+		for (std::size_t i = 0; i < brush->getNumFaces(); ++i)
+		{
+			_primitivesByMaterial[string::to_lower_copy(brush->getFace(i).getShader())].insert(node);
+		}
+	}
+
+	for (auto* node : _patches)
+	{
+		auto* patch = Node_getIPatch(node->getSelf());
+
+		_primitivesByMaterial[string::to_lower_copy(patch->getShader())].insert(node);
+	}
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <set>
+#include <map>
+#include <memory>
+#include <string>
+#include <functional>
+#include <unordered_map>
+
+#include "inode.h"
+#include "iscenegraph.h"
+
+namespace filters
+{
+
+/**
+ * Keeps track of the scene nodes the filter rules can apply to, indexed
+ * by the names the rules are matched against: entities by their class name
+ * and the spawnargs they carry, brushes and patches by their materials.
+ *
+ * This allows the filter system to re-evaluate just the nodes affected
+ * by a single filter instead of walking the whole scene.
+ */
+class FilterNodeIndex :
+	public scene::Graph::Observer
+{
+public:
+	typedef std::set<scene::INode*> NodeSet;
+
+	// Invoked when a spawnarg of an indexed entity has been added, changed or removed
+	typedef std::function<void(const scene::INodePtr& entityNode, const std::string& key)> KeyChangedCallback;
+
+private:
+	class EntityObserver;
+
+	KeyChangedCallback _onEntityKeyChanged;
+
+	NodeSet _entities;
+
+	// Entity nodes by class name and by (lowercase) spawnarg keys
+	std::unordered_map<std::string, NodeSet> _entitiesByClass;
+	std::unordered_map<std::string, NodeSet> _entitiesByKey;
+
+	// One observer per indexed entity, keeping the spawnarg index up to date
+	std::map<scene::INode*, std::unique_ptr<EntityObserver>> _entityObservers;
+
+	NodeSet _brushes;
+	NodeSet _patches;
+
+	// Brushes and patches by the (lowercase) names of their materials. Material assignments
+	// are not observed one by one, the index is rebuilt on demand after the scene changed.
+	std::unordered_map<std::string, NodeSet> _primitivesByMaterial;
+	bool _materialIndexNeedsRebuild;
+
+	bool _ignoreSceneChanges;
+
+public:
+	FilterNodeIndex(const KeyChangedCallback& onEntityKeyChanged);
+
+	~FilterNodeIndex();
+
+	// Stops observing the indexed entities and clears the index
+	void clear();
+
+	// scene::Graph::Observer implementation
+	void onSceneGraphChange() override;
+	void onSceneNodeInsert(const scene::INodePtr& node) override;
+	void onSceneNodeErase(const scene::INodePtr& node) override;
+
+	// Scene change notifications are invalidating the material index, unless ignored.
+	// To be used by the filter system when announcing its own changes.
+	void setIgnoreSceneChanges(bool ignore);
+
+	const NodeSet& getEntities() const;
+
+	// Returns the entities carrying the given spawnarg (case-insensitive)
+	const NodeSet& getEntitiesWithKey(const std::string& key) const;
+
+	// Visits each entity class name in use, along with its entities
+	void foreachEntityClass(const std::function<void(const std::string&, const NodeSet&)>& func) const;
+
+	const NodeSet& getBrushes() const;
+	const NodeSet& getPatches() const;
+
+	// Visits each (lowercase) material name in use, along with the brushes and patches using it
+	void foreachMaterial(const std::function<void(const std::string&, const NodeSet&)>& func);
+
+private:
+	void addEntity(const scene::INodePtr& node);
+	void removeEntity(const scene::INodePtr& node);
+
+	void onEntityKeyInsert(scene::INode* node, const std::string& key);
+	void onEntityKeyErase(scene::INode* node, const std::string& key);
+
+	void rebuildMaterialIndex();
+};
+
+}
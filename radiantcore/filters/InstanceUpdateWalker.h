@@ -41,6 +41,18 @@ public:
 	}
 };
 
+// Walker: Notifies a complete subgraph about changed filter settings
+class FiltersChangedNotifier :
+	public scene::NodeVisitor
+{
+public:
+	bool pre(const scene::INodePtr& node) override
+	{
+		node->onFiltersChanged();
+		return true;
+	}
+};
+
 /**
  * Scenegraph walker to update filtered status of nodes based on the
  * currently active set of filters.
@@ -60,13 +72,18 @@ private:
 	bool _patchesAreVisible;
 	bool _brushesAreVisible;
 
+	// Whether hidden nodes are de-selected. Selected nodes are forced visible,
+	// so keeping them selected is delaying their disappearance until de-selection.
+	bool _deselectHiddenNodes;
+
 public:
-	InstanceUpdateWalker(IFilterSystem& filterSystem) :
+	InstanceUpdateWalker(IFilterSystem& filterSystem, bool deselectHiddenNodes = true) :
 		_filterSystem(filterSystem),
 		_hideWalker(true),
 		_showWalker(false),
 		_patchesAreVisible(_filterSystem.isVisible(FilterRule::TYPE_OBJECT, "patch")),
-		_brushesAreVisible(_filterSystem.isVisible(FilterRule::TYPE_OBJECT, "brush"))
+		_brushesAreVisible(_filterSystem.isVisible(FilterRule::TYPE_OBJECT, "brush")),
+		_deselectHiddenNodes(deselectHiddenNodes)
 	{}
 
 	bool pre(const scene::INodePtr& node) override
@@ -137,7 +154,7 @@ private:
 	{
 		node->traverse(isVisible ? _showWalker : _hideWalker);
 
-		if (!isVisible)
+		if (!isVisible && _deselectHiddenNodes)
 		{
 			// de-select this node and all children
 			node->traverse(_deselector);
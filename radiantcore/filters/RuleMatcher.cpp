@@ -0,0 +1,228 @@
+#include "RuleMatcher.h"
+
+#include <cctype>
+#include <cstring>
+#include "itextstream.h"
+
+namespace filters
+{
+
+namespace
+{
+	// Characters having a special meaning in ECMAScript regular expressions
+	const char* const REGEX_SPECIAL_CHARS = "^$\\.*+?()[]{}|";
+
+	// The regex wildcard doesn't match line terminators
+	const char* const LINE_TERMINATORS = "\r\n";
+}
+
+RuleMatcher::RuleMatcher(const std::string& expression) :
+	_expression(expression),
+	_leadingWildcard(false),
+	_trailingWildcard(false),
+	_invalid(false)
+{
+	if (parseSimplePattern())
+	{
+		return;
+	}
+
+	_segments.clear();
+
+	try
+	{
+		_regex = std::make_shared<std::regex>(_expression);
+	}
+	catch (const std::regex_error& ex)
+	{
+		rWarning() << "[filters] Invalid match expression " << _expression << ": " << ex.what() << std::endl;
+		_invalid = true;
+	}
+}
+
+bool RuleMatcher::matches(const std::string& name) const
+{
+	if (_invalid)
+	{
+		return false;
+	}
+
+	if (_regex)
+	{
+		return std::regex_match(name, *_regex);
+	}
+
+	// Leave the rare names spanning several lines to std::regex, the wildcards are not matching them
+	if ((_leadingWildcard || _trailingWildcard || _segments.size() > 1) &&
+		name.find_first_of(LINE_TERMINATORS) != std::string::npos)
+	{
+		return std::regex_match(name, std::regex(_expression));
+	}
+
+	return matchesSimplePattern(name);
+}
+
+bool RuleMatcher::isRegex() const
+{
+	return static_cast<bool>(_regex);
+}
+
+bool RuleMatcher::parseSimplePattern()
+{
+	std::size_t pos = 0;
+	std::size_t end = _expression.size();
+
+	// Anchors at the ends don't change anything, the whole name is matched anyway
+	if (end > 0 && _expression[0] == '^')
+	{
+		++pos;
+	}
+
+	if (end > pos && _expression[end - 1] == '$')
+	{
+		// Check that the dollar sign is not escaped
+		std::size_t backslashes = 0;
+
+		for (std::size_t i = end - 1; i > pos && _expression[i - 1] == '\\'; --i)
+		{
+			++backslashes;
+		}
+
+		if (backslashes % 2 == 0)
+		{
+			--end;
+		}
+	}
+
+	std::string segment;
+	bool wildcardPending = false;
+
+	auto addWildcard = [&]()
+	{
+		if (_segments.empty() && segment.empty())
+		{
+			_leadingWildcard = true;
+		}
+
+		if (!segment.empty())
+		{
+			_segments.emplace_back(std::move(segment));
+			segment.clear();
+		}
+
+		wildcardPending = true;
+	};
+
+	while (pos < end)
+	{
+		if (_expression.compare(pos, 2, ".*") == 0)
+		{
+			addWildcard();
+			pos += 2;
+			continue;
+		}
+
+		if (_expression.compare(pos, 4, "(.*)") == 0)
+		{
+			addWildcard();
+			pos += 4;
+			continue;
+		}
+
+		char c = _expression[pos];
+
+		if (c == '\\')
+		{
+			// Escaped punctuation is a literal character, escapes like \d or \w are not
+			if (pos + 1 >= end || std::isalnum(static_cast<unsigned char>(_expression[pos + 1])))
+			{
+				return false;
+			}
+
+			c = _expression[pos + 1];
+			pos += 2;
+		}
+		else if (std::strchr(REGEX_SPECIAL_CHARS, c) != nullptr)
+		{
+			return false;
+		}
+		else
+		{
+			++pos;
+		}
+
+		segment += c;
+		wildcardPending = false;
+	}
+
+	if (!segment.empty())
+	{
+		_segments.emplace_back(std::move(segment));
+	}
+
+	_trailingWildcard = wildcardPending;
+
+	return true;
+}
+
+bool RuleMatcher::matchesSimplePattern(const std::string& name) const
+{
+	if (_segments.empty())
+	{
+		// Either ".*" or an empty expression
+		return _leadingWildcard || name.empty();
+	}
+
+	if (!_leadingWildcard && !_trailingWildcard && _segments.size() == 1)
+	{
+		return name == _segments.front();
+	}
+
+	std::size_t begin = 0;
+	std::size_t end = name.size();
+	std::size_t first = 0;
+	std::size_t last = _segments.size();
+
+	if (!_leadingWildcard)
+	{
+		const auto& prefix = _segments.front();
+
+		if (name.compare(0, prefix.size(), prefix) != 0)
+		{
+			return false;
+		}
+
+		begin = prefix.size();
+		++first;
+	}
+
+	if (!_trailingWildcard)
+	{
+		const auto& suffix = _segments.back();
+
+		if (end - begin < suffix.size() || name.compare(end - suffix.size(), suffix.size(), suffix) != 0)
+		{
+			return false;
+		}
+
+		end -= suffix.size();
+		--last;
+	}
+
+	// The segments in between are found in order, the wildcards take up the rest
+	for (auto i = first; i < last; ++i)
+	{
+		auto found = name.find(_segments[i], begin);
+
+		if (found == std::string::npos || found + _segments[i].size() > end)
+		{
+			return false;
+		}
+
+		begin = found + _segments[i].size();
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <regex>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace filters
+{
+
+/**
+ * Matches names against the expression of a filter rule, with the same result
+ * as std::regex_match. The expression is compiled once on construction.
+ *
+ * Most rules are plain names like "func_static" or simple wildcard patterns like
+ * "textures/common/.*" or "textures(.*)decals(.*)". These are matched by comparing
+ * the literal parts between the wildcards, without going through std::regex.
+ * Everything else is handed to a precompiled std::regex.
+ */
+class RuleMatcher
+{
+private:
+	std::string _expression;
+
+	// The literal parts between the wildcards of a simple pattern
+	std::vector<std::string> _segments;
+
+	// Whether the simple pattern starts or ends with a wildcard
+	bool _leadingWildcard;
+	bool _trailingWildcard;
+
+	// Set if the expression is not a simple pattern
+	std::shared_ptr<std::regex> _regex;
+
+	// True if the expression failed to compile, nothing is matching then
+	bool _invalid;
+
+public:
+	explicit RuleMatcher(const std::string& expression);
+
+	// Returns true if the whole name is matching the expression
+	bool matches(const std::string& name) const;
+
+	// True if this expression is evaluated using std::regex
+	bool isRegex() const;
+
+private:
+	// Splits a simple pattern into its literal segments,
+	// returns false if the expression needs a full regex
+	bool parseSimplePattern();
+
+	bool matchesSimplePattern(const std::string& name) const;
+};
+
+}
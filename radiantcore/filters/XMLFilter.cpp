@@ -3,7 +3,7 @@
 #include "scene/Entity.h"
 #include "ieclass.h"
 #include "ifilter.h"
-#include <regex>
+#include "string/predicate.h"
 #include <algorithm>
 
 namespace filters
@@ -25,24 +25,22 @@ bool XMLFilter::isVisible(const FilterRule::Type type, const std::string& name)
 
 	bool visible = true; // default if unmodified by rules
 
-	for (FilterRules::const_iterator ruleIter = _rules.begin();
-		 ruleIter != _rules.end();
-		 ++ruleIter)
+	for (std::size_t i = 0; i < _rules.size(); ++i)
 	{
+		const auto& rule = _rules[i];
+
 		// Check the item type.
-		if (ruleIter->type != type)
+		if (rule.type != type)
 		{
 			continue;
 		}
 
-		// If we have a rule for this item, use a regex to match the query name
-		// against the "match" parameter
-		std::regex ex(ruleIter->match);
-
-		if (std::regex_match(name, ex))
+		// If we have a rule for this item, match the query name
+		// against the compiled "match" parameter
+		if (_ruleMatchers[i].matches(name))
 		{
 			// Overwrite the visible flag with the value from the rule.
-			visible = ruleIter->show;
+			visible = rule.show;
 		}
 	}
 
@@ -56,31 +54,27 @@ bool XMLFilter::isEntityVisible(const FilterRule::Type type, const Entity& entit
 
 	IEntityClassConstPtr eclass = entity.getEntityClass();
 
-	for (FilterRules::const_iterator ruleIter = _rules.begin();
-		 ruleIter != _rules.end();
-		 ++ruleIter)
+	for (std::size_t i = 0; i < _rules.size(); ++i)
 	{
-		if (ruleIter->type != type)
+		const auto& rule = _rules[i];
+
+		if (rule.type != type)
 		{
 			continue;
 		}
 
 		if (type == FilterRule::TYPE_ENTITYCLASS)
 		{
-			std::regex ex(ruleIter->match);
-
-			if (std::regex_match(eclass->getDeclName(), ex))
+			if (_ruleMatchers[i].matches(eclass->getDeclName()))
 			{
-				visible = ruleIter->show;
+				visible = rule.show;
 			}
 		}
 		else if (type == FilterRule::TYPE_ENTITYKEYVALUE)
 		{
-			std::regex ex(ruleIter->match);
-
-			if (std::regex_match(entity.getKeyValue(ruleIter->entityKey), ex))
+			if (_ruleMatchers[i].matches(entity.getKeyValue(rule.entityKey)))
 			{
-				visible = ruleIter->show;
+				visible = rule.show;
 			}
 		}
 	}
@@ -88,6 +82,43 @@ bool XMLFilter::isEntityVisible(const FilterRule::Type type, const Entity& entit
 	return visible;
 }
 
+bool XMLFilter::hasRules(const FilterRule::Type type) const
+{
+	return std::any_of(_rules.begin(), _rules.end(), [&](const FilterRule& rule)
+	{
+		return rule.type == type;
+	});
+}
+
+bool XMLFilter::hasMatchingRule(const FilterRule::Type type, const std::string& name) const
+{
+	for (std::size_t i = 0; i < _rules.size(); ++i)
+	{
+		if (_rules[i].type == type && _ruleMatchers[i].matches(name))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool XMLFilter::hasMatchingKeyValueRule(const std::string& key, const std::string& value) const
+{
+	for (std::size_t i = 0; i < _rules.size(); ++i)
+	{
+		const auto& rule = _rules[i];
+
+		if (rule.type == FilterRule::TYPE_ENTITYKEYVALUE && string::iequals(rule.entityKey, key) &&
+			_ruleMatchers[i].matches(value))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 const std::string& XMLFilter::getEventName() const {
 	return _eventName;
 }
@@ -116,6 +147,15 @@ const FilterRules& XMLFilter::getRuleSet() const
 
 void XMLFilter::setRules(const FilterRules& rules) {
 	_rules = rules;
+
+	// Compile the match expressions once, they are evaluated for every queried item
+	_ruleMatchers.clear();
+	_ruleMatchers.reserve(_rules.size());
+
+	for (const auto& rule : _rules)
+	{
+		_ruleMatchers.emplace_back(rule.match);
+	}
 }
 
 void XMLFilter::updateEventName() {
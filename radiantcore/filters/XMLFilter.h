@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include "ifilter.h"
+#include "RuleMatcher.h"
 
 namespace filters
 {
@@ -24,6 +25,9 @@ private:
 	// Ordered list of rule objects
 	FilterRules _rules;
 
+	// The compiled match expression of each rule, same order as _rules
+	std::vector<RuleMatcher> _ruleMatchers;
+
 	// True if this filter can't be changed
 	bool _readonly;
 
@@ -55,6 +59,7 @@ public:
 	void addRule(const FilterRule::Type type, const std::string& match, bool show)
 	{
 		_rules.push_back(FilterRule::Create(type, match, show));
+		_ruleMatchers.emplace_back(match);
 	}
 
 	/** Add an entitykeyvalue rule to this filter.
@@ -72,6 +77,7 @@ public:
 	void addEntityKeyValueRule(const std::string& key, const std::string& match, bool show)
 	{
 		_rules.push_back(FilterRule::CreateEntityKeyValueRule(key, match, show));
+		_ruleMatchers.emplace_back(match);
 	}
 
 	/** Test a given item for visibility against all of the rules
@@ -96,6 +102,17 @@ public:
 	 */
 	bool isEntityVisible(const FilterRule::Type type, const Entity& entity) const;
 
+	// Returns true if this filter has any rules of the given type
+	bool hasRules(const FilterRule::Type type) const;
+
+	/** Returns true if any rule of the given type is matching the item name,
+	 * which means that toggling this filter can change the visibility of that item.
+	 */
+	bool hasMatchingRule(const FilterRule::Type type, const std::string& name) const;
+
+	// Same as hasMatchingRule() for the entitykeyvalue rules referencing the given spawnarg
+	bool hasMatchingKeyValueRule(const std::string& key, const std::string& value) const;
+
 	/** greebo: Returns the name of the toggle event associated to this filter.
 	* It's lacking any spaces or other incompatible characters, compared to the actual
 	* name returned in getName().
@@ -184,9 +184,9 @@ RGBAImagePtr LoadBMPBuff(stream::PointerInputStream& inputStream, std::size_t le
 
 ImagePtr BMPLoader::load(ArchiveFile& file) const
 {
-    archive::ScopedArchiveBuffer buffer(file);
+    archive::ScopedArchiveData buffer(file);
 
-    stream::PointerInputStream inputStream(buffer.buffer);
+    stream::PointerInputStream inputStream(buffer.data, buffer.length);
     return LoadBMPBuff(inputStream, buffer.length);
 }
 
@@ -365,8 +365,8 @@ namespace image
 
 ImagePtr JPEGLoader::load(ArchiveFile& file) const
 {
-    archive::ScopedArchiveBuffer buffer(file);
-    return LoadJPGBuff_(buffer.buffer, static_cast<int>(buffer.length));
+    archive::ScopedArchiveData buffer(file);
+    return LoadJPGBuff_(buffer.data, static_cast<int>(buffer.length));
 }
 
 ImageTypeLoader::Extensions JPEGLoader::getExtensions() const
@@ -4,6 +4,7 @@
 #include <cstring>
 #include "RGBAImage.h"
 #include "stream/ScopedArchiveBuffer.h"
+#include "stream/PointerInputStream.h"
 
 typedef unsigned char byte;
 
@@ -26,16 +27,17 @@ void user_error_fn(png_structp png_ptr, png_const_charp error_msg)
 
 void user_read_data(png_structp png_ptr, png_bytep data, png_uint_32 length)
 {
-	png_bytep* p_p_fbuffer = (png_bytep*)png_get_io_ptr(png_ptr);
-	std::memcpy(data, *p_p_fbuffer, length);
-	*p_p_fbuffer += length;
+	auto& inputStream = *static_cast<stream::PointerInputStream*>(png_get_io_ptr(png_ptr));
+
+	if (inputStream.read(data, length) != length)
+	{
+		png_error(png_ptr, "unexpected end of file");
+	}
 }
 
-RGBAImagePtr LoadPNGBuff(unsigned char* fbuffer)
+RGBAImagePtr LoadPNGBuff(const unsigned char* fbuffer, std::size_t length)
 {
-	png_bytep p_fbuffer;
-
-	p_fbuffer = fbuffer;
+	stream::PointerInputStream inputStream(fbuffer, length);
 
 	// the reading glue
 	// http://www.libpng.org/pub/png/libpng-manual.html
@@ -69,7 +71,7 @@ RGBAImagePtr LoadPNGBuff(unsigned char* fbuffer)
 	}
 
 	// configure the read function
-	png_set_read_fn(png_ptr, (png_voidp)&p_fbuffer, (png_rw_ptr)&user_read_data);
+	png_set_read_fn(png_ptr, (png_voidp)&inputStream, (png_rw_ptr)&user_read_data);
 
 	if (setjmp(png_jmpbuf(png_ptr)))
 	{
@@ -171,9 +173,9 @@ RGBAImagePtr LoadPNGBuff(unsigned char* fbuffer)
 
 ImagePtr PNGLoader::load(ArchiveFile& file) const
 {
-    archive::ScopedArchiveBuffer buffer(file);
+    archive::ScopedArchiveData buffer(file);
 
-    return LoadPNGBuff(buffer.buffer);
+    return LoadPNGBuff(buffer.data, buffer.length);
 }
 
 ImageTypeLoader::Extensions PNGLoader::getExtensions() const
@@ -366,9 +366,9 @@ RGBAImagePtr Targa_decodeImageData(const TargaHeader& targa_header, stream::Poin
 const unsigned int TGA_FLIP_HORIZONTAL = 0x10;
 const unsigned int TGA_FLIP_VERTICAL = 0x20;
 
-RGBAImagePtr LoadTGABuff(const byte* buffer)
+RGBAImagePtr LoadTGABuff(const byte* buffer, std::size_t length)
 {
-	stream::PointerInputStream istream(buffer);
+	stream::PointerInputStream istream(buffer, length);
   TargaHeader targa_header;
 
   targa_header_read_istream(targa_header, istream);
@@ -422,8 +422,8 @@ RGBAImagePtr LoadTGABuff(const byte* buffer)
 
 ImagePtr TGALoader::load(ArchiveFile& file) const
 {
-    archive::ScopedArchiveBuffer buffer(file);
-    return LoadTGABuff(buffer.buffer);
+    archive::ScopedArchiveData buffer(file);
+    return LoadTGABuff(buffer.data, buffer.length);
 }
 
 ImageTypeLoader::Extensions TGALoader::getExtensions() const
@@ -108,11 +108,34 @@ public:
     GLenum getGLFormat() const override { return _format; }
 
     /* BindableTexture implementation */
-    TexturePtr bindTexture(const std::string& name, Role /* role */) const
+    TexturePtr bindTexture(const std::string& name, Role role) const override
     {
         // Allocate a new texture number and store it into the Texture structure
         GLuint textureNum;
         glGenTextures(1, &textureNum);
+
+        if (!uploadTexture(textureNum, role, 0))
+        {
+            rError() << "[DDSImage] Unable to bind texture '" << name << "'" << std::endl;
+
+            glDeleteTextures(1, &textureNum);
+            return TexturePtr();
+        }
+
+        // Create and return texture object
+        BasicTexture2DPtr texObj(new BasicTexture2D(textureNum, name));
+        texObj->setWidth(getWidth());
+        texObj->setHeight(getHeight());
+
+        return texObj;
+    }
+
+    bool uploadTexture(GLuint textureNum, Role /* role */, std::size_t skipLevels) const override
+    {
+        // The stored mipmaps are uploaded as they are, reducing the quality means
+        // starting the chain at a smaller mipmap. The smallest one is always kept.
+        std::size_t baseLevel = std::min(skipLevels, _mipMapInfo.size() - 1);
+
         glBindTexture(GL_TEXTURE_2D, textureNum);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
@@ -120,14 +143,15 @@ public:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         debug::checkGLErrors("before uploading DDS mipmaps");
-        for (std::size_t i = 0; i < _mipMapInfo.size(); ++i)
+        for (std::size_t i = baseLevel; i < _mipMapInfo.size(); ++i)
         {
             const MipMapInfo& mipMap = _mipMapInfo[i];
+            auto level = static_cast<GLint>(i - baseLevel);
 
             if (_compressed)
             {
                 glCompressedTexImage2D(
-                    GL_TEXTURE_2D, static_cast<GLint>(i), _format,
+                    GL_TEXTURE_2D, level, _format,
                     static_cast<GLsizei>(mipMap.width),
                     static_cast<GLsizei>(mipMap.height),
                     0, static_cast<GLsizei>(mipMap.size),
@@ -137,7 +161,7 @@ public:
                 // If the upload failed but this is not level 0, we can fall
                 // back to regenerating the mipmaps.
                 if (debug::checkGLErrors("uploading DDS mipmap") != GL_NO_ERROR
-                    && i > 0)
+                    && level > 0)
                 {
                     rWarning() << "DDSImage: failed to upload mipmap " << (i+1)
                                << " of " << _mipMapInfo.size()
@@ -155,7 +179,7 @@ public:
                 // memory, not the internal format we want OpenGL to use (which
                 // is always GL_RGB).
                 glTexImage2D(
-                    GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGB,
+                    GL_TEXTURE_2D, level, GL_RGB,
                     static_cast<GLsizei>(mipMap.width),
                     static_cast<GLsizei>(mipMap.height),
                     0, _format, GL_UNSIGNED_BYTE,
@@ -166,30 +190,25 @@ public:
             // Handle unsupported format error
             if (glGetError() == GL_INVALID_ENUM)
             {
-                rError() << "[DDSImage] Unable to bind texture '" << name
-                         << "': unsupported texture format " << _format
+                rError() << "[DDSImage] Unsupported texture format " << _format
                          << (_compressed ? " (compressed)" : " (uncompressed)")
                          << std::endl;
 
-                return TexturePtr();
+                glBindTexture(GL_TEXTURE_2D, 0);
+                return false;
             }
 
             debug::assertNoGlErrors();
         }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(_mipMapInfo.size() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(_mipMapInfo.size() - 1 - baseLevel));
 
         // Un-bind the texture
         glBindTexture(GL_TEXTURE_2D, 0);
 
-        // Create and return texture object
-        BasicTexture2DPtr texObj(new BasicTexture2D(textureNum, name));
-        texObj->setWidth(getWidth());
-        texObj->setHeight(getHeight());
-
         debug::assertNoGlErrors();
 
-        return texObj;
+        return true;
     }
 };
 typedef std::shared_ptr<DDSImage> DDSImagePtr;
@@ -228,7 +247,8 @@ DDSImagePtr LoadDDSFromStream(InputStream& stream)
     int width = header.getWidth(), height = header.getHeight();
     std::string compressionFormat = header.getCompressionFormat();
     int bitDepth = header.getRGBBits();
-    std::size_t mipMapCount = header.getMipMapCount();
+    // Some writers set the mipmap flag along with a zero count
+    std::size_t mipMapCount = std::max(header.getMipMapCount(), 1);
 
     MipMapInfoList mipMapInfo;
     mipMapInfo.resize(mipMapCount);
@@ -50,6 +50,12 @@ stream::MapResourceStream::Ptr ArchivedMapResource::openInfofileStream()
     }
 }
 
+std::string ArchivedMapResource::getMapCachePath()
+{
+    // The map file is inside an archive, there's no place to keep a cache file
+    return std::string();
+}
+
 stream::MapResourceStream::Ptr ArchivedMapResource::openFileInArchive(const std::string& filePathWithinArchive)
 {
     assert(_archive);
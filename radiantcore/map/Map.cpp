@@ -7,6 +7,7 @@
 #include "iscenegraph.h"
 #include "icameraview.h"
 #include "imodel.h"
+#include "imodelcache.h"
 #include "igrid.h"
 #include "ifilesystem.h"
 #include "ifiletypes.h"
@@ -757,6 +758,30 @@ void Map::saveDirect(const std::string& filename, const MapFormatPtr& mapFormat)
     _saveInProgress = false;
 }
 
+bool Map::saveToBuffers(const std::string& filename, std::string& mapBuffer, std::string& infoFileBuffer)
+{
+    if (_saveInProgress) return false; // safeguard
+
+    _saveInProgress = true;
+
+    bool success = false;
+
+    try
+    {
+        MapResource::saveToBuffers(*getMapFormatForFilenameSafe(filename), GlobalSceneGraph().root(),
+            scene::traverse, mapBuffer, infoFileBuffer);
+        success = true;
+    }
+    catch (const IMapResource::OperationException& ex)
+    {
+        radiant::NotificationMessage::SendError(ex.what());
+    }
+
+    _saveInProgress = false;
+
+    return success;
+}
+
 void Map::saveSelected(const std::string& filename, const MapFormatPtr& mapFormat)
 {
     if (_saveInProgress) return; // safeguard
@@ -1514,7 +1539,8 @@ const StringSet& Map::getDependencies() const
         MODULE_MAPINFOFILEMANAGER,
         MODULE_FILETYPES,
         MODULE_MAPRESOURCEMANAGER,
-        MODULE_COMMANDSYSTEM
+        MODULE_COMMANDSYSTEM,
+        MODULE_MODELCACHE,
     };
 
     return _dependencies;
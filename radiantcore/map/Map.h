@@ -172,6 +172,13 @@ public:
 	 */
 	void saveDirect(const std::string& filename, const MapFormatPtr& mapFormat = MapFormatPtr());
 
+	/**
+	 * Serialises the current map into the given buffers, in the format matching
+	 * the given filename. Used by the auto saver, which is writing the buffers
+	 * to disk in the background. Returns false if the export failed.
+	 */
+	bool saveToBuffers(const std::string& filename, std::string& mapBuffer, std::string& infoFileBuffer);
+
 	void rename(const std::string& filename);
 
 	void exportSelected(std::ostream& out) override;
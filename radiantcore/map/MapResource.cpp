@@ -10,6 +10,7 @@
 #include "igroupnode.h"
 #include "ifilesystem.h"
 #include "iregistry.h"
+#include "registry/registry.h"
 #include "imapinfofile.h"
 
 #include "map/RootNode.h"
@@ -35,6 +36,7 @@
 #include "messages/NotificationMessage.h"
 #include "NodeCounter.h"
 #include "MapResourceLoader.h"
+#include "cache/BinaryMapCache.h"
 
 namespace map
 {
@@ -47,6 +49,39 @@ namespace
 			path_is_absolute(name.c_str()) ? name : GlobalFileSystem().findFile(name)
 		);
 	}
+
+	RootNodePtr loadFromMapCache(MapResourceLoader& loader, const std::string& cachePath,
+		const cache::MapFileChecksum& checksum)
+	{
+		if (!os::fileOrDirExists(cachePath))
+		{
+			return RootNodePtr();
+		}
+
+		std::ifstream cacheStream(cachePath, std::ios::binary);
+
+		return cacheStream ? loader.loadFromMapCache(cacheStream, checksum) : RootNodePtr();
+	}
+
+	void saveMapCache(MapResourceLoader& loader, const std::string& cachePath,
+		const cache::MapFileChecksum& checksum)
+	{
+		{
+			std::ofstream cacheStream(cachePath, std::ios::binary);
+
+			if (cacheStream && loader.saveMapCache(cacheStream, checksum))
+			{
+				rMessage() << "Wrote map cache " << cachePath << std::endl;
+				return;
+			}
+		}
+
+		rWarning() << "Could not write map cache " << cachePath << std::endl;
+
+		// Don't leave a partially written file behind
+		std::error_code ec;
+		fs::remove(cachePath, ec);
+	}
 }
 
 MapResource::MapResource(const std::string& resourcePath)
@@ -304,8 +339,27 @@ RootNodePtr MapResource::loadMapNode()
         // Instantiate a loader to process the map file stream
         MapResourceLoader loader(stream->getStream(), *format);
 
-        // Load the root from the primary stream (throws on failure or cancel)
-        rootNode = loader.load();
+        // The binary cache doesn't know about layers and groups, it's only used
+        // for formats storing these in the info file
+        auto cachePath = format->allowInfoFileCreation() ? getMapCachePath() : std::string();
+        cache::MapFileChecksum checksum;
+
+        if (!cachePath.empty())
+        {
+            checksum = cache::calculateChecksum(stream->getStream());
+            rootNode = loadFromMapCache(loader, cachePath, checksum);
+        }
+
+        if (!rootNode)
+        {
+            // Load the root from the primary stream (throws on failure or cancel)
+            rootNode = loader.load();
+
+            if (!cachePath.empty())
+            {
+                saveMapCache(loader, cachePath, checksum);
+            }
+        }
 
         if (rootNode)
         {
@@ -374,6 +428,19 @@ stream::MapResourceStream::Ptr MapResource::openInfofileStream()
     }
 }
 
+std::string MapResource::getMapCachePath()
+{
+    auto fullPath = getAbsoluteResourcePath();
+
+    // The cache is kept next to physical map files only
+    if (!registry::getValue<bool>(RKEY_MAP_BINARY_CACHE) || !path_is_absolute(fullPath.c_str()))
+    {
+        return std::string();
+    }
+
+    return os::replaceExtension(fullPath, cache::MAP_CACHE_EXTENSION);
+}
+
 void MapResource::refreshLastModifiedTime()
 {
     auto fullPath = getAbsoluteResourcePath();
@@ -444,6 +511,36 @@ void MapResource::saveFile(const MapFormat& format, const scene::IMapRootNodePtr
 
 	rMessage() << "success" << std::endl;
 
+	exportToStreams(format, root, traverse, outFileStream, auxFileStream.get());
+
+	// Check for any stream failures now that we're done writing
+	if (outFileStream.fail())
+	{
+		throw OperationException(fmt::format(_("Failure writing to file {0}"), outFile.string()));
+	}
+
+	if (auxFileStream && auxFileStream->fail())
+	{
+		throw OperationException(fmt::format(_("Failure writing to file {0}"), auxFile.string()));
+	}
+}
+
+void MapResource::saveToBuffers(const MapFormat& format, const scene::IMapRootNodePtr& root,
+	const GraphTraversalFunc& traverse, std::string& mapBuffer, std::string& infoFileBuffer)
+{
+	std::ostringstream mapStream;
+	std::ostringstream infoFileStream;
+
+	exportToStreams(format, root, traverse, mapStream,
+		format.allowInfoFileCreation() ? &infoFileStream : nullptr);
+
+	mapBuffer = mapStream.str();
+	infoFileBuffer = infoFileStream.str();
+}
+
+void MapResource::exportToStreams(const MapFormat& format, const scene::IMapRootNodePtr& root,
+	const GraphTraversalFunc& traverse, std::ostream& mapStream, std::ostream* infoFileStream)
+{
 	// Check the total count of nodes to traverse
 	NodeCounter counter;
 	traverse(root, counter);
@@ -455,13 +552,13 @@ void MapResource::saveFile(const MapFormat& format, const scene::IMapRootNodePtr
 	MapExporterPtr exporter;
 	auto mapWriter = format.getMapWriter();
 
-	if (format.allowInfoFileCreation())
+	if (infoFileStream != nullptr)
 	{
-		exporter.reset(new MapExporter(*mapWriter, root, outFileStream, *auxFileStream, counter.getCount()));
+		exporter.reset(new MapExporter(*mapWriter, root, mapStream, *infoFileStream, counter.getCount()));
 	}
 	else
 	{
-		exporter.reset(new MapExporter(*mapWriter, root, outFileStream, counter.getCount())); // no aux stream
+		exporter.reset(new MapExporter(*mapWriter, root, mapStream, counter.getCount())); // no aux stream
 	}
 
 	try
@@ -474,17 +571,6 @@ void MapResource::saveFile(const MapFormat& format, const scene::IMapRootNodePtr
 	{
 		throw OperationException(_("Map writing cancelled"));
 	}
-
-	// Check for any stream failures now that we're done writing
-	if (outFileStream.fail())
-	{
-		throw OperationException(fmt::format(_("Failure writing to file {0}"), outFile.string()));
-	}
-
-	if (auxFileStream && auxFileStream->fail())
-	{
-		throw OperationException(fmt::format(_("Failure writing to file {0}"), auxFile.string()));
-	}
 }
 
 } // namespace map
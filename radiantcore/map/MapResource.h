@@ -66,6 +66,12 @@ public:
 	static void saveFile(const MapFormat& format, const scene::IMapRootNodePtr& root,
 						 const GraphTraversalFunc& traverse, const std::string& filename);
 
+	// Serialise the map contents into the given buffers, using the given MapFormat export module.
+	// The info file buffer is left empty if the format doesn't support info files.
+	// Throws an OperationException if anything prevents successful completion
+	static void saveToBuffers(const MapFormat& format, const scene::IMapRootNodePtr& root,
+							  const GraphTraversalFunc& traverse, std::string& mapBuffer, std::string& infoFileBuffer);
+
 protected:
     // Implementation-specific method to open the stream of the primary .map or .mapx file
     // May return an empty reference, may throw OperationException on failure
@@ -75,6 +81,10 @@ protected:
     // May return an empty reference, may throw OperationException on failure
     virtual stream::MapResourceStream::Ptr openInfofileStream();
 
+    // Returns the path of the binary map cache file belonging to this resource,
+    // or an empty string if the map should not be cached
+    virtual std::string getMapCachePath();
+
     // Returns true if the file can be written to. Also returns true if the file
     // doesn't exist (assuming the file can always be created).
     static bool FileIsWriteable(const fs::path& path);
@@ -98,6 +108,10 @@ private:
 
 	// Checks if file can be overwritten (throws on failure)
 	static void throwIfNotWriteable(const fs::path& path);
+
+	// Exports the scene to the given streams, the info file stream is optional
+	static void exportToStreams(const MapFormat& format, const scene::IMapRootNodePtr& root,
+		const GraphTraversalFunc& traverse, std::ostream& mapStream, std::ostream* infoFileStream);
 };
 
 } // namespace map
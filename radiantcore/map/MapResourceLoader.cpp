@@ -60,6 +60,66 @@ RootNodePtr MapResourceLoader::load()
     }
 }
 
+RootNodePtr MapResourceLoader::loadFromMapCache(std::istream& cacheStream, const cache::MapFileChecksum& checksum)
+{
+    if (!cache::BinaryMapCacheReader::IsValidFor(cacheStream, checksum, _format.getMapFormatName()))
+    {
+        rMessage() << "Map cache is outdated, loading the map file." << std::endl;
+        return RootNodePtr();
+    }
+
+    auto root = std::make_shared<RootNode>("");
+
+    try
+    {
+        MapImporter importFilter(root, cacheStream);
+        cache::BinaryMapCacheReader reader(importFilter);
+
+        rMessage() << "Using the binary map cache to load the data." << std::endl;
+
+        reader.readFromStream(cacheStream);
+
+        // The cached primitives already contain the origin of their entities,
+        // there's no need to call addOriginToChildPrimitives here
+
+        _indexMapping.swap(importFilter.getNodeMap());
+
+        return root;
+    }
+    catch (FileOperation::OperationCancelled&)
+    {
+        scene::NodeRemover remover;
+        root->traverseChildren(remover);
+
+        throw IMapResource::OperationException(_("Map loading cancelled"), true); // cancelled flag set
+    }
+    catch (IMapReader::FailureException& e)
+    {
+        scene::NodeRemover remover;
+        root->traverseChildren(remover);
+
+        // A damaged cache is not an error, the map file is still there
+        rWarning() << "Could not load the map cache: " << e.what() << std::endl;
+        return RootNodePtr();
+    }
+}
+
+bool MapResourceLoader::saveMapCache(std::ostream& cacheStream, const cache::MapFileChecksum& checksum)
+{
+    try
+    {
+        cache::BinaryMapCacheWriter writer(checksum, _format.getMapFormatName());
+        writer.write(_indexMapping, cacheStream);
+
+        return !cacheStream.fail();
+    }
+    catch (IMapWriter::FailureException& e)
+    {
+        rWarning() << "Could not write the map cache: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 void MapResourceLoader::loadInfoFile(std::istream& stream, const RootNodePtr& root)
 {
     if (!stream.good())
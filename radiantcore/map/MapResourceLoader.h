@@ -7,6 +7,7 @@
 #include "imapformat.h"
 
 #include "infofile/InfoFile.h"
+#include "cache/BinaryMapCache.h"
 #include "RootNode.h"
 
 namespace map
@@ -33,6 +34,16 @@ public:
     // Throws IMapResource::OperationException on failure or cancel
     RootNodePtr load();
 
+    // Loads the root from the given binary map cache stream instead of the map stream,
+    // the cache must have been created from a map file with the given checksum.
+    // Returns an empty reference if the cache is outdated or damaged.
+    // Throws IMapResource::OperationException on cancel
+    RootNodePtr loadFromMapCache(std::istream& cacheStream, const cache::MapFileChecksum& checksum);
+
+    // Writes the nodes of the last load() call to the given binary map cache stream,
+    // returns false on failure
+    bool saveMapCache(std::ostream& cacheStream, const cache::MapFileChecksum& checksum);
+
     // Load the info file from the given stream, apply it to the root node
     void loadInfoFile(std::istream& stream, const RootNodePtr& root);
 };
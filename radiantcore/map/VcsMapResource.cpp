@@ -67,6 +67,12 @@ stream::MapResourceStream::Ptr VcsMapResource::openInfofileStream()
     return openFileFromVcs(_infoFileUri);
 }
 
+std::string VcsMapResource::getMapCachePath()
+{
+    // The map file refers to a past revision, not the one in the working copy
+    return std::string();
+}
+
 stream::MapResourceStream::Ptr VcsMapResource::openFileFromVcs(const std::string& uri)
 {
     if (!_vcsModule || !vcs::pathIsVcsUri(uri))
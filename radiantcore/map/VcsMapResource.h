@@ -26,6 +26,7 @@ public:
 protected:
     virtual stream::MapResourceStream::Ptr openMapfileStream() override;
     virtual stream::MapResourceStream::Ptr openInfofileStream() override;
+    virtual std::string getMapCachePath() override;
 
 private:
     stream::MapResourceStream::Ptr openFileFromVcs(const std::string& uri);
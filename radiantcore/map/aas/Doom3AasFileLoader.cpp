@@ -2,6 +2,8 @@
 
 #include "itextstream.h"
 
+#include <iterator>
+
 #include "parser/DefTokeniser.h"
 #include "string/convert.h"
 #include "Doom3AasFile.h"
@@ -50,12 +52,19 @@ bool Doom3AasFileLoader::canLoad(std::istream& stream) const
 
 IAasFilePtr Doom3AasFileLoader::loadFromStream(std::istream& stream)
 {
-    Doom3AasFilePtr aasFile = std::make_shared<Doom3AasFile>();
-
     // We assume that the stream is rewound to the beginning
+    // Read it into memory in one go, the buffer tokeniser is much faster than the stream one
+    std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    return loadFromBuffer(buffer);
+}
+
+IAasFilePtr Doom3AasFileLoader::loadFromBuffer(std::string_view contents)
+{
+    Doom3AasFilePtr aasFile = std::make_shared<Doom3AasFile>();
 
     // Instantiate a tokeniser to read the version tag
-	parser::BasicDefTokeniser<std::istream> tok(stream);
+	parser::BasicDefTokeniser<std::string_view> tok(contents);
 
     try
 	{
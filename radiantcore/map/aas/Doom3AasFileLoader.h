@@ -20,6 +20,7 @@ public:
 
 	virtual bool canLoad(std::istream& stream) const override;
     virtual IAasFilePtr loadFromStream(std::istream& stream) override;
+    virtual IAasFilePtr loadFromBuffer(std::string_view contents) override;
 
     // RegisterableModule implementation
 	virtual const std::string& getName() const override;
@@ -9,6 +9,8 @@
 #include "imodel.h"
 #include "imodelcache.h"
 #include "iscenegraph.h"
+#include "ieclass.h"
+#include "string/replace.h"
 
 #include "messages/ScopedLongRunningOperation.h"
 
@@ -164,6 +166,29 @@ void refreshModelsByPath(const std::string& relativeModelPath)
     rMessage() << "Refreshed " << refreshedEntityCount << " entities using the model " << relativeModelPath << std::endl;
 }
 
+
+void prefetchModels(const std::set<std::string>& modelKeyValues)
+{
+    std::set<std::string> modelPaths;
+
+    for (const auto& value : modelKeyValues)
+    {
+        // Same treatment as in ModelKey: forward slashes, modelDefs pointing to their mesh
+        auto modelPath = string::replace_all_copy(value, "\\", "/");
+
+        if (modelPath.empty()) continue;
+
+        if (auto modelDef = GlobalEntityClassManager().findModel(modelPath); modelDef)
+        {
+            modelPath = modelDef->getMesh();
+        }
+
+        modelPaths.insert(modelPath);
+    }
+
+    GlobalModelCache().prefetchModels(modelPaths);
+}
+
 }
 
 }
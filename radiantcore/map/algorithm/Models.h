@@ -1,5 +1,6 @@
 #pragma once
 
+#include <set>
 #include <string>
 
 namespace map
@@ -18,6 +19,10 @@ void refreshSelectedModels(bool blockScreenUpdates);
 // The given model path denotes a VFS path, i.e. it is mod/game-relative
 void refreshModelsByPath(const std::string& relativeModelPath);
 
+// Starts loading the models referenced by the given "model" spawnarg values in the
+// background, see IModelCache::prefetchModels(). ModelDefs are resolved to their mesh.
+void prefetchModels(const std::set<std::string>& modelKeyValues);
+
 }
 
 }
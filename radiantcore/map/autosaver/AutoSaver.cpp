@@ -3,6 +3,8 @@
 #include "i18n.h"
 #include <numeric>
 #include <iostream>
+#include <fstream>
+#include <chrono>
 #include "imapfilechangetracker.h"
 #include "itextstream.h"
 #include "iscenegraph.h"
@@ -38,10 +40,9 @@ namespace
 	// Registry key names
 	const char* GKEY_MAP_EXTENSION = "/mapFormat/fileExtension";
 
-	std::string constructSnapshotName(const fs::path& snapshotPath, const std::string& mapName, int num)
+	std::string constructSnapshotName(const fs::path& snapshotPath, const std::string& mapName,
+		int num, const std::string& mapExt)
 	{
-		std::string mapExt = game::current::getValue<std::string>(GKEY_MAP_EXTENSION);
-
 		// Construct the base name without numbered extension
 		std::string filename = (snapshotPath / mapName).replace_extension().string();
 
@@ -53,6 +54,63 @@ namespace
 
 		return filename;
 	}
+
+	// Maps the existing snapshots of the given map (snapshot num => path)
+	std::map<int, std::string> collectExistingSnapshots(const fs::path& snapshotPath,
+		const std::string& mapName, const std::string& mapExt)
+	{
+		std::map<int, std::string> existingSnapshots;
+
+		for (int num = 0; num < INT_MAX; num++)
+		{
+			// Construct the base name without numbered extension
+			std::string filename = constructSnapshotName(snapshotPath, mapName, num, mapExt);
+
+			if (!os::fileOrDirExists(filename))
+			{
+				break; // We've found an unused filename, break the loop
+			}
+
+			existingSnapshots.emplace(num, filename);
+		}
+
+		return existingSnapshots;
+	}
+
+	// Writes the buffer to the given file, returns false on failure
+	bool writeBufferToFile(const std::string& path, const std::string& buffer)
+	{
+		std::ofstream stream(path);
+
+		if (!stream.is_open())
+		{
+			return false;
+		}
+
+		stream.write(buffer.data(), buffer.size());
+		stream.close();
+
+		return !stream.fail();
+	}
+
+	// Writes the map file and the info file (if there is one), returns the path of a failed file
+	std::string writeMapFiles(const std::string& filename, const std::string& infoFileExtension,
+		const std::string& mapBuffer, const std::string& infoFileBuffer)
+	{
+		if (!writeBufferToFile(filename, mapBuffer))
+		{
+			return filename;
+		}
+
+		auto infoFilename = fs::path(filename).replace_extension(infoFileExtension).string();
+
+		if (!infoFileBuffer.empty() && !writeBufferToFile(infoFilename, infoFileBuffer))
+		{
+			return infoFilename;
+		}
+
+		return std::string();
+	}
 }
 
 AutoMapSaver::AutoMapSaver() :
@@ -97,32 +155,112 @@ void AutoMapSaver::saveSnapshot()
 	auto mapName = fullPath.filename().string();
 
 	// Check if the folder exists and create it if necessary
-	if (os::fileOrDirExists(snapshotPath.string()) || os::makeDirectory(snapshotPath.string()))
+	if (!os::fileOrDirExists(snapshotPath.string()) && !os::makeDirectory(snapshotPath.string()))
 	{
-        // Map existing snapshots (snapshot num => path)
-        std::map<int, std::string> existingSnapshots;
+		rError() << "Snapshot save failed, unable to create directory " << snapshotPath << std::endl;
+		return;
+	}
 
-		collectExistingSnapshots(existingSnapshots, snapshotPath, mapName);
+	auto mapExt = game::current::getValue<std::string>(GKEY_MAP_EXTENSION);
+	auto infoFileExt = game::current::getInfoFileExtension();
 
-		int highestNum = existingSnapshots.empty() ? 0 : existingSnapshots.rbegin()->first + 1;
+	rMessage() << "Autosaving snapshot to " << snapshotPath << std::endl;
 
-		std::string filename = constructSnapshotName(snapshotPath, mapName, highestNum);
+	// The snapshot number is determined in the background, the map format depends on the extension only
+	std::string mapBuffer;
+	std::string infoFileBuffer;
 
-		rMessage() << "Autosaving snapshot to " << filename << std::endl;
+	if (!GlobalMap().saveToBuffers(constructSnapshotName(snapshotPath, mapName, 0, mapExt), mapBuffer, infoFileBuffer))
+	{
+		return;
+	}
 
-		// Dump to map to the next available filename
-        GlobalCommandSystem().executeCommand("SaveAutomaticBackup", filename);
+	_pendingWrite = std::async(std::launch::async,
+		[=, mapBuffer = std::move(mapBuffer), infoFileBuffer = std::move(infoFileBuffer)]()
+	{
+		WriteResult result;
+		result.isSnapshot = true;
+		result.snapshotPath = snapshotPath;
+		result.mapName = mapName;
+
+		try
+		{
+			auto existingSnapshots = collectExistingSnapshots(snapshotPath, mapName, mapExt);
+
+			int highestNum = existingSnapshots.empty() ? 0 : existingSnapshots.rbegin()->first + 1;
+
+			// Dump to map to the next available filename
+			result.filename = constructSnapshotName(snapshotPath, mapName, highestNum, mapExt);
+			result.failedFile = writeMapFiles(result.filename, infoFileExt, mapBuffer, infoFileBuffer);
+
+			// Sum up the size of the previous snapshots
+			for (const auto& pair : existingSnapshots)
+			{
+				result.snapshotFolderSize += os::getFileSize(pair.second);
+			}
+		}
+		catch (fs::filesystem_error& ex)
+		{
+			result.failedFile = result.filename.empty() ? snapshotPath.string() : result.filename;
+			result.errorDetails = ex.what();
+		}
+
+		return result;
+	});
+}
 
-		handleSnapshotSizeLimit(existingSnapshots, snapshotPath, mapName);
+void AutoMapSaver::saveInBackground(const std::string& filename)
+{
+	std::string mapBuffer;
+	std::string infoFileBuffer;
+
+	if (!GlobalMap().saveToBuffers(filename, mapBuffer, infoFileBuffer))
+	{
+		return;
 	}
-	else
+
+	auto infoFileExt = game::current::getInfoFileExtension();
+
+	_pendingWrite = std::async(std::launch::async,
+		[=, mapBuffer = std::move(mapBuffer), infoFileBuffer = std::move(infoFileBuffer)]()
 	{
-		rError() << "Snapshot save failed, unable to create directory " << snapshotPath << std::endl;
+		WriteResult result;
+		result.filename = filename;
+		result.failedFile = writeMapFiles(filename, infoFileExt, mapBuffer, infoFileBuffer);
+
+		return result;
+	});
+}
+
+void AutoMapSaver::processWriteResult(const WriteResult& result)
+{
+	if (!result.failedFile.empty())
+	{
+		rError() << "Autosave failed, could not write " << result.failedFile << " " << result.errorDetails << std::endl;
+
+		radiant::NotificationMessage::SendError(
+			fmt::format(_("Failure writing to file {0}"), result.failedFile));
+		return;
+	}
+
+	rMessage() << "Autosave written to " << result.filename << std::endl;
+
+	if (result.isSnapshot)
+	{
+		handleSnapshotSizeLimit(result.snapshotFolderSize, result.snapshotPath, result.mapName);
+	}
+}
+
+void AutoMapSaver::waitForPendingSave()
+{
+	if (_pendingWrite.valid())
+	{
+		processWriteResult(_pendingWrite.get());
 	}
 }
 
-void AutoMapSaver::handleSnapshotSizeLimit(const std::map<int, std::string>& existingSnapshots,
-	const fs::path& snapshotPath, const std::string& mapName)
+void AutoMapSaver::handleSnapshotSizeLimit(std::size_t folderSize, const fs::path& snapshotPath,
+	const std::string& mapName)
 {
 	std::size_t maxSnapshotFolderSize =
 		registry::getValue<std::size_t>(RKEY_AUTOSAVE_MAX_SNAPSHOT_FOLDER_SIZE);
@@ -133,14 +271,6 @@ void AutoMapSaver::handleSnapshotSizeLimit(const std::map<int, std::string>& exi
 		maxSnapshotFolderSize = 100;
 	}
 
-	// Sum up the total folder size
-	std::size_t folderSize = 0;
-
-	for (const std::pair<int, std::string>& pair : existingSnapshots)
-	{
-		folderSize += os::getFileSize(pair.second);
-	}
-
 	std::size_t maxSize = maxSnapshotFolderSize * 1024 * 1024;
 
 	// The key containing the previously calculated size
@@ -181,25 +311,19 @@ void AutoMapSaver::handleSnapshotSizeLimit(const std::map<int, std::string>& exi
 	}
 }
 
-void AutoMapSaver::collectExistingSnapshots(std::map<int, std::string>& existingSnapshots,
-	const fs::path& snapshotPath, const std::string& mapName)
+bool AutoMapSaver::runAutosaveCheck()
 {
-	for (int num = 0; num < INT_MAX; num++)
-	{
-		// Construct the base name without numbered extension
-		std::string filename = constructSnapshotName(snapshotPath, mapName, num);
-
-		if (!os::fileOrDirExists(filename))
-		{
-			return; // We've found an unused filename, break the loop
-		}
+    // Report a finished background write, skip this round while it's still in progress
+    if (_pendingWrite.valid())
+    {
+        if (_pendingWrite.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return false;
+        }
 
-		existingSnapshots.insert(std::make_pair(num, filename));
-	}
-}
+        processWriteResult(_pendingWrite.get());
+    }
 
-bool AutoMapSaver::runAutosaveCheck()
-{
     // Check, if changes have been made since the last autosave
     if (!GlobalSceneGraph().root() || _savedChangeCount == GlobalSceneGraph().root()->getUndoChangeTracker().getCurrentChangeCount())
     {
@@ -220,6 +344,9 @@ bool AutoMapSaver::runAutosaveCheck()
 
 void AutoMapSaver::performAutosave()
 {
+    // Only one save at a time
+    waitForPendingSave();
+
     // Remember the change tracking counter
     _savedChangeCount = GlobalSceneGraph().root()->getUndoChangeTracker().getCurrentChangeCount();
 
@@ -251,8 +378,7 @@ void AutoMapSaver::performAutosave()
 
             rMessage() << "Autosaving unnamed map to " << autoSaveFilename << std::endl;
 
-            // Invoke the save call
-            GlobalCommandSystem().executeCommand("SaveAutomaticBackup", autoSaveFilename);
+            saveInBackground(autoSaveFilename);
         }
         else
         {
@@ -267,8 +393,7 @@ void AutoMapSaver::performAutosave()
 
             rMessage() << "Autosaving map to " << filename << std::endl;
 
-            // Invoke the save call
-            GlobalCommandSystem().executeCommand("SaveAutomaticBackup", filename);
+            saveInBackground(filename);
         }
     }
 }
@@ -343,6 +468,8 @@ void AutoMapSaver::initialiseModule(const IApplicationContext& ctx)
 
 void AutoMapSaver::shutdownModule()
 {
+	waitForPendingSave();
+
 	// Unsubscribe from all connections
 	for (sigc::connection& connection : _signalConnections)
 	{
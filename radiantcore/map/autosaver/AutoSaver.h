@@ -6,6 +6,7 @@
 #include "iautosaver.h"
 
 #include <vector>
+#include <future>
 #include <sigc++/connection.h>
 #include "os/fs.h"
 
@@ -15,6 +16,9 @@ namespace map
 /**
  * greebo: The AutoMapSaver class lets itself being called in distinct intervals
  * and saves the map files either to snapshots or to a single yyyy.autosave.map file.
+ *
+ * The map is serialised into memory on the calling thread, the files are written
+ * (and the snapshot folder inspected) on a background thread.
  */
 class AutoMapSaver final : 
 	public IAutomaticMapSaver
@@ -27,6 +31,24 @@ private:
 
 	std::vector<sigc::connection> _signalConnections;
 
+	// The outcome of a background write, to be processed on the main thread
+	struct WriteResult
+	{
+		std::string filename;
+
+		// Set if writing failed, along with the error details if there are any
+		std::string failedFile;
+		std::string errorDetails;
+
+		// Snapshots only: the folder and the size of the snapshots saved before
+		bool isSnapshot = false;
+		fs::path snapshotPath;
+		std::string mapName;
+		std::size_t snapshotFolderSize = 0;
+	};
+
+	std::future<WriteResult> _pendingWrite;
+
 public:
 	// Constructor
 	AutoMapSaver();
@@ -46,6 +68,8 @@ public:
 
     void performAutosave() override;
 
+    void waitForPendingSave() override;
+
 private:
 	void constructPreferences();
 
@@ -56,11 +80,13 @@ private:
 	// Saves a snapshot of the currently active map (only named maps)
 	void saveSnapshot();
 
-	void collectExistingSnapshots(std::map<int, std::string>& existingSnapshots,
-		const fs::path& snapshotPath, const std::string& mapName);
+	// Serialises the map and writes it to the given file in the background
+	void saveInBackground(const std::string& filename);
+
+	// Reports the outcome of a finished background write
+	void processWriteResult(const WriteResult& result);
 
-	void handleSnapshotSizeLimit(const std::map<int, std::string>& existingSnapshots,
-		const fs::path& snapshotPath, const std::string& mapName);
+	void handleSnapshotSizeLimit(std::size_t folderSize, const fs::path& snapshotPath, const std::string& mapName);
 };
 
 } // namespace map
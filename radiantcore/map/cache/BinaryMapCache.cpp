@@ -0,0 +1,791 @@
+#include "BinaryMapCache.h"
+
+#include "itextstream.h"
+#include "ibrush.h"
+#include "ipatch.h"
+#include "ieclass.h"
+#include "imap.h"
+#include "scene/EntityNode.h"
+#include "registry/registry.h"
+#include "math/Hash.h"
+#include "math/Matrix3.h"
+#include "math/Plane3.h"
+#include "../algorithm/Models.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <fmt/format.h>
+
+namespace map
+{
+
+namespace cache
+{
+
+namespace
+{
+	// "DRMC" - written in native byte order, caches written on a machine
+	// with a different endianness are rejected by the header check
+	constexpr std::uint32_t MAP_CACHE_MAGIC = 0x434D5244;
+	constexpr std::uint32_t MAP_CACHE_VERSION = 1;
+
+	constexpr std::size_t CHECKSUM_CHUNK_SIZE = 1 << 16;
+
+	// The header strings are short, anything longer is a damaged file
+	constexpr std::uint32_t MAX_HEADER_STRING_LENGTH = 256;
+
+	// The number of primitives a worker is decoding in one go
+	constexpr std::size_t PRIMITIVE_BATCH_SIZE = 256;
+
+	// The index the MapImporter is using for the entity nodes themselves
+	constexpr std::size_t ENTITY_PRIMITIVE_NUM = std::numeric_limits<std::size_t>::max();
+
+	enum class PrimitiveType : std::uint32_t
+	{
+		Brush = 0,
+		Patch = 1,
+	};
+
+	// Stored as contiguous array per brush
+	struct FaceRecord
+	{
+		double plane[4];   // normal xyz, dist
+		double texdef[6];  // xx, yx, zx, xy, yy, zy
+		std::uint32_t material;
+		std::uint32_t reserved;
+	};
+	static_assert(sizeof(FaceRecord) == 88, "Unexpected padding in FaceRecord");
+
+	// Followed by width * height control points of 5 doubles each (vertex xyz, texcoord st)
+	struct PatchRecord
+	{
+		std::uint32_t material;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t fixedSubdivisions;
+		std::uint32_t subdivisionsX;
+		std::uint32_t subdivisionsY;
+	};
+	static_assert(sizeof(PatchRecord) == 24, "Unexpected padding in PatchRecord");
+
+	constexpr std::size_t CONTROL_POINT_SIZE = 5 * sizeof(double);
+
+	struct Header
+	{
+		std::uint32_t magic = 0;
+		std::uint32_t version = 0;
+		MapFileChecksum checksum;
+		std::string mapFormatName;
+	};
+
+	template<typename T>
+	inline void writeValue(std::ostream& stream, const T& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	inline void writeString(std::ostream& stream, const std::string& str)
+	{
+		writeValue(stream, static_cast<std::uint32_t>(str.length()));
+		stream.write(str.data(), str.length());
+	}
+
+	template<typename T>
+	inline bool readValue(std::istream& stream, T& value)
+	{
+		return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	inline bool readString(std::istream& stream, std::string& str)
+	{
+		std::uint32_t length = 0;
+
+		if (!readValue(stream, length) || length > MAX_HEADER_STRING_LENGTH) return false;
+
+		str.resize(length);
+		return length == 0 || static_cast<bool>(stream.read(&str[0], length));
+	}
+
+	inline void writeHeader(std::ostream& stream, const MapFileChecksum& checksum, const std::string& mapFormatName)
+	{
+		writeValue(stream, MAP_CACHE_MAGIC);
+		writeValue(stream, MAP_CACHE_VERSION);
+		writeValue(stream, checksum.size);
+		writeString(stream, checksum.hash);
+		writeString(stream, mapFormatName);
+	}
+
+	inline bool readHeader(std::istream& stream, Header& header)
+	{
+		return readValue(stream, header.magic) && header.magic == MAP_CACHE_MAGIC &&
+			readValue(stream, header.version) && header.version == MAP_CACHE_VERSION &&
+			readValue(stream, header.checksum.size) &&
+			readString(stream, header.checksum.hash) &&
+			readString(stream, header.mapFormatName);
+	}
+
+	// Bounds-checked sequential access to the cache contents
+	class BufferReader
+	{
+	private:
+		const std::string& _buffer;
+		std::size_t _position;
+
+	public:
+		BufferReader(const std::string& buffer, std::size_t position = 0) :
+			_buffer(buffer),
+			_position(position)
+		{}
+
+		std::size_t getPosition() const
+		{
+			return _position;
+		}
+
+		// Throws if the given number of elements can't be present, to be checked before allocating anything
+		void expect(std::size_t count, std::size_t elementSize) const
+		{
+			if (count > (_buffer.size() - _position) / elementSize)
+			{
+				throw IMapReader::FailureException("Unexpected end of map cache");
+			}
+		}
+
+		// Returns the position of the given number of elements, then moves past them
+		std::size_t skip(std::size_t count, std::size_t elementSize = 1)
+		{
+			expect(count, elementSize);
+
+			auto position = _position;
+			_position += count * elementSize;
+
+			return position;
+		}
+
+		template<typename T>
+		T read()
+		{
+			T value;
+			std::memcpy(&value, _buffer.data() + skip(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		std::string readString()
+		{
+			auto length = read<std::uint32_t>();
+			return _buffer.substr(skip(length), length);
+		}
+	};
+
+	// Assigns ascending indices to the strings of the cache, equal strings are stored once
+	class StringTable
+	{
+	private:
+		std::unordered_map<std::string, std::uint32_t> _indices;
+		std::vector<const std::string*> _strings;
+
+	public:
+		std::uint32_t getIndex(const std::string& str)
+		{
+			auto result = _indices.emplace(str, static_cast<std::uint32_t>(_strings.size()));
+
+			if (result.second)
+			{
+				_strings.push_back(&result.first->first);
+			}
+
+			return result.first->second;
+		}
+
+		void write(std::ostream& stream) const
+		{
+			writeValue(stream, static_cast<std::uint32_t>(_strings.size()));
+
+			for (const auto* str : _strings)
+			{
+				writeString(stream, *str);
+			}
+		}
+	};
+
+	void writeBrush(std::ostream& stream, const IBrush& brush, StringTable& strings)
+	{
+		writeValue(stream, PrimitiveType::Brush);
+		writeValue(stream, static_cast<std::uint32_t>(brush.getDetailFlag()));
+		writeValue(stream, static_cast<std::uint32_t>(brush.getNumFaces()));
+
+		std::vector<FaceRecord> faces(brush.getNumFaces());
+
+		for (std::size_t i = 0; i < faces.size(); ++i)
+		{
+			const auto& face = brush.getFace(i);
+			const auto& plane = face.getPlane3();
+			auto texdef = face.getProjectionMatrix();
+
+			faces[i] = FaceRecord
+			{
+				{ plane.normal().x(), plane.normal().y(), plane.normal().z(), plane.dist() },
+				{ texdef.xx(), texdef.yx(), texdef.zx(), texdef.xy(), texdef.yy(), texdef.zy() },
+				strings.getIndex(face.getShader()),
+				0
+			};
+		}
+
+		stream.write(reinterpret_cast<const char*>(faces.data()), faces.size() * sizeof(FaceRecord));
+	}
+
+	void writePatch(std::ostream& stream, const IPatch& patch, StringTable& strings)
+	{
+		writeValue(stream, PrimitiveType::Patch);
+
+		PatchRecord record
+		{
+			strings.getIndex(patch.getShader()),
+			static_cast<std::uint32_t>(patch.getWidth()),
+			static_cast<std::uint32_t>(patch.getHeight()),
+			patch.subdivisionsFixed() ? 1u : 0u,
+			patch.getSubdivisions().x(),
+			patch.getSubdivisions().y()
+		};
+
+		writeValue(stream, record);
+
+		// Same order as in the map file, column by column
+		std::vector<double> controlPoints;
+		controlPoints.reserve(patch.getWidth() * patch.getHeight() * 5);
+
+		for (std::size_t c = 0; c < patch.getWidth(); c++)
+		{
+			for (std::size_t r = 0; r < patch.getHeight(); r++)
+			{
+				const auto& ctrl = patch.ctrlAt(r, c);
+
+				controlPoints.insert(controlPoints.end(), {
+					ctrl.vertex.x(), ctrl.vertex.y(), ctrl.vertex.z(), ctrl.texcoord.x(), ctrl.texcoord.y()
+				});
+			}
+		}
+
+		stream.write(reinterpret_cast<const char*>(controlPoints.data()), controlPoints.size() * sizeof(double));
+	}
+
+	void writeEntity(std::ostream& stream, Entity& entity, const std::vector<scene::INodePtr>& primitives,
+		StringTable& strings)
+	{
+		std::vector<std::uint32_t> keyValues;
+
+		entity.forEachKeyValue([&](const std::string& key, const std::string& value)
+		{
+			keyValues.push_back(strings.getIndex(key));
+			keyValues.push_back(strings.getIndex(value));
+		});
+
+		writeValue(stream, static_cast<std::uint32_t>(keyValues.size() / 2));
+		stream.write(reinterpret_cast<const char*>(keyValues.data()), keyValues.size() * sizeof(std::uint32_t));
+
+		writeValue(stream, static_cast<std::uint32_t>(primitives.size()));
+
+		for (const auto& primitive : primitives)
+		{
+			if (auto* brush = Node_getIBrush(primitive); brush != nullptr)
+			{
+				writeBrush(stream, *brush, strings);
+			}
+			else if (auto* patch = Node_getIPatch(primitive); patch != nullptr)
+			{
+				writePatch(stream, *patch, strings);
+			}
+			else
+			{
+				throw IMapWriter::FailureException("Cannot store primitive of unknown type");
+			}
+		}
+	}
+
+	// The location of a primitive in the cache buffer, as found by the initial scan
+	struct PrimitiveLocation
+	{
+		PrimitiveType type;
+		std::size_t offset;
+	};
+
+	struct EntityLocation
+	{
+		// Pairs of string indices
+		std::vector<std::uint32_t> keyValues;
+
+		std::size_t firstPrimitive;
+		std::size_t numPrimitives;
+	};
+
+	inline void checkStringIndex(std::uint32_t index, const std::vector<std::string>& strings)
+	{
+		if (index >= strings.size())
+		{
+			throw IMapReader::FailureException(fmt::format("Invalid string index {0} in map cache", index));
+		}
+	}
+
+	// Checks the size and the string references of the primitive record at the reader's position
+	// and moves past it. Returns the location of the data following the type tag.
+	PrimitiveLocation scanPrimitive(const std::string& buffer, BufferReader& reader, const std::vector<std::string>& strings)
+	{
+		auto type = static_cast<PrimitiveType>(reader.read<std::uint32_t>());
+
+		PrimitiveLocation location{ type, reader.getPosition() };
+
+		if (type == PrimitiveType::Brush)
+		{
+			reader.read<std::uint32_t>(); // detail flag
+			auto numFaces = reader.read<std::uint32_t>();
+			auto position = reader.skip(numFaces, sizeof(FaceRecord));
+
+			for (std::uint32_t i = 0; i < numFaces; ++i, position += sizeof(FaceRecord))
+			{
+				std::uint32_t material;
+				std::memcpy(&material, buffer.data() + position + offsetof(FaceRecord, material), sizeof(material));
+				checkStringIndex(material, strings);
+			}
+		}
+		else if (type == PrimitiveType::Patch)
+		{
+			auto record = reader.read<PatchRecord>();
+			checkStringIndex(record.material, strings);
+
+			reader.skip(static_cast<std::size_t>(record.width) * record.height, CONTROL_POINT_SIZE);
+		}
+		else
+		{
+			throw IMapReader::FailureException(fmt::format("Unknown primitive type {0} in map cache",
+				static_cast<std::uint32_t>(type)));
+		}
+
+		return location;
+	}
+
+	struct DecodedFace
+	{
+		Plane3 plane;
+		Matrix3 texdef;
+		std::uint32_t material;
+	};
+
+	// The contents of a primitive record, decoded into plain values. Decoding
+	// doesn't touch any scene objects, so it can be done on worker threads.
+	struct DecodedPrimitive
+	{
+		PrimitiveType type = PrimitiveType::Brush;
+
+		// Brush data
+		IBrush::DetailFlag detailFlag = IBrush::Structural;
+		std::vector<DecodedFace> faces;
+
+		// Patch data, the control points are stored column by column
+		PatchRecord patch = PatchRecord();
+		std::vector<PatchControl> controlPoints;
+	};
+
+	DecodedPrimitive decodePrimitive(const std::string& buffer, const PrimitiveLocation& location)
+	{
+		BufferReader reader(buffer, location.offset);
+
+		DecodedPrimitive decoded;
+		decoded.type = location.type;
+
+		if (location.type == PrimitiveType::Brush)
+		{
+			decoded.detailFlag = static_cast<IBrush::DetailFlag>(reader.read<std::uint32_t>());
+			auto numFaces = reader.read<std::uint32_t>();
+
+			decoded.faces.reserve(numFaces);
+
+			for (std::uint32_t i = 0; i < numFaces; ++i)
+			{
+				auto face = reader.read<FaceRecord>();
+
+				auto texdef = Matrix3::getIdentity();
+				texdef.xx() = face.texdef[0];
+				texdef.yx() = face.texdef[1];
+				texdef.zx() = face.texdef[2];
+				texdef.xy() = face.texdef[3];
+				texdef.yy() = face.texdef[4];
+				texdef.zy() = face.texdef[5];
+
+				decoded.faces.emplace_back(DecodedFace
+				{
+					Plane3(face.plane[0], face.plane[1], face.plane[2], face.plane[3]),
+					texdef,
+					face.material
+				});
+			}
+		}
+		else
+		{
+			decoded.patch = reader.read<PatchRecord>();
+
+			auto numControlPoints = static_cast<std::size_t>(decoded.patch.width) * decoded.patch.height;
+			decoded.controlPoints.reserve(numControlPoints);
+
+			for (std::size_t i = 0; i < numControlPoints; ++i)
+			{
+				double values[5];
+				std::memcpy(values, buffer.data() + reader.skip(sizeof(values)), sizeof(values));
+
+				decoded.controlPoints.emplace_back(PatchControl
+				{
+					Vector3(values[0], values[1], values[2]),
+					Vector2(values[3], values[4])
+				});
+			}
+		}
+
+		return decoded;
+	}
+
+	// Creating the nodes is emitting signals, this must happen on the thread loading the map
+	scene::INodePtr createBrush(const DecodedPrimitive& decoded, const std::vector<std::string>& strings)
+	{
+		auto node = GlobalBrushCreator().createBrush();
+		auto& brush = *Node_getIBrush(node);
+
+		brush.setDetailFlag(decoded.detailFlag);
+
+		for (const auto& face : decoded.faces)
+		{
+			brush.addFace(face.plane, face.texdef, strings[face.material]);
+		}
+
+		return node;
+	}
+
+	scene::INodePtr createPatch(const DecodedPrimitive& decoded, const std::vector<std::string>& strings)
+	{
+		const auto& record = decoded.patch;
+
+		auto node = GlobalPatchModule().createPatch(record.fixedSubdivisions != 0 ?
+			patch::PatchDefType::Def3 : patch::PatchDefType::Def2);
+		auto& patch = *Node_getIPatch(node);
+
+		patch.setShader(strings[record.material]);
+		patch.setDims(record.width, record.height);
+
+		if (patch.getWidth() != record.width || patch.getHeight() != record.height)
+		{
+			throw IMapReader::FailureException(fmt::format("Invalid patch dimensions {0}x{1} in map cache",
+				record.width, record.height));
+		}
+
+		if (record.fixedSubdivisions != 0)
+		{
+			patch.setFixedSubdivisions(true, Subdivisions(record.subdivisionsX, record.subdivisionsY));
+		}
+
+		auto controlPoint = decoded.controlPoints.begin();
+
+		for (std::size_t c = 0; c < patch.getWidth(); c++)
+		{
+			for (std::size_t r = 0; r < patch.getHeight(); r++)
+			{
+				patch.ctrlAt(r, c) = *controlPoint++;
+			}
+		}
+
+		patch.controlPointsChanged();
+
+		return node;
+	}
+
+	scene::INodePtr createEntity(const EntityLocation& location, const std::vector<std::string>& strings)
+	{
+		const std::string* className = nullptr;
+
+		for (std::size_t i = 0; i + 1 < location.keyValues.size(); i += 2)
+		{
+			if (strings[location.keyValues[i]] == "classname")
+			{
+				className = &strings[location.keyValues[i + 1]];
+				break;
+			}
+		}
+
+		if (className == nullptr)
+		{
+			throw IMapReader::FailureException("Entity in map cache has no classname");
+		}
+
+		auto eclass = GlobalEntityClassManager().findClass(*className);
+
+		if (!eclass)
+		{
+			rError() << "[MapCache]: Could not find entity class: " << *className << std::endl;
+
+			// Same as the map reader: insert a brush-based class
+			eclass = GlobalEntityClassManager().findOrInsert(*className, true);
+		}
+
+		auto node = GlobalEntityModule().createEntity(eclass);
+
+		// The key values are stored in the order the loaded entity had them
+		for (std::size_t i = 0; i + 1 < location.keyValues.size(); i += 2)
+		{
+			node->getEntity().setKeyValue(strings[location.keyValues[i]], strings[location.keyValues[i + 1]]);
+		}
+
+		return node;
+	}
+}
+
+MapFileChecksum calculateChecksum(std::istream& stream)
+{
+	MapFileChecksum checksum;
+	math::Hash hash;
+
+	stream.clear();
+	stream.seekg(0, std::ios_base::beg);
+
+	std::string chunk(CHECKSUM_CHUNK_SIZE, '\0');
+
+	while (stream.read(&chunk[0], chunk.size()) || stream.gcount() > 0)
+	{
+		auto count = static_cast<std::size_t>(stream.gcount());
+
+		if (count < chunk.size())
+		{
+			chunk.resize(count);
+		}
+
+		hash.addString(chunk);
+		checksum.size += count;
+	}
+
+	checksum.hash = hash;
+
+	// Rewind the stream for the map reader
+	stream.clear();
+	stream.seekg(0, std::ios_base::beg);
+
+	return checksum;
+}
+
+BinaryMapCacheWriter::BinaryMapCacheWriter(const MapFileChecksum& checksum, const std::string& mapFormatName) :
+	_checksum(checksum),
+	_mapFormatName(mapFormatName)
+{}
+
+void BinaryMapCacheWriter::write(const NodeIndexMap& nodes, std::ostream& stream)
+{
+	// The strings are collected while writing the records, the table is written first
+	StringTable strings;
+	std::ostringstream records;
+
+	std::uint32_t numEntities = 0;
+	std::vector<scene::INodePtr> primitives;
+
+	// The index map is sorted by entity number, each entity coming after its primitives
+	for (const auto& [index, node] : nodes)
+	{
+		if (index.second != ENTITY_PRIMITIVE_NUM)
+		{
+			primitives.push_back(node);
+			continue;
+		}
+
+		auto* entity = Node_getEntity(node);
+
+		if (entity == nullptr)
+		{
+			throw IMapWriter::FailureException("Cannot store entity node without entity");
+		}
+
+		writeEntity(records, *entity, primitives, strings);
+
+		primitives.clear();
+		++numEntities;
+	}
+
+	writeHeader(stream, _checksum, _mapFormatName);
+	strings.write(stream);
+
+	writeValue(stream, numEntities);
+
+	auto body = records.str();
+	stream.write(body.data(), body.size());
+}
+
+BinaryMapCacheReader::BinaryMapCacheReader(IMapImportFilter& importFilter) :
+	_importFilter(importFilter)
+{}
+
+bool BinaryMapCacheReader::IsValidFor(std::istream& stream, const MapFileChecksum& checksum,
+	const std::string& mapFormatName)
+{
+	Header header;
+
+	bool isValid = readHeader(stream, header) &&
+		header.checksum == checksum && header.mapFormatName == mapFormatName;
+
+	stream.clear();
+	stream.seekg(0, std::ios_base::beg);
+
+	return isValid;
+}
+
+void BinaryMapCacheReader::readFromStream(std::istream& stream)
+{
+	Header header;
+
+	if (!readHeader(stream, header))
+	{
+		throw FailureException("Invalid map cache header");
+	}
+
+	// Pull the rest of the file into memory, everything is read from the buffer
+	std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+	// Reset the EOF state, the import filter is still querying the stream position
+	stream.clear();
+
+	BufferReader reader(buffer);
+
+	auto numStrings = reader.read<std::uint32_t>();
+	reader.expect(numStrings, sizeof(std::uint32_t)); // each string is at least storing its length
+
+	_strings.clear();
+	_strings.reserve(numStrings);
+
+	for (std::uint32_t i = 0; i < numStrings; ++i)
+	{
+		_strings.emplace_back(reader.readString());
+	}
+
+	// Scan the entity and primitive records, checking their sizes and references
+	auto numEntities = reader.read<std::uint32_t>();
+	reader.expect(numEntities, 2 * sizeof(std::uint32_t));
+
+	std::vector<EntityLocation> entities(numEntities);
+	std::vector<PrimitiveLocation> primitiveLocations;
+
+	for (auto& entity : entities)
+	{
+		auto numKeyValues = reader.read<std::uint32_t>();
+		auto keyValuesSize = 2 * sizeof(std::uint32_t);
+
+		entity.keyValues.resize(static_cast<std::size_t>(numKeyValues) * 2);
+		std::memcpy(entity.keyValues.data(), buffer.data() + reader.skip(numKeyValues, keyValuesSize),
+			numKeyValues * keyValuesSize);
+
+		for (auto index : entity.keyValues)
+		{
+			checkStringIndex(index, _strings);
+		}
+
+		auto numPrimitives = reader.read<std::uint32_t>();
+		reader.expect(numPrimitives, sizeof(std::uint32_t));
+
+		entity.firstPrimitive = primitiveLocations.size();
+		entity.numPrimitives = numPrimitives;
+
+		for (std::uint32_t i = 0; i < numPrimitives; ++i)
+		{
+			primitiveLocations.push_back(scanPrimitive(buffer, reader, _strings));
+		}
+	}
+
+	auto parallel = registry::getValue<bool>(RKEY_MAP_PARALLEL_LOADING);
+
+	if (parallel)
+	{
+		// Load the models referenced by the entities in the background
+		std::set<std::string> modelKeyValues;
+
+		for (const auto& entity : entities)
+		{
+			for (std::size_t i = 0; i + 1 < entity.keyValues.size(); i += 2)
+			{
+				if (_strings[entity.keyValues[i]] == "model")
+				{
+					modelKeyValues.insert(_strings[entity.keyValues[i + 1]]);
+				}
+			}
+		}
+
+		algorithm::prefetchModels(modelKeyValues);
+	}
+
+	// Decode the primitive records, in parallel if enabled. The workers are not
+	// creating any nodes, this is emitting signals meant for the main thread only.
+	std::vector<DecodedPrimitive> decoded(primitiveLocations.size());
+	std::atomic<std::size_t> nextBatch(0);
+
+	// Each primitive is writing to its own slot, no need to lock anything here
+	auto worker = [&]()
+	{
+		while (true)
+		{
+			std::size_t start = nextBatch.fetch_add(1) * PRIMITIVE_BATCH_SIZE;
+
+			if (start >= primitiveLocations.size()) break;
+
+			std::size_t end = std::min(start + PRIMITIVE_BATCH_SIZE, primitiveLocations.size());
+
+			for (std::size_t i = start; i < end; ++i)
+			{
+				// The records have been checked by the initial scan, this is not throwing
+				decoded[i] = decodePrimitive(buffer, primitiveLocations[i]);
+			}
+		}
+	};
+
+	std::size_t numBatches = (primitiveLocations.size() + PRIMITIVE_BATCH_SIZE - 1) / PRIMITIVE_BATCH_SIZE;
+	std::size_t numWorkers = parallel ?
+		std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), numBatches) : 1;
+
+	// The calling thread is doing its share too
+	std::vector<std::future<void>> workers;
+
+	for (std::size_t i = 1; i < numWorkers; ++i)
+	{
+		workers.emplace_back(std::async(std::launch::async, worker));
+	}
+
+	worker();
+
+	for (auto& result : workers)
+	{
+		result.get(); // propagates any unexpected exceptions
+	}
+
+	// Node creation and scene insertion is happening in the original order on this thread
+	for (const auto& location : entities)
+	{
+		auto entity = createEntity(location, _strings);
+
+		for (std::size_t i = location.firstPrimitive; i < location.firstPrimitive + location.numPrimitives; ++i)
+		{
+			auto primitive = decoded[i].type == PrimitiveType::Brush ?
+				createBrush(decoded[i], _strings) : createPatch(decoded[i], _strings);
+
+			_importFilter.addPrimitiveToEntity(primitive, entity);
+
+			// The decoded values are not needed anymore
+			decoded[i] = DecodedPrimitive();
+		}
+
+		_importFilter.addEntity(entity);
+	}
+
+	rMessage() << "[MapCache] Loaded " << entities.size() << " entities and "
+		<< decoded.size() << " primitives from the map cache" << std::endl;
+}
+
+}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "imapformat.h"
+#include "imapinfofile.h"
+
+namespace map
+{
+
+namespace cache
+{
+
+// File extension of the binary map cache, stored next to the .map file
+const char* const MAP_CACHE_EXTENSION = ".mapcache";
+
+/**
+ * Identifies the contents of a map file: its size and SHA256 hash.
+ * A map cache is only valid for the map file it has been created from.
+ */
+struct MapFileChecksum
+{
+	std::uint64_t size = 0;
+	std::string hash;
+
+	bool operator==(const MapFileChecksum& other) const
+	{
+		return size == other.size && hash == other.hash;
+	}
+
+	bool operator!=(const MapFileChecksum& other) const
+	{
+		return !operator==(other);
+	}
+};
+
+// Calculates the checksum of the given stream's contents, the stream is rewound afterwards
+MapFileChecksum calculateChecksum(std::istream& stream);
+
+/**
+ * Writes the binary map cache, containing the scene as it has been
+ * loaded from the map file: entities as interned key/value tables,
+ * brushes as plane and texture matrix arrays, patches as control point arrays.
+ *
+ * The primitives are stored in their final position, i.e. including
+ * the origin of their parent entity.
+ */
+class BinaryMapCacheWriter
+{
+private:
+	MapFileChecksum _checksum;
+	std::string _mapFormatName;
+
+public:
+	BinaryMapCacheWriter(const MapFileChecksum& checksum, const std::string& mapFormatName);
+
+	// Writes the given nodes to the stream, in the order they have been
+	// imported from the map file. Throws IMapWriter::FailureException on error.
+	void write(const NodeIndexMap& nodes, std::ostream& stream);
+};
+
+/**
+ * Map reader loading the contents of a binary map cache, sending
+ * the nodes through the import filter in the same order as the
+ * map reader did when the cache has been written.
+ */
+class BinaryMapCacheReader :
+	public IMapReader
+{
+private:
+	IMapImportFilter& _importFilter;
+
+	// The string table of the cache, indexed by the records
+	std::vector<std::string> _strings;
+
+public:
+	BinaryMapCacheReader(IMapImportFilter& importFilter);
+
+	// Throws FailureException if the cache is damaged
+	void readFromStream(std::istream& stream) override;
+
+	// Returns true if the cache in the given stream has been created for
+	// a map file with the given checksum and format. The stream is rewound afterwards.
+	static bool IsValidFor(std::istream& stream, const MapFileChecksum& checksum,
+		const std::string& mapFormatName);
+};
+
+}
+
+}
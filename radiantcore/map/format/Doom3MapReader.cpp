@@ -3,12 +3,23 @@
 #include "itextstream.h"
 #include "ieclass.h"
 #include "igame.h"
+#include "imap.h"
 #include "scene/EntityNode.h"
 #include "string/string.h"
+#include "registry/registry.h"
 
 #include "Doom3MapFormat.h"
+#include "../algorithm/Models.h"
 
 #include "i18n.h"
+#include <atomic>
+#include <algorithm>
+#include <cctype>
+#include <future>
+#include <thread>
+#include <iterator>
+#include <set>
+#include <string_view>
 #include <fmt/format.h>
 
 #include "primitiveparsers/BrushDef.h"
@@ -18,6 +29,77 @@
 
 namespace map {
 
+namespace
+{
+	// The number of primitives a worker is processing in one go
+	constexpr std::size_t PRIMITIVE_BATCH_SIZE = 256;
+
+	// Hands out the tokens of a primitive block which has been tokenised beforehand
+	class TokenListTokeniser :
+		public parser::DefTokeniser
+	{
+	private:
+		const std::vector<std::string_view>& _tokens;
+		std::size_t _next;
+
+	public:
+		TokenListTokeniser(const std::vector<std::string_view>& tokens) :
+			_tokens(tokens),
+			_next(0)
+		{}
+
+		bool hasMoreTokens() const override
+		{
+			return _next < _tokens.size();
+		}
+
+		std::string nextToken() override
+		{
+			return std::string(nextTokenView());
+		}
+
+		std::string peek() const override
+		{
+			if (_next >= _tokens.size())
+			{
+				throw parser::ParseException("DefTokeniser: no more tokens");
+			}
+
+			return std::string(_tokens[_next]);
+		}
+
+		void assertNextToken(const std::string& val) override
+		{
+			auto tok = nextTokenView();
+
+			if (tok != val)
+			{
+				throw parser::ParseException("DefTokeniser: Assertion failed: Required \""
+					+ val + "\", found \"" + std::string(tok) + "\"");
+			}
+		}
+
+		void skipTokens(unsigned int n) override
+		{
+			for (unsigned int i = 0; i < n; i++)
+			{
+				nextTokenView();
+			}
+		}
+
+	private:
+		std::string_view nextTokenView()
+		{
+			if (_next >= _tokens.size())
+			{
+				throw parser::ParseException("DefTokeniser: no more tokens");
+			}
+
+			return _tokens[_next++];
+		}
+	};
+}
+
 Doom3MapReader::Doom3MapReader(IMapImportFilter& importFilter) :
 	_importFilter(importFilter),
 	_entityCount(0),
@@ -29,6 +111,18 @@ void Doom3MapReader::readFromStream(std::istream& stream)
 	// Call the virtual method to initialise the primitve parser map (if not done yet)
 	initPrimitiveParsers();
 
+	if (registry::getValue<bool>(RKEY_MAP_PARALLEL_LOADING))
+	{
+		// Pull the whole file into memory, the parallel path is working on the buffer
+		std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+		// Reset the EOF state, the import filter is still querying the stream position
+		stream.clear();
+
+		readFromBuffer(buffer);
+		return;
+	}
+
 	// The tokeniser used to split the stream into pieces
 	parser::BasicDefTokeniser<std::istream> tok(stream);
 
@@ -58,6 +152,352 @@ void Doom3MapReader::readFromStream(std::istream& stream)
 	// EOF reached, success
 }
 
+void Doom3MapReader::readFromBuffer(const std::string& buffer)
+{
+	std::vector<EntityBlock> entities;
+	std::size_t headerEnd = splitIntoEntityBlocks(buffer, entities);
+
+	// Parse the map version from the text in front of the first entity (throws on failure)
+	{
+		parser::BasicDefTokeniser<std::string_view> tok(buffer.data(), headerEnd);
+		parseMapVersion(tok);
+	}
+
+	// Parse the spawnargs up front, the models they reference are loaded
+	// in the background while the primitives are processed
+	std::vector<EntityKeyValues> entityKeyValues(entities.size());
+	std::vector<std::string> entityErrors(entities.size());
+	std::set<std::string> modelKeyValues;
+
+	for (std::size_t i = 0; i < entities.size(); ++i)
+	{
+		try
+		{
+			entityKeyValues[i] = parseKeyValues(buffer, entities[i].keyValues);
+		}
+		catch (FailureException& e)
+		{
+			entityErrors[i] = e.what();
+			continue;
+		}
+
+		auto model = entityKeyValues[i].find("model");
+
+		if (model != entityKeyValues[i].end())
+		{
+			modelKeyValues.insert(model->second);
+		}
+	}
+
+	algorithm::prefetchModels(modelKeyValues);
+
+	// Flatten the primitive blocks of all entities, the workers don't care about ownership
+	std::vector<const TextRange*> primitiveRanges;
+	std::vector<std::size_t> primitiveNumbers;
+
+	for (const auto& entity : entities)
+	{
+		for (std::size_t i = 0; i < entity.primitives.size(); ++i)
+		{
+			primitiveRanges.push_back(&entity.primitives[i]);
+			primitiveNumbers.push_back(i + 1);
+		}
+	}
+
+	// The workers are only tokenising the primitives. Creating brushes and patches
+	// is emitting signals which are not meant to be used outside the main thread.
+	// The tokens are views into the buffer, which stays alive until all nodes are built.
+	std::vector<PrimitiveTokens> primitiveTokens(primitiveRanges.size());
+	std::vector<std::string> errors(primitiveRanges.size());
+	std::atomic<std::size_t> nextBatch(0);
+
+	// Every worker keeps grabbing batches until all primitives are processed
+	// Each primitive is writing to its own slot, no need to lock anything here
+	auto worker = [&]()
+	{
+		while (true)
+		{
+			std::size_t start = nextBatch.fetch_add(1) * PRIMITIVE_BATCH_SIZE;
+
+			if (start >= primitiveRanges.size()) break;
+
+			std::size_t end = std::min(start + PRIMITIVE_BATCH_SIZE, primitiveRanges.size());
+
+			for (std::size_t i = start; i < end; ++i)
+			{
+				try
+				{
+					primitiveTokens[i] = tokenisePrimitiveBlock(buffer, *primitiveRanges[i], primitiveNumbers[i]);
+				}
+				catch (FailureException& e)
+				{
+					errors[i] = e.what();
+				}
+			}
+		}
+	};
+
+	std::size_t numBatches = (primitiveRanges.size() + PRIMITIVE_BATCH_SIZE - 1) / PRIMITIVE_BATCH_SIZE;
+	std::size_t numWorkers = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), numBatches);
+
+	// The calling thread is doing its share too
+	std::vector<std::future<void>> workers;
+
+	for (std::size_t i = 1; i < numWorkers; ++i)
+	{
+		workers.emplace_back(std::async(std::launch::async, worker));
+	}
+
+	worker();
+
+	for (auto& result : workers)
+	{
+		result.get(); // propagates any unexpected exceptions
+	}
+
+	rMessage() << "[mapdoom3] Tokenised " << primitiveTokens.size() << " primitives in "
+		<< numBatches << " batches using " << std::max<std::size_t>(numWorkers, 1) << " threads" << std::endl;
+
+	// Entity creation and scene insertion is happening in file order on this thread
+	std::size_t primitiveIndex = 0;
+
+	for (std::size_t entityIndex = 0; entityIndex < entities.size(); ++entityIndex)
+	{
+		const auto& block = entities[entityIndex];
+
+		try
+		{
+			if (!entityErrors[entityIndex].empty())
+			{
+				throw FailureException(entityErrors[entityIndex]);
+			}
+
+			scene::INodePtr entity = createEntity(entityKeyValues[entityIndex]);
+
+			for (_primitiveCount = 0; _primitiveCount < block.primitives.size(); ++_primitiveCount, ++primitiveIndex)
+			{
+				if (!errors[primitiveIndex].empty())
+				{
+					throw FailureException(errors[primitiveIndex]);
+				}
+
+				auto primitive = parsePrimitiveTokens(primitiveTokens[primitiveIndex], _primitiveCount + 1);
+				_importFilter.addPrimitiveToEntity(primitive, entity);
+
+				// The tokens are not needed anymore
+				primitiveTokens[primitiveIndex] = PrimitiveTokens();
+			}
+
+			_importFilter.addEntity(entity);
+		}
+		catch (FailureException& e)
+		{
+			std::string text = fmt::format(_("Failed parsing entity {0:d}:\n{1}"), _entityCount, e.what());
+
+			// Re-throw with more text
+			throw FailureException(text);
+		}
+
+		_entityCount++;
+	}
+}
+
+std::size_t Doom3MapReader::splitIntoEntityBlocks(const std::string& buffer, std::vector<EntityBlock>& entities)
+{
+	const std::size_t length = buffer.length();
+	const std::size_t npos = std::string::npos;
+
+	std::size_t headerEnd = length;
+	std::size_t primitiveStart = 0;
+	std::size_t depth = 0;
+
+	for (std::size_t i = 0; i < length; ++i)
+	{
+		char c = buffer[i];
+
+		// Braces within quoted strings and comments must not be counted,
+		// the rules are matching the ones of the DefTokeniser
+		if (c == '"')
+		{
+			for (++i; i < length && buffer[i] != '"'; ++i)
+			{
+				if (buffer[i] == '\\') ++i; // skip escaped characters
+			}
+			continue;
+		}
+
+		if (c == '/' && i + 1 < length && buffer[i + 1] == '/')
+		{
+			i = buffer.find_first_of("\r\n", i);
+			if (i == npos) break;
+			continue;
+		}
+
+		if (c == '/' && i + 1 < length && buffer[i + 1] == '*')
+		{
+			i = buffer.find("*/", i + 2);
+			if (i == npos) break;
+			++i; // skip the slash
+			continue;
+		}
+
+		if (c == '{')
+		{
+			if (depth == 0)
+			{
+				if (entities.empty())
+				{
+					headerEnd = i;
+				}
+
+				entities.emplace_back(EntityBlock{ TextRange{ i + 1, npos } });
+			}
+			else if (depth == 1)
+			{
+				primitiveStart = i;
+
+				// The key values are ending where the first primitive starts
+				if (entities.back().keyValues.end == npos)
+				{
+					entities.back().keyValues.end = i;
+				}
+			}
+
+			++depth;
+		}
+		else if (c == '}')
+		{
+			if (depth == 0)
+			{
+				throw FailureException(fmt::format(_("Failed parsing entity {0:d}:\n{1}"),
+					entities.size(), _("Unexpected closing brace")));
+			}
+
+			--depth;
+
+			if (depth == 1)
+			{
+				entities.back().primitives.emplace_back(TextRange{ primitiveStart, i + 1 });
+			}
+			else if (depth == 0 && entities.back().keyValues.end == npos)
+			{
+				entities.back().keyValues.end = i;
+			}
+		}
+		else if (depth == 0 && !entities.empty() && !std::isspace(static_cast<unsigned char>(c)))
+		{
+			throw FailureException(fmt::format(_("Failed parsing entity {0:d}:\n{1}"),
+				entities.size(), fmt::format(_("Unexpected character '{0}' between entities"), c)));
+		}
+	}
+
+	if (depth > 0)
+	{
+		throw FailureException(fmt::format(_("Failed parsing entity {0:d}:\n{1}"),
+			entities.size() - 1, _("Unexpected end of file")));
+	}
+
+	return headerEnd;
+}
+
+Doom3MapReader::PrimitiveTokens Doom3MapReader::tokenisePrimitiveBlock(const std::string& buffer,
+	const TextRange& range, std::size_t primitiveNum) const
+{
+	PrimitiveTokens tokens;
+
+	const char* bufferStart = buffer.data();
+	const char* bufferEnd = bufferStart + buffer.size();
+
+	try
+	{
+		parser::BasicDefTokeniser<std::string_view> tok(bufferStart + range.begin, range.end - range.begin);
+
+		while (tok.hasMoreTokens())
+		{
+			auto token = tok.nextTokenView();
+
+			// Quoted tokens with escape sequences are assembled by the tokeniser,
+			// these need to be kept, everything else is pointing into the buffer
+			if (token.data() < bufferStart || token.data() > bufferEnd)
+			{
+				token = tokens.assembled.emplace_back(token);
+			}
+
+			tokens.views.push_back(token);
+		}
+	}
+	catch (parser::ParseException& e)
+	{
+		// Translate ParseExceptions to FailureExceptions
+		throw FailureException(fmt::format(_("Primitive #{0:d}: parse exception {1}"), primitiveNum, e.what()));
+	}
+
+	return tokens;
+}
+
+scene::INodePtr Doom3MapReader::parsePrimitiveTokens(const PrimitiveTokens& tokens, std::size_t primitiveNum) const
+{
+	try
+	{
+		TokenListTokeniser tok(tokens.views);
+
+		tok.assertNextToken("{");
+
+		std::string primitiveKeyword = tok.nextToken();
+
+		auto p = _primitiveParsers.find(primitiveKeyword);
+
+		if (p == _primitiveParsers.end())
+		{
+			throw FailureException("Unknown primitive type: " + primitiveKeyword);
+		}
+
+		scene::INodePtr primitive = p->second->parse(tok);
+
+		if (!primitive)
+		{
+			throw FailureException(fmt::format(_("Primitive #{0:d}: parse error"), primitiveNum));
+		}
+
+		return primitive;
+	}
+	catch (parser::ParseException& e)
+	{
+		// Translate ParseExceptions to FailureExceptions
+		throw FailureException(fmt::format(_("Primitive #{0:d}: parse exception {1}"), primitiveNum, e.what()));
+	}
+}
+
+Doom3MapReader::EntityKeyValues Doom3MapReader::parseKeyValues(const std::string& buffer, const TextRange& range) const
+{
+	EntityKeyValues keyValues;
+
+	parser::BasicDefTokeniser<std::string_view> tok(buffer.data() + range.begin, range.end - range.begin);
+
+	try
+	{
+		while (tok.hasMoreTokens())
+		{
+			std::string key = tok.nextToken();
+			std::string value = tok.nextToken();
+
+			// Same sanity check as in parseEntity()
+			if (value == "{" || value == "}")
+			{
+				throw FailureException(fmt::format(_("Parsed invalid value '{0}' for key '{1}'"), value, key));
+			}
+
+			keyValues.insert(EntityKeyValues::value_type(key, value));
+		}
+	}
+	catch (parser::ParseException& e)
+	{
+		throw FailureException(e.what());
+	}
+
+	return keyValues;
+}
+
 void Doom3MapReader::initPrimitiveParsers()
 {
 	if (_primitiveParsers.empty())
@@ -1,7 +1,10 @@
 #ifndef NODE_IMPORTER_H_
 #define NODE_IMPORTER_H_
 
+#include <list>
 #include <map>
+#include <string_view>
+#include <vector>
 #include "inode.h"
 #include "imapformat.h"
 #include "parser/DefTokeniser.h"
@@ -27,6 +30,23 @@ protected:
 	typedef std::map<std::string, PrimitiveParserPtr> PrimitiveParsers;
 	PrimitiveParsers _primitiveParsers;
 
+	// A [begin, end) character range in the map text buffer
+	struct TextRange
+	{
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	// The ranges of a single entity block, as found by the brace-matching scan
+	struct EntityBlock
+	{
+		// The key/value section between the opening brace and the first primitive
+		TextRange keyValues;
+
+		// Each primitive block, including its enclosing braces
+		std::vector<TextRange> primitives;
+	};
+
 public:
 	Doom3MapReader(IMapImportFilter& importFilter);
 
@@ -46,6 +66,37 @@ protected:
 	// Parses an entity plus all child primitives, throws on failure
 	virtual void parseEntity(parser::DefTokeniser& tok);
 
+	// Parallel load path: splits the buffer into entity blocks, tokenises the primitives
+	// on a worker pool and sends the parsed nodes to the import filter in file order
+	void readFromBuffer(const std::string& buffer);
+
+	// Scans the map text for the top-level entity blocks and their primitive blocks.
+	// Returns the offset of the first entity block, the text before is the map header.
+	std::size_t splitIntoEntityBlocks(const std::string& buffer, std::vector<EntityBlock>& entities);
+
+	// The tokens of a single primitive block, including its enclosing braces
+	struct PrimitiveTokens
+	{
+		// Views into the map text buffer or into the assembled strings
+		std::vector<std::string_view> views;
+
+		// Quoted tokens which don't exist in the buffer as they are (escape sequences).
+		// The list nodes are never moved, so the views stay valid.
+		std::list<std::string> assembled;
+	};
+
+	// Splits a single primitive block into tokens, throws on failure.
+	// Safe to be called from worker threads, no nodes are created here.
+	PrimitiveTokens tokenisePrimitiveBlock(const std::string& buffer, const TextRange& range,
+		std::size_t primitiveNum) const;
+
+	// Runs the matching primitive parser on the given tokens, throws on failure.
+	// Creating the nodes emits signals, this must run on the thread loading the map.
+	scene::INodePtr parsePrimitiveTokens(const PrimitiveTokens& tokens, std::size_t primitiveNum) const;
+
+	// Parses the key/value pairs in the given text range, throws on failure
+	EntityKeyValues parseKeyValues(const std::string& buffer, const TextRange& range) const;
+
 	// Parse the primitive block and insert the child into the given parent
 	virtual void parsePrimitive(parser::DefTokeniser& tok, const scene::INodePtr& parentEntity);
 
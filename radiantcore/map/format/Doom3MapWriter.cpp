@@ -1,7 +1,14 @@
 #include "Doom3MapWriter.h"
 
+#include <atomic>
+#include <future>
+#include <sstream>
+#include <thread>
+
 #include "igame.h"
+#include "imap.h"
 #include "scene/EntityNode.h"
+#include "registry/registry.h"
 
 #include "primitivewriters/BrushDef3Exporter.h"
 #include "primitivewriters/PatchDefExporter.h"
@@ -14,6 +21,12 @@ namespace map
 namespace
 {
 
+// Entities with fewer primitives are written on the calling thread
+constexpr std::size_t MIN_PRIMITIVES_FOR_PARALLEL_WRITE = 256;
+
+// Number of primitives each worker is formatting into a single buffer
+constexpr std::size_t PRIMITIVE_WRITE_BATCH_SIZE = 128;
+
 // Escape line breaks and quotes in the given input string
 inline std::string escapeEntityKeyValue(const std::string& input)
 {
@@ -26,27 +39,28 @@ inline std::string escapeEntityKeyValue(const std::string& input)
 
 Doom3MapWriter::Doom3MapWriter() :
 	_entityCount(0),
-	_primitiveCount(0)
+	_parallelSaving(registry::getValue<bool>(RKEY_MAP_PARALLEL_SAVING))
 {}
 
 void Doom3MapWriter::beginWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream)
 {
 	// Write the version tag
-    stream << "Version " << MAP_VERSION_D3 << std::endl;
+    stream << "Version " << MAP_VERSION_D3 << "\n";
 }
 
 void Doom3MapWriter::endWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream)
 {
-	// nothing
+	// Primitives exported without a parent entity
+	writePendingPrimitives(stream);
 }
 
 void Doom3MapWriter::beginWriteEntity(const EntityNodePtr& entity, std::ostream& stream)
 {
 	// Write out the entity number comment
-	stream << "// entity " << _entityCount++ << std::endl;
+	stream << "// entity " << _entityCount++ << "\n";
 
 	// Entity opening brace
-	stream << "{" << std::endl;
+	stream << "{\n";
 
 	// Entity key values
 	writeEntityKeyValues(entity, stream);
@@ -57,26 +71,21 @@ void Doom3MapWriter::writeEntityKeyValues(const EntityNodePtr& entity, std::ostr
 	// Export the entity key values
     entity->getEntity().forEachKeyValue([&](const std::string& key, const std::string& value)
     {
-        stream << "\"" << escapeEntityKeyValue(key) << "\" \"" << escapeEntityKeyValue(value) << "\"" << std::endl;
+        stream << "\"" << escapeEntityKeyValue(key) << "\" \"" << escapeEntityKeyValue(value) << "\"\n";
     });
 }
 
 void Doom3MapWriter::endWriteEntity(const EntityNodePtr& entity, std::ostream& stream)
 {
-	// Write the closing brace for the entity
-	stream << "}" << std::endl;
+	writePendingPrimitives(stream);
 
-	// Reset the primitive count again
-	_primitiveCount = 0;
+	// Write the closing brace for the entity
+	stream << "}\n";
 }
 
 void Doom3MapWriter::beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream)
 {
-	// Primitive count comment
-	stream << "// primitive " << _primitiveCount++ << std::endl;
-
-	// Export brushDef3 definition to stream
-	BrushDef3Exporter::exportBrush(stream, brush);
+	_pendingPrimitives.push_back(Primitive{ brush, IPatchNodePtr() });
 }
 
 void Doom3MapWriter::endWriteBrush(const IBrushNodePtr& brush, std::ostream& stream)
@@ -85,17 +94,122 @@ void Doom3MapWriter::endWriteBrush(const IBrushNodePtr& brush, std::ostream& str
 }
 
 void Doom3MapWriter::beginWritePatch(const IPatchNodePtr& patch, std::ostream& stream)
+{
+	_pendingPrimitives.push_back(Primitive{ IBrushNodePtr(), patch });
+}
+
+void Doom3MapWriter::endWritePatch(const IPatchNodePtr& patch, std::ostream& stream)
+{
+	// nothing
+}
+
+void Doom3MapWriter::writeBrush(const IBrushNodePtr& brush, std::size_t number, std::ostream& stream) const
 {
 	// Primitive count comment
-	stream << "// primitive " << _primitiveCount++ << std::endl;
+	stream << "// primitive " << number << "\n";
+
+	// Export brushDef3 definition to stream
+	BrushDef3Exporter::exportBrush(stream, brush);
+}
 
-	// Export patch here _mapStream
+void Doom3MapWriter::writePatch(const IPatchNodePtr& patch, std::size_t number, std::ostream& stream) const
+{
+	// Primitive count comment
+	stream << "// primitive " << number << "\n";
+
+	// Export patch definition to stream
 	PatchDefExporter::exportPatch(stream, patch);
 }
 
-void Doom3MapWriter::endWritePatch(const IPatchNodePtr& patch, std::ostream& stream)
+bool Doom3MapWriter::canWritePrimitivesConcurrently() const
 {
-	// nothing
+	return true;
+}
+
+void Doom3MapWriter::writePendingPrimitives(std::ostream& stream)
+{
+	auto writePrimitive = [&](std::size_t index, std::ostream& output)
+	{
+		const auto& primitive = _pendingPrimitives[index];
+
+		if (primitive.brush)
+		{
+			writeBrush(primitive.brush, index, output);
+		}
+		else
+		{
+			writePatch(primitive.patch, index, output);
+		}
+	};
+
+	if (!_parallelSaving || !canWritePrimitivesConcurrently() ||
+		_pendingPrimitives.size() < MIN_PRIMITIVES_FOR_PARALLEL_WRITE)
+	{
+		for (std::size_t i = 0; i < _pendingPrimitives.size(); ++i)
+		{
+			writePrimitive(i, stream);
+		}
+
+		_pendingPrimitives.clear();
+		return;
+	}
+
+	std::size_t numBatches = (_pendingPrimitives.size() + PRIMITIVE_WRITE_BATCH_SIZE - 1) / PRIMITIVE_WRITE_BATCH_SIZE;
+	std::vector<std::string> buffers(numBatches);
+	std::atomic<std::size_t> nextBatch(0);
+
+	// Every worker keeps grabbing batches until all primitives are formatted
+	// Each batch is writing to its own buffer, no need to lock anything here
+	auto worker = [&]()
+	{
+		while (true)
+		{
+			std::size_t batch = nextBatch.fetch_add(1);
+
+			if (batch >= numBatches) break;
+
+			// Format the numbers exactly like the target stream would
+			std::ostringstream output;
+			output.flags(stream.flags());
+			output.precision(stream.precision());
+			output.imbue(stream.getloc());
+
+			std::size_t start = batch * PRIMITIVE_WRITE_BATCH_SIZE;
+			std::size_t end = std::min(start + PRIMITIVE_WRITE_BATCH_SIZE, _pendingPrimitives.size());
+
+			for (std::size_t i = start; i < end; ++i)
+			{
+				writePrimitive(i, output);
+			}
+
+			buffers[batch] = output.str();
+		}
+	};
+
+	std::size_t numWorkers = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), numBatches);
+
+	// The calling thread is doing its share too
+	std::vector<std::future<void>> workers;
+
+	for (std::size_t i = 1; i < numWorkers; ++i)
+	{
+		workers.emplace_back(std::async(std::launch::async, worker));
+	}
+
+	worker();
+
+	for (auto& result : workers)
+	{
+		result.get(); // propagates any exceptions
+	}
+
+	_pendingPrimitives.clear();
+
+	// Write the buffers in scene order
+	for (const auto& buffer : buffers)
+	{
+		stream.write(buffer.data(), buffer.size());
+	}
 }
 
 } // namespace
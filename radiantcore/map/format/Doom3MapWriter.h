@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "imapformat.h"
 #include "scene/scene_fwd.h"
 
@@ -10,14 +11,29 @@ namespace map
  * Standard implementation of a Doom 3 Map file writer (Map Version 2)
  *
  * Creates a plaintext file with brushDef3/patchDef2/patchDef3 primitives.
+ *
+ * The primitives of an entity are collected and written when the entity is
+ * finished. Entities with many primitives (like the worldspawn) are formatted
+ * on several threads, with the resulting text written in scene order.
  */
 class Doom3MapWriter :
 	public IMapWriter
 {
 protected:
-	// The counters for numbering the comments
+	// The counter for numbering the entity comments
 	std::size_t _entityCount;
-	std::size_t _primitiveCount;
+
+private:
+	struct Primitive
+	{
+		IBrushNodePtr brush;
+		IPatchNodePtr patch;
+	};
+
+	// The primitives of the current entity, written in endWriteEntity()
+	std::vector<Primitive> _pendingPrimitives;
+
+	bool _parallelSaving;
 
 public:
 	Doom3MapWriter();
@@ -39,6 +55,18 @@ public:
 
 protected:
 	void writeEntityKeyValues(const EntityNodePtr& entity, std::ostream& stream);
+
+	// Write a single primitive along with its comment line, the number is counting
+	// the primitives of the current entity. These may be called from several threads
+	// at once, implementations must not modify the writer or the scene.
+	virtual void writeBrush(const IBrushNodePtr& brush, std::size_t number, std::ostream& stream) const;
+	virtual void writePatch(const IPatchNodePtr& patch, std::size_t number, std::ostream& stream) const;
+
+	// Returns true if writeBrush() and writePatch() can be called concurrently
+	virtual bool canWritePrimitivesConcurrently() const;
+
+private:
+	void writePendingPrimitives(std::ostream& stream);
 };
 
 } // namespace
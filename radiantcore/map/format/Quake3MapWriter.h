@@ -19,37 +19,44 @@ public:
 	virtual void beginWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream) override
 	{
 		// Write an empty line at the beginning of the file
-		stream << std::endl;
+		stream << "\n";
 	}
 
-	virtual void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
+protected:
+	void writeBrush(const IBrushNodePtr& brush, std::size_t number, std::ostream& stream) const override
 	{
 		// Primitive count comment
-		stream << "// brush " << _primitiveCount++ << std::endl;
+		stream << "// brush " << number << "\n";
 
 		// Export old brush syntax to stream
 		LegacyBrushDefExporter::exportBrush(stream, brush);
 	}
 
-	virtual void beginWritePatch(const IPatchNodePtr& patch, std::ostream& stream) override
+	void writePatch(const IPatchNodePtr& patch, std::size_t number, std::ostream& stream) const override
 	{
 		// Primitive count comment, not a typo, patches also seem to have "brush" in their comments
-		stream << "// brush " << _primitiveCount++ << std::endl;
+		stream << "// brush " << number << "\n";
 
 		// Export patchDef2 to stream (patchDef3 is not supported)
 		PatchDefExporter::exportQ3PatchDef2(stream, patch);
 	}
+
+	// The legacy brush format needs the texture dimensions, which might have to be loaded first
+	bool canWritePrimitivesConcurrently() const override
+	{
+		return false;
+	}
 };
 
 class Quake3AlternateMapWriter :
     public Doom3MapWriter
 {
-public:
+protected:
     // Q3 alternate is writing the newer brushDef syntax
-    virtual void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
+    void writeBrush(const IBrushNodePtr& brush, std::size_t number, std::ostream& stream) const override
     {
         // Primitive count comment
-        stream << "// brush " << _primitiveCount++ << std::endl;
+        stream << "// brush " << number << "\n";
 
         // Export brushDef definition to stream
         BrushDefExporter::exportBrush(stream, brush);
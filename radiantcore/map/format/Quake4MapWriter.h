@@ -17,13 +17,14 @@ public:
 	virtual void beginWriteMap(const scene::IMapRootNodePtr& root, std::ostream& stream) override
 	{
 		// Write the version tag
-		stream << "Version " << MAP_VERSION_Q4 << std::endl;
+		stream << "Version " << MAP_VERSION_Q4 << "\n";
 	}
 
-	virtual void beginWriteBrush(const IBrushNodePtr& brush, std::ostream& stream) override
+protected:
+	void writeBrush(const IBrushNodePtr& brush, std::size_t number, std::ostream& stream) const override
 	{
 		// Primitive count comment
-		stream << "// primitive " << _primitiveCount++ << std::endl;
+		stream << "// primitive " << number << "\n";
 
 		// Export brushDef3 definition to stream, but without contents flags
 		BrushDef3Exporter::exportBrush(stream, brush, false);
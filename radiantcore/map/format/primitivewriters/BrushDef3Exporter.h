@@ -18,9 +18,9 @@ public:
 		const IBrush& brush = brushNode->getIBrush();
 
 		// Brush decl header
-		stream << "{" << std::endl;
-		stream << "brushDef3" << std::endl;
-		stream << "{" << std::endl;
+		stream << "{\n";
+		stream << "brushDef3\n";
+		stream << "{\n";
 
 		// Iterate over each brush face, exporting the tokens from all faces
 		for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
@@ -29,7 +29,7 @@ public:
 		}
 
 		// Close brush contents and header
-		stream << "}" << std::endl << "}" << std::endl;
+		stream << "}\n}\n";
 	}
 
 private:
@@ -94,7 +94,7 @@ private:
 			stream << detailFlag << " 0 0";
 		}
 
-		stream << std::endl;
+		stream << "\n";
 	}
 };
 
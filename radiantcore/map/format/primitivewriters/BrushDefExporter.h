@@ -21,9 +21,9 @@ public:
 		const IBrush& brush = brushNode->getIBrush();
 
 		// Brush decl header
-		stream << "{" << std::endl;
-		stream << "brushDef" << std::endl;
-		stream << "{" << std::endl;
+		stream << "{\n";
+		stream << "brushDef\n";
+		stream << "{\n";
 
 		// Iterate over each brush face, exporting the tokens from all faces
 		for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
@@ -32,7 +32,7 @@ public:
 		}
 
 		// Close brush contents and header
-		stream << "}" << std::endl << "}" << std::endl;
+		stream << "}\n}\n";
 	}
 
 	/* 
@@ -133,7 +133,7 @@ private:
 		// Export (dummy) contents/flags
 		stream << detailFlag << " 0 0";
 		
-		stream << std::endl;
+		stream << "\n";
 	}
 };
 
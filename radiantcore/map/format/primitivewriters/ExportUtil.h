@@ -1,6 +1,8 @@
 #pragma once
 
 #include <ostream>
+#include <algorithm>
+#include <fmt/format.h>
 #include "math/FloatTools.h"
 
 namespace map
@@ -15,6 +17,15 @@ inline void writeDoubleSafe(const double d, std::ostream& os)
 		{
 			os << 0; // convert -0 to 0
 		}
+		else if ((os.flags() & std::ios_base::floatfield) == 0)
+		{
+			// Same output as os << d (%g with the stream's precision),
+			// without going through the stream's locale facets
+			char buffer[40];
+			auto result = fmt::format_to_n(buffer, sizeof(buffer), "{:.{}g}", d,
+				std::max<std::streamsize>(os.precision(), 1));
+			os.write(buffer, result.out - buffer);
+		}
 		else
 		{
 			os << d;
@@ -22,7 +22,7 @@ public:
 		const IBrush& brush = brushNode->getIBrush();
 
 		// Curly braces surround the brush contents
-		stream << "{" << std::endl;
+		stream << "{\n";
 
 		// Iterate over each brush face, exporting the tokens from all faces
 		for (std::size_t i = 0; i < brush.getNumFaces(); ++i)
@@ -31,7 +31,7 @@ public:
 		}
 
 		// Close brush contents
-		stream << "}" << std::endl;
+		stream << "}\n";
 	}
 
     /*
@@ -150,7 +150,7 @@ private:
 		// Export contents flags and the two zeroes at the end
 		stream << detailFlag << " 0 0";
 		
-		stream << std::endl;
+		stream << "\n";
 	}
 };
 
@@ -3,20 +3,30 @@
 #include "imodel.h"
 #include "iparticlenode.h"
 #include "iparticles.h"
+#include "itextstream.h"
 
 #include "os/path.h"
 #include "os/file.h"
 
 #include "module/StaticModule.h"
 #include <functional>
+#include <thread>
+#include <algorithm>
 
 #include "map/algorithm/Models.h"
 
 namespace model
 {
 
+namespace
+{
+	// Upper limit of the worker threads loading models in the background
+	constexpr std::size_t MAX_MODEL_LOADER_THREADS = 8;
+}
+
 ModelCache::ModelCache() :
-	_enabled(true)
+	_numWorkers(0),
+	_loadedNotificationPending(false)
 {}
 
 scene::INodePtr ModelCache::getModelNode(const std::string& modelPath)
@@ -42,15 +52,32 @@ scene::INodePtr ModelCache::getModelNode(const std::string& modelPath)
 
 IModelPtr ModelCache::getModel(const std::string& modelPath)
 {
+	std::unique_lock<std::mutex> lock(_lock);
+
 	// Try to lookup the existing model
 	auto found = _modelMap.find(modelPath);
 
-	if (_enabled && found != _modelMap.end())
+	if (found != _modelMap.end())
 	{
 		return found->second;
 	}
 
-	// The model is not cached or the cache is disabled, load afresh
+	// If another thread is loading this model right now, wait for its result
+	auto pending = _pendingLoads.find(modelPath);
+
+	if (pending != _pendingLoads.end())
+	{
+		auto result = pending->second.result;
+		lock.unlock();
+
+		return result.get();
+	}
+
+	// The model is not cached, load afresh
+	std::promise<IModelPtr> promise;
+	_pendingLoads.emplace(modelPath, PendingLoad{ promise.get_future().share(), false });
+
+	lock.unlock();
 
 	// Get the extension of this model
 	std::string type = os::getExtension(modelPath);
@@ -58,7 +85,29 @@ IModelPtr ModelCache::getModel(const std::string& modelPath)
 	// Find a suitable model loader
 	IModelImporterPtr modelLoader = GlobalModelFormatManager().getImporter(type);
 
-	IModelPtr model = modelLoader->loadModelFromPath(modelPath);
+	IModelPtr model;
+
+	try
+	{
+		model = modelLoader->loadModelFromPath(modelPath);
+	}
+	catch (...)
+	{
+		// Don't leave the waiting threads hanging
+		finishLoad(modelPath, IModelPtr());
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	finishLoad(modelPath, model);
+	promise.set_value(model);
+
+	return model;
+}
+
+void ModelCache::finishLoad(const std::string& modelPath, const IModelPtr& model)
+{
+	std::lock_guard<std::mutex> lock(_lock);
 
 	if (model)
 	{
@@ -66,7 +115,178 @@ IModelPtr ModelCache::getModel(const std::string& modelPath)
 		_modelMap.emplace(modelPath, model);
 	}
 
-	return model;
+	_pendingLoads.erase(modelPath);
+}
+
+void ModelCache::prefetchModels(const std::set<std::string>& modelPaths)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	for (const auto& modelPath : modelPaths)
+	{
+		if (_modelMap.count(modelPath) > 0 || _pendingLoads.count(modelPath) > 0)
+		{
+			continue;
+		}
+
+		// Paths without a matching importer end up with the NullModelLoader, which is not using the cache
+		auto importer = GlobalModelFormatManager().getImporter(os::getExtension(modelPath));
+
+		if (importer->getExtension().empty())
+		{
+			continue;
+		}
+
+		auto promise = std::make_shared<std::promise<IModelPtr>>();
+		_pendingLoads.emplace(modelPath, PendingLoad{ promise->get_future().share(), true });
+		_backgroundQueue.push_back(BackgroundLoad{ modelPath, importer, promise });
+	}
+
+	// Forget about the workers which already ran out of work
+	_workers.erase(std::remove_if(_workers.begin(), _workers.end(), [](const std::future<void>& worker)
+	{
+		return worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}), _workers.end());
+
+	auto maxWorkers = std::clamp(static_cast<std::size_t>(std::thread::hardware_concurrency()),
+		static_cast<std::size_t>(1), MAX_MODEL_LOADER_THREADS);
+
+	while (_numWorkers < std::min(maxWorkers, _backgroundQueue.size()))
+	{
+		++_numWorkers;
+		_workers.emplace_back(std::async(std::launch::async, [this]() { processBackgroundQueue(); }));
+	}
+}
+
+void ModelCache::processBackgroundQueue()
+{
+	while (true)
+	{
+		BackgroundLoad load;
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			if (_backgroundQueue.empty())
+			{
+				--_numWorkers;
+				_workersFinished.notify_all();
+				return;
+			}
+
+			load = std::move(_backgroundQueue.front());
+			_backgroundQueue.pop_front();
+		}
+
+		IModelPtr model;
+
+		try
+		{
+			model = load.importer->loadModelFromPath(load.modelPath);
+		}
+		catch (const std::exception& ex)
+		{
+			rError() << "ModelCache: Failed to load " << load.modelPath << ": " << ex.what() << std::endl;
+		}
+		catch (...)
+		{
+			// Leaving the loop here would keep waitForBackgroundLoads() waiting forever
+			rError() << "ModelCache: Failed to load " << load.modelPath << ": unknown error" << std::endl;
+		}
+
+		finishLoad(load.modelPath, model);
+		load.promise->set_value(model);
+
+		// Announce the model to the observers waiting for it. Failed models are not
+		// announced, their placeholder is all that getModelNode() could provide.
+		if (model)
+		{
+			announceLoadedModel(load.modelPath);
+		}
+	}
+}
+
+void ModelCache::announceLoadedModel(const std::string& modelPath)
+{
+	MainThreadDispatcher dispatcher;
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		if (!_mainThreadDispatcher) return;
+
+		_loadedModels.insert(modelPath);
+
+		// Many models are finishing at once, a single notification is enough for all of them
+		if (_loadedNotificationPending) return;
+
+		_loadedNotificationPending = true;
+		dispatcher = _mainThreadDispatcher;
+	}
+
+	dispatcher([this]()
+	{
+		std::set<std::string> loadedModels;
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+
+			loadedModels.swap(_loadedModels);
+			_loadedNotificationPending = false;
+		}
+
+		if (!loadedModels.empty())
+		{
+			_sigModelsLoaded.emit(loadedModels);
+		}
+	});
+}
+
+bool ModelCache::isLoadingInBackground(const std::string& modelPath)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	if (!_mainThreadDispatcher)
+	{
+		return false;
+	}
+
+	// Loaded models count as long as their observers have not been notified
+	if (_loadedModels.count(modelPath) > 0)
+	{
+		return true;
+	}
+
+	auto pending = _pendingLoads.find(modelPath);
+
+	return pending != _pendingLoads.end() && pending->second.inBackground;
+}
+
+void ModelCache::waitForBackgroundLoads()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+
+	_workersFinished.wait(lock, [this]() { return _numWorkers == 0; });
+
+	auto workers = std::move(_workers);
+	_workers.clear();
+
+	lock.unlock();
+
+	for (auto& worker : workers)
+	{
+		worker.get();
+	}
+}
+
+void ModelCache::setMainThreadDispatcher(const MainThreadDispatcher& dispatcher)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_mainThreadDispatcher = dispatcher;
+
+	// A notification sent through the previous dispatcher might never run
+	_loadedModels.clear();
+	_loadedNotificationPending = false;
 }
 
 scene::INodePtr ModelCache::getModelNodeForStaticResource(const std::string& resourcePath)
@@ -94,31 +314,58 @@ scene::INodePtr ModelCache::loadNullModel(const std::string& modelPath)
 
 void ModelCache::removeModel(const std::string& modelPath)
 {
-	// greebo: Disable the modelcache. During map::clear(), the nodes
-	// get cleared, which might trigger a loopback to insert().
-	_enabled = false;
-
-	ModelMap::iterator found = _modelMap.find(modelPath);
+	IModelPtr removedModel;
 
-	if (found != _modelMap.end())
 	{
-		_modelMap.erase(found);
+		std::lock_guard<std::mutex> lock(_lock);
+
+		ModelMap::iterator found = _modelMap.find(modelPath);
+
+		if (found != _modelMap.end())
+		{
+			removedModel = found->second;
+			_modelMap.erase(found);
+		}
 	}
 
-	// Allow usage of the modelnodemap again.
-	_enabled = true;
+	// greebo: The model is released outside the lock. During map::clear(), the nodes
+	// get cleared, which might trigger a loopback to the cache.
 }
 
 void ModelCache::clear()
 {
-	// greebo: Disable the modelcache. During map::clear(), the nodes
-	// get cleared, which might trigger a loopback to insert().
-	_enabled = false;
+	// Drop the models which are still queued, loading them would be wasted
+	std::list<BackgroundLoad> cancelledLoads;
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		cancelledLoads.swap(_backgroundQueue);
 
-	_modelMap.clear();
+		for (const auto& load : cancelledLoads)
+		{
+			_pendingLoads.erase(load.modelPath);
+		}
+	}
+
+	// Threads waiting for one of these in getModel() get an empty model
+	for (const auto& load : cancelledLoads)
+	{
+		load.promise->set_value(IModelPtr());
+	}
+
+	// Don't let the loads already running put their model back afterwards
+	waitForBackgroundLoads();
+
+	ModelMap models;
 
-	// Allow usage of the modelnodemap again.
-	_enabled = true;
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		models.swap(_modelMap);
+	}
+
+	// greebo: The models are released outside the lock. During map::clear(), the nodes
+	// get cleared, which might trigger a loopback to the cache.
 }
 
 sigc::signal<void> ModelCache::signal_modelsReloaded()
@@ -126,6 +373,11 @@ sigc::signal<void> ModelCache::signal_modelsReloaded()
 	return _sigModelsReloaded;
 }
 
+sigc::signal<void, const std::set<std::string>&> ModelCache::signal_modelsLoaded()
+{
+	return _sigModelsLoaded;
+}
+
 // RegisterableModule implementation
 const std::string& ModelCache::getName() const
 {
@@ -156,6 +408,7 @@ void ModelCache::initialiseModule(const IApplicationContext& ctx)
 
 void ModelCache::shutdownModule()
 {
+	setMainThreadDispatcher(MainThreadDispatcher());
 	clear();
 }
 
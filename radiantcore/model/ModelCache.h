@@ -1,7 +1,12 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <list>
 #include <string>
+#include <mutex>
+#include <future>
+#include <condition_variable>
 #include "imodelcache.h"
 #include "icommandsystem.h"
 
@@ -16,10 +21,41 @@ private:
 	typedef std::map<std::string, IModelPtr> ModelMap;
 	ModelMap _modelMap;
 
-	// Flag to disable the cache on demand (used during clear())
-	bool _enabled;
+	// A model load in progress, threads requesting the same model wait for its result
+	struct PendingLoad
+	{
+		std::shared_future<IModelPtr> result;
+		bool inBackground;
+	};
+	std::map<std::string, PendingLoad> _pendingLoads;
+
+	// A model queued for loading on the worker threads
+	struct BackgroundLoad
+	{
+		std::string modelPath;
+		IModelImporterPtr importer;
+		std::shared_ptr<std::promise<IModelPtr>> promise;
+	};
+	std::list<BackgroundLoad> _backgroundQueue;
+
+	// Number of worker threads processing the background queue
+	std::size_t _numWorkers;
+	std::condition_variable _workersFinished;
+	std::vector<std::future<void>> _workers;
+
+	MainThreadDispatcher _mainThreadDispatcher;
+
+	// Models loaded in the background which have not been announced yet
+	std::set<std::string> _loadedModels;
+
+	// Set while an announcement of the loaded models is waiting to be run on the main thread
+	bool _loadedNotificationPending;
+
+	// Guards the containers above, models are loaded outside of it
+	std::mutex _lock;
 
 	sigc::signal<void> _sigModelsReloaded;
+	sigc::signal<void, const std::set<std::string>&> _sigModelsLoaded;
 
 public:
 	ModelCache();
@@ -32,6 +68,11 @@ public:
 
     scene::INodePtr getModelNodeForStaticResource(const std::string& resourcePath) override;
 
+	void prefetchModels(const std::set<std::string>& modelPaths) override;
+	bool isLoadingInBackground(const std::string& modelPath) override;
+	void waitForBackgroundLoads() override;
+	void setMainThreadDispatcher(const MainThreadDispatcher& dispatcher) override;
+
 	// Clear methods
 	void removeModel(const std::string& modelPath) override;
 	void clear() override;
@@ -41,6 +82,7 @@ public:
 
 	// Public events
 	sigc::signal<void> signal_modelsReloaded() override;
+	sigc::signal<void, const std::set<std::string>&> signal_modelsLoaded() override;
 
 	// RegisterableModule implementation
 	const std::string& getName() const override;
@@ -51,6 +93,16 @@ public:
 private:
     scene::INodePtr loadNullModel(const std::string& modelPath);
 
+	// Worker thread function, loading queued models until the queue is empty
+	void processBackgroundQueue();
+
+	// Inserts a loaded model and removes it from the pending loads
+	void finishLoad(const std::string& modelPath, const IModelPtr& model);
+
+	// Queues the given model to be announced on the main thread, together
+	// with the ones finishing until the dispatched notification is run
+	void announceLoadedModel(const std::string& modelPath);
+
 	// Command targets
 	void refreshModelsCmd(const cmd::ArgumentList& args);
 	void refreshSelectedModelsCmd(const cmd::ArgumentList& args);
@@ -5,6 +5,7 @@
 #include "math/Frustum.h"
 #include "math/Ray.h"
 #include "iselectiontest.h"
+#include "ivolumetest.h"
 #include "irenderable.h"
 #include "gamelib.h"
 
@@ -67,12 +68,17 @@ void StaticModelSurface::testSelect(Selector& selector, SelectionTest& test,
 		test.BeginMesh(localToWorld, twoSided);
 		SelectionIntersection result;
 
-		test.TestTriangles(
-			VertexPointer(&_vertices[0].vertex, sizeof(MeshVertex)),
-      		IndexPointer(&_indices[0],
-      					 IndexPointer::index_type(_indices.size())),
-			result
-		);
+		// Only test the triangles in parts of the hierarchy touching the selection volume,
+		// which is transformed into model space for that purpose
+		auto localFrustum = Frustum::createFromViewproj(
+			test.getVolume().GetViewProjection().getMultipliedBy(localToWorld));
+
+		VertexPointer vertices(&_vertices[0].vertex, sizeof(MeshVertex));
+
+		getBVH().foreachTriangleRangeInFrustum(localFrustum, [&](const unsigned int* indices, std::size_t numIndices)
+		{
+			test.TestTriangles(vertices, IndexPointer(indices, numIndices), result);
+		});
 
 		// Add the intersection to the selector if it is valid
 		if(result.isValid()) {
@@ -149,45 +155,31 @@ const AABB& StaticModelSurface::getSurfaceBounds() const
     return getAABB();
 }
 
-bool StaticModelSurface::getIntersection(const Ray& ray, Vector3& intersection, const Matrix4& localToWorld)
+const render::MeshBVH& StaticModelSurface::getBVH() const
 {
-	Vector3 bestIntersection = ray.origin;
-	Vector3 triIntersection;
-
-	for (Indices::const_iterator i = _indices.begin();
-		 i != _indices.end();
-		 i += 3)
+	if (!_bvh)
 	{
-		// Get the vertices for this triangle
-		const MeshVertex& p1 = _vertices[*(i)];
-		const MeshVertex& p2 = _vertices[*(i+1)];
-		const MeshVertex& p3 = _vertices[*(i+2)];
-
-		if (ray.intersectTriangle(localToWorld.transformPoint(p1.vertex), 
-			localToWorld.transformPoint(p2.vertex), localToWorld.transformPoint(p3.vertex), triIntersection))
-		{
-			intersection = triIntersection;
-			
-			// Test if this surface intersection is better than what we currently have
-			auto oldDistSquared = (bestIntersection - ray.origin).getLengthSquared();
-			auto newDistSquared = (triIntersection - ray.origin).getLengthSquared();
-
-			if ((oldDistSquared == 0 && newDistSquared > 0) || newDistSquared < oldDistSquared)
-			{
-				bestIntersection = triIntersection;
-			}
-		}
+		_bvh = std::make_unique<render::MeshBVH>(_vertices, _indices);
 	}
 
-	if ((bestIntersection - ray.origin).getLengthSquared() > 0)
-	{
-		intersection = bestIntersection;
-		return true;
-	}
-	else
+	return *_bvh;
+}
+
+bool StaticModelSurface::getIntersection(const Ray& ray, Vector3& intersection, const Matrix4& localToWorld)
+{
+	// Transform the ray into model space, instead of transforming every vertex
+	Ray localRay(ray);
+	localRay.transform(localToWorld.getFullInverse());
+
+	Vector3 localIntersection;
+
+	if (!getBVH().getIntersection(_vertices, localRay, localIntersection))
 	{
 		return false;
 	}
+
+	intersection = localToWorld.transformPoint(localIntersection);
+	return true;
 }
 
 void StaticModelSurface::applyScale(const Vector3& scale, const StaticModelSurface& originalSurface)
@@ -199,6 +191,7 @@ void StaticModelSurface::applyScale(const Vector3& scale, const StaticModelSurfa
 	}
 
 	_localAABB = AABB();
+	_bvh.reset();
 
 	Matrix4 scaleMatrix = Matrix4::getScale(scale);
 	Matrix4 invTranspScale = Matrix4::getScale(Vector3(1/scale.x(), 1/scale.y(), 1/scale.z()));
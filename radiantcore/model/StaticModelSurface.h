@@ -4,6 +4,7 @@
 #include "ishaders.h"
 
 #include "math/AABB.h"
+#include "render/MeshBVH.h"
 
 /* FORWARD DECLS */
 class ModelSkin;
@@ -47,10 +48,16 @@ private:
 	// The AABB containing this surface, in local object space.
 	AABB _localAABB;
 
+	// Bounding volume hierarchy used for intersection and selection tests,
+	// built on first use, cleared when the vertices are changing
+	mutable std::unique_ptr<render::MeshBVH> _bvh;
+
 private:
 	// Calculate tangent and bitangent vectors for all vertices.
 	void calculateTangents();
 
+	const render::MeshBVH& getBVH() const;
+
 public:
     // Move-construct this static model surface from the given vertex- and index array
 	StaticModelSurface(std::vector<MeshVertex>&& vertices, std::vector<unsigned int>&& indices);
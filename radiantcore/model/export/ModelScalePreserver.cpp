@@ -3,6 +3,7 @@
 #include "scene/EntityNode.h"
 #include "itransformable.h"
 #include "imapresource.h"
+#include "imodelcache.h"
 #include "itextstream.h"
 #include "string/convert.h"
 
@@ -85,9 +86,11 @@ void ModelScalePreserver::onResourceExported(const scene::IMapRootNodePtr& root)
 	});
 }
 
-void ModelScalePreserver::restoreModelScale(const scene::IMapRootNodePtr& root)
+std::size_t ModelScalePreserver::restoreModelScale(const scene::IMapRootNodePtr& root)
 {
-	root->foreachNode([this](const scene::INodePtr& node)
+	std::size_t numPendingEntities = 0;
+
+	root->foreachNode([&](const scene::INodePtr& node)
 	{
 		if (Node_isEntity(node))
 		{
@@ -99,6 +102,8 @@ void ModelScalePreserver::restoreModelScale(const scene::IMapRootNodePtr& root)
 			if (!savedScale.empty())
 			{
 				Vector3 scale = string::convert<Vector3>(savedScale);
+				bool restored = false;
+				bool loading = false;
 
 				// Find any model nodes below that one
 				node->foreachNode([&](const scene::INodePtr& child)
@@ -113,18 +118,35 @@ void ModelScalePreserver::restoreModelScale(const scene::IMapRootNodePtr& root)
 						transformable->setType(TRANSFORM_PRIMITIVE);
 						transformable->setScale(scale);
 						transformable->freezeTransform();
+
+						restored = true;
+					}
+					else if (model && GlobalModelCache().isLoadingInBackground(model->getIModel().getModelPath()))
+					{
+						// This is the placeholder of a model loaded in the background
+						loading = true;
 					}
 
 					return true;
 				});
 
-				// Clear the spawnarg now that we've applied it
-				entity->setKeyValue(_modelScaleKey, "");
+				// The placeholder can't be scaled, keep the spawnarg until the model is there
+				if (!restored && loading)
+				{
+					++numPendingEntities;
+				}
+				else
+				{
+					// Clear the spawnarg now that we've applied it (or the model is missing)
+					entity->setKeyValue(_modelScaleKey, "");
+				}
 			}
 		}
 
 		return true;
 	});
+
+	return numPendingEntities;
 }
 
 void ModelScalePreserver::onMapEvent(IMap::MapEvent ev)
@@ -132,7 +154,27 @@ void ModelScalePreserver::onMapEvent(IMap::MapEvent ev)
 	if (ev == IMap::MapLoaded)
 	{
 		// After loading, restore the scale if it gets recovered
-		restoreModelScale(GlobalMapModule().getRoot());
+		if (restoreModelScale(GlobalMapModule().getRoot()) > 0)
+		{
+			// Try again when the models arrive. The model keys replacing their
+			// placeholders have connected before, they are notified first.
+			_modelsLoadedConn.disconnect();
+			_modelsLoadedConn = GlobalModelCache().signal_modelsLoaded().connect(
+				sigc::mem_fun(this, &ModelScalePreserver::onModelsLoaded)
+			);
+		}
+	}
+	else if (ev == IMap::MapUnloading)
+	{
+		_modelsLoadedConn.disconnect();
+	}
+}
+
+void ModelScalePreserver::onModelsLoaded(const std::set<std::string>& modelPaths)
+{
+	if (restoreModelScale(GlobalMapModule().getRoot()) == 0)
+	{
+		_modelsLoadedConn.disconnect();
 	}
 }
 
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <set>
 #include <string>
 #include <functional>
 #include <sigc++/trackable.h>
+#include <sigc++/connection.h>
 
 #include "imodel.h"
 #include "imap.h"
@@ -30,6 +32,9 @@ class ModelScalePreserver :
 private:
     const std::string _modelScaleKey;
 
+    // Connected while models are loading whose scale is still to be restored
+    sigc::connection _modelsLoadedConn;
+
 public:
     ModelScalePreserver();
 
@@ -44,9 +49,11 @@ private:
     void onResourceExporting(const scene::IMapRootNodePtr& root);
     void onResourceExported(const scene::IMapRootNodePtr& root);
 
-    void restoreModelScale(const scene::IMapRootNodePtr& root);
+    // Returns the number of scaled entities whose model is still loading in the background
+    std::size_t restoreModelScale(const scene::IMapRootNodePtr& root);
 
     void onMapEvent(IMap::MapEvent ev);
+    void onModelsLoaded(const std::set<std::string>& modelPaths);
 };
 
 }
@@ -29,6 +29,7 @@ MD5Surface::MD5Surface(const MD5Surface& other) :
 void MD5Surface::updateGeometry()
 {
 	_aabb_local = AABB();
+	_bvh.reset();
 
 	for (const auto& vertex : _vertices)
 	{
@@ -53,6 +54,16 @@ void MD5Surface::updateGeometry()
 	}
 }
 
+const render::MeshBVH& MD5Surface::getBVH()
+{
+	if (!_bvh)
+	{
+		_bvh = std::make_unique<render::MeshBVH>(_vertices, _indices);
+	}
+
+	return *_bvh;
+}
+
 void MD5Surface::testSelect(Selector& selector,
 							SelectionTest& test,
 							const Matrix4& localToWorld)
@@ -60,11 +71,17 @@ void MD5Surface::testSelect(Selector& selector,
 	test.BeginMesh(localToWorld);
 
 	SelectionIntersection best;
-	test.TestTriangles(
-	  vertexpointer_Meshvertex(_vertices.data()),
-	  IndexPointer(_indices.data(), IndexPointer::index_type(_indices.size())),
-	  best
-	);
+
+	// Skip the triangles in parts of the hierarchy outside the selection volume (in model space)
+	auto localFrustum = Frustum::createFromViewproj(
+		test.getVolume().GetViewProjection().getMultipliedBy(localToWorld));
+
+	auto vertices = vertexpointer_Meshvertex(_vertices.data());
+
+	getBVH().foreachTriangleRangeInFrustum(localFrustum, [&](const unsigned int* indices, std::size_t numIndices)
+	{
+		test.TestTriangles(vertices, IndexPointer(indices, numIndices), best);
+	});
 
 	if(best.isValid()) {
 		selector.addIntersection(best);
@@ -73,43 +90,19 @@ void MD5Surface::testSelect(Selector& selector,
 
 bool MD5Surface::getIntersection(const Ray& ray, Vector3& intersection, const Matrix4& localToWorld)
 {
-	Vector3 bestIntersection = ray.origin;
-	Vector3 triIntersection;
-
-	for (Indices::const_iterator i = _indices.begin();
-		 i != _indices.end();
-		 i += 3)
-	{
-		// Get the vertices for this triangle
-		const auto& p1 = _vertices[*(i)];
-		const auto& p2 = _vertices[*(i+1)];
-		const auto& p3 = _vertices[*(i+2)];
+	// Intersect the ray in model space, this way the vertices don't need to be transformed
+	Ray localRay(ray);
+	localRay.transform(localToWorld.getFullInverse());
 
-		if (ray.intersectTriangle(localToWorld.transformPoint(p1.vertex),
-			localToWorld.transformPoint(p2.vertex), localToWorld.transformPoint(p3.vertex), triIntersection))
-		{
-			intersection = triIntersection;
-
-			// Test if this surface intersection is better than what we currently have
-            auto oldDistSquared = (bestIntersection - ray.origin).getLengthSquared();
-            auto newDistSquared = (triIntersection - ray.origin).getLengthSquared();
+	Vector3 localIntersection;
 
-			if ((oldDistSquared == 0 && newDistSquared > 0) || newDistSquared < oldDistSquared)
-			{
-				bestIntersection = triIntersection;
-			}
-		}
-	}
-
-	if ((bestIntersection - ray.origin).getLengthSquared() > 0)
-	{
-		intersection = bestIntersection;
-		return true;
-	}
-	else
+	if (!getBVH().getIntersection(_vertices, localRay, localIntersection))
 	{
 		return false;
 	}
+
+	intersection = localToWorld.transformPoint(localIntersection);
+	return true;
 }
 
 void MD5Surface::setDefaultMaterial(const std::string& name)
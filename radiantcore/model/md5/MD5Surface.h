@@ -4,6 +4,7 @@
 #include "render.h"
 #include "math/AABB.h"
 #include "math/Frustum.h"
+#include "render/MeshBVH.h"
 #include "iselectiontest.h"
 #include "modelskin.h"
 #include "imodelsurface.h"
@@ -42,6 +43,10 @@ private:
 	Vertices _vertices;
 	Indices _indices;
 
+	// Bounding volume hierarchy used for intersection and selection tests,
+	// built on first use, cleared whenever the geometry is updated
+	std::unique_ptr<render::MeshBVH> _bvh;
+
 public:
 
 	MD5Surface();
@@ -97,6 +102,8 @@ public:
 private:
     // Re-calculate the normal vectors
     void buildVertexNormals();
+
+	const render::MeshBVH& getBVH();
 };
 typedef std::shared_ptr<MD5Surface> MD5SurfacePtr;
 
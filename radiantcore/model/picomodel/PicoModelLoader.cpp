@@ -9,6 +9,7 @@
 #include "gamelib.h"
 
 #include "os/path.h"
+#include <mutex>
 
 #include "idatastream.h"
 #include "string/case_conv.h"
@@ -60,13 +61,22 @@ IModelPtr PicoModelLoader::loadModelFromPath(const std::string& path)
 	string::to_lower(fName);
 	std::string fExt = fName.substr(fName.size() - 3, 3);
 
-	picoModel_t* model = PicoModuleLoadModelStream(
-		_module,
-		&file->getInputStream(),
-		picoInputStreamReam,
-		file->size(),
-		0
-	);
+	picoModel_t* model = nullptr;
+
+	{
+		// The picomodel library keeps global state while parsing (e.g. in the LWO reader),
+		// models loaded on several threads need to take turns here
+		static std::mutex picoLock;
+		std::lock_guard<std::mutex> lock(picoLock);
+
+		model = PicoModuleLoadModelStream(
+			_module,
+			&file->getInputStream(),
+			picoInputStreamReam,
+			file->size(),
+			0
+		);
+	}
 
 	// greebo: Check if the model load was successful
 	if (!model || model->numSurfaces == 0)
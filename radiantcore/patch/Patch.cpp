@@ -391,6 +391,32 @@ void Patch::importState(const IUndoMementoPtr& state)
 {
     undoSave();
 
+    if (auto delta = std::dynamic_pointer_cast<ControlPointDelta>(state); delta)
+    {
+        if (delta->_isTranslation)
+        {
+            // Same expression as in getStateDelta(), yielding the exact vertices
+            for (auto& ctrl : _ctrl)
+            {
+                ctrl.vertex = ctrl.vertex - delta->_translation;
+            }
+        }
+        else
+        {
+            for (const auto& [index, ctrl] : delta->_changedControls)
+            {
+                _ctrl[index] = ctrl;
+            }
+        }
+
+        _ctrlTransformed = _ctrl;
+        _node.updateSelectableControls();
+
+        textureChanged();
+        controlPointsChanged();
+        return;
+    }
+
     const SavedState& other = *(std::static_pointer_cast<SavedState>(state));
 
     // begin duplicate of SavedState copy constructor, needs refactoring
@@ -414,6 +440,70 @@ void Patch::importState(const IUndoMementoPtr& state)
     controlPointsChanged();
 }
 
+IUndoMementoPtr Patch::getStateDelta(const IUndoMementoPtr& state) const
+{
+    const auto& saved = static_cast<const SavedState&>(*state);
+
+    // Keep the full state if anything but the control points changed
+    if (saved.m_width != _width || saved.m_height != _height || saved.m_patchDef3 != _patchDef3 ||
+        saved.m_subdivisions_x != _subDivisions.x() || saved.m_subdivisions_y != _subDivisions.y() ||
+        saved._materialName != _shader.getMaterialName() || saved.m_ctrl.size() != _ctrl.size())
+    {
+        return state;
+    }
+
+    if (_ctrl.empty())
+    {
+        return IUndoMementoPtr();
+    }
+
+    // Moving a patch is the most common operation, check for a plain translation first
+    Vector3 translation = _ctrl.front().vertex - saved.m_ctrl.front().vertex;
+    bool isTranslation = true;
+
+    for (std::size_t i = 0; i < _ctrl.size(); ++i)
+    {
+        if (_ctrl[i].texcoord != saved.m_ctrl[i].texcoord ||
+            _ctrl[i].vertex - translation != saved.m_ctrl[i].vertex)
+        {
+            isTranslation = false;
+            break;
+        }
+    }
+
+    if (isTranslation)
+    {
+        return translation == Vector3(0, 0, 0) ? IUndoMementoPtr() :
+            std::make_shared<ControlPointDelta>(translation);
+    }
+
+    ControlPointDelta::ChangedControls changedControls;
+
+    for (std::size_t i = 0; i < _ctrl.size(); ++i)
+    {
+        if (_ctrl[i].vertex != saved.m_ctrl[i].vertex || _ctrl[i].texcoord != saved.m_ctrl[i].texcoord)
+        {
+            changedControls.emplace_back(i, saved.m_ctrl[i]);
+        }
+    }
+
+    if (changedControls.empty())
+    {
+        return IUndoMementoPtr();
+    }
+
+    // The indices add to the size, storing them only pays off for a few changed points
+    if (changedControls.size() * sizeof(ControlPointDelta::ChangedControls::value_type) >=
+        _ctrl.size() * sizeof(PatchControl))
+    {
+        return state;
+    }
+
+    changedControls.shrink_to_fit();
+
+    return std::make_shared<ControlPointDelta>(std::move(changedControls));
+}
+
 void Patch::check_shader()
 {
     if (!shader_valid(getShader().c_str()))
@@ -303,6 +303,9 @@ public:
 	// Revert the state of this patch to the one that has been saved in the UndoMemento
 	void importState(const IUndoMementoPtr& state) override;
 
+	// Reduce a saved state to the control points changed since, if possible
+	IUndoMementoPtr getStateDelta(const IUndoMementoPtr& state) const override;
+
 	/** greebo: Gets whether this patch is a patchDef3 (fixed tesselation)
 	 */
 	bool subdivisionsFixed() const override;
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <utility>
 #include "PatchControl.h"
+#include "string/intern.h"
 
 /* greebo: This is a structure that is allocated on the heap and contains all the state
  * information of a patch. This information is used by the UndoSystem to save the current
@@ -16,7 +18,7 @@ public:
 	bool m_patchDef3;
 	std::size_t m_subdivisions_x;
 	std::size_t m_subdivisions_y;
-    std::string _materialName;
+    const std::string& _materialName;
 
 	// Constructor
 	SavedState(
@@ -34,6 +36,41 @@ public:
 		m_patchDef3(patchDef3),
 		m_subdivisions_x(subdivisions_x),
 		m_subdivisions_y(subdivisions_y),
-        _materialName(materialName)
+        _materialName(string::intern(materialName))
     {}
+
+	std::size_t getMemoryUsage() const override
+	{
+		return sizeof(SavedState) + m_ctrl.capacity() * sizeof(PatchControl);
+	}
+};
+
+/* The control points changed by an undoable operation, for patches which kept
+ * their dimensions, settings and material. Either a translation applied to all
+ * vertices (with unchanged texture coordinates) or the list of changed points.
+ */
+class ControlPointDelta :
+	public IUndoMemento
+{
+public:
+	typedef std::vector<std::pair<std::size_t, PatchControl>> ChangedControls;
+
+	bool _isTranslation;
+	Vector3 _translation;
+	ChangedControls _changedControls;
+
+	ControlPointDelta(const Vector3& translation) :
+		_isTranslation(true),
+		_translation(translation)
+	{}
+
+	ControlPointDelta(ChangedControls&& changedControls) :
+		_isTranslation(false),
+		_changedControls(std::move(changedControls))
+	{}
+
+	std::size_t getMemoryUsage() const override
+	{
+		return sizeof(ControlPointDelta) + _changedControls.capacity() * sizeof(ChangedControls::value_type);
+	}
 };
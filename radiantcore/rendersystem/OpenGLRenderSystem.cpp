@@ -7,6 +7,7 @@
 #include "iradiant.h"
 #include "icolourscheme.h"
 #include "ideclmanager.h"
+#include "iscenegraph.h"
 
 #include "math/Matrix4.h"
 #include "module/StaticModule.h"
@@ -23,6 +24,15 @@
 namespace render
 {
 
+namespace
+{
+    // Let the CPU write the next frame while the GPU is still busy with the previous one
+    constexpr std::size_t NumGeometryFrameBuffers = GeometryStore::DefaultNumFrameBuffers;
+
+    // Time spent per frame uploading textures decoded in the background
+    constexpr std::chrono::milliseconds TEXTURE_UPLOAD_BUDGET(8);
+}
+
 /**
  * Main constructor.
  */
@@ -32,7 +42,8 @@ OpenGLRenderSystem::OpenGLRenderSystem() :
     _glProgramFactory(std::make_shared<GLProgramFactory>()),
     _currentShaderProgram(SHADER_PROGRAM_NONE),
     _time(0),
-    _geometryStore(_syncObjectProvider, _bufferObjectProvider),
+    _bufferObjectProvider(NumGeometryFrameBuffers > 1), // mapped buffers need the fences of multiple frames
+    _geometryStore(_syncObjectProvider, _bufferObjectProvider, NumGeometryFrameBuffers),
     _objectRenderer(_geometryStore),
     m_traverseRenderablesMutex(false)
 {
@@ -187,6 +198,14 @@ void OpenGLRenderSystem::startFrame()
 {
     // Prepare the storage objects
     _geometryStore.onFrameStart();
+
+    // Fill in the textures which finished decoding in the background. The budget
+    // might have left some of them waiting, draw another frame to pick them up.
+    // Images finishing later on are announced by the material manager.
+    if (GlobalMaterialManager().uploadPendingTextures(TEXTURE_UPLOAD_BUDGET))
+    {
+        SceneChangeNotify();
+    }
 }
 
 void OpenGLRenderSystem::endFrame()
@@ -406,6 +425,8 @@ void OpenGLRenderSystem::initialiseModule(const IApplicationContext& ctx)
 
     GlobalCommandSystem().addCommand("ShowRenderMemoryStats",
         sigc::mem_fun(*this, &OpenGLRenderSystem::showMemoryStats));
+    GlobalCommandSystem().addCommand("CompactRenderMemory",
+        sigc::mem_fun(*this, &OpenGLRenderSystem::compactMemory));
 }
 
 void OpenGLRenderSystem::shutdownModule()
@@ -485,6 +506,12 @@ void OpenGLRenderSystem::showMemoryStats(const cmd::ArgumentList& args)
     _geometryStore.printMemoryStats();
 }
 
+void OpenGLRenderSystem::compactMemory(const cmd::ArgumentList& args)
+{
+    _geometryStore.compact();
+    _geometryStore.printMemoryStats();
+}
+
 // Define the static OpenGLRenderSystem module
 module::StaticModuleRegistration<OpenGLRenderSystem> openGLRenderSystemModule;
 
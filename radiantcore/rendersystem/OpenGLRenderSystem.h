@@ -145,6 +145,7 @@ private:
     ShaderPtr capture(const std::string& name, const std::function<OpenGLShaderPtr()>& createShader);
 
     void showMemoryStats(const cmd::ArgumentList& args);
+    void compactMemory(const cmd::ArgumentList& args);
 };
 
 } // namespace
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdexcept>
+#include <cstring>
 #include "igl.h"
 #include "igeometrystore.h"
 
@@ -20,12 +21,22 @@ private:
         GLenum _target;
         std::size_t _allocatedSize;
 
+        // Whether the storage may be mapped persistently, decided on first allocation
+        bool _allowPersistentMapping;
+        bool _persistentMapping;
+
+        // The client-side address of the persistently mapped storage
+        unsigned char* _mappedData;
+
     public:
-        BufferObject(IBufferObject::Type type) :
+        BufferObject(IBufferObject::Type type, bool allowPersistentMapping) :
             _type(type),
             _buffer(0),
             _target(_type == Type::Vertex ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER),
-            _allocatedSize(0)
+            _allocatedSize(0),
+            _allowPersistentMapping(allowPersistentMapping),
+            _persistentMapping(false),
+            _mappedData(nullptr)
         {}
 
         ~BufferObject() override
@@ -37,6 +48,7 @@ private:
 
             _allocatedSize = 0;
             _buffer = 0;
+            _mappedData = nullptr;
         }
 
         void bind() override
@@ -56,6 +68,13 @@ private:
                 throw std::runtime_error("Buffer is too small, resize first");
             }
 
+            if (_mappedData != nullptr)
+            {
+                // The mapping is coherent, no need to flush anything
+                std::memcpy(_mappedData + offset, firstElement, numBytes);
+                return;
+            }
+
             glBufferSubData(_target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(numBytes), firstElement);
             debug::assertNoGlErrors();
         }
@@ -74,6 +93,18 @@ private:
         // from the old internal buffer to the new one.
         void resize(std::size_t newSize) override
         {
+            if (_buffer == 0)
+            {
+                // Immutable buffer storage is available in GL 4.4 or through the extension
+                _persistentMapping = _allowPersistentMapping && GLEW_ARB_buffer_storage;
+            }
+
+            if (_persistentMapping)
+            {
+                resizePersistentStorage(newSize);
+                return;
+            }
+
             if (_buffer == 0)
             {
                 glGenBuffers(1, &_buffer);
@@ -96,12 +127,57 @@ private:
 
             glBindBuffer(_target, 0);
         }
+
+    private:
+        void resizePersistentStorage(std::size_t newSize)
+        {
+            // Immutable storage cannot be resized, replace the whole buffer
+            if (_buffer != 0)
+            {
+                glDeleteBuffers(1, &_buffer); // implicitly unmaps the storage
+                _buffer = 0;
+                _mappedData = nullptr;
+                _allocatedSize = 0;
+            }
+
+            glGenBuffers(1, &_buffer);
+            debug::assertNoGlErrors();
+
+            if (newSize == 0) return;
+
+            constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            glBindBuffer(_target, _buffer);
+            glBufferStorage(_target, static_cast<GLsizeiptr>(newSize), nullptr, flags);
+            debug::assertNoGlErrors();
+
+            _mappedData = static_cast<unsigned char*>(glMapBufferRange(_target, 0, static_cast<GLsizeiptr>(newSize), flags));
+            debug::assertNoGlErrors();
+
+            glBindBuffer(_target, 0);
+
+            if (_mappedData == nullptr)
+            {
+                throw std::runtime_error("Failed to map the GL buffer object");
+            }
+
+            _allocatedSize = newSize;
+        }
     };
 
+    bool _allowPersistentMapping;
+
 public:
+    // Persistently mapped buffers are written to directly, without any implicit
+    // synchronisation. Only allow them if the client is using multiple buffers
+    // and takes care of waiting for the GPU before overwriting them.
+    BufferObjectProvider(bool allowPersistentMapping = false) :
+        _allowPersistentMapping(allowPersistentMapping)
+    {}
+
     IBufferObject::Ptr createBufferObject(IBufferObject::Type type) override
     {
-        return std::make_shared<BufferObject>(type);
+        return std::make_shared<BufferObject>(type, _allowPersistentMapping);
     }
 };
 
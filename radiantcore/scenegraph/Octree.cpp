@@ -2,8 +2,6 @@
 
 #include "inode.h"
 
-#include "OctreeNode.h"
-
 namespace scene
 {
 
@@ -15,40 +13,44 @@ namespace
 	const AABB START_AABB(Vector3(0,0,0), Vector3(START_SIZE, START_SIZE, START_SIZE));
 }
 
-Octree::Octree()
+const ISPNode* OctreeNode::getParent() const
 {
-	_root = OctreeNodePtr(new OctreeNode(*this, START_AABB));
+	return _parent != NO_INDEX ? &_owner->getNode(_parent) : nullptr;
 }
 
-Octree::~Octree()
+const ISPNode& OctreeNode::getChildNode(std::size_t index) const
+{
+	assert(index <= 7);
+	assert(!isLeaf());
+
+	return _owner->getNode(_firstChild + static_cast<std::uint32_t>(index));
+}
+
+Octree::Octree()
 {
-	_nodeMapping.clear();
-	_root = OctreeNodePtr();
+	_root = allocateNode(START_AABB, OctreeNode::NO_INDEX);
 }
 
 void Octree::link(const scene::INodePtr& sceneNode)
 {
 	// Make sure we don't do double-links
-	assert(_nodeMapping.find(sceneNode) == _nodeMapping.end());
+	assert(_nodeMapping.find(sceneNode.get()) == nullptr);
 
 	// Make sure the root node is large enough
-	ensureRootSize(sceneNode);
+	ensureRootSize(sceneNode->worldAABB());
 
 	// Root node size is adjusted, let's link the node into the smallest encompassing octant
-	_root->linkRecursively(sceneNode);
+	linkRecursively(_root, sceneNode);
 }
 
-void Octree::ensureRootSize(const scene::INodePtr& sceneNode)
+void Octree::ensureRootSize(const AABB& aabb)
 {
-	// Check if sceneNode exceeds the root node's bounds
-	const AABB& aabb = sceneNode->worldAABB();
-
 	if (!aabb.isValid()) return; // skip this for invalid bounds
 
-	while (!_root->getBounds().contains(aabb))
+	while (!_nodes[_root].getBounds().contains(aabb))
 	{
 		// The bounding box of this node exceed the root node's bounds, we need to extend the tree bounds
-		AABB newBounds = _root->getBounds();
+		AABB newBounds = _nodes[_root].getBounds();
 		newBounds.extents *= 2;
 
 		// Don't go beyond the map limits
@@ -58,42 +60,44 @@ void Octree::ensureRootSize(const scene::INodePtr& sceneNode)
 		}
 
 		// Allocate a new root node and subdivide it once
-		OctreeNodePtr newRootPtr(new OctreeNode(*this, newBounds));
-
-		OctreeNode& newRoot = *newRootPtr;
-		OctreeNode& oldRoot = *_root;
+		auto newRoot = allocateNode(newBounds, OctreeNode::NO_INDEX);
+		auto oldRoot = _root;
 
 		// Re-link the members of the old root node
 		// Note: this might be inaccurate, as some members of the old root could be
 		// re-linked to some children of the new root. But we don't want to call
 		// link again, as this can lead to re-entering of the evaluateBounds() function
 		// in scene::Node in some cases.
-		oldRoot.relocateMembersTo(newRoot);
+		relocateMembers(oldRoot, newRoot);
 
 		// Now, subdivide the new root node, after we moved the members
-		newRoot.subdivide();
+		subdivide(newRoot);
 
 		// Check if the old root had children
-		if (!oldRoot.isLeaf())
+		if (!_nodes[oldRoot].isLeaf())
 		{
 			// Move the children of the old root into the new root
 			// Each octant of the old root will be added to one child of the new root
-			for (std::size_t i = 0; i < 8; ++i)
+			for (std::uint32_t i = 0; i < 8; ++i)
 			{
+				auto newChild = _nodes[newRoot]._firstChild + i;
+
 				// Subdivide each of the new children
-				newRoot[i].subdivide();
+				subdivide(newChild);
 
 				// Find out which of the new subdivisions is matching the children of the old root
-				for (std::size_t j = 0; j < 8; ++j)
+				for (std::uint32_t j = 0; j < 8; ++j)
 				{
-					for (std::size_t old = 0; old < 8; ++old)
+					auto newNode = _nodes[newChild]._firstChild + j;
+
+					for (std::uint32_t old = 0; old < 8; ++old)
 					{
-						OctreeNode& newNode = newRoot[i][j];
+						auto oldNode = _nodes[oldRoot]._firstChild + old;
 
-						if (newNode.getBounds() == oldRoot[old].getBounds())
+						if (_nodes[newNode].getBounds() == _nodes[oldNode].getBounds())
 						{
-							oldRoot[old].relocateMembersTo(newNode);
-							oldRoot[old].relocateChildrenTo(newNode);
+							relocateMembers(oldNode, newNode);
+							relocateChildren(oldNode, newNode);
 							break;
 						}
 					}
@@ -101,58 +105,268 @@ void Octree::ensureRootSize(const scene::INodePtr& sceneNode)
 			}
 		}
 
-		_root = newRootPtr;
+		_root = newRoot;
 	}
 }
 
-// Unlink this node from the SP tree
-bool Octree::unlink(const scene::INodePtr& sceneNode)
+std::uint32_t Octree::allocateNode(const AABB& bounds, std::uint32_t parent)
+{
+	auto index = static_cast<std::uint32_t>(_nodes.size());
+	_nodes.emplace_back(*this, bounds, parent);
+
+	return index;
+}
+
+void Octree::subdivide(std::uint32_t nodeIndex)
+{
+	assert(_nodes[nodeIndex].isLeaf());
+
+	// Each child node has half the extents of this node
+	AABB bounds = _nodes[nodeIndex].getBounds();
+	Vector3 childExtents = bounds.extents * 0.5;
+
+	// Construct delta-vectors, pointing in each room direction
+	Vector3 x(childExtents.x(), 0, 0);
+	Vector3 y(0, childExtents.y(), 0);
+	Vector3 z(0, 0, childExtents.z());
+
+	Vector3 baseUpper = bounds.origin + z;
+	Vector3 baseLower = bounds.origin - z;
+
+	// The 8 children are allocated in consecutive slots
+	auto firstChild = static_cast<std::uint32_t>(_nodes.size());
+	_nodes.reserve(_nodes.size() + 8);
+
+	// Upper half of the cube
+	allocateNode(AABB(baseUpper + x + y, childExtents), nodeIndex);
+	allocateNode(AABB(baseUpper + x - y, childExtents), nodeIndex);
+	allocateNode(AABB(baseUpper - x - y, childExtents), nodeIndex);
+	allocateNode(AABB(baseUpper - x + y, childExtents), nodeIndex);
+
+	// Lower half of the cube
+	allocateNode(AABB(baseLower + x + y, childExtents), nodeIndex);
+	allocateNode(AABB(baseLower + x - y, childExtents), nodeIndex);
+	allocateNode(AABB(baseLower - x - y, childExtents), nodeIndex);
+	allocateNode(AABB(baseLower - x + y, childExtents), nodeIndex);
+
+	_nodes[nodeIndex]._firstChild = firstChild;
+}
+
+std::uint32_t Octree::findContainingChild(std::uint32_t nodeIndex, const AABB& bounds) const
 {
-	NodeMapping::iterator found = _nodeMapping.find(sceneNode);
+	auto firstChild = _nodes[nodeIndex]._firstChild;
 
-	if (found != _nodeMapping.end())
+	if (firstChild == OctreeNode::NO_INDEX) return OctreeNode::NO_INDEX;
+
+	for (std::uint32_t i = firstChild; i < firstChild + 8; ++i)
 	{
-		// Lookup successful, unlink the node (will fire notifyUnlink())
-		found->second->unlink(sceneNode);
-		return true;
+		if (_nodes[i].getBounds().contains(bounds))
+		{
+			return i;
+		}
 	}
 
-	return false;
+	return OctreeNode::NO_INDEX;
 }
 
-// Returns the root node of this SP tree
-ISPNodePtr Octree::getRoot() const
+void Octree::linkRecursively(std::uint32_t nodeIndex, const scene::INodePtr& sceneNode)
+{
+	// Take a copy, evaluating the bounds of other nodes can lead to re-entrant calls
+	AABB bounds = sceneNode->worldAABB();
+
+	// If the AABB is not valid, just link it here
+	if (!bounds.isValid())
+	{
+		addMember(nodeIndex, sceneNode);
+		return;
+	}
+
+	// Descend as long as the object fits into one of the children
+	for (auto child = findContainingChild(nodeIndex, bounds); child != OctreeNode::NO_INDEX;
+		 child = findContainingChild(nodeIndex, bounds))
+	{
+		nodeIndex = child;
+	}
+
+	// Node didn't fit into any of the children, link it here
+	addMember(nodeIndex, sceneNode);
+
+	const auto& node = _nodes[nodeIndex];
+
+	// If this is a leaf, check if we exceeded the subdivision threshold and are large enough
+	if (node.isLeaf() &&
+		node._members.size() >= SUBDIVISION_THRESHOLD &&
+		node.getBounds().extents.x() > MIN_NODE_EXTENTS)
+	{
+		// This leaf has enough members to justify a further subdivision, create 8 child nodes
+		subdivide(nodeIndex);
+
+		// To avoid concurrent nodeBoundsChanged() calls during this operation, evaluate all
+		// child bounds before trying to re-distribute them over the new childnodes.
+		// Do this in a copy of the members list, the re-entrant calls might modify it,
+		// and the node pool might be reallocated too, so don't hold any references.
+		{
+			ISPNode::MemberList temp = _nodes[nodeIndex]._members;
+
+			for (const auto& member : temp)
+			{
+				member->worldAABB();
+			}
+		}
+
+		// At this point, all child bounds are calculated, some children might have re-located
+		// themselves to a different node already, so it's possible that the number of members is
+		// below SUBDIVISION_THRESHOLD now. We cannot rely on this, so let's continue anyway.
+
+		// We cannot use the original _members vector in the loop below (iterator invalidation)...
+		ISPNode::MemberList oldList;
+
+		// ... so move the list into a temporary
+		oldList.swap(_nodes[nodeIndex]._members);
+
+		// Cycle through all the members and distribute them over the children
+		for (const auto& member : oldList)
+		{
+			_nodeMapping.erase(member.get());
+
+			// Call ourselves. The fact that we have 8 children now ensures that we won't be
+			// going down the same code path here again
+			linkRecursively(nodeIndex, member);
+		}
+	}
+}
+
+void Octree::addMember(std::uint32_t nodeIndex, const scene::INodePtr& sceneNode)
 {
-	return _root;
+	auto& members = _nodes[nodeIndex]._members;
+
+	_nodeMapping.insert(sceneNode.get(), { nodeIndex, static_cast<std::uint32_t>(members.size()) });
+	members.push_back(sceneNode);
 }
 
-void Octree::notifyLink(const scene::INodePtr& sceneNode, OctreeNode* node)
+void Octree::removeMember(std::uint32_t nodeIndex, std::uint32_t memberIndex)
 {
-	std::pair<NodeMapping::iterator, bool> result =
-		_nodeMapping.insert(NodeMapping::value_type(sceneNode, node));
+	auto& members = _nodes[nodeIndex]._members;
+
+	assert(memberIndex < members.size());
+
+	// Fill the gap with the last member and update its location
+	if (memberIndex + 1 < members.size())
+	{
+		members[memberIndex] = std::move(members.back());
+
+		auto location = _nodeMapping.find(members[memberIndex].get());
+		assert(location != nullptr);
+
+		location->memberIndex = memberIndex;
+	}
+
+	members.pop_back();
+}
+
+void Octree::relocateMembers(std::uint32_t source, std::uint32_t target)
+{
+	auto& sourceMembers = _nodes[source]._members;
+	auto& targetMembers = _nodes[target]._members;
+
+	for (auto& member : sourceMembers)
+	{
+		auto location = _nodeMapping.find(member.get());
+		assert(location != nullptr);
+
+		location->octreeNode = target;
+		location->memberIndex = static_cast<std::uint32_t>(targetMembers.size());
+
+		targetMembers.emplace_back(std::move(member));
+	}
+
+	sourceMembers.clear();
+}
+
+void Octree::relocateChildren(std::uint32_t source, std::uint32_t target)
+{
+	assert(_nodes[source].isLeaf() || _nodes[target].isLeaf());
+
+	_nodes[target]._firstChild = _nodes[source]._firstChild;
+	_nodes[source]._firstChild = OctreeNode::NO_INDEX;
+
+	if (_nodes[target].isLeaf()) return;
 
-	assert(result.second);
+	// Tell each children who their parent is
+	for (std::uint32_t i = 0; i < 8; ++i)
+	{
+		_nodes[_nodes[target]._firstChild + i]._parent = target;
+	}
 }
 
-void Octree::notifyUnlink(const scene::INodePtr& sceneNode, OctreeNode* node)
+// Unlink this node from the SP tree
+bool Octree::unlink(const scene::INodePtr& sceneNode)
 {
-	// Remove the node from the lookup table, if found
-	NodeMapping::iterator found = _nodeMapping.find(sceneNode);
+	auto location = _nodeMapping.find(sceneNode.get());
+
+	if (location == nullptr)
+	{
+		return false;
+	}
 
-	assert(found != _nodeMapping.end());
+	// Lookup successful, unlink the node
+	auto [nodeIndex, memberIndex] = *location;
 
-	_nodeMapping.erase(found);
+	// Keep the scene node alive until the mapping is removed
+	auto node = sceneNode;
+
+	removeMember(nodeIndex, memberIndex);
+	_nodeMapping.erase(node.get());
+
+	return true;
 }
 
-#ifdef _DEBUG
-void Octree::notifyErase(OctreeNode* node)
+bool Octree::relink(const scene::INodePtr& sceneNode)
 {
-	// Remove the node from the lookup table, if found
-	for (NodeMapping::iterator i = _nodeMapping.begin(); i != _nodeMapping.end(); ++i)
+	// Evaluate the bounds before looking up the node, this might already
+	// re-enter this method for the very same scene node
+	AABB bounds = sceneNode->worldAABB();
+
+	auto location = _nodeMapping.find(sceneNode.get());
+
+	if (location == nullptr)
 	{
-		assert(i->second != node);
+		return false;
 	}
+
+	auto [nodeIndex, memberIndex] = *location;
+
+	if (bounds.isValid() && _nodes[nodeIndex].getBounds().contains(bounds))
+	{
+		// Still fits into its current octree node, nothing to do if it can't be
+		// pushed further down into one of the children, which is the common case
+		// for small movements
+		if (findContainingChild(nodeIndex, bounds) == OctreeNode::NO_INDEX)
+		{
+			return true;
+		}
+
+		// Descend from the current octree node, no need to start at the root
+		auto node = sceneNode;
+
+		removeMember(nodeIndex, memberIndex);
+		_nodeMapping.erase(node.get());
+
+		linkRecursively(nodeIndex, node);
+		return true;
+	}
+
+	// Doesn't fit anymore, do the full unlink/link cycle
+	unlink(sceneNode);
+	link(sceneNode);
+
+	return true;
+}
+
+// Returns the root node of this SP tree
+const ISPNode& Octree::getRoot() const
+{
+	return _nodes[_root];
 }
-#endif
 
 } // namespace scene
@@ -2,14 +2,13 @@
 #define _OCTREE_H_
 
 #include "ispacepartition.h"
-#include <map>
+#include <vector>
+#include "OctreeNode.h"
+#include "OctreeNodeMapping.h"
 
 namespace scene
 {
 
-class OctreeNode;
-typedef std::shared_ptr<OctreeNode> OctreeNodePtr;
-
 /**
  * greebo: An Octree is a simple way to subdivide the entire space
  * used by a collectivity of nodes in a scene. This is achieved by using cubic
@@ -33,53 +32,83 @@ typedef std::shared_ptr<OctreeNode> OctreeNodePtr;
  * one OctreeNode, the scene::INode remains in the one parent node able to do so.
  * In the "worst" case this is the root node itself.
  *
- * The Octree maintains a lookup table (NodeMapping) to implement a fast unlink()
- * algorithm. The scene::INodes don't know or care where they are linked to, so
- * it needs a fast lookup to avoid having to traverse the entire tree to find and
+ * All OctreeNodes live in a single pool, referring to each other by index.
+ * The Octree maintains a hash table (OctreeNodeMapping) pointing to the octree node
+ * and member slot of every linked scene::INode, to implement fast unlink() and
+ * relink() algorithms. The scene::INodes don't know or care where they are linked to,
+ * so it needs a fast lookup to avoid having to traverse the entire tree to find and
  * remove a single node.
  */
 class Octree :
 	public ISpacePartitionSystem
 {
 private:
-	// The root node of this SP
-	OctreeNodePtr _root;
+	// The node pool, the 8 children of a node are stored in consecutive slots.
+	// Nodes are never released, the pool is discarded with the whole Octree.
+	std::vector<OctreeNode> _nodes;
+
+	// Index of the root node in the pool
+	std::uint32_t _root;
 
 	// Maps scene nodes against octree nodes, for fast lookup during unlink
-	typedef std::map<INodePtr, OctreeNode*> NodeMapping;
-	NodeMapping _nodeMapping;
+	OctreeNodeMapping _nodeMapping;
 
 public:
 	Octree();
 
-	~Octree();
+	// The pooled nodes are referring back to this instance
+	Octree(const Octree& other) = delete;
+	Octree& operator=(const Octree& other) = delete;
 
 	// Links this node into the SP tree.
-	void link(const scene::INodePtr& sceneNode);
+	void link(const scene::INodePtr& sceneNode) override;
 
 	// Unlink this node from the SP tree, returns true if found
-	bool unlink(const scene::INodePtr& sceneNode);
+	bool unlink(const scene::INodePtr& sceneNode) override;
 
-	// Returns the root node of this SP tree
-	ISPNodePtr getRoot() const;
+	// Re-link this node after its bounds changed, keeping it in place if possible
+	bool relink(const scene::INodePtr& sceneNode) override;
 
-	// Callback used by the OctreeNodes to let the tree update its caching structures
-	void notifyLink(const scene::INodePtr& sceneNode, OctreeNode* node);
-	void notifyUnlink(const scene::INodePtr& sceneNode, OctreeNode* node);
+	// Returns the root node of this SP tree
+	const ISPNode& getRoot() const override;
 
-#ifdef _DEBUG
-	// In debug builds, this ensures that no octree node is deleted
-	// while it is still mapped in the NodeMapping table
-	void notifyErase(OctreeNode* node);
-#endif
+	// Access an octree node in the pool
+	const OctreeNode& getNode(std::uint32_t index) const
+	{
+		return _nodes[index];
+	}
 
 private:
 	/**
 	 * This is called whenever a node is linked into the octree
 	 * and ensures that the topmost octree node (the root node) is
-	 * large enough to encompass the scenenode's bounds.
+	 * large enough to encompass the given bounds.
 	 */
-	void ensureRootSize(const scene::INodePtr& sceneNode);
+	void ensureRootSize(const AABB& aabb);
+
+	std::uint32_t allocateNode(const AABB& bounds, std::uint32_t parent);
+
+	// Subdivide the given octree node (adding 8 child nodes)
+	void subdivide(std::uint32_t nodeIndex);
+
+	// Links the given scene object into the subtree starting at the given octree node
+	void linkRecursively(std::uint32_t nodeIndex, const scene::INodePtr& sceneNode);
+
+	void addMember(std::uint32_t nodeIndex, const scene::INodePtr& sceneNode);
+
+	// Removes the member at the given position from the octree node,
+	// the removed scene node's mapping is left untouched
+	void removeMember(std::uint32_t nodeIndex, std::uint32_t memberIndex);
+
+	// Moves all the members of the source node to the target node
+	void relocateMembers(std::uint32_t source, std::uint32_t target);
+
+	// Moves all the children of the source node to the target node
+	// If the source has children, the target node must be a leaf (this method won't override existing children)
+	void relocateChildren(std::uint32_t source, std::uint32_t target);
+
+	// Returns the index of the child node fully containing the given bounds, or NO_INDEX
+	std::uint32_t findContainingChild(std::uint32_t nodeIndex, const AABB& bounds) const;
 };
 
 } // namespace scene
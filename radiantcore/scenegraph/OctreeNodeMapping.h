@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <cassert>
+
+namespace scene
+{
+
+class INode;
+
+/**
+ * Hash table mapping scene nodes to their location in the Octree, used
+ * to find the octree node and member slot of a scene node in constant time.
+ *
+ * Uses open addressing with linear probing, the key is the scene node's
+ * address. Removed entries are back-filled by shifting the following
+ * entries of the probe sequence, so no tombstones are needed.
+ */
+class OctreeNodeMapping
+{
+public:
+	struct Location
+	{
+		// Index of the octree node in the node pool
+		std::uint32_t octreeNode;
+
+		// Position in the member list of the octree node
+		std::uint32_t memberIndex;
+	};
+
+private:
+	struct Slot
+	{
+		const INode* key = nullptr;
+		Location location;
+	};
+
+	// Always a power of two, or empty
+	std::vector<Slot> _slots;
+	std::size_t _size;
+
+public:
+	OctreeNodeMapping() :
+		_size(0)
+	{}
+
+	std::size_t size() const
+	{
+		return _size;
+	}
+
+	// Returns the location of the given node, or nullptr if the node is not mapped
+	Location* find(const INode* key)
+	{
+		if (_slots.empty()) return nullptr;
+
+		for (auto i = getHomeSlot(key); ; i = nextSlot(i))
+		{
+			if (_slots[i].key == key)
+			{
+				return &_slots[i].location;
+			}
+
+			if (_slots[i].key == nullptr)
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	// Adds a new mapping, the key must not be present yet
+	void insert(const INode* key, const Location& location)
+	{
+		assert(key != nullptr);
+		assert(find(key) == nullptr);
+
+		// Keep the load factor below 0.5 to have short probe sequences
+		if ((_size + 1) * 2 > _slots.size())
+		{
+			rehash(_slots.empty() ? 64 : _slots.size() * 2);
+		}
+
+		auto i = getHomeSlot(key);
+
+		while (_slots[i].key != nullptr)
+		{
+			i = nextSlot(i);
+		}
+
+		_slots[i].key = key;
+		_slots[i].location = location;
+		++_size;
+	}
+
+	// Removes the mapping of the given node, returns false if it was not present
+	bool erase(const INode* key)
+	{
+		if (_slots.empty()) return false;
+
+		auto i = getHomeSlot(key);
+
+		while (_slots[i].key != key)
+		{
+			if (_slots[i].key == nullptr) return false;
+			i = nextSlot(i);
+		}
+
+		// Close the gap by moving back any following entry whose
+		// home slot is not located between the gap and itself
+		for (auto j = nextSlot(i); _slots[j].key != nullptr; j = nextSlot(j))
+		{
+			auto home = getHomeSlot(_slots[j].key);
+
+			bool canMove = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+
+			if (canMove)
+			{
+				_slots[i] = _slots[j];
+				i = j;
+			}
+		}
+
+		_slots[i].key = nullptr;
+		--_size;
+
+		return true;
+	}
+
+	void clear()
+	{
+		_slots.clear();
+		_size = 0;
+	}
+
+private:
+	std::size_t getHomeSlot(const INode* key) const
+	{
+		// Fibonacci hashing of the address, the low bits are always zero due to alignment
+		auto hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key) >> 4);
+		return static_cast<std::size_t>((hash * 0x9E3779B97F4A7C15ull) >> 32) & (_slots.size() - 1);
+	}
+
+	std::size_t nextSlot(std::size_t i) const
+	{
+		return (i + 1) & (_slots.size() - 1);
+	}
+
+	void rehash(std::size_t newCapacity)
+	{
+		std::vector<Slot> oldSlots(newCapacity);
+		oldSlots.swap(_slots);
+		_size = 0;
+
+		for (const auto& slot : oldSlots)
+		{
+			if (slot.key != nullptr)
+			{
+				insert(slot.key, slot.location);
+			}
+		}
+	}
+};
+
+}
@@ -1,5 +1,11 @@
 #include "SceneGraph.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "ivolumetest.h"
 #include "itextstream.h"
 
@@ -15,11 +21,199 @@
 namespace scene
 {
 
+namespace
+{
+    // Subtrees starting at this depth of the SpacePartition are culled by separate tasks
+    constexpr std::size_t PARALLEL_CULLING_DEPTH = 2;
+
+    // Upper limit of threads used to cull a single volume (including the calling one)
+    constexpr std::size_t MAX_CULLING_THREADS = 8;
+
+    // With fewer visible subtrees than this, waking up the workers costs more than it saves
+    constexpr std::size_t MIN_SUBTREES_FOR_PARALLEL_CULLING = 4;
+
+    using VisibleMemberList = std::vector<const INodePtr*>;
+
+    // A contiguous part of the traversal order: either the members of a single
+    // SpacePartition node or all the visible members of a subtree
+    struct CullingSegment
+    {
+        const ISPNode* node;
+        bool isSubtree;
+        VisibleMemberList members;
+    };
+
+    void addVisibleMembers(const ISPNode& node, bool visitHidden, VisibleMemberList& list)
+    {
+        for (const auto& member : node.getMembers())
+        {
+            if (visitHidden || member->visible())
+            {
+                list.push_back(&member);
+            }
+        }
+    }
+
+    // Same descend as SceneGraph::foreachNodeInVolume_r, just collecting the members
+    void cullSubtree(const ISPNode& node, const VolumeTest& volume, bool visitHidden, VisibleMemberList& list)
+    {
+        addVisibleMembers(node, visitHidden, list);
+
+        for (std::size_t i = 0, numChildren = node.getNumChildNodes(); i < numChildren; ++i)
+        {
+            const ISPNode& child = node.getChildNode(i);
+
+            if (volume.TestAABB(child.getBounds()) != VOLUME_OUTSIDE)
+            {
+                cullSubtree(child, volume, visitHidden, list);
+            }
+        }
+    }
+
+    // Splits the upper levels of the tree into segments, in traversal order
+    void collectCullingSegments(const ISPNode& node, const VolumeTest& volume, bool visitHidden,
+        std::size_t depth, std::vector<CullingSegment>& segments)
+    {
+        if (depth == PARALLEL_CULLING_DEPTH && !node.isLeaf())
+        {
+            segments.push_back(CullingSegment{ &node, true, {} });
+            return;
+        }
+
+        // The members of the upper levels are few, collect them right away
+        segments.push_back(CullingSegment{ &node, false, {} });
+        addVisibleMembers(node, visitHidden, segments.back().members);
+
+        for (std::size_t i = 0, numChildren = node.getNumChildNodes(); i < numChildren; ++i)
+        {
+            const ISPNode& child = node.getChildNode(i);
+
+            if (volume.TestAABB(child.getBounds()) != VOLUME_OUTSIDE)
+            {
+                collectCullingSegments(child, volume, visitHidden, depth + 1, segments);
+            }
+        }
+    }
+}
+
+/**
+ * Threads kept alive for the lifetime of the scene graph, to avoid
+ * spawning new threads for each culling pass. run() is executing the
+ * given task on the calling thread plus the requested number of workers.
+ */
+class CullingWorkerPool
+{
+private:
+    std::vector<std::thread> _threads;
+
+    std::mutex _lock;
+    std::condition_variable _taskAvailable;
+    std::condition_variable _taskFinished;
+
+    const std::function<void()>* _task;
+
+    // Increased with every task, the workers are waiting for this to change
+    std::size_t _generation;
+
+    // The number of workers taking part in the current task, and how many of these are still busy
+    std::size_t _numActiveWorkers;
+    std::size_t _numBusyWorkers;
+
+    bool _shutdown;
+
+public:
+    CullingWorkerPool(std::size_t numThreads) :
+        _task(nullptr),
+        _generation(0),
+        _numActiveWorkers(0),
+        _numBusyWorkers(0),
+        _shutdown(false)
+    {
+        for (std::size_t i = 0; i < numThreads; ++i)
+        {
+            _threads.emplace_back([this, i]() { runWorker(i); });
+        }
+    }
+
+    ~CullingWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _shutdown = true;
+        }
+
+        _taskAvailable.notify_all();
+
+        for (auto& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::size_t getNumThreads() const
+    {
+        return _threads.size();
+    }
+
+    // Runs the task on the calling thread and the given number of workers, returns when all of them are done
+    void run(const std::function<void()>& task, std::size_t numWorkers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            _task = &task;
+            _numActiveWorkers = _numBusyWorkers = std::min(numWorkers, _threads.size());
+            ++_generation;
+        }
+
+        _taskAvailable.notify_all();
+
+        task();
+
+        std::unique_lock<std::mutex> lock(_lock);
+        _taskFinished.wait(lock, [this]() { return _numBusyWorkers == 0; });
+
+        _task = nullptr;
+    }
+
+private:
+    void runWorker(std::size_t index)
+    {
+        std::size_t lastGeneration = 0;
+        std::unique_lock<std::mutex> lock(_lock);
+
+        while (true)
+        {
+            _taskAvailable.wait(lock, [&]() { return _shutdown || _generation != lastGeneration; });
+
+            if (_shutdown) return;
+
+            lastGeneration = _generation;
+
+            // Not every task is using all the workers
+            if (index >= _numActiveWorkers) continue;
+
+            auto task = _task;
+
+            lock.unlock();
+            (*task)();
+            lock.lock();
+
+            if (--_numBusyWorkers == 0)
+            {
+                _taskFinished.notify_one();
+            }
+        }
+    }
+};
+
 SceneGraph::SceneGraph() :
 	_spacePartition(new Octree),
 	_visitedSPNodes(0),
 	_skippedSPNodes(0),
-    _traversalOngoing(false)
+    _traversalOngoing(false),
+    _boundsChangeBatchLevel(0),
+    _boundsChangedDuringBatch(false)
 {}
 
 SceneGraph::~SceneGraph()
@@ -131,6 +325,13 @@ void SceneGraph::onUndoEvent(IUndoSystem::EventType type, const std::string& ope
 
 void SceneGraph::boundsChanged()
 {
+    if (_boundsChangeBatchLevel > 0)
+    {
+        // Emit the signal once the batch is done
+        _boundsChangedDuringBatch = true;
+        return;
+    }
+
     _sigBoundsChanged();
 }
 
@@ -194,11 +395,49 @@ void SceneGraph::nodeBoundsChanged(const INodePtr& node)
         return;
     }
 
-	if (_spacePartition->unlink(node))
-	{
-		// unlink returned true, so the given node was linked before => re-link it
-		_spacePartition->link(node);
-	}
+    if (_boundsChangeBatchLevel > 0)
+    {
+        // Record every node only once, the re-link uses the bounds at the end of the batch
+        if (_nodesWithPendingBoundsChange.insert(node.get()).second)
+        {
+            _pendingBoundsChanges.push_back(node);
+        }
+        return;
+    }
+
+	// Nodes that haven't been linked before are ignored
+	_spacePartition->relink(node);
+}
+
+void SceneGraph::beginBoundsChangeBatch()
+{
+    ++_boundsChangeBatchLevel;
+}
+
+void SceneGraph::endBoundsChangeBatch()
+{
+    assert(_boundsChangeBatchLevel > 0);
+
+    if (--_boundsChangeBatchLevel > 0)
+    {
+        return; // not the outermost batch
+    }
+
+    // Move the collected nodes out, re-linking them might cause further bounds changes
+    std::vector<INodePtr> pendingBoundsChanges;
+    pendingBoundsChanges.swap(_pendingBoundsChanges);
+    _nodesWithPendingBoundsChange.clear();
+
+    for (const auto& node : pendingBoundsChanges)
+    {
+        nodeBoundsChanged(node);
+    }
+
+    if (_boundsChangedDuringBatch)
+    {
+        _boundsChangedDuringBatch = false;
+        _sigBoundsChanged();
+    }
 }
 
 void SceneGraph::foreachNode(const INode::VisitorFunc& functor)
@@ -240,26 +479,37 @@ void SceneGraph::foreachVisibleNodeInVolume(const VolumeTest& volume, const INod
 	foreachNodeInVolume(volume, functor, false); // don't visit hidden
 }
 
-void SceneGraph::foreachNodeInVolume(const VolumeTest& volume, const INode::VisitorFunc& functor, bool visitHidden)
+void SceneGraph::foreachNodeInVolume(const VolumeTest& volume, const INode::VisitorFunc& functor, bool visitHidden,
+                                     bool parallelCulling)
 {
     // Acquire the worldAABB() of the scenegraph root - if any node got changed in the graph
     // the scenegraph's root bounds are marked as "dirty" and the bounds will be re-calculated
     // which in turn might trigger a re-link in the Octree. We want to avoid that the Octree
     // changes during traversal so let's call this now. If nothing got changed, this call is very cheap.
-    if (_root != nullptr) _root->worldAABB();
+    // All the nodes changed since the last traversal are re-linked in one batch.
+    if (_root != nullptr)
+    {
+        ScopedBoundsChangeBatch batch(*this);
+        _root->worldAABB();
+    }
 
     {
         // Buffer any calls that might happen in between
         util::ScopedBoolLock traversal(_traversalOngoing);
 
-        // Descend the SpacePartition tree and call the walker for each (partially) visible member
-        ISPNodePtr root = _spacePartition->getRoot();
-
-        _visitedSPNodes = _skippedSPNodes = 0;
+        if (parallelCulling)
+        {
+            foreachNodeInVolumeParallel(volume, functor, visitHidden);
+        }
+        else
+        {
+            // Descend the SpacePartition tree and call the walker for each (partially) visible member
+            _visitedSPNodes = _skippedSPNodes = 0;
 
-        foreachNodeInVolume_r(*root, volume, functor, visitHidden);
+            foreachNodeInVolume_r(_spacePartition->getRoot(), volume, functor, visitHidden);
 
-        _visitedSPNodes = _skippedSPNodes = 0;
+            _visitedSPNodes = _skippedSPNodes = 0;
+        }
     }
 
     // Traversal finished, flush the action buffer
@@ -271,7 +521,8 @@ void SceneGraph::foreachNodeInVolume(const VolumeTest& volume, Walker& walker)
 	// Use a small adaptor lambda to dispatch calls to the walker
 	foreachNodeInVolume(volume,
 		[&] (const INodePtr& node) { return walker.visit(node); },
-		true); // visit hidden
+		true, // visit hidden
+		walker.supportsParallelCulling());
 }
 
 void SceneGraph::foreachVisibleNodeInVolume(const VolumeTest& volume, Walker& walker)
@@ -279,7 +530,8 @@ void SceneGraph::foreachVisibleNodeInVolume(const VolumeTest& volume, Walker& wa
 	// Use a small adaptor lambda to dispatch calls to the walker
 	foreachNodeInVolume(volume,
 		[&] (const INodePtr& node) { return walker.visit(node); },
-		false); // don't visit hidden
+		false, // don't visit hidden
+		walker.supportsParallelCulling());
 }
 
 bool SceneGraph::foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& volume,
@@ -308,11 +560,11 @@ bool SceneGraph::foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& vo
 	}
 
 	// Now consider the children
-	const ISPNode::NodeList& children = node.getChildNodes();
-
-	for (ISPNode::NodeList::const_iterator i = children.begin(); i != children.end(); ++i)
+	for (std::size_t i = 0, numChildren = node.getNumChildNodes(); i < numChildren; ++i)
 	{
-		if (volume.TestAABB((*i)->getBounds()) == VOLUME_OUTSIDE)
+		const ISPNode& child = node.getChildNode(i);
+
+		if (volume.TestAABB(child.getBounds()) == VOLUME_OUTSIDE)
 		{
 			// Skip this node, not visible
 			_skippedSPNodes++;
@@ -320,7 +572,7 @@ bool SceneGraph::foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& vo
 		}
 
 		// Traverse all the children too, enter recursion
-		if (!foreachNodeInVolume_r(**i, volume, functor, visitHidden))
+		if (!foreachNodeInVolume_r(child, volume, functor, visitHidden))
 		{
 			// The walker returned false somewhere in the recursion depths, propagate this message
 			return false;
@@ -330,6 +582,67 @@ bool SceneGraph::foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& vo
 	return true; // continue traversal
 }
 
+void SceneGraph::foreachNodeInVolumeParallel(const VolumeTest& volume, const INode::VisitorFunc& functor, bool visitHidden)
+{
+    // The SpacePartition is not modified while a traversal is ongoing (all changes are
+    // buffered), so it's safe to share it between threads and to refer to its members
+    std::vector<CullingSegment> segments;
+    collectCullingSegments(_spacePartition->getRoot(), volume, visitHidden, 0, segments);
+
+    std::vector<CullingSegment*> subtrees;
+
+    for (auto& segment : segments)
+    {
+        if (segment.isSubtree)
+        {
+            subtrees.push_back(&segment);
+        }
+    }
+
+    // Each thread picks the next unprocessed subtree until all of them are done
+    std::atomic<std::size_t> nextSubtree(0);
+
+    auto cullSubtrees = [&]()
+    {
+        for (auto i = nextSubtree++; i < subtrees.size(); i = nextSubtree++)
+        {
+            cullSubtree(*subtrees[i]->node, volume, visitHidden, subtrees[i]->members);
+        }
+    };
+
+    if (subtrees.size() < MIN_SUBTREES_FOR_PARALLEL_CULLING)
+    {
+        // Not worth the synchronisation, cull everything on this thread
+        cullSubtrees();
+    }
+    else
+    {
+        if (!_cullingWorkers)
+        {
+            auto numThreads = std::min(static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)),
+                MAX_CULLING_THREADS);
+
+            // The calling thread is taking part too
+            _cullingWorkers = std::make_unique<CullingWorkerPool>(numThreads - 1);
+        }
+
+        _cullingWorkers->run(cullSubtrees, subtrees.size() - 1);
+    }
+
+    // Visit the collected members in traversal order
+    for (const auto& segment : segments)
+    {
+        for (auto member : segment.members)
+        {
+            // We're done, as soon as the walker returns FALSE
+            if (!functor(*member))
+            {
+                return;
+            }
+        }
+    }
+}
+
 ISpacePartitionSystemPtr SceneGraph::getSpacePartition()
 {
 	return _spacePartition;
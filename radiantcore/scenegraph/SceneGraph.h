@@ -2,6 +2,9 @@
 
 #include <map>
 #include <list>
+#include <memory>
+#include <vector>
+#include <unordered_set>
 #include <sigc++/signal.h>
 #include <sigc++/connection.h>
 
@@ -14,6 +17,8 @@
 namespace scene
 {
 
+class CullingWorkerPool;
+
 /**
  * Implementing class for the scenegraph.
  *
@@ -53,8 +58,17 @@ private:
 
     bool _traversalOngoing;
 
+    // Bounds changes collected during a batch, each node is recorded only once
+    std::size_t _boundsChangeBatchLevel;
+    std::vector<INodePtr> _pendingBoundsChanges;
+    std::unordered_set<INode*> _nodesWithPendingBoundsChange;
+    bool _boundsChangedDuringBatch;
+
     sigc::connection _undoEventHandler;
 
+    // The threads helping with parallel culling, created on first use
+    std::unique_ptr<CullingWorkerPool> _cullingWorkers;
+
 public:
 	SceneGraph();
 
@@ -85,6 +99,9 @@ public:
 
     void nodeBoundsChanged(const scene::INodePtr& node) override;
 
+    void beginBoundsChangeBatch() override;
+    void endBoundsChangeBatch() override;
+
 	// Walker variants
     void foreachNodeInVolume(const VolumeTest& volume, Walker& walker) override;
     void foreachVisibleNodeInVolume(const VolumeTest& volume, Walker& walker) override;
@@ -97,12 +114,17 @@ public:
 
     ISpacePartitionSystemPtr getSpacePartition() override;
 private:
-	void foreachNodeInVolume(const VolumeTest& volume, const INode::VisitorFunc& functor, bool visitHidden);
+	void foreachNodeInVolume(const VolumeTest& volume, const INode::VisitorFunc& functor, bool visitHidden,
+                             bool parallelCulling = false);
 
 	// Recursive method used to descend the SpacePartition tree, returns FALSE if the walker signaled stop
 	bool foreachNodeInVolume_r(const ISPNode& node, const VolumeTest& volume, 
 							   const INode::VisitorFunc& functor, bool visitHidden);
 
+    // Culls the SpacePartition tree on several threads, then invokes the functor on the
+    // visible members in the same order as foreachNodeInVolume_r would do
+    void foreachNodeInVolumeParallel(const VolumeTest& volume, const INode::VisitorFunc& functor, bool visitHidden);
+
     void flushActionBuffer();
 
     void onUndoEvent(IUndoSystem::EventType type, const std::string& operationName);
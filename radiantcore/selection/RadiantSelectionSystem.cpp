@@ -813,7 +813,10 @@ void RadiantSelectionSystem::onManipulationChanged()
 
 void RadiantSelectionSystem::onManipulationEnd()
 {
-    GlobalSceneGraph().foreachNode(scene::freezeTransformableNode);
+    {
+        scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+        GlobalSceneGraph().foreachNode(scene::freezeTransformableNode);
+    }
 
     _pivot.endOperation();
 
@@ -40,6 +40,9 @@ namespace
 
 void rotateSelected(const Quaternion& rotation)
 {
+	// Process the bounds changes of all transformed nodes at once
+	scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+
 	// Perform the rotation according to the current mode
 	if (GlobalSelectionSystem().getSelectionMode() == SelectionMode::Component)
 	{
@@ -90,6 +93,7 @@ void scaleSelected(const Vector3& scaleXYZ)
 		std::string command("scaleSelected: ");
 		command += string::to_string(scaleXYZ);
 		UndoableCommand undo(command);
+		scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
 
 		// Pass the scale to the according traversor
 		if (GlobalSelectionSystem().getSelectionMode() == SelectionMode::Component)
@@ -358,6 +362,8 @@ Vector3 AxisBase_axisForDirection(const AxisBase& axes, ENudgeDirection directio
 
 void translateSelected(const Vector3& translation)
 {
+	scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+
 	// Apply the transformation and freeze the changes
 	if (GlobalSelectionSystem().getSelectionMode() == SelectionMode::Component)
 	{
@@ -118,7 +118,7 @@ void CShader::setEditorImageExpressionFromString(const std::string& editorImageP
 
 bool CShader::isEditorImageNoTex()
 {
-	return (getEditorImage() == GetTextureManager().getShaderNotFound());
+	return GetTextureManager().isShaderNotFound(getEditorImage());
 }
 
 IMapExpression::Ptr CShader::getLightFalloffExpression()
@@ -8,11 +8,10 @@
 
 #include "os/path.h"
 #include "string/convert.h"
-#include "math/FloatTools.h" // contains float_to_integer() helper
-#include "math/Vector3.h"
 #include "fmt/format.h"
 
 #include "RGBAImage.h"
+#include "image/PixelKernels.h"
 #include "textures/HeightmapCreator.h"
 #include "textures/TextureManipulator.h"
 #include "string/predicate.h"
@@ -205,40 +204,9 @@ ImagePtr AddNormalsExpression::getImage() const {
 
     ImagePtr result (new image::RGBAImage(width, height));
 
-    byte* pixOne = imgOne->getPixels();
-    byte* pixTwo = imgTwo->getPixels();
-    byte* pixOut = result->getPixels();
+    // Take the mean value of the two normal vectors
+    image::kernels::addNormals(imgOne->getPixels(), imgTwo->getPixels(), result->getPixels(), width * height);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; y++ )
-	{
-		for( std::size_t x = 0; x < width; x++ )
-		{
-			// create the two vectors
-			Vector3 vectorOne(
-    			static_cast<double>(pixOne[0]),
-    			static_cast<double>(pixOne[1]),
-    			static_cast<double>(pixOne[2])
-			);
-			Vector3 vectorTwo(
-    			static_cast<double>(pixTwo[0]),
-    			static_cast<double>(pixTwo[1]),
-    			static_cast<double>(pixTwo[2])
-			);
-			// Take the mean value of the two vectors
-			Vector3 vectorOut = (vectorOne + vectorTwo) * 0.5;
-
-			pixOut[0] = static_cast<byte>(float_to_integer(vectorOut.x()));
-			pixOut[1] = static_cast<byte>(float_to_integer(vectorOut.y()));
-			pixOut[2] = static_cast<byte>(float_to_integer(vectorOut.z()));
-			pixOut[3] = 255;
-
-			// advance the pixel pointer
-			pixOne += 4;
-			pixTwo += 4;
-			pixOut += 4;
-		}
-    }
     return result;
 }
 
@@ -276,56 +244,9 @@ ImagePtr SmoothNormalsExpression::getImage() const {
 
 	ImagePtr result (new image::RGBAImage(width, height));
 
-	byte* in = normalMap->getPixels();
-	byte* out = result->getPixels();
-
-	struct KernelElement {
-		// offset to the current pixel
-		int dx, dy;
-	};
-
-	// a 3x3 kernel with the surrounding pixels including the pixel itself
-	const int kernelSize = 9;
-	KernelElement kernel[kernelSize] = {
-		{-1, -1 },
-		{ 0, -1 },
-		{ 1, -1 },
-		{ 1,  0 },
-		{ 1,  1 },
-		{ 0,  1 },
-		{-1,  1 },
-		{-1,  0 },
-		{ 0,  0 }
-	};
-	const float perKernelSize = 1.0f/kernelSize;
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++) {
-		for( std::size_t x = 0; x < width; x++) {
-			//the new normal vector for this pixel
-			Vector3 smoothVector(0,0,0);
-
-			// calculate the average direction of the surrounding vectors
-			for (KernelElement* i = kernel; i != kernel + kernelSize; ++i) {
-				// temporary vector to represent one of the surrounding pixels
-				byte* pixel = getPixel(in, width, height, x + i->dx, y + i->dy);
-				Vector3 temp(pixel[0], pixel[1], pixel[2]);
-
-				smoothVector += temp;
-			}
-
-			// Take the average normal vector as result
-			smoothVector *= perKernelSize;
-
-			out[0] = static_cast<byte>(float_to_integer(smoothVector.x()));
-			out[1] = static_cast<byte>(float_to_integer(smoothVector.y()));
-			out[2] = static_cast<byte>(float_to_integer(smoothVector.z()));
-			out[3] = 255;
-
-			// advance the pixel pointer
-			out += 4;
-	    }
-	}
+	// Average each normal vector with the surrounding ones (3x3 kernel)
+	image::kernels::smoothNormals(normalMap->getPixels(), result->getPixels(), width, height);
+
     return result;
 }
 
@@ -371,27 +292,9 @@ ImagePtr AddExpression::getImage() const {
 
     ImagePtr result (new image::RGBAImage(width, height));
 
-    byte* pixOne = imgOne->getPixels();
-    byte* pixTwo = imgTwo->getPixels();
-    byte* pixOut = result->getPixels();
+    // add the colors
+    image::kernels::addChannels(imgOne->getPixels(), imgTwo->getPixels(), result->getPixels(), width * height);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; y++)
-	{
-		for( std::size_t x = 0; x < width; x++)
-		{
-			// add the colors
-			pixOut[0] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[0]) + pixTwo[0]) * 0.5f));
-			pixOut[1] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[1]) + pixTwo[1]) * 0.5f));
-			pixOut[2] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[2]) + pixTwo[2]) * 0.5f));
-			pixOut[3] = static_cast<byte>(float_to_integer((static_cast<float>(pixOne[3]) + pixTwo[3]) * 0.5f));
-
-			//advance the pixel pointer
-			pixOne += 4;
-			pixTwo += 4;
-			pixOut += 4;
-		}
-    }
 	return result;
 }
 
@@ -453,32 +356,10 @@ ImagePtr ScaleExpression::getImage() const
 
     ImagePtr result (new image::RGBAImage(width, height));
 
-    byte* in = img->getPixels();
-    byte* out = result->getPixels();
+    // values >255 are clamped, the scale values have been checked for negative values above
+    image::kernels::scaleChannels(img->getPixels(), result->getPixels(), width * height,
+        scaleRed, scaleGreen, scaleBlue, scaleAlpha);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; ++y)
-	{
-		for( std::size_t x = 0; x < width; ++x)
-		{
-			// prevent negative values and check for values >255
-			int red = float_to_integer(static_cast<float>(in[0]) * scaleRed);
-			out[0] = (red>255) ? 255 : static_cast<byte>(red);
-
-			int green = float_to_integer(static_cast<float>(in[1]) * scaleGreen);
-			out[1] = (green>255) ? 255 : static_cast<byte>(green);
-
-			int blue = float_to_integer(static_cast<float>(in[2]) * scaleBlue);
-			out[2] = (blue>255) ? 255 : static_cast<byte>(blue);
-
-			int alpha = float_to_integer(static_cast<float>(in[3]) * scaleAlpha);
-			out[3] = (alpha>255) ? 255 : static_cast<byte>(alpha);
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-    }
 	return result;
 }
 
@@ -519,24 +400,7 @@ ImagePtr InvertAlphaExpression::getImage() const {
 
 	ImagePtr result (new image::RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; ++y)
-	{
-		for( std::size_t x = 0; x < width; ++x)
-		{
-			out[0] = in[0];
-			out[1] = in[1];
-			out[2] = in[2];
-			out[3] = 255 - in[3];
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::kernels::invertAlpha(img->getPixels(), result->getPixels(), width * height);
 
 	return result;
 }
@@ -574,22 +438,7 @@ ImagePtr InvertColorExpression::getImage() const {
 
 	ImagePtr result (new image::RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++) {
-		for( std::size_t x = 0; x < width; x++) {
-			out[0] = 255 - in[0];
-			out[1] = 255 - in[1];
-			out[2] = 255 - in[2];
-			out[3] = in[3];
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::kernels::invertColour(img->getPixels(), result->getPixels(), width * height);
 
 	return result;
 }
@@ -627,24 +476,7 @@ ImagePtr MakeIntensityExpression::getImage() const {
 
 	ImagePtr result (new image::RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; ++y)
-	{
-		for( std::size_t x = 0; x < width; ++x)
-		{
-			out[0] = in[0];
-			out[1] = in[0];
-			out[2] = in[0];
-			out[3] = in[0];
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::kernels::makeIntensity(img->getPixels(), result->getPixels(), width * height);
 
 	return result;
 }
@@ -685,24 +517,7 @@ ImagePtr MakeAlphaExpression::getImage() const
 
 	ImagePtr result (new image::RGBAImage(width, height));
 
-	byte* in = img->getPixels();
-	byte* out = result->getPixels();
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++)
-	{
-		for( std::size_t x = 0; x < width; x++)
-		{
-			out[0] = 255;
-			out[1] = 255;
-			out[2] = 255;
-			out[3] = (in[0] + in[1] + in[2])/3;
-
-			// advance the pixel pointer
-			in += 4;
-			out += 4;
-		}
-	}
+	image::kernels::makeAlpha(img->getPixels(), result->getPixels(), width * height);
 
 	return result;
 }
@@ -274,6 +274,21 @@ void MaterialManager::reloadImages()
     });
 }
 
+bool MaterialManager::uploadPendingTextures(std::chrono::milliseconds budget)
+{
+    return _textureManager->uploadPendingTextures(budget);
+}
+
+void MaterialManager::setMainThreadDispatcher(const MainThreadDispatcher& dispatcher)
+{
+    _textureManager->setMainThreadDispatcher(dispatcher);
+}
+
+sigc::signal<void>& MaterialManager::signal_texturesDecoded()
+{
+    return _textureManager->signal_texturesDecoded();
+}
+
 const std::string& MaterialManager::getName() const
 {
     static std::string _name(MODULE_SHADERSYSTEM);
@@ -326,6 +341,10 @@ void MaterialManager::shutdownModule()
 {
     rMessage() << "MaterialManager::shutdownModule called" << std::endl;
 
+    // No more decoding once the VFS and image loaders are going away
+    _textureManager->stopDecoding();
+    _textureManager->setMainThreadDispatcher(MainThreadDispatcher());
+
     destroy();
     _library->clear();
     _library.reset();
@@ -90,6 +90,10 @@ public:
 
     void reloadImages() override;
 
+    bool uploadPendingTextures(std::chrono::milliseconds budget) override;
+    void setMainThreadDispatcher(const MainThreadDispatcher& dispatcher) override;
+    sigc::signal<void>& signal_texturesDecoded() override;
+
 public:
     sigc::signal<void> signal_activeShadersChanged() const override;
 
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <Texture.h>
+#include "iimage.h"
+#include "itextstream.h"
+#include "../MapExpression.h"
+#include "TextureManipulator.h"
+
+namespace shaders
+{
+
+/**
+ * \brief
+ * The decoding of a map expression's image, which is run by one of the
+ * TextureDecodeQueue's worker threads. A job that has not been picked up by a
+ * worker yet is run on the calling thread when someone needs the image right away.
+ */
+class ImageDecodeJob
+{
+public:
+    using Ptr = std::shared_ptr<ImageDecodeJob>;
+
+private:
+    enum class State
+    {
+        Queued,
+        Running,
+        Finished,
+    };
+
+    MapExpressionPtr _expression;
+    State _state;
+    ImagePtr _image;
+
+    mutable std::mutex _lock;
+    std::condition_variable _finished;
+
+public:
+    ImageDecodeJob(const MapExpressionPtr& expression) :
+        _expression(expression),
+        _state(State::Queued)
+    {}
+
+    // Decodes the image, unless this job has already been claimed by another thread
+    void run()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            if (_state != State::Queued) return;
+
+            _state = State::Running;
+        }
+
+        decode();
+    }
+
+    bool isFinished() const
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _state == State::Finished;
+    }
+
+    // Returns the decoded image (which is empty if decoding failed),
+    // blocks until the image is available
+    ImagePtr waitForImage()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+
+        if (_state == State::Queued)
+        {
+            // Nobody picked up this job yet, decode it right here
+            _state = State::Running;
+            lock.unlock();
+
+            decode();
+
+            lock.lock();
+        }
+
+        _finished.wait(lock, [this] { return _state == State::Finished; });
+
+        return _image;
+    }
+
+private:
+    void decode()
+    {
+        ImagePtr image;
+
+        try
+        {
+            image = _expression->getImage();
+        }
+        catch (const std::exception& ex)
+        {
+            rError() << "[shaders] Failed to decode image " << _expression->getIdentifier()
+                << ": " << ex.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            _image = std::move(image);
+            _expression.reset();
+            _state = State::Finished;
+        }
+
+        _finished.notify_all();
+    }
+};
+
+/**
+ * \brief
+ * Implementation of Texture for a 2D texture whose image is decoded in the background.
+ *
+ * The GL texture object is allocated right away and holds a single placeholder
+ * texel until the GLTextureManager uploads the decoded image into it, such that
+ * the texture number handed out to the clients stays the same. Querying the
+ * dimensions blocks until the image has been decoded, use isLoaded() to avoid that.
+ *
+ * Must only be used by the thread owning the GL context.
+ */
+class DeferredTexture :
+    public Texture
+{
+private:
+    GLuint _texNum;
+    std::string _name;
+    BindableTexture::Role _role;
+
+    // Released after the image has been uploaded
+    mutable ImageDecodeJob::Ptr _job;
+
+    // The image uploaded in place of images that failed to decode
+    ImagePtr _fallbackImage;
+
+    mutable ImagePtr _image;
+    mutable bool _failed;
+
+    bool _uploaded;
+
+    mutable std::size_t _width;
+    mutable std::size_t _height;
+
+public:
+    DeferredTexture(const std::string& name, BindableTexture::Role role,
+                    const ImageDecodeJob::Ptr& job, const ImagePtr& fallbackImage) :
+        _texNum(0),
+        _name(name),
+        _role(role),
+        _job(job),
+        _fallbackImage(fallbackImage),
+        _failed(false),
+        _uploaded(false),
+        _width(INVALID_SIZE),
+        _height(INVALID_SIZE)
+    {
+        // Normal maps are pointing straight up until the real image is there
+        const GLubyte placeholder[4] = {
+            128, 128, static_cast<GLubyte>(role == BindableTexture::Role::NORMAL_MAP ? 255 : 128), 255
+        };
+
+        glGenTextures(1, &_texNum);
+        glBindTexture(GL_TEXTURE_2D, _texNum);
+
+        // No mipmaps for the placeholder, they would be missing otherwise
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    ~DeferredTexture()
+    {
+        if (_texNum != 0)
+        {
+            glDeleteTextures(1, &_texNum);
+        }
+    }
+
+    // True if the image has been decoded (or failed to) and is waiting to be uploaded
+    bool isReadyForUpload() const
+    {
+        return !_uploaded && (!_job || _job->isFinished());
+    }
+
+    bool isUploaded() const
+    {
+        return _uploaded;
+    }
+
+    // True if the image could not be decoded, false while decoding is still in progress
+    bool isFailed() const
+    {
+        if (!isLoaded()) return false;
+
+        acquireImage();
+        return _failed;
+    }
+
+    // Uploads the decoded image into the GL texture, blocks if decoding is not done yet
+    void upload()
+    {
+        if (_uploaded) return;
+
+        acquireImage();
+
+        if (_failed)
+        {
+            rError() << "[shaders] Unable to load texture: " << _name << std::endl;
+        }
+
+        // Images with stored mipmaps (DDS) are reduced by leaving out the top levels,
+        // the reported dimensions remain the ones of the full-sized image
+        if (_image && !_image->uploadTexture(_texNum, _role,
+                TextureManipulator::instance().getMipLevelsToSkip(*_image)))
+        {
+            rError() << "[shaders] Unable to upload texture: " << _name << std::endl;
+        }
+
+        // The pixel data is in GL memory now
+        _uploaded = true;
+        _image.reset();
+        _fallbackImage.reset();
+    }
+
+    /* Texture implementation */
+
+    std::string getName() const override
+    {
+        return _name;
+    }
+
+    GLuint getGLTexNum() const override
+    {
+        return _texNum;
+    }
+
+    std::size_t getWidth() const override
+    {
+        acquireImage();
+        return _width;
+    }
+
+    std::size_t getHeight() const override
+    {
+        acquireImage();
+        return _height;
+    }
+
+    bool isLoaded() const override
+    {
+        return !_job || _job->isFinished();
+    }
+
+private:
+    // Takes over the decoded image (or the fallback) and its dimensions
+    void acquireImage() const
+    {
+        if (!_job) return; // already acquired
+
+        _image = _job->waitForImage();
+        _job.reset();
+
+        if (!_image)
+        {
+            _failed = true;
+            _image = _fallbackImage;
+        }
+
+        if (_image)
+        {
+            _width = _image->getWidth();
+            _height = _image->getHeight();
+        }
+    }
+};
+
+}
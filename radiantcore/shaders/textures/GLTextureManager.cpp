@@ -16,6 +16,16 @@ namespace
 
 namespace shaders {
 
+GLTextureManager::GLTextureManager() :
+    _decodeQueue([this] { onImageDecoded(); }),
+    _decodeNotificationPending(false)
+{}
+
+GLTextureManager::~GLTextureManager()
+{
+    stopDecoding();
+}
+
 void GLTextureManager::checkBindings()
 {
     // Check the TextureMap for unique pointers and release them
@@ -57,6 +67,13 @@ TexturePtr GLTextureManager::getBinding(const NamedBindablePtr& bindable,
         return existing->second;
     }
 
+    // Map expressions are decoded in the background, the texture shows
+    // a placeholder until the image data has been uploaded
+    if (auto mapExpression = std::dynamic_pointer_cast<MapExpression>(bindable); mapExpression)
+    {
+        return createDeferredTexture(identifier, mapExpression, role);
+    }
+
     // Create and insert texture object, if it is valid
     auto texture = bindable->bindTexture(identifier, role);
     if (texture)
@@ -109,15 +126,33 @@ void GLTextureManager::clearCacheForBindable(const NamedBindablePtr& bindable)
 TexturePtr GLTextureManager::getShaderNotFound()
 {
     // Construct the texture if necessary
-    if (!_shaderNotFound) {
-        _shaderNotFound = loadStandardTexture(SHADER_NOT_FOUND);
+    if (!_shaderNotFound)
+    {
+        _shaderNotFoundImage = loadStandardImage(SHADER_NOT_FOUND);
+
+        if (_shaderNotFoundImage)
+        {
+            _shaderNotFound = _shaderNotFoundImage->bindTexture(SHADER_NOT_FOUND);
+        }
     }
 
     // Return the texture
     return _shaderNotFound;
 }
 
-TexturePtr GLTextureManager::loadStandardTexture(const std::string& filename)
+bool GLTextureManager::isShaderNotFound(const TexturePtr& texture)
+{
+    if (texture == getShaderNotFound())
+    {
+        return true;
+    }
+
+    // Textures still being decoded are not known to have failed yet
+    auto deferredTexture = std::dynamic_pointer_cast<DeferredTexture>(texture);
+    return deferredTexture && deferredTexture->isFailed();
+}
+
+ImagePtr GLTextureManager::loadStandardImage(const std::string& filename)
 {
     // Create the texture path
     std::string fullpath = module::GlobalModuleRegistry().getApplicationContext().getBitmapsPath() + filename;
@@ -125,16 +160,109 @@ TexturePtr GLTextureManager::loadStandardTexture(const std::string& filename)
     // load the image with the ImageFileLoader (which can handle .bmp)
     ImagePtr img = GlobalImageLoader().imageFromFile(fullpath);
 
-    if (img)
+    if (!img)
+    {
+        rError() << "[shaders] Couldn't load Standard Texture texture: " << filename << "\n";
+    }
+
+    return img;
+}
+
+TexturePtr GLTextureManager::createDeferredTexture(const std::string& identifier,
+    const MapExpressionPtr& mapExpression, BindableTexture::Role role)
+{
+    // The resampler is set up on first use, which needs to happen on this thread
+    TextureManipulator::instance();
+
+    // Failed images are replaced with the fallback, make sure it's loaded
+    getShaderNotFound();
+
+    auto job = std::make_shared<ImageDecodeJob>(mapExpression);
+    auto texture = std::make_shared<DeferredTexture>(identifier, role, job, _shaderNotFoundImage);
+
+    _textures.emplace(identifier, texture);
+    _pendingUploads.push_back(texture);
+
+    _decodeQueue.enqueue(job);
+
+    return texture;
+}
+
+bool GLTextureManager::uploadPendingTextures(std::chrono::milliseconds budget)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool uploadedAny = false;
+
+    for (auto i = _pendingUploads.begin(); i != _pendingUploads.end(); /* in-loop increment */)
     {
-        // Bind the (processed) texture and get the OpenGL id
-        // The getProcessed() call may substitute the passed image by another
-        return img->bindTexture(filename);
+        auto texture = i->lock();
+
+        // Forget about textures that have been released in the meantime
+        if (!texture)
+        {
+            i = _pendingUploads.erase(i);
+            continue;
+        }
+
+        if (!texture->isReadyForUpload())
+        {
+            ++i;
+            continue;
+        }
+
+        if (uploadedAny && std::chrono::steady_clock::now() - start >= budget)
+        {
+            break; // continue in the next frame
+        }
+
+        texture->upload();
+        uploadedAny = true;
+
+        i = _pendingUploads.erase(i);
+    }
+
+    return uploadedAny;
+}
+
+void GLTextureManager::onImageDecoded()
+{
+    // Many images are finishing at once, a single notification is enough for all of them
+    if (_decodeNotificationPending.exchange(true)) return;
+
+    IMaterialManager::MainThreadDispatcher dispatcher;
+
+    {
+        std::lock_guard<std::mutex> lock(_dispatcherLock);
+        dispatcher = _mainThreadDispatcher;
     }
 
-    rError() << "[shaders] Couldn't load Standard Texture texture: " << filename << "\n";
+    if (!dispatcher)
+    {
+        _decodeNotificationPending = false;
+        return;
+    }
+
+    dispatcher([this]()
+    {
+        _decodeNotificationPending = false;
+        _sigTexturesDecoded.emit();
+    });
+}
+
+void GLTextureManager::setMainThreadDispatcher(const IMaterialManager::MainThreadDispatcher& dispatcher)
+{
+    std::lock_guard<std::mutex> lock(_dispatcherLock);
+    _mainThreadDispatcher = dispatcher;
+}
+
+sigc::signal<void>& GLTextureManager::signal_texturesDecoded()
+{
+    return _sigTexturesDecoded;
+}
 
-    return TexturePtr();
+void GLTextureManager::stopDecoding()
+{
+    _decodeQueue.stop();
 }
 
 } // namespace shaders
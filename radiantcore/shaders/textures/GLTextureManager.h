@@ -3,8 +3,15 @@
 
 #include "ishaders.h"
 #include <map>
+#include <list>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <sigc++/signal.h>
 #include "../MapExpression.h"
 #include "texturelib.h"
+#include "DeferredTexture.h"
+#include "TextureDecodeQueue.h"
 
 namespace shaders
 {
@@ -18,12 +25,40 @@ class GLTextureManager
 	// The fallback textures in case a texture is empty or broken
 	TexturePtr _shaderNotFound;
 
+	// The image of the above, uploaded into deferred textures that failed to load
+	ImagePtr _shaderNotFoundImage;
+
+	// Decodes the images of map expressions in the background
+	TextureDecodeQueue _decodeQueue;
+
+	// Deferred textures still showing their placeholder, in the order they have been requested
+	std::list<std::weak_ptr<DeferredTexture>> _pendingUploads;
+
+	IMaterialManager::MainThreadDispatcher _mainThreadDispatcher;
+	std::mutex _dispatcherLock;
+
+	// Set while a notification about decoded images is waiting to be run on the main thread
+	std::atomic<bool> _decodeNotificationPending;
+
+	sigc::signal<void> _sigTexturesDecoded;
+
 private:
 
-	// Constructs the fallback textures like "Shader Image Missing"
-	TexturePtr loadStandardTexture(const std::string& filename);
+	// Loads the images of the fallback textures like "Shader Image Missing"
+	ImagePtr loadStandardImage(const std::string& filename);
+
+	// Allocates a placeholder texture and queues the decoding of the map expression's image
+	TexturePtr createDeferredTexture(const std::string& identifier, const MapExpressionPtr& mapExpression,
+		BindableTexture::Role role);
+
+	// Called by the decoder threads after an image has been decoded
+	void onImageDecoded();
 
 public:
+	GLTextureManager();
+
+	// Joins the decoder threads before the members they are accessing are destroyed
+	~GLTextureManager();
 
     /// Construct a bound texture from a generic named bindable.
     TexturePtr getBinding(const NamedBindablePtr& bindable,
@@ -47,12 +82,33 @@ public:
      */
 	TexturePtr getShaderNotFound();
 
+	// Returns true if the given texture is the "shader not found" texture,
+	// or a deferred texture which turned out to have no valid image.
+	bool isShaderNotFound(const TexturePtr& texture);
+
 	/* greebo: This is some sort of "cleanup" call, which causes
 	 * the TextureManager to go through the list of textures and
 	 * remove the unused ones.
 	 */
 	void checkBindings();
 
+	/**
+	 * Uploads the images of map expressions which have been decoded in the
+	 * background, until the given time budget is used up (at least one texture
+	 * is uploaded per call). Needs the shared GL context to be current.
+	 * Returns true if any texture has been uploaded.
+	 */
+	bool uploadPendingTextures(std::chrono::milliseconds budget);
+
+	// The dispatcher used to announce decoded images on the main thread
+	void setMainThreadDispatcher(const IMaterialManager::MainThreadDispatcher& dispatcher);
+
+	// Emitted on the main thread after images have been decoded in the background
+	sigc::signal<void>& signal_texturesDecoded();
+
+	// Stops the decoder threads, unfinished images are decoded on demand after this call
+	void stopDecoding();
+
 };
 
 typedef std::shared_ptr<GLTextureManager> GLTextureManagerPtr;
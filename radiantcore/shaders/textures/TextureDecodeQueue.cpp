@@ -0,0 +1,91 @@
+#include "TextureDecodeQueue.h"
+
+#include <algorithm>
+
+namespace shaders
+{
+
+namespace
+{
+    // Decoding is mostly bound by the VFS and the image libraries,
+    // leave some cores to the main thread and the renderer
+    constexpr std::size_t MAX_DECODER_THREADS = 4;
+}
+
+TextureDecodeQueue::TextureDecodeQueue(const std::function<void()>& onJobFinished) :
+    _stopping(false),
+    _onJobFinished(onJobFinished)
+{}
+
+TextureDecodeQueue::~TextureDecodeQueue()
+{
+    stop();
+}
+
+void TextureDecodeQueue::enqueue(const ImageDecodeJob::Ptr& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+
+        _stopping = false;
+        _jobs.push_back(job);
+
+        auto hardwareThreads = static_cast<std::size_t>(std::thread::hardware_concurrency());
+        auto maxThreads = std::clamp<std::size_t>(hardwareThreads > 1 ? hardwareThreads - 1 : 1, 1, MAX_DECODER_THREADS);
+
+        if (_workers.size() < std::min(maxThreads, _jobs.size()))
+        {
+            _workers.emplace_back([this] { runWorker(); });
+        }
+    }
+
+    _jobsAvailable.notify_one();
+}
+
+void TextureDecodeQueue::stop()
+{
+    std::vector<std::thread> workers;
+
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+
+        _stopping = true;
+        _jobs.clear();
+        workers.swap(_workers);
+    }
+
+    _jobsAvailable.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void TextureDecodeQueue::runWorker()
+{
+    while (true)
+    {
+        ImageDecodeJob::Ptr job;
+
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+
+            _jobsAvailable.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+
+            if (_stopping) return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        job->run();
+
+        if (_onJobFinished)
+        {
+            _onJobFinished();
+        }
+    }
+}
+
+}
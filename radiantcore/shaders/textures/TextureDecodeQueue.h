@@ -0,0 +1,47 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <functional>
+#include "DeferredTexture.h"
+
+namespace shaders
+{
+
+/**
+ * \brief
+ * Runs ImageDecodeJobs on a small pool of worker threads, in the order they
+ * have been queued. The threads are started on demand.
+ */
+class TextureDecodeQueue
+{
+private:
+    std::vector<std::thread> _workers;
+    std::deque<ImageDecodeJob::Ptr> _jobs;
+
+    std::mutex _lock;
+    std::condition_variable _jobsAvailable;
+    bool _stopping;
+
+    // Invoked on the worker thread after each finished job
+    std::function<void()> _onJobFinished;
+
+public:
+    TextureDecodeQueue(const std::function<void()>& onJobFinished);
+    ~TextureDecodeQueue();
+
+    void enqueue(const ImageDecodeJob::Ptr& job);
+
+    // Discards the jobs that have not been started, waits for the running ones
+    // and stops the worker threads. Discarded jobs are decoded on demand when
+    // their image is requested later on.
+    void stop();
+
+private:
+    void runWorker();
+};
+
+}
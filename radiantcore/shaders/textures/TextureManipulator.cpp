@@ -8,11 +8,23 @@
 #include "ipreferencesystem.h"
 #include "../MaterialManager.h"
 #include "RGBAImage.h"
+#include "image/PixelKernels.h"
 
 namespace 
 {
-	static byte *row1 = NULL, *row2 = NULL;
-	static std::size_t rowsize = 0;
+	// The resampling rows are per thread, images are decoded on several threads
+	thread_local byte *row1 = NULL, *row2 = NULL;
+	thread_local std::size_t rowsize = 0;
+
+	// Releases the resampling rows of a thread when it exits
+	struct ResampleRowsCleanup
+	{
+		~ResampleRowsCleanup()
+		{
+			free(row1);
+			free(row2);
+		}
+	};
 
 	const std::size_t MAX_TEXTURE_QUALITY = 3;
 
@@ -137,23 +149,10 @@ ImagePtr TextureManipulator::getResized(const ImagePtr& input) {
 		output = input;
 	}
 
-	// Now retrieve the maximum texture size opengl can handle
-	if (_maxTextureSize == 0)
-	{
-		int temp;
-		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &temp);
-		_maxTextureSize = temp;
-
-		// If the value is still zero, fill it to some default value of 1024
-		if (_maxTextureSize == 0) {
-			_maxTextureSize = 1024;
-		}
-	}
-
 	// Determine the target dimensions
-	std::size_t qualityReduction = MAX_TEXTURE_QUALITY - _textureQuality;
-	std::size_t targetWidth = std::min(gl_width >> qualityReduction, _maxTextureSize);
-	std::size_t targetHeight = std::min(gl_height >> qualityReduction, _maxTextureSize);
+	std::size_t qualityReduction = getQualityReduction();
+	std::size_t targetWidth = std::min(gl_width >> qualityReduction, getMaxTextureSize());
+	std::size_t targetHeight = std::min(gl_height >> qualityReduction, getMaxTextureSize());
 
 	// Reduce the image to the next smaller power of two until it fits the openGL max texture size
 	while (gl_width > targetWidth || gl_height > targetHeight)
@@ -170,6 +169,50 @@ ImagePtr TextureManipulator::getResized(const ImagePtr& input) {
 	return output;
 }
 
+std::size_t TextureManipulator::getMipLevelsToSkip(const Image& image)
+{
+	std::size_t levels = image.getLevels();
+
+	if (levels < 2) {
+		return 0;
+	}
+
+	// The smallest mipmap is always uploaded
+	std::size_t skip = std::min(getQualityReduction(), levels - 1);
+
+	// Skip further mipmaps until the texture fits the openGL max texture size
+	while (skip < levels - 1 &&
+		   (image.getWidth(skip) > getMaxTextureSize() || image.getHeight(skip) > getMaxTextureSize()))
+	{
+		++skip;
+	}
+
+	return skip;
+}
+
+std::size_t TextureManipulator::getMaxTextureSize()
+{
+	// Retrieve the maximum texture size opengl can handle
+	if (_maxTextureSize == 0)
+	{
+		int temp;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &temp);
+		_maxTextureSize = temp;
+
+		// If the value is still zero, fill it to some default value of 1024
+		if (_maxTextureSize == 0) {
+			_maxTextureSize = 1024;
+		}
+	}
+
+	return _maxTextureSize;
+}
+
+std::size_t TextureManipulator::getQualityReduction() const
+{
+	return _textureQuality < MAX_TEXTURE_QUALITY ? MAX_TEXTURE_QUALITY - _textureQuality : 0;
+}
+
 // resample texture gamma according to user settings
 ImagePtr TextureManipulator::processGamma(const ImagePtr& input) {
 
@@ -184,14 +227,8 @@ ImagePtr TextureManipulator::processGamma(const ImagePtr& input) {
 	// Set the pixel pointer to the very first pixel
 	byte* pixels = input->getPixels();
 
-	// Go over all the pixels and change their value accordingly
-	for (std::size_t i = 0; i < (numPixels*4); i += 4)
-	{
-		// Change the current RGB pixel value to the one in the gamma table
-		pixels[i] = _gammaTable[pixels[i]];
-		(pixels + 1)[i] = _gammaTable[(pixels + 1)[i]];
-		(pixels + 2)[i] = _gammaTable[(pixels + 2)[i]];
-	}
+	// Change the RGB values of all pixels to the ones in the gamma table
+	image::kernels::applyGammaTable(pixels, numPixels, _gammaTable);
 
 	return input;
 }
@@ -229,36 +266,14 @@ void TextureManipulator::calculateGammaTable() {
 void TextureManipulator::resampleTextureLerpLine(const byte *in, byte *out,
 							 std::size_t inwidth, std::size_t outwidth, int bytesperpixel)
 {
-	std::size_t j, xi, oldx = 0, f, lerp;
-#define LERPBYTE(i) out[i] = (byte) ((((row2[i] - row1[i]) * lerp) >> 16) + row1[i])
-
-	std::size_t fstep = static_cast<std::size_t>(inwidth * 65536.0f / outwidth);
-	std::size_t endx = (inwidth - 1);
 	if (bytesperpixel == 4) {
-		for (j = 0,f = 0;j < outwidth;j++, f += fstep) {
-			xi = f >> 16;
-			if (xi != oldx) {
-				in += (xi - oldx) * 4;
-				oldx = xi;
-			}
-
-			if (xi < endx) {
-				lerp = f & 0xFFFF;
-				*out++ = (byte) ((((in[4] - in[0]) * lerp) >> 16) + in[0]);
-				*out++ = (byte) ((((in[5] - in[1]) * lerp) >> 16) + in[1]);
-				*out++ = (byte) ((((in[6] - in[2]) * lerp) >> 16) + in[2]);
-				*out++ = (byte) ((((in[7] - in[3]) * lerp) >> 16) + in[3]);
-			}
-			else // last pixel of the line has no pixel to lerp to
-			{
-				*out++ = in[0];
-				*out++ = in[1];
-				*out++ = in[2];
-				*out++ = in[3];
-			}
-		}
+		image::kernels::lerpLine(in, out, inwidth, outwidth);
 	}
 	else if (bytesperpixel == 3) {
+		std::size_t j, xi, oldx = 0, f, lerp;
+		std::size_t fstep = static_cast<std::size_t>(inwidth * 65536.0f / outwidth);
+		std::size_t endx = (inwidth - 1);
+
 		for (j = 0, f = 0; j < outwidth; j++, f += fstep) {
 			xi = f >> 16;
 			if (xi != oldx) {
@@ -294,6 +309,8 @@ void TextureManipulator::resampleTexture(const void *indata, std::size_t inwidth
 										 void *outdata,  std::size_t outwidth, std::size_t outheight, int bytesperpixel)
 {
 	if (rowsize < outwidth * bytesperpixel) {
+		thread_local ResampleRowsCleanup cleanup;
+
 		if (row1)
 			free(row1);
 		if (row2)
@@ -306,12 +323,9 @@ void TextureManipulator::resampleTexture(const void *indata, std::size_t inwidth
 
 	if (bytesperpixel == 4) {
 		std::size_t i, yi, oldy, f, fstep, lerp, endy = (inheight-1), inwidth4 = inwidth*4, outwidth4 = outwidth*4;
-		long j;
 		byte *inrow, *out;
 		out = (byte *)outdata;
 		fstep = (int) (inheight * 65536.0f / outheight);
-#define LERPBYTE(i) out[i] = (byte) ((((row2[i] - row1[i]) * lerp) >> 16) + row1[i])
-
 		inrow = (byte *)indata;
 		oldy = 0;
 		resampleTextureLerpLine(inrow, row1, inwidth, outwidth, bytesperpixel);
@@ -331,53 +345,8 @@ void TextureManipulator::resampleTexture(const void *indata, std::size_t inwidth
 					resampleTextureLerpLine(inrow + inwidth4, row2, inwidth, outwidth, bytesperpixel);
 					oldy = yi;
 				}
-				j = static_cast<long>(outwidth - 4);
-				while (j >= 0) {
-					LERPBYTE( 0);
-					LERPBYTE( 1);
-					LERPBYTE( 2);
-					LERPBYTE( 3);
-					LERPBYTE( 4);
-					LERPBYTE( 5);
-					LERPBYTE( 6);
-					LERPBYTE( 7);
-					LERPBYTE( 8);
-					LERPBYTE( 9);
-					LERPBYTE(10);
-					LERPBYTE(11);
-					LERPBYTE(12);
-					LERPBYTE(13);
-					LERPBYTE(14);
-					LERPBYTE(15);
-					out += 16;
-					row1 += 16;
-					row2 += 16;
-					j -= 4;
-				}
-				if (j & 2) {
-					LERPBYTE( 0);
-					LERPBYTE( 1);
-					LERPBYTE( 2);
-					LERPBYTE( 3);
-					LERPBYTE( 4);
-					LERPBYTE( 5);
-					LERPBYTE( 6);
-					LERPBYTE( 7);
-					out += 8;
-					row1 += 8;
-					row2 += 8;
-				}
-				if (j & 1) {
-					LERPBYTE( 0);
-					LERPBYTE( 1);
-					LERPBYTE( 2);
-					LERPBYTE( 3);
-					out += 4;
-					row1 += 4;
-					row2 += 4;
-				}
-				row1 -= outwidth4;
-				row2 -= outwidth4;
+				image::kernels::blendRows(row1, row2, out, outwidth4, lerp);
+				out += outwidth4;
 			}
 			else {
 				if (yi != oldy) {
@@ -395,12 +364,9 @@ void TextureManipulator::resampleTexture(const void *indata, std::size_t inwidth
 	}
 	else if (bytesperpixel == 3) {
 		std::size_t i, yi, oldy, f, fstep, lerp, endy = (inheight-1), inwidth3 = inwidth * 3, outwidth3 = outwidth * 3;
-		long j;
 		byte *inrow, *out;
 		out = (byte *)outdata;
 		fstep = (int) (inheight*65536.0f/outheight);
-#define LERPBYTE(i) out[i] = (byte) ((((row2[i] - row1[i]) * lerp) >> 16) + row1[i])
-
 		inrow = (byte *)indata;
 		oldy = 0;
 		resampleTextureLerpLine(inrow, row1, inwidth, outwidth, bytesperpixel);
@@ -419,46 +385,8 @@ void TextureManipulator::resampleTexture(const void *indata, std::size_t inwidth
 					resampleTextureLerpLine(inrow + inwidth3, row2, inwidth, outwidth, bytesperpixel);
 					oldy = yi;
 				}
-				j = static_cast<long>(outwidth - 4);
-				while (j >= 0) {
-					LERPBYTE( 0);
-					LERPBYTE( 1);
-					LERPBYTE( 2);
-					LERPBYTE( 3);
-					LERPBYTE( 4);
-					LERPBYTE( 5);
-					LERPBYTE( 6);
-					LERPBYTE( 7);
-					LERPBYTE( 8);
-					LERPBYTE( 9);
-					LERPBYTE(10);
-					LERPBYTE(11);
-					out += 12;
-					row1 += 12;
-					row2 += 12;
-					j -= 4;
-				}
-				if (j & 2) {
-					LERPBYTE( 0);
-					LERPBYTE( 1);
-					LERPBYTE( 2);
-					LERPBYTE( 3);
-					LERPBYTE( 4);
-					LERPBYTE( 5);
-					out += 6;
-					row1 += 6;
-					row2 += 6;
-				}
-				if (j & 1) {
-					LERPBYTE( 0);
-					LERPBYTE( 1);
-					LERPBYTE( 2);
-					out += 3;
-					row1 += 3;
-					row2 += 3;
-				}
-				row1 -= outwidth3;
-				row2 -= outwidth3;
+				image::kernels::blendRows(row1, row2, out, outwidth3, lerp);
+				out += outwidth3;
 			}
 			else {
 				if (yi != oldy) {
@@ -484,61 +412,15 @@ void TextureManipulator::mipReduce(byte *in, byte *out,
 								   std::size_t width, std::size_t height,
 								   std::size_t destwidth, std::size_t destheight)
 {
-	std::size_t x, y, width2, height2, nextrow;
-	if (width > destwidth) {
-		if (height > destheight) {
-			// reduce both
-			width2 = width >> 1;
-			height2 = height >> 1;
-			nextrow = width << 2;
-			for (y = 0;y < height2;y++) {
-				for (x = 0;x < width2;x++) {
-					out[0] = (byte) ((in[0] + in[4] + in[nextrow  ] + in[nextrow+4]) >> 2);
-					out[1] = (byte) ((in[1] + in[5] + in[nextrow+1] + in[nextrow+5]) >> 2);
-					out[2] = (byte) ((in[2] + in[6] + in[nextrow+2] + in[nextrow+6]) >> 2);
-					out[3] = (byte) ((in[3] + in[7] + in[nextrow+3] + in[nextrow+7]) >> 2);
-					out += 4;
-					in += 8;
-				}
-				in += nextrow; // skip a line
-			}
-		}
-		else {
-			// reduce width
-			width2 = width >> 1;
-			for (y = 0;y < height;y++) {
-				for (x = 0;x < width2;x++) {
-					out[0] = (byte) ((in[0] + in[4]) >> 1);
-					out[1] = (byte) ((in[1] + in[5]) >> 1);
-					out[2] = (byte) ((in[2] + in[6]) >> 1);
-					out[3] = (byte) ((in[3] + in[7]) >> 1);
-					out += 4;
-					in += 8;
-				}
-			}
-		}
-	}
-	else {
-		if (height > destheight) {
-			// reduce height
-			height2 = height >> 1;
-			nextrow = width << 2;
-			for (y = 0;y < height2;y++) {
-				for (x = 0;x < width;x++) {
-					out[0] = (byte) ((in[0] + in[nextrow  ]) >> 1);
-					out[1] = (byte) ((in[1] + in[nextrow+1]) >> 1);
-					out[2] = (byte) ((in[2] + in[nextrow+2]) >> 1);
-					out[3] = (byte) ((in[3] + in[nextrow+3]) >> 1);
-					out += 4;
-					in += 4;
-				}
-				in += nextrow; // skip a line
-			}
-		}
-		else {
-			rMessage() << "GL_MipReduce: desired size already achieved\n";
-		}
+	bool reduceWidth = width > destwidth;
+	bool reduceHeight = height > destheight;
+
+	if (!reduceWidth && !reduceHeight) {
+		rMessage() << "GL_MipReduce: desired size already achieved\n";
+		return;
 	}
+
+	image::kernels::mipReduce(in, out, width, height, reduceWidth, reduceHeight);
 }
 
 /* greebo: This gets called by the preference system and is responsible for adding the
@@ -55,6 +55,15 @@ public:
 	 */
 	Vector3 getFlatshadeColour(const ImagePtr& input);
 
+	/**
+	 * Returns the number of top mipmap levels to leave out when uploading
+	 * the given image, according to the texture quality setting and the
+	 * maximum texture size. This is used for images which come with their
+	 * own mipmaps (like DDS files), such that their pixel data doesn't need
+	 * to be resampled. Returns 0 for images without mipmaps.
+	 */
+	std::size_t getMipLevelsToSkip(const Image& image);
+
 private:
 	void keyChanged();
 
@@ -71,6 +80,12 @@ private:
 	 */
 	ImagePtr getResized(const ImagePtr& input);
 
+	// Returns the maximum texture size supported by openGL
+	std::size_t getMaxTextureSize();
+
+	// Returns the number of halvings requested by the texture quality setting
+	std::size_t getQualityReduction() const;
+
 	// Recalculates the gamma table according to the given gamma value
 	// This is called on first startup or if the user changes the value
 	void calculateGammaTable();
@@ -40,6 +40,19 @@ private:
 			_undoable.importState(_data);
 		}
 
+		// Replaces the memento by its delta to the current state of the undoable,
+		// returns false if the undoable hasn't changed at all
+		bool compact()
+		{
+			_data = _undoable.getStateDelta(_data);
+			return static_cast<bool>(_data);
+		}
+
+		std::size_t getMemoryUsage() const
+		{
+			return _data ? _data->getMemoryUsage() : 0;
+		}
+
         void notifyOperationRestored()
         {
             _undoable.onOperationRestored();
@@ -52,6 +65,10 @@ private:
 	// The name of the UndoOperaton
 	std::string _command;
 
+	// Memory usage as measured by compact(), mementos may report different
+	// values later on when the objects they share are released by the scene
+	std::size_t _memoryUsage = 0;
+
 public:
     using Ptr = std::shared_ptr<Operation>;
 
@@ -81,6 +98,28 @@ public:
 		_snapshot.emplace_front(undoable);
 	}
 
+	// To be called when the operation is complete, reduces the recorded states
+	// to the parts which have actually been changed by this operation
+	void compact()
+	{
+		_snapshot.remove_if([](UndoableState& state) { return !state.compact(); });
+
+		_memoryUsage = sizeof(Operation) + _command.capacity();
+
+		for (const auto& state : _snapshot)
+		{
+			// Each list node is holding two extra pointers
+			_memoryUsage += sizeof(UndoableState) + 2 * sizeof(void*) + state.getMemoryUsage();
+		}
+	}
+
+	// Returns the approximate number of bytes occupied by this operation,
+	// this value is stable after compact() has been called
+	std::size_t getMemoryUsage() const
+	{
+		return _memoryUsage;
+	}
+
 	void restoreSnapshot()
 	{
         // Walk through the snapshot front-to-back, the most recently added one is at the front
@@ -28,6 +28,9 @@ private:
 	// The pending undo operation (will be committed on finish, if not empty)
     Operation::Ptr _pending;
 
+	// Sum of the memory used by the operations in the stack
+	std::size_t _memoryUsage = 0;
+
 public:
 
 	bool empty() const
@@ -52,17 +55,26 @@ public:
 
 	void pop_front()
 	{
+		_memoryUsage -= _stack.front()->getMemoryUsage();
 		_stack.pop_front();
 	}
 
 	void pop_back()
 	{
+		_memoryUsage -= _stack.back()->getMemoryUsage();
 		_stack.pop_back();
 	}
 
 	void clear()
 	{
 		_stack.clear();
+		_memoryUsage = 0;
+	}
+
+	// Returns the approximate number of bytes occupied by the stored operations
+	std::size_t getMemoryUsage() const
+	{
+		return _memoryUsage;
 	}
 
 	// Allocate a new Operation to work with
@@ -97,7 +109,18 @@ public:
 		// Rename the last undo operation (it may be "unnamed" till now)
         _pending->setName(command);
 
+        // All changes are done, keep just what is needed to restore them
+        _pending->compact();
+
+        if (_pending->empty())
+        {
+            // None of the saved undoables has actually been changed
+            _pending.reset();
+            return false;
+        }
+
         // Move the pending operation into its place
+        _memoryUsage += _pending->getMemoryUsage();
         _stack.emplace_back(std::move(_pending));
 		return true;
 	}
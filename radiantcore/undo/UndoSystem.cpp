@@ -1,6 +1,7 @@
 #include "UndoSystem.h"
 
 #include "itextstream.h"
+#include "iscenegraph.h"
 
 #include <iostream>
 
@@ -12,7 +13,8 @@ namespace undo
 
 UndoSystem::UndoSystem() :
 	_activeUndoStack(nullptr),
-	_undoLevels(RKEY_UNDO_QUEUE_SIZE)
+	_undoLevels(RKEY_UNDO_QUEUE_SIZE),
+	_memoryBudget(RKEY_UNDO_MEMORY_BUDGET)
 {}
 
 UndoSystem::~UndoSystem()
@@ -53,6 +55,11 @@ bool UndoSystem::operationStarted() const
 	return _activeUndoStack != nullptr;
 }
 
+std::size_t UndoSystem::getMemoryUsage() const
+{
+	return _undoStack.getMemoryUsage() + _redoStack.getMemoryUsage();
+}
+
 void UndoSystem::cancel()
 {
     if (_activeUndoStack != nullptr)
@@ -66,6 +73,8 @@ void UndoSystem::finish(const std::string& command)
 {
 	if (finishUndo(command))
     {
+		enforceMemoryBudget();
+
 		rMessage() << command << std::endl;
         _eventSignal.emit(EventType::OperationRecorded, command);
 	}
@@ -90,7 +99,13 @@ void UndoSystem::undo()
 	rMessage() << "Undo: " << operationName << std::endl;
 
 	startRedo();
-	operation->restoreSnapshot();
+
+    {
+        // Restoring the snapshots might move lots of nodes, process their bounds changes in one go
+        scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+        operation->restoreSnapshot();
+    }
+
 	finishRedo(operationName);
 	_undoStack.pop_back();
     _eventSignal.emit(EventType::OperationUndone, operationName);
@@ -115,7 +130,13 @@ void UndoSystem::redo()
 	rMessage() << "Redo: " << operationName << std::endl;
 
 	startUndo();
-	operation->restoreSnapshot();
+
+    {
+        // Restoring the snapshots might move lots of nodes, process their bounds changes in one go
+        scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+        operation->restoreSnapshot();
+    }
+
 	finishUndo(operationName);
 	_redoStack.pop_back();
     _eventSignal.emit(EventType::OperationRedone, operationName);
@@ -174,4 +195,26 @@ void UndoSystem::setActiveUndoStack(UndoStack* stack)
 	}
 }
 
+void UndoSystem::enforceMemoryBudget()
+{
+	auto budget = _memoryBudget.get() * 1024 * 1024;
+
+	if (budget == 0) return; // unlimited
+
+	std::size_t discarded = 0;
+
+	// Always keep the most recent operation, even if it exceeds the budget on its own
+	while (_undoStack.size() > 1 && _undoStack.getMemoryUsage() > budget)
+	{
+		_undoStack.pop_front();
+		++discarded;
+	}
+
+	if (discarded > 0)
+	{
+		rMessage() << "Undo: discarded " << discarded << " operation(s) exceeding the memory budget of " <<
+			_memoryBudget.get() << " MB" << std::endl;
+	}
+}
+
 } // namespace undo
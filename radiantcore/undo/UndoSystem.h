@@ -16,6 +16,9 @@ namespace undo
 
 constexpr const char* const RKEY_UNDO_QUEUE_SIZE = "user/ui/undo/queueSize";
 
+// Memory limit of the undo history in MB, 0 means unlimited
+constexpr const char* const RKEY_UNDO_MEMORY_BUDGET = "user/ui/undo/memoryBudget";
+
 /**
 * greebo: The UndoSystem (interface: iundo.h) is maintaining two internal
 * stacks of Operations (one for Undo, one for Redo), each containing a list
@@ -47,6 +50,7 @@ private:
 	std::map<IUndoable*, UndoStackFiller> _undoables;
 
     registry::CachedKey<std::size_t> _undoLevels;
+    registry::CachedKey<std::size_t> _memoryBudget;
 
     sigc::signal<void(EventType, const std::string&)> _eventSignal;
 
@@ -63,6 +67,8 @@ public:
 
 	bool operationStarted() const override;
 
+	std::size_t getMemoryUsage() const override;
+
 	void undo() override;
 	void redo() override;
 
@@ -79,6 +85,9 @@ private:
 
 	// Assigns the given stack to all of the Undoables listed in the map
 	void setActiveUndoStack(UndoStack* stack);
+
+	// Discards the oldest undo operations until the history fits into the memory budget
+	void enforceMemoryBudget();
 };
 
 }
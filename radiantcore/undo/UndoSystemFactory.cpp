@@ -2,6 +2,7 @@
 
 #include "i18n.h"
 #include "ipreferencesystem.h"
+#include "iscenegraph.h"
 #include "UndoSystem.h"
 #include "module/StaticModule.h"
 
@@ -20,7 +21,7 @@ public:
 
     const StringSet& getDependencies() const override
     {
-        static StringSet _dependencies{ MODULE_PREFERENCESYSTEM };
+        static StringSet _dependencies{ MODULE_PREFERENCESYSTEM, MODULE_SCENEGRAPH };
         return _dependencies;
     }
 
@@ -40,6 +41,7 @@ private:
     {
         IPreferencePage& page = GlobalPreferenceSystem().getPage(_("Undo System"));
         page.appendSpinner(_("Undo Queue Size"), RKEY_UNDO_QUEUE_SIZE, 0, 1024, 1);
+        page.appendSpinner(_("Undo Memory Budget (MB, 0 = unlimited)"), RKEY_UNDO_MEMORY_BUDGET, 0, 65536, 64);
     }
 };
 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "iarchive.h"
+#include "gamelib.h"
+#include "DirectoryArchiveMappedFile.h"
+#include "ZipFileCache.h"
+
+namespace archive
+{
+
+/// \brief An ArchiveFile reading from a decompressed buffer held by the ZipFileCache,
+/// exposing the data through getMappedData() without copying it.
+class CachedArchiveFile :
+	public ArchiveFile
+{
+private:
+	std::string _name;
+	ZipFileCache::BufferPtr _buffer;
+	detail::MappedInputStream _istream;
+
+public:
+	CachedArchiveFile(const std::string& name, const ZipFileCache::BufferPtr& buffer) :
+		_name(name),
+		_buffer(buffer),
+		_istream(_buffer->data(), _buffer->size())
+	{}
+
+	std::size_t size() const override
+	{
+		return _buffer->size();
+	}
+
+	const std::string& getName() const override
+	{
+		return _name;
+	}
+
+	InputStream& getInputStream() override
+	{
+		return _istream;
+	}
+
+	const unsigned char* getMappedData() const override
+	{
+		return _buffer->data();
+	}
+};
+
+/// \brief An ArchiveTextFile reading from a decompressed buffer held by the ZipFileCache,
+/// exposing the contents through getMappedData() without copying them.
+class CachedArchiveTextFile :
+	public ArchiveTextFile
+{
+private:
+	std::string _name;
+	ZipFileCache::BufferPtr _buffer;
+	detail::MappedTextInputStream _inputStream;
+
+	// Mod directory containing this file
+	std::string _modRoot;
+
+public:
+	CachedArchiveTextFile(const std::string& name,
+						  const std::string& modRoot,
+						  const ZipFileCache::BufferPtr& buffer) :
+		_name(name),
+		_buffer(buffer),
+		_inputStream(reinterpret_cast<const char*>(_buffer->data()), _buffer->size()),
+		_modRoot(modRoot)
+	{}
+
+	const std::string& getName() const override
+	{
+		return _name;
+	}
+
+	TextInputStream& getInputStream() override
+	{
+		return _inputStream;
+	}
+
+	std::string_view getMappedData() const override
+	{
+		return std::string_view(reinterpret_cast<const char*>(_buffer->data()), _buffer->size());
+	}
+
+	std::string getModName() const override
+	{
+		return game::current::getModPath(_modRoot);
+	}
+};
+
+}
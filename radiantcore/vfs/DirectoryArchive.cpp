@@ -10,6 +10,7 @@
 
 #include "DirectoryArchiveFile.h"
 #include "DirectoryArchiveTextFile.h"
+#include "DirectoryArchiveMappedFile.h"
 
 DirectoryArchive::DirectoryArchive(const std::string& root) :
 	_root(root)
@@ -20,6 +21,18 @@ ArchiveFilePtr DirectoryArchive::openFile(const std::string& name)
 	UnixPath path(_root);
 	path.push_filename(name);
 
+	if (archive::detail::shouldBeMapped(path))
+	{
+		auto mappedFile = std::make_shared<archive::DirectoryArchiveMappedFile>(name, path);
+
+		if (!mappedFile->failed())
+		{
+			return mappedFile;
+		}
+
+		// Mapping failed, try the stream approach below
+	}
+
 	std::shared_ptr<archive::DirectoryArchiveFile> file = 
 		std::make_shared<archive::DirectoryArchiveFile>(name, path);
 
@@ -36,6 +49,16 @@ ArchiveTextFilePtr DirectoryArchive::openTextFile(const std::string& name)
 	UnixPath path(_root);
 	path.push_filename(name);
 
+	if (archive::detail::shouldBeMapped(path))
+	{
+		auto mappedFile = std::make_shared<archive::DirectoryArchiveMappedTextFile>(name, _root, path);
+
+		if (!mappedFile->failed())
+		{
+			return mappedFile;
+		}
+	}
+
 	auto file = std::make_shared<archive::DirectoryArchiveTextFile>(name, _root, path);
 
 	if (!file->failed()) 
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include "iarchive.h"
+#include "idatastream.h"
+#include "gamelib.h"
+#include "os/fs.h"
+#include "os/MappedFile.h"
+
+namespace archive
+{
+
+namespace detail
+{
+
+// Files at least this large are memory-mapped, smaller ones go through regular
+// file streams, since the mapping overhead outweighs the saved copies
+constexpr std::size_t MAPPED_FILE_SIZE_THRESHOLD = 64 * 1024;
+
+inline bool shouldBeMapped(const std::string& path)
+{
+	std::error_code ec;
+	auto size = fs::file_size(path, ec);
+
+	return !ec && size >= MAPPED_FILE_SIZE_THRESHOLD;
+}
+
+// Binary stream reading from a fixed memory block
+class MappedInputStream :
+	public InputStream
+{
+private:
+	const byte_type* _pos;
+	const byte_type* _end;
+
+public:
+	MappedInputStream(const byte_type* data, std::size_t size) :
+		_pos(data),
+		_end(data + size)
+	{}
+
+	size_type read(byte_type* buffer, size_type length) override
+	{
+		size_type count = std::min(static_cast<size_type>(_end - _pos), length);
+
+		std::memcpy(buffer, _pos, count);
+		_pos += count;
+
+		return count;
+	}
+};
+
+// Text stream exposing the whole memory block as get area, the std::istream
+// wrapping this streambuf reads straight from the mapped pages without copying
+class MappedTextInputStream :
+	public TextInputStream
+{
+private:
+	char* _begin;
+	char* _end;
+
+public:
+	MappedTextInputStream(const char* data, std::size_t size) :
+		// streambuf wants non-const pointers, the get area is never written to
+		_begin(const_cast<char*>(data)),
+		_end(const_cast<char*>(data) + size)
+	{
+		setg(_begin, _begin, _end);
+	}
+
+	std::size_t read(char* buffer, std::size_t length) override
+	{
+		std::size_t count = std::min(static_cast<std::size_t>(egptr() - gptr()), length);
+
+		std::memcpy(buffer, gptr(), count);
+		setg(_begin, gptr() + count, _end);
+
+		return count;
+	}
+
+protected:
+	int underflow() override
+	{
+		// The get area is spanning the whole file, nothing to replenish
+		return gptr() < egptr() ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+	}
+
+	std::streampos seekoff(std::streamoff off, std::ios_base::seekdir way,
+		std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
+	{
+		char* base = way == std::ios_base::beg ? _begin : way == std::ios_base::cur ? gptr() : _end;
+		char* newPos = base + off;
+
+		if (newPos < _begin || newPos > _end)
+		{
+			return std::streampos(-1); // error
+		}
+
+		setg(_begin, newPos, _end);
+		return std::streampos(newPos - _begin);
+	}
+
+	std::streampos seekpos(std::streampos pos,
+		std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override
+	{
+		return seekoff(std::streamoff(pos), std::ios_base::beg, which);
+	}
+};
+
+// Returns the text of the given file. Text files are delivered with LF line endings, like
+// the BinaryToTextInputStream does. Files containing CR characters are copied to the given
+// storage with these removed, all others are referenced in the mapped pages.
+inline std::string_view getTextWithLineFeeds(const os::MappedFile& file, std::string& storage)
+{
+	std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+
+	if (text.empty() || text.find('\r') == std::string_view::npos)
+	{
+		return text;
+	}
+
+	storage.reserve(text.size());
+	std::remove_copy(text.begin(), text.end(), std::back_inserter(storage), '\r');
+
+	return storage;
+}
+
+}
+
+/// \brief An ArchiveFile on disk which is memory-mapped, exposing its data through getMappedData().
+class DirectoryArchiveMappedFile :
+	public ArchiveFile
+{
+private:
+	std::string _name;
+	os::MappedFile _file;
+	detail::MappedInputStream _istream;
+
+public:
+	DirectoryArchiveMappedFile(const std::string& name, const std::string& filename) :
+		_name(name),
+		_file(filename),
+		_istream(_file.data(), _file.size())
+	{}
+
+	bool failed() const
+	{
+		return _file.failed();
+	}
+
+	std::size_t size() const override
+	{
+		return _file.size();
+	}
+
+	const std::string& getName() const override
+	{
+		return _name;
+	}
+
+	InputStream& getInputStream() override
+	{
+		return _istream;
+	}
+
+	const unsigned char* getMappedData() const override
+	{
+		return _file.data();
+	}
+};
+
+/// \brief An ArchiveTextFile on disk which is memory-mapped, exposing its contents through getMappedData().
+class DirectoryArchiveMappedTextFile :
+	public ArchiveTextFile
+{
+private:
+	std::string _name;
+	os::MappedFile _file;
+
+	// The file contents without CR characters, only used if the file contains any
+	std::string _strippedText;
+	std::string_view _text;
+
+	detail::MappedTextInputStream _inputStream;
+
+	// Mod directory root
+	std::string _modRoot;
+
+public:
+	DirectoryArchiveMappedTextFile(const std::string& name,
+								   const std::string& modRoot,
+								   const std::string& filename) :
+		_name(name),
+		_file(filename),
+		_text(detail::getTextWithLineFeeds(_file, _strippedText)),
+		_inputStream(_text.data(), _text.size()),
+		_modRoot(modRoot)
+	{}
+
+	bool failed() const
+	{
+		return _file.failed();
+	}
+
+	const std::string& getName() const override
+	{
+		return _name;
+	}
+
+	TextInputStream& getInputStream() override
+	{
+		return _inputStream;
+	}
+
+	std::string_view getMappedData() const override
+	{
+		return _text;
+	}
+
+	std::string getModName() const override
+	{
+		return game::current::getModPath(_modRoot);
+	}
+};
+
+}
@@ -16,6 +16,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <locale>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <algorithm>
 
 #include "iradiant.h"
 #include "idatastream.h"
@@ -38,6 +42,7 @@
 #include "DirectoryArchive.h"
 #include "DirectoryArchiveFile.h"
 #include "DirectoryArchiveTextFile.h"
+#include "DirectoryArchiveMappedFile.h"
 #include "SortedFilenames.h"
 #include "ZipArchive.h"
 #include "module/StaticModule.h"
@@ -46,7 +51,16 @@
 namespace vfs
 {
 
-void Doom3FileSystem::initDirectory(const std::string& inputPath)
+namespace
+{
+    const std::size_t MAX_PAK_LOADER_THREADS = 8;
+}
+
+Doom3FileSystem::Doom3FileSystem() :
+    _zipFileCache(std::make_shared<archive::ZipFileCache>())
+{}
+
+void Doom3FileSystem::initDirectory(const std::string& inputPath, std::vector<ArchiveDescriptor>& archives)
 {
     // greebo: Normalise path: Replace backslashes and ensure trailing slash
     _directories.push_back(os::standardPathWithSlash(inputPath));
@@ -60,7 +74,7 @@ void Doom3FileSystem::initDirectory(const std::string& inputPath)
         entry.archive = std::make_shared<DirectoryArchive>(path);
         entry.is_pakfile = false;
 
-        _archives.push_back(entry);
+        archives.emplace_back(std::move(entry));
     }
 
     // Instantiate a new sorting container for the filenames
@@ -100,7 +114,7 @@ void Doom3FileSystem::initDirectory(const std::string& inputPath)
     for (const std::string& filename : filenameList)
     {
         // Assemble the filename and try to load the archive
-        initPakFile(path + filename);
+        initPakFile(path + filename, archives);
     }
 }
 
@@ -134,9 +148,19 @@ void Doom3FileSystem::initialise(const SearchPaths& vfsSearchPaths, const std::s
     }
 
     // Initialise the paths, in the given order
+    std::vector<ArchiveDescriptor> archives;
+
     for (const std::string& path : _vfsSearchPaths)
     {
-        initDirectory(path);
+        initDirectory(path, archives);
+    }
+
+    // Open the pk4s concurrently, they are added in their priority order afterwards
+    loadPakFiles(archives);
+
+    for (auto& archive : archives)
+    {
+        addArchive(std::move(archive));
     }
 
     signal_Initialised().emit();
@@ -150,6 +174,9 @@ bool Doom3FileSystem::isInitialised() const
 void Doom3FileSystem::shutdown()
 {
     _archives.clear();
+    _pakFileIndex.clear();
+    _directoryArchives.clear();
+    _zipFileCache->clear();
     _directories.clear();
     _vfsSearchPaths.clear();
     _allowedExtensions.clear();
@@ -163,31 +190,129 @@ const std::set<std::string>& Doom3FileSystem::getArchiveExtensions() const
     return _allowedExtensions;
 }
 
+void Doom3FileSystem::addArchive(ArchiveDescriptor&& descriptor)
+{
+    auto position = _archives.size();
+    _archives.emplace_back(std::move(descriptor));
+
+    const auto& added = _archives.back();
+
+    if (!added.is_pakfile)
+    {
+        _directoryArchives.push_back(position);
+        return;
+    }
+
+    // Collect all the files in this pak
+    class IndexBuilder :
+        public IArchive::Visitor
+    {
+    private:
+        std::unordered_map<std::string, PakFileIndexEntry>& _index;
+        std::size_t _position;
+
+    public:
+        IndexBuilder(std::unordered_map<std::string, PakFileIndexEntry>& index, std::size_t position) :
+            _index(index),
+            _position(position)
+        {}
+
+        void visitFile(const std::string& name, IArchiveFileInfoProvider& infoProvider) override
+        {
+            // Paks with lower priority are added later, they don't change the first one
+            auto result = _index.try_emplace(string::to_lower_copy(name), PakFileIndexEntry{ _position, 0 });
+            ++result.first->second.numArchives;
+        }
+
+        bool visitDirectory(const std::string& name, std::size_t depth) override
+        {
+            return false; // don't skip anything
+        }
+    } indexBuilder(_pakFileIndex, position);
+
+    added.archive->traverse(indexBuilder, "");
+}
+
+template<typename ArchiveVisitorFunc>
+void Doom3FileSystem::foreachArchiveContainingFile(const std::string& filename, const ArchiveVisitorFunc& visitor)
+{
+    auto indexEntry = _pakFileIndex.find(string::to_lower_copy(filename));
+
+    auto nextPak = indexEntry != _pakFileIndex.end() ? indexEntry->second.firstArchive : _archives.size();
+    auto remainingPaks = indexEntry != _pakFileIndex.end() ? indexEntry->second.numArchives : 0;
+
+    auto nextDirectory = _directoryArchives.begin();
+
+    // Merge the directory archives and the paks containing the file, in the order of their position
+    while (nextDirectory != _directoryArchives.end() || remainingPaks > 0)
+    {
+        if (nextDirectory != _directoryArchives.end() && (remainingPaks == 0 || *nextDirectory < nextPak))
+        {
+            if (!visitor(_archives[*nextDirectory++]))
+            {
+                return;
+            }
+
+            continue;
+        }
+
+        if (!visitor(_archives[nextPak]))
+        {
+            return;
+        }
+
+        // Files that are contained in more than one pak are rare, find the next one
+        if (--remainingPaks > 0)
+        {
+            do
+            {
+                ++nextPak;
+            }
+            while (nextPak < _archives.size() &&
+                   (!_archives[nextPak].is_pakfile || !_archives[nextPak].archive->containsFile(filename)));
+
+            assert(nextPak < _archives.size());
+        }
+    }
+}
+
 int Doom3FileSystem::getFileCount(const std::string& filename)
 {
     int count = 0;
     std::string fixedFilename(os::standardPath(filename));
 
-    for (const ArchiveDescriptor& descriptor : _archives)
+    foreachArchiveContainingFile(fixedFilename, [&](const ArchiveDescriptor& descriptor)
     {
-        if (descriptor.archive->containsFile(fixedFilename))
+        if (descriptor.is_pakfile || descriptor.archive->containsFile(fixedFilename))
         {
             ++count;
         }
-    }
+
+        return true;
+    });
 
     return count;
 }
 
 FileInfo Doom3FileSystem::getFileInfo(const std::string& vfsRelativePath)
 {
-    for (const auto& descriptor : _archives)
+    const ArchiveDescriptor* foundDescriptor = nullptr;
+
+    foreachArchiveContainingFile(vfsRelativePath, [&](const ArchiveDescriptor& descriptor)
     {
-        if (!descriptor.archive->containsFile(vfsRelativePath))
+        if (descriptor.is_pakfile || descriptor.archive->containsFile(vfsRelativePath))
         {
-            continue;
+            foundDescriptor = &descriptor;
+            return false;
         }
 
+        return true;
+    });
+
+    if (foundDescriptor != nullptr)
+    {
+        const auto& descriptor = *foundDescriptor;
+
         // Determine the visibility of this file
         auto topLevelDir = os::getToplevelDirectory(vfsRelativePath);
 
@@ -215,18 +340,15 @@ ArchiveFilePtr Doom3FileSystem::openFile(const std::string& filename)
         return ArchiveFilePtr();
     }
 
-    for (const auto& descriptor : _archives)
-    {
-        auto file = descriptor.archive->openFile(filename);
+    ArchiveFilePtr file;
 
-        if (file)
-        {
-            return file;
-        }
-    }
+    foreachArchiveContainingFile(filename, [&](const ArchiveDescriptor& descriptor)
+    {
+        file = descriptor.archive->openFile(filename);
+        return !file;
+    });
 
-    // not found
-    return ArchiveFilePtr();
+    return file;
 }
 
 ArchiveFilePtr Doom3FileSystem::openFileInAbsolutePath(const std::string& filename)
@@ -243,21 +365,30 @@ ArchiveFilePtr Doom3FileSystem::openFileInAbsolutePath(const std::string& filena
 
 ArchiveTextFilePtr Doom3FileSystem::openTextFile(const std::string& filename)
 {
-    for (const auto& descriptor : _archives)
-    {
-        auto file = descriptor.archive->openTextFile(filename);
+    ArchiveTextFilePtr file;
 
-        if (file)
-        {
-            return file;
-        }
-    }
+    foreachArchiveContainingFile(filename, [&](const ArchiveDescriptor& descriptor)
+    {
+        file = descriptor.archive->openTextFile(filename);
+        return !file;
+    });
 
-    return ArchiveTextFilePtr();
+    return file;
 }
 
 ArchiveTextFilePtr Doom3FileSystem::openTextFileInAbsolutePath(const std::string& filename)
 {
+    // Large files like AAS files are mapped, clients can parse them through getMappedData()
+    if (archive::detail::shouldBeMapped(filename))
+    {
+        auto mappedFile = std::make_shared<archive::DirectoryArchiveMappedTextFile>(filename, filename, filename);
+
+        if (!mappedFile->failed())
+        {
+            return mappedFile;
+        }
+    }
+
     auto file = std::make_shared<archive::DirectoryArchiveTextFile>(filename, filename, filename);
 
     if (!file->failed())
@@ -340,11 +471,11 @@ void Doom3FileSystem::forEachFileInArchive(const std::string& absoluteArchivePat
 
 std::string Doom3FileSystem::findFile(const std::string& name)
 {
-    for (const auto& descriptor : _archives)
+    for (auto position : _directoryArchives)
     {
-        if (!descriptor.is_pakfile && descriptor.archive->containsFile(name))
+        if (_archives[position].archive->containsFile(name))
         {
-            return descriptor.name;
+            return _archives[position].name;
         }
     }
 
@@ -364,7 +495,55 @@ std::string Doom3FileSystem::findRoot(const std::string& name)
     return std::string();
 }
 
-void Doom3FileSystem::initPakFile(const std::string& filename)
+void Doom3FileSystem::loadPakFiles(std::vector<ArchiveDescriptor>& archives)
+{
+    std::vector<ArchiveDescriptor*> pakFiles;
+
+    for (auto& descriptor : archives)
+    {
+        if (!descriptor.archive)
+        {
+            pakFiles.push_back(&descriptor);
+        }
+    }
+
+    if (pakFiles.empty())
+    {
+        return;
+    }
+
+    ScopedDebugTimer timer("[vfs] Loaded " + std::to_string(pakFiles.size()) + " pak files");
+
+    std::atomic<std::size_t> nextPakFile(0);
+
+    auto worker = [&]()
+    {
+        for (auto i = nextPakFile.fetch_add(1); i < pakFiles.size(); i = nextPakFile.fetch_add(1))
+        {
+            pakFiles[i]->archive = std::make_shared<archive::ZipArchive>(pakFiles[i]->name, _zipFileCache);
+        }
+    };
+
+    auto numWorkers = std::min(pakFiles.size(), std::clamp(
+        static_cast<std::size_t>(std::thread::hardware_concurrency()), static_cast<std::size_t>(1), MAX_PAK_LOADER_THREADS));
+
+    // The calling thread is doing its share too
+    std::vector<std::future<void>> workers;
+
+    for (std::size_t i = 1; i < numWorkers; ++i)
+    {
+        workers.emplace_back(std::async(std::launch::async, worker));
+    }
+
+    worker();
+
+    for (auto& result : workers)
+    {
+        result.get(); // propagates any unexpected exceptions
+    }
+}
+
+void Doom3FileSystem::initPakFile(const std::string& filename, std::vector<ArchiveDescriptor>& archives)
 {
     std::string fileExt = string::to_lower_copy(os::getExtension(filename));
 
@@ -373,10 +552,10 @@ void Doom3FileSystem::initPakFile(const std::string& filename)
         // Matched extension for archive (e.g. "pk3", "pk4")
         ArchiveDescriptor entry;
 
+        // The archive itself is opened later on, see loadPakFiles()
         entry.name = filename;
-        entry.archive = std::make_shared<archive::ZipArchive>(filename);
         entry.is_pakfile = true;
-        _archives.push_back(entry);
+        archives.emplace_back(std::move(entry));
 
         rMessage() << "[vfs] pak file: " << filename << std::endl;
     }
@@ -389,7 +568,7 @@ void Doom3FileSystem::initPakFile(const std::string& filename)
         entry.name = path;
         entry.archive = std::make_shared<DirectoryArchive>(path);
         entry.is_pakfile = false;
-        _archives.push_back(entry);
+        archives.emplace_back(std::move(entry));
 
         rMessage() << "[vfs] pak dir:  " << path << std::endl;
     }
@@ -426,6 +605,26 @@ const StringSet& Doom3FileSystem::getDependencies() const
 
 void Doom3FileSystem::initialiseModule(const IApplicationContext& ctx)
 {
+    // The VFS is used by almost every module, so it can't depend on the command system,
+    // register the command once everything else is up
+    module::GlobalModuleRegistry().signal_allModulesInitialised().connect([this]()
+    {
+        GlobalCommandSystem().addCommand("ShowVfsCacheStats",
+            std::bind(&Doom3FileSystem::showCacheStatsCmd, this, std::placeholders::_1));
+    });
+}
+
+void Doom3FileSystem::showCacheStatsCmd(const cmd::ArgumentList& args)
+{
+    auto stats = _zipFileCache->getStatistics();
+
+    auto lookups = stats.hits + stats.misses;
+    auto hitRate = lookups > 0 ? 100.0 * stats.hits / lookups : 0.0;
+
+    rMessage() << "[vfs] Zip file cache: " << stats.numEntries << " files, "
+        << (stats.size / 1024) << " of " << (stats.capacity / 1024) << " KiB used" << std::endl;
+    rMessage() << "[vfs] " << stats.hits << " hits, " << stats.misses << " misses ("
+        << hitRate << "% hit rate), " << stats.evictions << " evictions" << std::endl;
 }
 
 void Doom3FileSystem::shutdownModule()
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <unordered_map>
 #include "iarchive.h"
 #include "ifilesystem.h"
+#include "icommandsystem.h"
+#include "ZipFileCache.h"
 
 namespace vfs
 {
@@ -27,11 +30,30 @@ private:
 		bool is_pakfile;
 	};
 
-    std::list<ArchiveDescriptor> _archives;
+    // All archives, in order of their priority
+    std::vector<ArchiveDescriptor> _archives;
+
+    // The contents of pak files don't change while they're loaded, so their files
+    // are indexed, mapping the lower-case VFS path to the archives containing it.
+    struct PakFileIndexEntry
+    {
+        std::size_t firstArchive;   // Position in _archives of the first pak containing the file
+        std::size_t numArchives;    // Number of paks containing the file
+    };
+    std::unordered_map<std::string, PakFileIndexEntry> _pakFileIndex;
+
+    // Positions of the non-pak archives (physical folders) in _archives.
+    // Their contents can change at any time, so they are not indexed.
+    std::vector<std::size_t> _directoryArchives;
+
+    // Decompressed files of all the pk4 archives
+    std::shared_ptr<archive::ZipFileCache> _zipFileCache;
 
     sigc::signal<void> _sigInitialised;
 
 public:
+	Doom3FileSystem();
+
 	void initialise(const SearchPaths& vfsSearchPaths, const std::set<std::string>& allowedExtensions) override;
     bool isInitialised() const override;
 	void shutdown() override;
@@ -76,10 +98,26 @@ public:
 	void shutdownModule() override;
 
 private:
-	void initDirectory(const std::string& path);
-	void initPakFile(const std::string& filename);
+	// These add the archives found in the given location to the list, pk4 files are
+	// not opened yet, their descriptors are left without an archive instance
+	void initDirectory(const std::string& path, std::vector<ArchiveDescriptor>& archives);
+	void initPakFile(const std::string& filename, std::vector<ArchiveDescriptor>& archives);
+
+    // Opens the pk4 files of all descriptors lacking an archive, using several threads
+    void loadPakFiles(std::vector<ArchiveDescriptor>& archives);
+
+    // Adds the archive to the list, updating the pak file index
+    void addArchive(ArchiveDescriptor&& descriptor);
+
+    // Invokes the visitor for every archive that might contain the given file, in the
+    // order of their priority, until the visitor returns false. All the pak files passed
+    // to the visitor contain the file, the directory archives need to be checked.
+    template<typename ArchiveVisitorFunc>
+    void foreachArchiveContainingFile(const std::string& filename, const ArchiveVisitorFunc& visitor);
 
     std::shared_ptr<AssetsList> findAssetsList(const std::string& topLevelPath);
+
+    void showCacheStatsCmd(const cmd::ArgumentList& args);
 };
 
 }
@@ -1,6 +1,7 @@
 #include "ZipArchive.h"
 
 #include <stdexcept>
+#include <algorithm>
 #include "itextstream.h"
 #include "iarchive.h"
 #include "gamelib.h"
@@ -10,10 +11,12 @@
 #include "os/path.h"
 
 #include "ZipStreamUtils.h"
+#include "stream/PointerInputStream.h"
 #include "DeflatedArchiveFile.h"
 #include "DeflatedArchiveTextFile.h"
 #include "StoredArchiveFile.h"
 #include "StoredArchiveTextFile.h"
+#include "CachedArchiveFile.h"
 
 namespace archive
 {
@@ -28,13 +31,27 @@ public:
 	{}
 };
 
+namespace
+{
+	// Reads a little-endian value from the given position of a memory buffer
+	template<typename ValueType>
+	ValueType readLittleEndianAt(const stream::PointerInputStream::byte_type* data)
+	{
+		stream::PointerInputStream stream(data);
+		return stream::readLittleEndian<ValueType>(stream);
+	}
+}
 
-ZipArchive::ZipArchive(const std::string& fullPath) :
+ZipArchive::ZipArchive(const std::string& fullPath, const std::shared_ptr<ZipFileCache>& cache) :
 	_fullPath(fullPath),
 	_containingFolder(os::standardPathWithSlash(fs::path(_fullPath).remove_filename())),
-	_istream(_fullPath)
+	_file(_fullPath),
+	_cache(cache)
 {
-	if (_istream.failed())
+	// The central directory is read through a regular stream
+	stream::FileInputStream istream(_fullPath);
+
+	if (istream.failed() || _file.failed())
 	{
 		rError() << "Cannot open Zip file stream: " << _fullPath << std::endl;
 		return;
@@ -43,7 +60,7 @@ ZipArchive::ZipArchive(const std::string& fullPath) :
 	try
 	{
 		// Try loading the zip file, this will throw exceptoions on any problem
-		loadZipFile();
+		loadZipFile(istream);
 	}
 	catch (ZipFailureException& ex)
 	{
@@ -64,24 +81,18 @@ ArchiveFilePtr ZipArchive::openFile(const std::string& name)
 	{
 		const std::shared_ptr<ZipRecord>& file = i->second.getRecord();
 
-		stream::FileInputStream::size_type position = 0;
-
+		if (isCacheable(*file))
 		{
-			// Guard against concurrent access
-			std::lock_guard<std::mutex> lock(_streamLock);
-
-			_istream.seek(file->position);
-
-			ZipFileHeader header;
-			stream::readZipFileHeader(_istream, header);
+			auto buffer = loadCachedFileData(*file, false);
+			return buffer ? std::make_shared<CachedArchiveFile>(name, buffer) : ArchiveFilePtr();
+		}
 
-			position = _istream.tell();
+		std::size_t position = 0;
 
-			if (header.magic != ZIP_MAGIC_FILE_HEADER)
-			{
-				rError() << "Error reading zip file " << _fullPath << std::endl;
-				return ArchiveFilePtr();
-			}
+		if (!readFileDataPosition(*file, position))
+		{
+			rError() << "Error reading zip file " << _fullPath << std::endl;
+			return ArchiveFilePtr();
 		}
 
 		switch (file->mode)
@@ -104,15 +115,15 @@ ArchiveTextFilePtr ZipArchive::openTextFile(const std::string& name)
 	{
 		const std::shared_ptr<ZipRecord>& file = i->second.getRecord();
 
-		// Guard against concurrent access
-		std::lock_guard<std::mutex> lock(_streamLock);
-
-		_istream.seek(file->position);
+		if (isCacheable(*file))
+		{
+			auto buffer = loadCachedFileData(*file, true);
+			return buffer ? std::make_shared<CachedArchiveTextFile>(name, _containingFolder, buffer) : ArchiveTextFilePtr();
+		}
 
-		ZipFileHeader header;
-		stream::readZipFileHeader(_istream, header);
+		std::size_t position = 0;
 
-		if (header.magic != ZIP_MAGIC_FILE_HEADER)
+		if (!readFileDataPosition(*file, position))
 		{
 			rError() << "Error reading zip file " << _fullPath << std::endl;
 			return ArchiveTextFilePtr();
@@ -122,12 +133,12 @@ ArchiveTextFilePtr ZipArchive::openTextFile(const std::string& name)
 		{
 		case ZipRecord::eStored:
 			return std::make_shared<StoredArchiveTextFile>(
-                name, _fullPath, _containingFolder, _istream.tell(), file->stream_size
+                name, _fullPath, _containingFolder, position, file->stream_size
             );
 
 		case ZipRecord::eDeflated:
 			return std::make_shared<DeflatedArchiveTextFile>(
-                name, _fullPath, _containingFolder, _istream.tell(), file->stream_size
+                name, _fullPath, _containingFolder, position, file->stream_size
             );
 		}
 	}
@@ -135,6 +146,110 @@ ArchiveTextFilePtr ZipArchive::openTextFile(const std::string& name)
 	return ArchiveTextFilePtr();
 }
 
+bool ZipArchive::isCacheable(const ZipRecord& file) const
+{
+	return _cache && file.file_size <= _cache->getMaxEntrySize();
+}
+
+bool ZipArchive::readFileDataPosition(const ZipRecord& file, std::size_t& position) const
+{
+	// The data is following the local file header and its variable-length fields
+	stream::PointerInputStream::byte_type header[ZIP_FILE_HEADER_LENGTH];
+
+	if (_file.read(file.position, header, sizeof(header)) != sizeof(header))
+	{
+		return false;
+	}
+
+	ZipMagic magic;
+	std::copy(header, header + 4, magic.value);
+
+	if (magic != ZIP_MAGIC_FILE_HEADER)
+	{
+		return false;
+	}
+
+	auto nameLength = readLittleEndianAt<uint16_t>(header + 26);
+	auto extras = readLittleEndianAt<uint16_t>(header + 28);
+
+	position = file.position + ZIP_FILE_HEADER_LENGTH + nameLength + extras;
+	return true;
+}
+
+ZipFileCache::BufferPtr ZipArchive::loadCachedFileData(const ZipRecord& file, bool textMode)
+{
+	auto buffer = _cache->find(_fullPath, file.position, textMode);
+
+	if (buffer)
+	{
+		return buffer;
+	}
+
+	std::size_t position = 0;
+
+	if (!readFileDataPosition(file, position))
+	{
+		rError() << "Error reading zip file " << _fullPath << std::endl;
+		return ZipFileCache::BufferPtr();
+	}
+
+	auto data = std::make_shared<ZipFileCache::Buffer>(file.file_size);
+
+	if (file.mode == ZipRecord::eStored)
+	{
+		if (_file.read(position, data->data(), data->size()) != data->size())
+		{
+			rError() << "Error reading zip file " << _fullPath << std::endl;
+			return ZipFileCache::BufferPtr();
+		}
+	}
+	else
+	{
+		ZipFileCache::Buffer compressed(file.stream_size);
+
+		if (_file.read(position, compressed.data(), compressed.size()) != compressed.size() ||
+			!inflateFileData(compressed, *data))
+		{
+			rError() << "Error inflating file data in zip file " << _fullPath << std::endl;
+			return ZipFileCache::BufferPtr();
+		}
+	}
+
+	if (textMode)
+	{
+		// Text files are delivered with LF line endings, like the BinaryToTextInputStream does
+		data->erase(std::remove(data->begin(), data->end(), '\r'), data->end());
+	}
+
+	_cache->insert(_fullPath, file.position, textMode, data);
+
+	return data;
+}
+
+bool ZipArchive::inflateFileData(ZipFileCache::Buffer& compressed, ZipFileCache::Buffer& target)
+{
+	z_stream zipStream = {};
+
+	if (inflateInit2(&zipStream, -MAX_WBITS) != Z_OK)
+	{
+		return false;
+	}
+
+	zipStream.next_in = compressed.data();
+	zipStream.avail_in = static_cast<uInt>(compressed.size());
+	zipStream.next_out = target.data();
+	zipStream.avail_out = static_cast<uInt>(target.size());
+
+	auto result = inflate(&zipStream, Z_FINISH);
+
+	// Empty files might not even have an end-of-stream marker
+	bool success = result == Z_STREAM_END || (result == Z_BUF_ERROR && target.empty());
+
+	inflateEnd(&zipStream);
+
+	return success && zipStream.avail_out == 0;
+}
+
 bool ZipArchive::containsFile(const std::string& name)
 {
 	ZipFileSystem::iterator i = _filesystem.find(name);
@@ -163,10 +278,10 @@ std::string ZipArchive::getArchivePath(const std::string& relativePath)
     return _fullPath;
 }
 
-void ZipArchive::readZipRecord()
+void ZipArchive::readZipRecord(stream::PointerInputStream& stream)
 {
 	ZipMagic magic;
-	stream::readZipMagic(_istream, magic);
+	stream.read(reinterpret_cast<stream::PointerInputStream::byte_type*>(magic.value), 4);
 
 	if (magic != ZIP_MAGIC_ROOT_DIR_ENTRY)
 	{
@@ -174,14 +289,14 @@ void ZipArchive::readZipRecord()
 	}
 
 	ZipVersion version_encoder;
-	stream::readZipVersion(_istream, version_encoder);
+	stream::readZipVersion(stream, version_encoder);
 	ZipVersion version_extract;
-	stream::readZipVersion(_istream, version_extract);
+	stream::readZipVersion(stream, version_extract);
 
 	//unsigned short flags =
-	stream::readLittleEndian<int16_t>(_istream);
+	stream::readLittleEndian<int16_t>(stream);
 	
-	uint16_t compression_mode = stream::readLittleEndian<uint16_t>(_istream);
+	uint16_t compression_mode = stream::readLittleEndian<uint16_t>(stream);
 
 	if (compression_mode != Z_DEFLATED && compression_mode != 0)
 	{
@@ -189,40 +304,30 @@ void ZipArchive::readZipRecord()
 	}
 
 	ZipDosTime dostime;
-	stream::readZipDosTime(_istream, dostime);
+	stream::readZipDosTime(stream, dostime);
 
 	//unsigned int crc32 =
-	stream::readLittleEndian<uint32_t>(_istream);
+	stream::readLittleEndian<uint32_t>(stream);
 	
-	uint32_t compressed_size = stream::readLittleEndian<uint32_t>(_istream);
-	uint32_t uncompressed_size = stream::readLittleEndian<uint32_t>(_istream);
-	uint16_t namelength = stream::readLittleEndian<uint16_t>(_istream);
-	uint16_t extras = stream::readLittleEndian<uint16_t>(_istream);
-	uint16_t comment = stream::readLittleEndian<uint16_t>(_istream);
+	uint32_t compressed_size = stream::readLittleEndian<uint32_t>(stream);
+	uint32_t uncompressed_size = stream::readLittleEndian<uint32_t>(stream);
+	uint16_t namelength = stream::readLittleEndian<uint16_t>(stream);
+	uint16_t extras = stream::readLittleEndian<uint16_t>(stream);
+	uint16_t comment = stream::readLittleEndian<uint16_t>(stream);
 
 	//unsigned short diskstart =
-	stream::readLittleEndian<uint16_t>(_istream);
+	stream::readLittleEndian<uint16_t>(stream);
 	//unsigned short filetype =
-	stream::readLittleEndian<uint16_t>(_istream);
+	stream::readLittleEndian<uint16_t>(stream);
 	//unsigned int filemode =
-	stream::readLittleEndian<uint32_t>(_istream);
-
-	uint32_t position = stream::readLittleEndian<uint32_t>(_istream);
+	stream::readLittleEndian<uint32_t>(stream);
 
-	// greebo: Read the filename directly into a newly constructed std::string.
+	uint32_t position = stream::readLittleEndian<uint32_t>(stream);
 
-	// I'm not entirely happy about this brute-force casting, but I wanted to
-	// avoid reading the filename into a temporary char[] array
-	// only to let its contents end up being copied by the std::string anyway.
-	// Alternative: use a static std::shared_array here, resized to fit?
+	// The name is following the fixed-size part of the record
+	std::string path(reinterpret_cast<const char*>(stream.get()), namelength);
 
-	std::string path(namelength, '\0');
-
-	_istream.read(
-		reinterpret_cast<stream::FileInputStream::byte_type*>(const_cast<char*>(path.data())),
-		namelength);
-
-	_istream.seek(extras + comment, stream::FileInputStream::cur);
+	stream.seek(namelength + extras + comment);
 
 	if (os::isDirectory(path))
 	{
@@ -246,30 +351,58 @@ void ZipArchive::readZipRecord()
 	}
 }
 
-void ZipArchive::loadZipFile()
+void ZipArchive::loadZipFile(stream::FileInputStream& istream)
 {
-	SeekableStream::position_type pos = findZipDiskTrailerPosition(_istream);
+	SeekableStream::position_type pos = findZipDiskTrailerPosition(istream);
 
 	if (pos == 0)
 	{
 		throw ZipFailureException("Unable to locate Zip disk trailer");
 	}
 
-	_istream.seek(pos);
+	istream.seek(pos);
 
 	ZipDiskTrailer trailer;
-	stream::readZipDiskTrailer(_istream, trailer);
+	stream::readZipDiskTrailer(istream, trailer);
 
 	if (trailer.magic != ZIP_MAGIC_DISK_TRAILER)
 	{
 		throw ZipFailureException("Invalid Zip Magic, maybe this is not a zip file?");
 	}
 
-	_istream.seek(trailer.rootseek);
+	// Read the whole central directory in one go, the records are parsed from memory
+	std::vector<stream::PointerInputStream::byte_type> centralDirectory(trailer.rootsize);
+
+	istream.seek(trailer.rootseek);
+
+	if (istream.read(centralDirectory.data(), centralDirectory.size()) != centralDirectory.size())
+	{
+		throw ZipFailureException("Unable to read the Zip central directory");
+	}
+
+	stream::PointerInputStream recordStream(centralDirectory.data());
+	const auto* directoryEnd = centralDirectory.data() + centralDirectory.size();
 
 	for (unsigned short i = 0; i < trailer.entries; ++i)
 	{
-		readZipRecord();
+		// Check that the fixed-size part and the variable-length fields are within the buffer
+		auto remaining = static_cast<std::size_t>(directoryEnd - recordStream.get());
+
+		if (remaining < ZIP_ROOT_DIR_ENTRY_LENGTH)
+		{
+			throw ZipFailureException("Truncated Zip central directory");
+		}
+
+		auto variableLength = static_cast<std::size_t>(readLittleEndianAt<uint16_t>(recordStream.get() + 28)) +
+			readLittleEndianAt<uint16_t>(recordStream.get() + 30) +
+			readLittleEndianAt<uint16_t>(recordStream.get() + 32);
+
+		if (remaining < ZIP_ROOT_DIR_ENTRY_LENGTH + variableLength)
+		{
+			throw ZipFailureException("Truncated Zip central directory entry");
+		}
+
+		readZipRecord(recordStream);
 	}
 }
 
@@ -3,7 +3,9 @@
 #include "iarchive.h"
 #include "GenericFileSystem.h"
 #include "stream/FileInputStream.h"
-#include <mutex>
+#include "stream/PointerInputStream.h"
+#include "os/PositionalFile.h"
+#include "ZipFileCache.h"
 
 namespace archive
 {
@@ -51,11 +53,16 @@ private:
 	std::string _fullPath;			// the full path to the Zip file
 	std::string _containingFolder;  // the folder this Zip is located in
 	mutable std::string _modName;	// mod name, calculated based on the containing folder
-	stream::FileInputStream _istream;
-    std::mutex _streamLock;
+	// File handle used to read the entries, several threads can read from it at once
+	os::PositionalFile _file;
+
+	// Cache of the decompressed files, might be empty
+	std::shared_ptr<ZipFileCache> _cache;
 
 public:
-	ZipArchive(const std::string& fullPath);
+	// Files of this archive are kept in the given cache after decompression,
+	// pass an empty reference to disable caching
+	ZipArchive(const std::string& fullPath, const std::shared_ptr<ZipFileCache>& cache = {});
 	virtual ~ZipArchive();
 
 	// Archive implementation
@@ -69,8 +76,19 @@ public:
     std::string getArchivePath(const std::string& relativePath) override;
 
 private:
-	void readZipRecord();
-	void loadZipFile();
+	void readZipRecord(stream::PointerInputStream& stream);
+	void loadZipFile(stream::FileInputStream& istream);
+
+	bool isCacheable(const ZipRecord& file) const;
+
+	// Determines the position of the file data following the local file header
+	bool readFileDataPosition(const ZipRecord& file, std::size_t& position) const;
+
+	// Returns the decompressed file from the cache, loading it if necessary.
+	// In text mode, the carriage returns are removed from the data.
+	ZipFileCache::BufferPtr loadCachedFileData(const ZipRecord& file, bool textMode);
+
+	static bool inflateFileData(ZipFileCache::Buffer& compressed, ZipFileCache::Buffer& target);
 };
 
 }
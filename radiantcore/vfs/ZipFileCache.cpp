@@ -0,0 +1,99 @@
+#include "ZipFileCache.h"
+
+namespace archive
+{
+
+ZipFileCache::ZipFileCache(std::size_t capacity) :
+    _capacity(capacity),
+    _size(0),
+    _hits(0),
+    _misses(0),
+    _evictions(0)
+{}
+
+std::size_t ZipFileCache::getMaxEntrySize() const
+{
+    return _capacity / 8;
+}
+
+ZipFileCache::BufferPtr ZipFileCache::find(const std::string& archivePath, std::size_t position, bool textMode)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    auto found = _lookup.find(Key{ archivePath, position, textMode });
+
+    if (found == _lookup.end())
+    {
+        ++_misses;
+        return BufferPtr();
+    }
+
+    ++_hits;
+
+    // Move the entry to the front of the list
+    _entries.splice(_entries.begin(), _entries, found->second);
+
+    return found->second->buffer;
+}
+
+void ZipFileCache::insert(const std::string& archivePath, std::size_t position, bool textMode, const BufferPtr& buffer)
+{
+    if (!buffer || buffer->size() > getMaxEntrySize()) return;
+
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Key key{ archivePath, position, textMode };
+
+    // Another thread might have inserted the same file in the meantime
+    if (_lookup.find(key) != _lookup.end())
+    {
+        return;
+    }
+
+    _entries.push_front(Entry{ key, buffer });
+    _lookup.emplace(std::move(key), _entries.begin());
+    _size += buffer->size();
+
+    evictEntries();
+}
+
+void ZipFileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    _lookup.clear();
+    _entries.clear();
+    _size = 0;
+}
+
+ZipFileCache::Statistics ZipFileCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Statistics stats;
+
+    stats.hits = _hits;
+    stats.misses = _misses;
+    stats.evictions = _evictions;
+    stats.numEntries = _entries.size();
+    stats.size = _size;
+    stats.capacity = _capacity;
+
+    return stats;
+}
+
+void ZipFileCache::evictEntries()
+{
+    while (_size > _capacity && !_entries.empty())
+    {
+        const auto& leastRecentlyUsed = _entries.back();
+
+        _size -= leastRecentlyUsed.buffer->size();
+        _lookup.erase(leastRecentlyUsed.key);
+        _entries.pop_back();
+
+        ++_evictions;
+    }
+}
+
+}
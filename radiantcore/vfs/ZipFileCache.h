@@ -0,0 +1,105 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace archive
+{
+
+/**
+ * Size-bounded cache of decompressed files from Zip archives, shared by all
+ * the ZipArchives of the VFS. Files that are opened repeatedly (like images
+ * on reloadImages or models on refreshModels) only need to be inflated once.
+ *
+ * Entries are identified by the archive path, the position of the file's
+ * local header and whether the file has been opened in text mode (which
+ * strips carriage returns). The least recently used entries are evicted when
+ * the total size exceeds the capacity. The buffers are shared with the files
+ * handed out to the clients, evicting an entry doesn't invalidate any opened file.
+ *
+ * All methods are thread-safe.
+ */
+class ZipFileCache
+{
+public:
+    using Buffer = std::vector<unsigned char>;
+    using BufferPtr = std::shared_ptr<const Buffer>;
+
+    struct Statistics
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t numEntries = 0;
+        std::size_t size = 0;       // Sum of the buffer sizes in bytes
+        std::size_t capacity = 0;   // Maximum size in bytes
+    };
+
+    static constexpr std::size_t DefaultCapacity = 64 * 1024 * 1024;
+
+private:
+    struct Key
+    {
+        std::string archivePath;
+        std::size_t position;
+        bool textMode;
+
+        bool operator==(const Key& other) const
+        {
+            return position == other.position && textMode == other.textMode && archivePath == other.archivePath;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return std::hash<std::string>()(key.archivePath) ^ (std::hash<std::size_t>()(key.position * 2 + (key.textMode ? 1 : 0)) * 31);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        BufferPtr buffer;
+    };
+
+    // Most recently used entries are at the front
+    std::list<Entry> _entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _lookup;
+
+    std::size_t _capacity;
+    std::size_t _size;
+
+    std::size_t _hits;
+    std::size_t _misses;
+    std::size_t _evictions;
+
+    mutable std::mutex _lock;
+
+public:
+    ZipFileCache(std::size_t capacity = DefaultCapacity);
+
+    // Files larger than this are not cached, they would displace too many other entries
+    std::size_t getMaxEntrySize() const;
+
+    // Returns the cached buffer of the given file or an empty pointer, counting a hit or miss
+    BufferPtr find(const std::string& archivePath, std::size_t position, bool textMode);
+
+    // Adds the buffer of the given file, evicting the least recently used entries if necessary
+    void insert(const std::string& archivePath, std::size_t position, bool textMode, const BufferPtr& buffer);
+
+    // Removes all entries, the statistic counters are kept
+    void clear();
+
+    Statistics getStatistics() const;
+
+private:
+    void evictEntries();
+};
+
+}
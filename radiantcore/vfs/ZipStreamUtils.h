@@ -72,6 +72,9 @@ struct ZipFileHeader
 								/* followed by extra field (of variable size) */
 };
 
+// Size of the fixed-length part of a local file header
+const std::size_t ZIP_FILE_HEADER_LENGTH = 30;
+
 /* B. data descriptor
 * the data descriptor exists only if bit 3 of z_flags is set. It is byte aligned
 * and immediately follows the last byte of compressed data. It is only used if
@@ -119,6 +122,9 @@ struct ZipRootDirEntry
 								/* followed by file comment (of variable size) */
 };
 
+// Size of the fixed-length part of a central directory entry
+const std::size_t ZIP_ROOT_DIR_ENTRY_LENGTH = 46;
+
 /* end of central dir record */
 const ZipMagic ZIP_MAGIC_DISK_TRAILER('P', 'K', 0x05, 0x06);
 
@@ -1,5 +1,7 @@
 #include "gtest/gtest.h"
 
+#include <map>
+#include <random>
 #include "render/ContinuousBuffer.h"
 #include "testutil/TestBufferObjectProvider.h"
 
@@ -650,4 +652,200 @@ TEST(ContinuousBufferTest, SyncToBufferAfterApplyingTransaction)
     EXPECT_TRUE(checkDataInBufferObject(buffer, handle2, *bufferObject, eight)) << "Data sync unsuccessful";
 }
 
+// The smallest free slot that is large enough should be used
+TEST(ContinuousBufferTest, BestFitAllocation)
+{
+    auto four = std::vector<int>({ 10,11,12,13 });
+
+    render::ContinuousBuffer<int> buffer(40);
+
+    // Allocate slots of size 8, 4, 6, 4, 6 and 4, filling up the buffer except for 8 elements
+    std::vector<render::ContinuousBuffer<int>::Handle> handles;
+
+    for (auto size : { 8, 4, 6, 4, 6, 4 })
+    {
+        handles.push_back(buffer.allocate(size));
+    }
+
+    // Release the 8, the first 6 and the second 6, each of them surrounded by occupied slots
+    buffer.deallocate(handles[0]);
+    buffer.deallocate(handles[2]);
+    buffer.deallocate(handles[4]);
+
+    // A 5-sized block should go into the first 6-sized gap, not the 8-sized one at the start
+    auto handle = buffer.allocate(5);
+    EXPECT_EQ(buffer.getOffset(handle), 12) << "Expected the block in the first 6-sized gap";
+
+    auto stats = buffer.getStats();
+    EXPECT_EQ(stats.numFreeSlots, 4) << "Expected gaps of size 8, 1, 6 and 8";
+    EXPECT_EQ(stats.freeElements, 23);
+    EXPECT_EQ(stats.largestFreeSlot, 8);
+    EXPECT_EQ(stats.allocatedElements, 17);
+
+    handle = buffer.allocate(four.size());
+    buffer.setData(handle, four);
+    EXPECT_EQ(buffer.getOffset(handle), 22) << "Expected the block in the second 6-sized gap";
+    EXPECT_TRUE(checkData(buffer, handle, four));
+}
+
+TEST(ContinuousBufferTest, FragmentationStats)
+{
+    render::ContinuousBuffer<int> buffer(32);
+
+    auto stats = buffer.getStats();
+    EXPECT_EQ(stats.bufferSize, 32);
+    EXPECT_EQ(stats.numOccupiedSlots, 0);
+    EXPECT_EQ(stats.numFreeSlots, 1);
+    EXPECT_EQ(stats.largestFreeSlot, 32);
+    EXPECT_EQ(stats.getFragmentation(), 0.0) << "A single free block is not fragmented";
+
+    std::vector<render::ContinuousBuffer<int>::Handle> handles;
+
+    for (auto i = 0; i < 8; ++i)
+    {
+        handles.push_back(buffer.allocate(4));
+    }
+
+    stats = buffer.getStats();
+    EXPECT_EQ(stats.numOccupiedSlots, 8);
+    EXPECT_EQ(stats.numFreeSlots, 0);
+    EXPECT_EQ(stats.getFragmentation(), 0.0);
+
+    // Release every other slot, producing 4 gaps of equal size
+    for (auto i = 0; i < 8; i += 2)
+    {
+        buffer.deallocate(handles[i]);
+    }
+
+    stats = buffer.getStats();
+    EXPECT_EQ(stats.numOccupiedSlots, 4);
+    EXPECT_EQ(stats.numFreeSlots, 4);
+    EXPECT_EQ(stats.freeElements, 16);
+    EXPECT_EQ(stats.largestFreeSlot, 4);
+    EXPECT_DOUBLE_EQ(stats.getFragmentation(), 0.75);
+
+    // Releasing the remaining ones merges everything into a single block
+    for (auto i = 1; i < 8; i += 2)
+    {
+        buffer.deallocate(handles[i]);
+    }
+
+    stats = buffer.getStats();
+    EXPECT_EQ(stats.numOccupiedSlots, 0);
+    EXPECT_EQ(stats.numFreeSlots, 1);
+    EXPECT_EQ(stats.largestFreeSlot, 32);
+}
+
+TEST(ContinuousBufferTest, Compact)
+{
+    auto four = std::vector<int>({ 10,11,12,13 });
+    auto eight = std::vector<int>({ 0,1,2,3,4,5,6,7 });
+    auto six = std::vector<int>({ 20,21,22,23,24,25 });
+
+    render::ContinuousBuffer<int> buffer(40);
+    auto bufferObject = std::make_shared<TestBufferObject>();
+
+    auto handle1 = buffer.allocate(four.size());
+    auto handle2 = buffer.allocate(eight.size());
+    auto handle3 = buffer.allocate(six.size());
+    auto handle4 = buffer.allocate(eight.size());
+    auto handle5 = buffer.allocate(four.size());
+
+    buffer.setData(handle1, four);
+    buffer.setData(handle2, eight);
+    buffer.setData(handle3, six);
+    buffer.setData(handle4, eight);
+    buffer.setData(handle5, four);
+    buffer.syncModificationsToBufferObject(bufferObject);
+
+    // Punch a few holes into the buffer
+    buffer.deallocate(handle1);
+    buffer.deallocate(handle4);
+
+    EXPECT_EQ(buffer.getStats().numFreeSlots, 3);
+
+    buffer.compact();
+
+    // The remaining slots should have been moved to the front, in the same order
+    EXPECT_EQ(buffer.getOffset(handle2), 0);
+    EXPECT_TRUE(checkContinuousData(buffer, handle2, { eight, six, four }));
+
+    auto stats = buffer.getStats();
+    EXPECT_EQ(stats.numFreeSlots, 1) << "All the free space should have been merged";
+    EXPECT_EQ(stats.largestFreeSlot, 40 - eight.size() - six.size() - four.size());
+    EXPECT_EQ(stats.getFragmentation(), 0.0);
+
+    // The next sync should upload the moved data
+    buffer.syncModificationsToBufferObject(bufferObject);
+    EXPECT_TRUE(checkDataInBufferObject(buffer, handle2, *bufferObject, eight)) << "Data sync unsuccessful";
+    EXPECT_TRUE(checkDataInBufferObject(buffer, handle3, *bufferObject, six)) << "Data sync unsuccessful";
+    EXPECT_TRUE(checkDataInBufferObject(buffer, handle5, *bufferObject, four)) << "Data sync unsuccessful";
+
+    // Allocations should continue to work after compaction, using the free space at the end
+    auto handle6 = buffer.allocate(eight.size());
+    buffer.setData(handle6, eight);
+    EXPECT_TRUE(checkContinuousData(buffer, handle2, { eight, six, four, eight }));
+}
+
+// Random allocations and deallocations, checking that no slot ever overlaps another one
+TEST(ContinuousBufferTest, RandomAllocationsDontOverlap)
+{
+    render::ContinuousBuffer<int> buffer(64);
+    std::map<render::ContinuousBuffer<int>::Handle, int> allocations; // handle => fill value
+
+    std::minstd_rand rand(5); // fixed seed
+
+    auto checkAllocations = [&]()
+    {
+        std::size_t allocatedElements = 0;
+
+        for (const auto& [handle, value] : allocations)
+        {
+            auto start = buffer.getBufferStart() + buffer.getOffset(handle);
+            auto end = start + buffer.getSize(handle);
+
+            allocatedElements += buffer.getSize(handle);
+            EXPECT_TRUE(std::all_of(start, end, [&](int i) { return i == value; })) << "Slot data has been overwritten";
+        }
+
+        auto stats = buffer.getStats();
+        EXPECT_EQ(stats.allocatedElements, allocatedElements);
+        EXPECT_EQ(stats.numOccupiedSlots, allocations.size());
+        EXPECT_EQ(stats.allocatedElements + stats.freeElements, stats.bufferSize) << "Lost track of some elements";
+    };
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        if (allocations.empty() || rand() % 3 != 0)
+        {
+            auto size = 1 + rand() % 40;
+            auto handle = buffer.allocate(size);
+
+            EXPECT_EQ(allocations.count(handle), 0) << "Handle handed out twice";
+            allocations[handle] = i;
+            buffer.setData(handle, std::vector<int>(size, i));
+        }
+        else
+        {
+            auto it = allocations.begin();
+            std::advance(it, rand() % allocations.size());
+
+            buffer.deallocate(it->first);
+            allocations.erase(it);
+        }
+
+        if (i % 500 == 499)
+        {
+            buffer.compact();
+        }
+
+        if (i % 50 == 0)
+        {
+            checkAllocations();
+        }
+    }
+
+    checkAllocations();
+}
+
 }
@@ -9,6 +9,7 @@
 #include "os/path.h"
 #include "parser/DefBlockSyntaxParser.h"
 #include "string/case_conv.h"
+#include "fmt/format.h"
 
 namespace test
 {
@@ -653,6 +654,43 @@ testdecl    decl/temporary/12 { diffusemap textures/changed_temporary/12 } // ch
     expectDeclIsPresent(decl::Type::TestDecl, "decl/temporary/13");
 }
 
+// Unchanged files are served from the parse cache, changed files must not be
+TEST_F(DeclManagerTest, ReloadDeclarationDetectsChangedFileOfSameSize)
+{
+    auto tempPath = _context.getTestProjectPath() + "testdecls/temp_file.decl";
+    TemporaryFile tempFile(tempPath);
+    tempFile.setContents(R"(
+testdecl   decl/temporary/11 { diffusemap textures/temporary/11 }
+)");
+
+    GlobalDeclarationManager().registerDeclType("testdecl", std::make_shared<TestDeclarationCreator>());
+    GlobalDeclarationManager().registerDeclFolder(decl::Type::TestDecl, TEST_DECL_FOLDER, ".decl");
+
+    expectDeclContains(decl::Type::TestDecl, "decl/temporary/11", "diffusemap textures/temporary/11");
+    expectDeclIsPresent(decl::Type::TestDecl, "decl/numbers/1");
+
+    // Replace the contents, keeping both file size and modification time.
+    // The cache is keyed by these, so the reload must still deliver the cached blocks.
+    auto modificationTime = fs::last_write_time(tempPath);
+    tempFile.setContents(R"(
+testdecl   decl/temporary/11 { diffusemap textures/temporary/99 }
+)");
+    fs::last_write_time(tempPath, modificationTime);
+
+    GlobalDeclarationManager().reloadDeclarations();
+
+    expectDeclContains(decl::Type::TestDecl, "decl/temporary/11", "diffusemap textures/temporary/11");
+    expectDeclIsPresent(decl::Type::TestDecl, "decl/numbers/1");
+
+    // Move the timestamp forward, the file needs to be parsed again
+    fs::last_write_time(tempPath, modificationTime + std::chrono::seconds(2));
+
+    GlobalDeclarationManager().reloadDeclarations();
+
+    expectDeclContains(decl::Type::TestDecl, "decl/temporary/11", "diffusemap textures/temporary/99");
+    expectDeclIsPresent(decl::Type::TestDecl, "decl/numbers/1");
+}
+
 TEST_F(DeclManagerTest, ReloadDeclarationsIncreasesParseStamp)
 {
     GlobalDeclarationManager().registerDeclType("testdecl", std::make_shared<TestDeclarationCreator>());
@@ -714,6 +752,48 @@ TEST_F(DeclManagerTest, DeclarationPrecedence)
     expectDeclContains(decl::Type::TestDecl, "decl/precedence_test/1", "diffusemap textures/numbers/1");
 }
 
+// Files are parsed by several threads, the precedence must still follow the sorted file order
+TEST_F(DeclManagerTest, DeclarationPrecedenceWithManyFiles)
+{
+    std::vector<std::unique_ptr<TemporaryFile>> tempFiles;
+
+    // Enough files to have them distributed across all worker threads
+    // Create them in reverse order to not rely on the order the files are found in
+    for (int i = 31; i >= 0; --i)
+    {
+        auto number = fmt::format("{0:02d}", i);
+
+        tempFiles.emplace_back(std::make_unique<TemporaryFile>(
+            _context.getTestProjectPath() + "testdecls/parallel_precedence_" + number + ".decl",
+            fmt::format(R"(
+testdecl decl/parallel_precedence/{0} {{ diffusemap textures/parallel_precedence/{0} }}
+testdecl decl/parallel_precedence/shared {{ diffusemap textures/parallel_precedence/shared_{0} }}
+)", number)));
+    }
+
+    GlobalDeclarationManager().registerDeclType("testdecl", std::make_shared<TestDeclarationCreator>());
+    GlobalDeclarationManager().registerDeclFolder(decl::Type::TestDecl, TEST_DECL_FOLDER, ".decl");
+
+    for (int i = 0; i < 32; ++i)
+    {
+        expectDeclIsPresent(decl::Type::TestDecl, fmt::format("decl/parallel_precedence/{0:02d}", i));
+    }
+
+    // The first file in sort order takes precedence, as it does when parsing on a single thread
+    expectDeclContains(decl::Type::TestDecl, "decl/parallel_precedence/shared",
+        "diffusemap textures/parallel_precedence/shared_00");
+
+    auto decl = GlobalDeclarationManager().findDeclaration(decl::Type::TestDecl, "decl/parallel_precedence/shared");
+    EXPECT_EQ(decl->getBlockSyntax().fileInfo.name, "parallel_precedence_00.decl");
+
+    // Same outcome after reparsing
+    GlobalDeclarationManager().reloadDeclarations();
+
+    expectDeclContains(decl::Type::TestDecl, "decl/parallel_precedence/shared",
+        "diffusemap textures/parallel_precedence/shared_00");
+    expectDeclContains(decl::Type::TestDecl, "decl/precedence_test/1", "diffusemap textures/numbers/1");
+}
+
 TEST_F(DeclManagerTest, RemoveDeclaration)
 {
     GlobalDeclarationManager().registerDeclType("testdecl", std::make_shared<TestDeclarationCreator>());
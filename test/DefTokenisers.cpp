@@ -128,4 +128,81 @@ TEST(DefTokeniser, EmptyQuotesAtEndOfBlock)
     EXPECT_EQ(keyValuePairs["mins"], "-1 -1 -3");
 }
 
+namespace
+{
+
+// Runs both the std::string and the std::string_view tokeniser on the given input
+// and returns the two token sequences
+std::pair<std::vector<std::string>, std::vector<std::string>> tokeniseWithBoth(const std::string& input)
+{
+    std::pair<std::vector<std::string>, std::vector<std::string>> result;
+
+    parser::BasicDefTokeniser<std::string> stringTokeniser(input, parser::WHITESPACE, "{}(),");
+
+    while (stringTokeniser.hasMoreTokens())
+    {
+        result.first.emplace_back(stringTokeniser.nextToken());
+    }
+
+    parser::BasicDefTokeniser<std::string_view> bufferTokeniser(input);
+
+    while (bufferTokeniser.hasMoreTokens())
+    {
+        result.second.emplace_back(bufferTokeniser.nextTokenView());
+    }
+
+    return result;
+}
+
+}
+
+TEST(DefTokeniser, BufferTokeniserMatchesStringTokeniser)
+{
+    std::string testString = R"(Version 2
+// entity 0
+{
+"classname" "worldspawn"
+"escaped" "a\"b\nc\q"
+/* block comment { with braces } */
+"continued" "atdm:" \ 	
+    "mover_handle_base"
+"empty" ""
+// primitive 0
+{
+brushDef3
+{
+( 0 0 1 -604 ) ( ( 0.015625 0 255.9375 ) ( 0 0.015625 0 ) ) "textures/darkmod/stone/brick/blocks_brown" 0 0 0
+}
+}
+}
+textures/common/caulk//comment
+a/*comment*/b,c
+)";
+
+    auto [stringTokens, bufferTokens] = tokeniseWithBoth(testString);
+
+    EXPECT_FALSE(stringTokens.empty());
+    EXPECT_EQ(stringTokens, bufferTokens);
+}
+
+TEST(DefTokeniser, BufferTokeniserReferencesSourceBuffer)
+{
+    std::string testString = R"(  "quoted"  unquoted  )";
+    parser::BasicDefTokeniser<std::string_view> tokeniser(testString);
+
+    // Tokens without escape sequences should not be copied
+    auto quoted = tokeniser.nextTokenView();
+    EXPECT_EQ(quoted, "quoted");
+    EXPECT_EQ(quoted.data(), testString.data() + 3);
+
+    EXPECT_EQ(tokeniser.peek(), "unquoted");
+
+    auto unquoted = tokeniser.nextTokenView();
+    EXPECT_EQ(unquoted, "unquoted");
+    EXPECT_EQ(unquoted.data(), testString.data() + 12);
+
+    EXPECT_FALSE(tokeniser.hasMoreTokens());
+    EXPECT_THROW(tokeniser.nextTokenView(), parser::ParseException);
+}
+
 }
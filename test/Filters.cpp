@@ -4,6 +4,10 @@
 #include "scene/Node.h"
 #include "imap.h"
 #include "scenelib.h"
+#include "ieclass.h"
+#include "scene/EntityNode.h"
+#include "algorithm/Entity.h"
+#include "algorithm/Primitives.h"
 
 namespace test
 {
@@ -50,4 +54,187 @@ TEST_F(FilterTest, OnFiltersChangedInvoked)
     EXPECT_EQ(testNode->onFiltersChangedInvocationCount, 1) << "Node should have been notified";
 }
 
+TEST_F(FilterTest, WildcardRulesMatchLikeRegex)
+{
+    FilterRules rules;
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/.*", false));
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures(.*)decals(.*)", false));
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "^textures/darkmod/stone$", false));
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/test/(red|blue)", false));
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/common/caulk", true));
+
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("WildcardTest", rules));
+    GlobalFilterSystem().setFilterState("WildcardTest", true);
+
+    // Prefix pattern, with a literal rule showing one of its matches again
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/common/nodraw"));
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/common/"));
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/common/caulk"));
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/commons"));
+
+    // Wildcards in between
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/darkmod/decals/dirt"));
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "texturesdecals"));
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "models/decals/dirt"));
+
+    // Anchors and full match semantics
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/darkmod/stone"));
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/darkmod/stone2"));
+
+    // Expressions needing a real regex
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/test/red"));
+    EXPECT_FALSE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/test/blue"));
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/test/green"));
+
+    // The rules only apply to their own type
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_OBJECT, "textures/common/nodraw"));
+}
+
+TEST_F(FilterTest, InvalidRuleExpressionMatchesNothing)
+{
+    FilterRules rules;
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/(broken", false));
+
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("InvalidTest", rules));
+    GlobalFilterSystem().setFilterState("InvalidTest", true);
+
+    EXPECT_TRUE(GlobalFilterSystem().isVisible(FilterRule::TYPE_TEXTURE, "textures/(broken"));
+}
+
+TEST_F(FilterTest, EntityVisibilityFollowsSpawnargChanges)
+{
+    FilterRules rules;
+    rules.push_back(FilterRule::CreateEntityKeyValueRule("noshadows", "1", false));
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_ENTITYCLASS, "light_.*", false));
+
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("EntityTest", rules));
+    GlobalFilterSystem().setFilterState("EntityTest", true);
+
+    auto light = GlobalEntityModule().createEntity(GlobalEntityClassManager().findClass("light"));
+    auto& entity = light->getEntity();
+
+    EXPECT_TRUE(GlobalFilterSystem().isEntityVisible(FilterRule::TYPE_ENTITYCLASS, entity));
+    EXPECT_TRUE(GlobalFilterSystem().isEntityVisible(FilterRule::TYPE_ENTITYKEYVALUE, entity));
+
+    // The result for the previous value is cached, the changed value must be evaluated anew
+    entity.setKeyValue("noshadows", "1");
+    EXPECT_FALSE(GlobalFilterSystem().isEntityVisible(FilterRule::TYPE_ENTITYKEYVALUE, entity));
+
+    entity.setKeyValue("noshadows", "0");
+    EXPECT_TRUE(GlobalFilterSystem().isEntityVisible(FilterRule::TYPE_ENTITYKEYVALUE, entity));
+
+    // Changing the rules invalidates the cached results
+    rules.front() = FilterRule::CreateEntityKeyValueRule("noshadows", "0", false);
+    EXPECT_TRUE(GlobalFilterSystem().setFilterRules("EntityTest", rules));
+    EXPECT_FALSE(GlobalFilterSystem().isEntityVisible(FilterRule::TYPE_ENTITYKEYVALUE, entity));
+}
+
+
+TEST_F(FilterTest, ToggledFilterUpdatesMatchingEntities)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto brush = algorithm::createCubicBrush(worldspawn, { 0, 0, 0 }, "textures/numbers/1");
+
+    auto light = algorithm::createEntityByClassName("light");
+    auto funcStatic = algorithm::createEntityByClassName("func_static");
+    scene::addNodeToContainer(light, GlobalMapModule().getRoot());
+    scene::addNodeToContainer(funcStatic, GlobalMapModule().getRoot());
+
+    FilterRules rules;
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_ENTITYCLASS, "light", false));
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("LightTest", rules));
+
+    GlobalFilterSystem().setFilterState("LightTest", true);
+
+    EXPECT_TRUE(light->isFiltered()) << "The light should be hidden";
+    EXPECT_FALSE(funcStatic->isFiltered()) << "The func_static is not matched by the filter";
+    EXPECT_FALSE(worldspawn->isFiltered()) << "The worldspawn is not matched by the filter";
+    EXPECT_FALSE(brush->isFiltered()) << "The brush is not matched by the filter";
+
+    GlobalFilterSystem().setFilterState("LightTest", false);
+
+    EXPECT_FALSE(light->isFiltered()) << "The light should be visible again";
+}
+
+// Entities get spawnargs they don't carry themselves from their entityDef
+TEST_F(FilterTest, ToggledFilterMatchesInheritedSpawnargs)
+{
+    // atdm:ai_builder_guard inherits the scriptobject spawnarg from atdm:ai_base
+    auto guard = algorithm::createEntityByClassName("atdm:ai_builder_guard");
+    auto light = algorithm::createEntityByClassName("light");
+    scene::addNodeToContainer(guard, GlobalMapModule().getRoot());
+    scene::addNodeToContainer(light, GlobalMapModule().getRoot());
+
+    EXPECT_TRUE(guard->getEntity().isInherited("scriptobject")) << "Test entity should inherit the spawnarg";
+    EXPECT_EQ(guard->getEntity().getKeyValue("scriptobject"), "ai_darkmod_base");
+
+    FilterRules rules;
+    rules.push_back(FilterRule::CreateEntityKeyValueRule("scriptobject", "ai_darkmod_base", false));
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("ScriptObjectTest", rules));
+
+    GlobalFilterSystem().setFilterState("ScriptObjectTest", true);
+
+    EXPECT_TRUE(guard->isFiltered()) << "The AI should be hidden through its inherited spawnarg";
+    EXPECT_FALSE(light->isFiltered()) << "The light is not matched by the filter";
+
+    GlobalFilterSystem().setFilterState("ScriptObjectTest", false);
+
+    EXPECT_FALSE(guard->isFiltered()) << "The AI should be visible again";
+}
+
+TEST_F(FilterTest, SpawnargChangeRefiltersEntity)
+{
+    FilterRules rules;
+    rules.push_back(FilterRule::CreateEntityKeyValueRule("noshadows", "1", false));
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("NoShadowsTest", rules));
+    GlobalFilterSystem().setFilterState("NoShadowsTest", true);
+
+    auto light = algorithm::createEntityByClassName("light");
+    scene::addNodeToContainer(light, GlobalMapModule().getRoot());
+
+    EXPECT_FALSE(light->isFiltered()) << "The light doesn't have the spawnarg yet";
+
+    // No filter update is needed after changing the spawnargs
+    light->getEntity().setKeyValue("noshadows", "1");
+    EXPECT_TRUE(light->isFiltered()) << "The light should be hidden after setting the spawnarg";
+
+    light->getEntity().setKeyValue("noshadows", "0");
+    EXPECT_FALSE(light->isFiltered()) << "The light should be visible after changing the spawnarg";
+
+    light->getEntity().setKeyValue("noshadows", "1");
+    light->getEntity().setKeyValue("noshadows", "");
+    EXPECT_FALSE(light->isFiltered()) << "The light should be visible after removing the spawnarg";
+
+    // Spawnargs not referenced by any rule are not changing anything
+    light->getEntity().setKeyValue("noshadows", "1");
+    light->getEntity().setKeyValue("_color", "1 0 0");
+    EXPECT_TRUE(light->isFiltered()) << "The light should still be hidden";
+}
+
+TEST_F(FilterTest, TextureFilterFollowsMaterialChanges)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto brush = algorithm::createCubicBrush(worldspawn, { 0, 0, 0 }, "textures/numbers/1");
+    auto otherBrush = algorithm::createCubicBrush(worldspawn, { 128, 0, 0 }, "textures/numbers/3");
+
+    FilterRules rules;
+    rules.push_back(FilterRule::Create(FilterRule::TYPE_TEXTURE, "textures/numbers/2", false));
+    EXPECT_TRUE(GlobalFilterSystem().addFilter("NumberTest", rules));
+
+    GlobalFilterSystem().setFilterState("NumberTest", true);
+    EXPECT_FALSE(brush->isFiltered()) << "The brush is not using the filtered material";
+
+    GlobalFilterSystem().setFilterState("NumberTest", false);
+
+    // Assign the material while the filter is inactive, the next toggle must pick it up
+    Node_getIBrush(brush)->setShader("textures/numbers/2");
+
+    GlobalFilterSystem().setFilterState("NumberTest", true);
+    EXPECT_TRUE(brush->isFiltered()) << "The brush should be hidden after changing its material";
+    EXPECT_FALSE(otherBrush->isFiltered()) << "The other brush should be unaffected";
+
+    GlobalFilterSystem().setFilterState("NumberTest", false);
+    EXPECT_FALSE(brush->isFiltered()) << "The brush should be visible again";
+}
+
 }
@@ -398,6 +398,205 @@ TEST(GeometryStore, FrameBufferSwitching)
     EXPECT_GT(deallocationCount, 0) << "No deallocation operations performed";
 }
 
+// Checks that the buffer objects of the current frame contain the same data as the client memory
+inline void verifyBufferObjectContents(render::GeometryStore& store, const std::vector<Allocation>& allocations)
+{
+    auto [vertexBufferObject, indexBufferObject] = store.getBufferObjects();
+    const auto& vertexBuffer = std::static_pointer_cast<TestBufferObject>(vertexBufferObject)->buffer;
+    const auto& indexBuffer = std::static_pointer_cast<TestBufferObject>(indexBufferObject)->buffer;
+
+    for (const auto& allocation : allocations)
+    {
+        auto renderParms = store.getBufferAddresses(allocation.slot);
+
+        auto vertexByteOffset = renderParms.firstVertex * sizeof(render::RenderVertex);
+        auto vertexByteCount = allocation.vertices.size() * sizeof(render::RenderVertex);
+        auto clientVertices = reinterpret_cast<const unsigned char*>(renderParms.clientBufferStart + renderParms.firstVertex);
+
+        ASSERT_LE(vertexByteOffset + vertexByteCount, vertexBuffer.size()) << "Vertex buffer object too small";
+        EXPECT_TRUE(std::equal(clientVertices, clientVertices + vertexByteCount, vertexBuffer.begin() + vertexByteOffset))
+            << "Vertex buffer object is out of sync";
+
+        auto indexByteOffset = reinterpret_cast<std::uintptr_t>(renderParms.firstIndex);
+        auto indexByteCount = renderParms.indexCount * sizeof(unsigned int);
+        auto clientIndices = reinterpret_cast<const unsigned char*>(renderParms.clientFirstIndex);
+
+        ASSERT_LE(indexByteOffset + indexByteCount, indexBuffer.size()) << "Index buffer object too small";
+        EXPECT_TRUE(std::equal(clientIndices, clientIndices + indexByteCount, indexBuffer.begin() + indexByteOffset))
+            << "Index buffer object is out of sync";
+    }
+}
+
+TEST(GeometryStore, NumberOfFrameBuffers)
+{
+    EXPECT_EQ(render::GeometryStore(TestSyncObjectProvider::Instance(), _testBufferObjectProvider).getNumFrameBuffers(),
+        render::GeometryStore::DefaultNumFrameBuffers);
+    EXPECT_EQ(render::GeometryStore(TestSyncObjectProvider::Instance(), _testBufferObjectProvider, 0).getNumFrameBuffers(), 1);
+    EXPECT_EQ(render::GeometryStore(TestSyncObjectProvider::Instance(), _testBufferObjectProvider, 3).getNumFrameBuffers(), 3);
+    EXPECT_EQ(render::GeometryStore(TestSyncObjectProvider::Instance(), _testBufferObjectProvider, 10).getNumFrameBuffers(),
+        render::GeometryStore::MaxNumFrameBuffers);
+}
+
+// Modifications applied in one frame need to be replayed to all the other frame buffers
+TEST(GeometryStore, MultiBufferTransactionReplay)
+{
+    for (std::size_t numFrameBuffers = 1; numFrameBuffers <= render::GeometryStore::MaxNumFrameBuffers; ++numFrameBuffers)
+    {
+        render::GeometryStore store(TestSyncObjectProvider::Instance(), _testBufferObjectProvider, numFrameBuffers);
+
+        std::vector<Allocation> allocations;
+        std::minstd_rand rand(23); // fixed seed
+
+        for (auto frame = 0; frame < 30; ++frame)
+        {
+            store.onFrameStart();
+
+            // The newly active buffer must have received the changes of all the previous frames
+            verifyAllAllocations(store, allocations);
+
+            // Every frame is touching just a few slots, so most of the data needs to be replayed
+            switch (frame % 5)
+            {
+            case 0: // allocate a new slot
+            {
+                auto vertices = generateVertices(frame, 20 + rand() % 80);
+                auto indices = generateIndices(vertices);
+
+                auto slot = store.allocateSlot(vertices.size(), indices.size());
+                store.updateData(slot, vertices, indices);
+                allocations.emplace_back(Allocation{ slot, vertices, indices });
+                break;
+            }
+
+            case 1: // replace the data of one slot
+            {
+                auto& allocation = allocations[rand() % allocations.size()];
+
+                allocation.vertices = generateVertices(frame, allocation.vertices.size());
+                allocation.indices = generateIndices(allocation.vertices);
+                store.updateData(allocation.slot, allocation.vertices, allocation.indices);
+                break;
+            }
+
+            case 2: // overwrite a part of one slot
+            {
+                auto& allocation = allocations[rand() % allocations.size()];
+
+                auto newVertices = generateVertices(frame, allocation.vertices.size() / 2);
+                auto newIndices = generateIndices(newVertices);
+                auto offset = allocation.vertices.size() - newVertices.size();
+
+                std::copy(newVertices.begin(), newVertices.end(), allocation.vertices.begin() + offset);
+                std::copy(newIndices.begin(), newIndices.end(), allocation.indices.begin());
+                store.updateSubData(allocation.slot, offset, newVertices, 0, newIndices);
+                break;
+            }
+
+            case 3: // shrink one slot
+            {
+                auto& allocation = allocations[rand() % allocations.size()];
+
+                if (allocation.vertices.size() < 10) break;
+
+                allocation.vertices.resize(allocation.vertices.size() - 5);
+                allocation.indices = generateIndices(allocation.vertices);
+                store.resizeData(allocation.slot, allocation.vertices.size(), allocation.indices.size());
+                store.updateData(allocation.slot, allocation.vertices, allocation.indices);
+                break;
+            }
+
+            case 4: // release the oldest slot
+                if (allocations.size() > 1)
+                {
+                    store.deallocateSlot(allocations.front().slot);
+                    allocations.erase(allocations.begin());
+                }
+                break;
+            }
+
+            verifyAllAllocations(store, allocations);
+
+            // Upload to the buffer objects of this frame, which should then match the client data
+            store.syncToBufferObjects();
+            verifyBufferObjectContents(store, allocations);
+
+            store.onFrameFinished();
+        }
+
+        // Cycle through all buffers without any modifications, each of them needs to be up to date
+        for (std::size_t i = 0; i < numFrameBuffers; ++i)
+        {
+            store.onFrameStart();
+            verifyAllAllocations(store, allocations);
+            store.syncToBufferObjects();
+            verifyBufferObjectContents(store, allocations);
+            store.onFrameFinished();
+        }
+    }
+}
+
+TEST(GeometryStore, CompactAllFrameBuffers)
+{
+    render::GeometryStore store(TestSyncObjectProvider::Instance(), _testBufferObjectProvider, 3);
+
+    std::vector<Allocation> allocations;
+
+    store.onFrameStart();
+
+    for (auto i = 0; i < 20; ++i)
+    {
+        auto vertices = generateVertices(i, 10 + i * 3);
+        auto indices = generateIndices(vertices);
+
+        auto slot = store.allocateSlot(vertices.size(), indices.size());
+        store.updateData(slot, vertices, indices);
+        allocations.emplace_back(Allocation{ slot, vertices, indices });
+    }
+
+    store.onFrameFinished();
+
+    // Release every other slot in the next frame, leaving lots of gaps
+    store.onFrameStart();
+
+    std::vector<Allocation> remaining;
+
+    for (std::size_t i = 0; i < allocations.size(); i += 2)
+    {
+        store.deallocateSlot(allocations[i].slot);
+
+        if (i + 1 < allocations.size())
+        {
+            remaining.emplace_back(allocations[i + 1]);
+        }
+    }
+
+    allocations.swap(remaining);
+
+    store.onFrameFinished();
+
+    // Defragment, then change one of the slots
+    store.compact();
+
+    store.onFrameStart();
+
+    auto& changed = allocations.front();
+    changed.vertices = generateVertices(99, changed.vertices.size());
+    changed.indices = generateIndices(changed.vertices);
+    store.updateData(changed.slot, changed.vertices, changed.indices);
+
+    store.onFrameFinished();
+
+    // All frame buffers should contain the compacted data, including the change
+    for (auto i = 0; i < 3; ++i)
+    {
+        store.onFrameStart();
+        verifyAllAllocations(store, allocations);
+        store.syncToBufferObjects();
+        verifyBufferObjectContents(store, allocations);
+        store.onFrameFinished();
+    }
+}
+
 TEST(GeometryStore, SyncObjectAcquisition)
 {
     render::GeometryStore store(TestSyncObjectProvider::Instance(), _testBufferObjectProvider);
@@ -2,6 +2,9 @@
 
 #include "iimage.h"
 #include "RGBAImage.h"
+#include "testutil/TemporaryFile.h"
+#include <fstream>
+#include <iterator>
 
 // Helpers for examining pixel data
 using RGB8 = BasicVector3<uint8_t>;
@@ -97,6 +100,31 @@ TEST_F(ImageLoadingTest, LoadPngGreyscaleWithAlpha)
     }
 }
 
+// The image loaders read from buffers without null terminator, truncated
+// files must not make them read past the end of the data
+TEST_F(ImageLoadingTest, LoadTruncatedImages)
+{
+    auto loadTruncated = [&](const std::string& path, const std::string& tempName)
+    {
+        std::ifstream input(_context.getTestProjectPath() + path, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        TemporaryFile tempFile(_context.getTemporaryDataPath() + tempName,
+            contents.substr(0, contents.size() / 2));
+
+        return GlobalImageLoader().imageFromFile(_context.getTemporaryDataPath() + tempName);
+    };
+
+    // libpng reports the missing data as error, no image is returned
+    EXPECT_FALSE(loadTruncated("textures/pngs/twentyone_8bit.png", "truncated.png"));
+
+    // The TGA decoder fills the missing pixels with zeros
+    auto tga = loadTruncated("textures/a_1024x512.tga", "truncated.tga");
+    ASSERT_TRUE(tga);
+    EXPECT_EQ(tga->getWidth(), 1024);
+    EXPECT_EQ(tga->getHeight(), 512);
+}
+
 TEST_F(ImageLoadingTest, LoadInvalidDDS)
 {
     auto img = loadImage("textures/dds/not_a_dds.dds");
@@ -1,6 +1,8 @@
 #include "RadiantTest.h"
 
 #include <fstream>
+#include <sstream>
+#include <regex>
 #include "iundo.h"
 #include "imap.h"
 #include "imapformat.h"
@@ -8,6 +10,7 @@
 #include "imapresource.h"
 #include "ifilesystem.h"
 #include "iradiant.h"
+#include "ilogwriter.h"
 #include "iselectiongroup.h"
 #include "ilightnode.h"
 #include "icommandsystem.h"
@@ -21,10 +24,12 @@
 #include "algorithm/XmlUtils.h"
 #include "algorithm/Primitives.h"
 #include "os/file.h"
+#include "string/replace.h"
 #include <sigc++/connection.h>
 #include "testutil/FileSelectionHelper.h"
 #include "testutil/FileSaveConfirmationHelper.h"
 #include "registry/registry.h"
+#include "scene/Traverse.h"
 #include "testutil/TemporaryFile.h"
 
 using namespace std::chrono_literals;
@@ -455,6 +460,232 @@ TEST_F(MapLoadingTest, loadMapxInResourceOnly)
     checkAltarScene(resource->getRootNode());
 }
 
+namespace
+{
+
+// Loads the given map into a MapResource and exports the resulting scene to a string
+std::string loadMapResourceAndExport(const std::string& modRelativePath)
+{
+    auto resource = GlobalMapResourceManager().createFromPath(modRelativePath);
+    EXPECT_TRUE(resource->load()) << "Test map not found: " << modRelativePath;
+
+    auto format = GlobalMapFormatManager().getMapFormatForGameType("doom3", "map");
+    auto writer = format->getMapWriter();
+
+    std::ostringstream output;
+
+    {
+        auto exporter = GlobalMapModule().createMapExporter(*writer, resource->getRootNode(), output);
+        exporter->exportMap(resource->getRootNode(), scene::traverse);
+    }
+
+    return output.str();
+}
+
+}
+
+namespace
+{
+
+// Writes a map with the given number of func_statics, each of them holding a few
+// brushes and a patch, spread over enough primitive batches to keep several workers busy
+std::string generateMapWithManyPrimitives(std::size_t numEntities)
+{
+    std::ostringstream map;
+
+    map << "Version 2" << std::endl;
+    map << "{" << std::endl << "\"classname\" \"worldspawn\"" << std::endl << "}" << std::endl;
+
+    for (std::size_t e = 0; e < numEntities; ++e)
+    {
+        map << "{" << std::endl;
+        map << "\"classname\" \"func_static\"" << std::endl;
+        map << "\"name\" \"static_" << e << "\"" << std::endl;
+
+        for (std::size_t b = 0; b < 4; ++b)
+        {
+            auto x = static_cast<int>(e * 64);
+            auto z = static_cast<int>(b * 32);
+
+            map << "{" << std::endl << "brushDef3" << std::endl << "{" << std::endl;
+            map << "( 0 0 1 " << -(z + 16) << " ) ( ( 0.03125 0 0 ) ( 0 0.03125 0 ) ) \"textures/numbers/1\" 0 0 0" << std::endl;
+            map << "( 0 0 -1 " << z << " ) ( ( 0.03125 0 0 ) ( 0 0.03125 0 ) ) \"textures/numbers/2\" 0 0 0" << std::endl;
+            map << "( 1 0 0 " << -(x + 16) << " ) ( ( 0.03125 0 0 ) ( 0 0.03125 0 ) ) \"textures/numbers/3\" 0 0 0" << std::endl;
+            map << "( -1 0 0 " << x << " ) ( ( 0.03125 0 0 ) ( 0 0.03125 0 ) ) \"textures/numbers/4\" 0 0 0" << std::endl;
+            map << "( 0 1 0 -16 ) ( ( 0.03125 0 0 ) ( 0 0.03125 0 ) ) \"textures/numbers/5\" 0 0 0" << std::endl;
+            map << "( 0 -1 0 0 ) ( ( 0.03125 0 0 ) ( 0 0.03125 0 ) ) \"textures/numbers/6\" 0 0 0" << std::endl;
+            map << "}" << std::endl << "}" << std::endl;
+        }
+
+        map << "{" << std::endl << "patchDef2" << std::endl << "{" << std::endl;
+        map << "\"textures/numbers/7\"" << std::endl << "( 3 3 0 0 0 )" << std::endl << "(" << std::endl;
+
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            map << "( ";
+
+            for (std::size_t r = 0; r < 3; ++r)
+            {
+                map << "( " << e * 64 + c * 8 << " " << r * 8 << " 160 " << c * 0.5 << " " << r * 0.5 << " ) ";
+            }
+
+            map << ")" << std::endl;
+        }
+
+        map << ")" << std::endl << "}" << std::endl << "}" << std::endl;
+        map << "}" << std::endl;
+    }
+
+    return map.str();
+}
+
+// Collects the messages of the map reader reporting the number of processed batches
+class PrimitiveBatchLog :
+    public applog::ILogDevice
+{
+private:
+    std::string _buffer;
+
+public:
+    std::vector<std::size_t> batchCounts;
+
+    void writeLog(const std::string& outputStr, applog::LogLevel level) override
+    {
+        _buffer.append(outputStr);
+
+        std::size_t lineEnd;
+
+        while ((lineEnd = _buffer.find('\n')) != std::string::npos)
+        {
+            std::smatch match;
+            auto line = _buffer.substr(0, lineEnd);
+            _buffer.erase(0, lineEnd + 1);
+
+            if (std::regex_search(line, match, std::regex("\\[mapdoom3\\] Tokenised \\d+ primitives in (\\d+) batches")))
+            {
+                batchCounts.push_back(std::stoul(match[1].str()));
+            }
+        }
+    }
+};
+
+}
+
+// The parallel map parser must produce the same scene as the single-threaded one
+TEST_F(MapLoadingTest, parallelLoadingProducesSameScene)
+{
+    // 5 primitives per entity, ample batches for any number of worker threads
+    fs::path mapPath = _context.getTemporaryDataPath();
+    mapPath /= "parallel_loading.map";
+    TemporaryFile mapFile(mapPath.string(), generateMapWithManyPrimitives(2000));
+
+    std::string serialResult;
+    std::string parallelResult;
+
+    {
+        registry::ScopedKeyChanger<bool> changer(RKEY_MAP_PARALLEL_LOADING, false);
+        serialResult = loadMapResourceAndExport(mapPath.string());
+    }
+
+    PrimitiveBatchLog batchLog;
+    GlobalRadiantCore().getLogWriter().attach(&batchLog);
+
+    {
+        registry::ScopedKeyChanger<bool> changer(RKEY_MAP_PARALLEL_LOADING, true);
+        parallelResult = loadMapResourceAndExport(mapPath.string());
+    }
+
+    GlobalRadiantCore().getLogWriter().detach(&batchLog);
+
+    ASSERT_EQ(batchLog.batchCounts.size(), 1) << "The parallel map reader has not been used";
+    EXPECT_GT(batchLog.batchCounts.front(), 1) << "Expected the primitives to be split into several batches";
+
+    EXPECT_NE(serialResult.find("brushDef3"), std::string::npos) << "Serial load produced no brushes";
+    EXPECT_NE(serialResult.find("patchDef2"), std::string::npos) << "Serial load produced no patches";
+    EXPECT_EQ(serialResult, parallelResult) << "Parallel load produced a different scene";
+}
+
+namespace
+{
+
+// Replaces all occurrences of the given string in the file with one of the same length
+void replaceInFile(const fs::path& path, const std::string& search, const std::string& replacement)
+{
+    std::string contents;
+
+    {
+        std::ifstream input(path.string(), std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    EXPECT_NE(contents.find(search), std::string::npos) << search << " not found in " << path;
+    string::replace_all(contents, search, replacement);
+
+    std::ofstream output(path.string(), std::ios::binary);
+    output << contents;
+}
+
+}
+
+TEST_F(MapLoadingTest, binaryMapCacheProducesSameScene)
+{
+    registry::ScopedKeyChanger<bool> changer(RKEY_MAP_BINARY_CACHE, true);
+
+    auto mapPath = createMapCopyInTempDataPath("altar.map", "altar_binaryMapCache.map");
+    auto cachePath = fs::path(mapPath).replace_extension("mapcache");
+    fs::remove(cachePath);
+
+    // The first load is parsing the map file, the cache is written afterwards
+    auto parsedResult = loadMapResourceAndExport(mapPath.string());
+    EXPECT_TRUE(fs::exists(cachePath)) << "No map cache has been written";
+
+    // The second load is using the cache, the info file still applies
+    auto resource = GlobalMapResourceManager().createFromPath(mapPath.string());
+    EXPECT_TRUE(resource->load());
+    checkAltarScene(resource->getRootNode());
+
+    auto cachedResult = loadMapResourceAndExport(mapPath.string());
+    EXPECT_EQ(parsedResult, cachedResult) << "Cached load produced a different scene";
+
+    // Rename a material in the cache's string table to see that the cache is really used
+    replaceInFile(cachePath, "textures/tiles01", "textures/tiles02");
+
+    resource = GlobalMapResourceManager().createFromPath(mapPath.string());
+    EXPECT_TRUE(resource->load());
+    EXPECT_TRUE(algorithm::findFirstNode(resource->getRootNode(), algorithm::brushHasMaterial("textures/tiles02")))
+        << "The map cache has not been used";
+
+    fs::remove(cachePath);
+}
+
+TEST_F(MapLoadingTest, outdatedBinaryMapCacheIsIgnored)
+{
+    registry::ScopedKeyChanger<bool> changer(RKEY_MAP_BINARY_CACHE, true);
+
+    auto mapPath = createMapCopyInTempDataPath("altar.map", "altar_outdatedMapCache.map");
+    auto cachePath = fs::path(mapPath).replace_extension("mapcache");
+    fs::remove(cachePath);
+
+    loadMapResourceAndExport(mapPath.string());
+    EXPECT_TRUE(fs::exists(cachePath)) << "No map cache has been written";
+
+    // Change the map file without changing its size, only the hash tells the difference
+    replaceInFile(mapPath, "textures/tiles01", "textures/tiles02");
+
+    auto resource = GlobalMapResourceManager().createFromPath(mapPath.string());
+    EXPECT_TRUE(resource->load());
+    EXPECT_TRUE(algorithm::findFirstNode(resource->getRootNode(), algorithm::brushHasMaterial("textures/tiles02")))
+        << "The outdated map cache has been used";
+    EXPECT_FALSE(algorithm::findFirstNode(resource->getRootNode(), algorithm::brushHasMaterial("textures/tiles01")));
+
+    // The cache has been replaced with one matching the changed file
+    resource = GlobalMapResourceManager().createFromPath(mapPath.string());
+    EXPECT_TRUE(resource->load());
+    EXPECT_TRUE(algorithm::findFirstNode(resource->getRootNode(), algorithm::brushHasMaterial("textures/tiles02")));
+
+    fs::remove(cachePath);
+}
+
 TEST_F(MapSavingTest, saveMapWithoutModification)
 {
     auto tempPath = createMapCopyInTempDataPath("altar.map", "altar_saveMapWithoutModification.map");
@@ -1261,6 +1492,7 @@ TEST_F(MapSavingTest, AutoSaveSnapshotsSupportRelativePaths)
 
     // Trigger an auto save now
     GlobalAutoSaver().performAutosave();
+    GlobalAutoSaver().waitForPendingSave();
 
     EXPECT_TRUE(GlobalFileSystem().openTextFile(expectedSnapshotPath)) << "Snapshot should now exist in " << expectedSnapshotPath;
     
@@ -1296,6 +1528,7 @@ TEST_F(MapSavingTest, AutoSaveSnapshotsSupportAbsolutePaths)
 
     // Trigger an auto save now
     GlobalAutoSaver().performAutosave();
+    GlobalAutoSaver().waitForPendingSave();
 
     EXPECT_TRUE(GlobalFileSystem().openTextFileInAbsolutePath(expectedSnapshotPath)) << "Snapshot should now exist in " << expectedSnapshotPath;
 
@@ -1307,6 +1540,43 @@ TEST_F(MapSavingTest, AutoSaveSnapshotsSupportAbsolutePaths)
     fs::remove(expectedSnapshotPath);
 }
 
+// The autosave files are written in the background, the content must be the same as a regular save
+TEST_F(MapSavingTest, BackgroundAutoSaveMatchesForegroundSave)
+{
+    GlobalCommandSystem().executeCommand("OpenMap", std::string("maps/altar.map"));
+    checkAltarScene();
+
+    auto snapshotFolder = _context.getTemporaryDataPath() + "backgroundsnapshots/";
+    registry::setValue(map::RKEY_AUTOSAVE_SNAPSHOTS_ENABLED, true);
+    registry::setValue(map::RKEY_AUTOSAVE_SNAPSHOTS_FOLDER, snapshotFolder);
+
+    fs::path foregroundPath = _context.getTemporaryDataPath();
+    foregroundPath /= "altar_foreground.map";
+
+    GlobalCommandSystem().executeCommand("SaveAutomaticBackup", foregroundPath.string());
+    GlobalAutoSaver().performAutosave();
+
+    // Changing the scene while the snapshot is written must not affect the file
+    algorithm::createCubicBrush(GlobalMapModule().findOrInsertWorldspawn(), Vector3(512, 0, 0), "textures/numbers/1");
+
+    GlobalAutoSaver().waitForPendingSave();
+
+    fs::path snapshotPath = snapshotFolder + "altar.0.map";
+    EXPECT_TRUE(fs::exists(snapshotPath)) << "Snapshot should now exist in " << snapshotPath;
+
+    EXPECT_EQ(algorithm::loadFileToString(snapshotPath), algorithm::loadFileToString(foregroundPath))
+        << "The autosaved map differs from the regular save";
+    EXPECT_EQ(algorithm::loadFileToString(os::replaceExtension(snapshotPath.string(), "darkradiant")),
+        algorithm::loadFileToString(os::replaceExtension(foregroundPath.string(), "darkradiant")))
+        << "The autosaved info file differs from the regular save";
+
+    for (const auto& path : { snapshotPath, foregroundPath })
+    {
+        fs::remove(os::replaceExtension(path.string(), "darkradiant"));
+        fs::remove(path);
+    }
+}
+
 namespace
 {
 
@@ -1660,4 +1930,96 @@ TEST_F(MapSavingTest, EscapeCharactersInEntityKeyValues)
     EXPECT_EQ(savedContent, mapContent) << "Failed to serialise quoted entity key values";
 }
 
+
+namespace
+{
+
+// Exports the current map's scene to a string, using the Doom 3 map format
+std::string exportCurrentMap()
+{
+    auto format = GlobalMapFormatManager().getMapFormatForGameType("doom3", "map");
+    auto writer = format->getMapWriter();
+
+    std::ostringstream output;
+
+    {
+        auto exporter = GlobalMapModule().createMapExporter(*writer, GlobalMapModule().getRoot(), output);
+        exporter->exportMap(GlobalMapModule().getRoot(), scene::traverse);
+    }
+
+    return output.str();
+}
+
+// Formats the number the way std::ostream does with the game's float precision
+std::string formatLikeStream(double value)
+{
+    std::ostringstream stream;
+    stream.precision(16);
+    stream << (value == 0 ? 0.0 : value); // -0 is written as 0
+
+    return stream.str();
+}
+
+}
+
+// Large entities are written on several threads, the output must be the same
+TEST_F(MapSavingTest, ParallelSavingProducesSameOutput)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        algorithm::createCubicBrush(worldspawn, Vector3(i * 64.1, 0.3, -0.7), "textures/numbers/1");
+
+        if (i % 10 == 0)
+        {
+            algorithm::createPatchFromBounds(worldspawn, AABB(Vector3(i * 64.1, 128.3, 0.7), Vector3(16.1, 32, 8)));
+        }
+    }
+
+    std::string serialResult;
+    std::string parallelResult;
+
+    {
+        registry::ScopedKeyChanger<bool> changer(RKEY_MAP_PARALLEL_SAVING, false);
+        serialResult = exportCurrentMap();
+    }
+
+    {
+        registry::ScopedKeyChanger<bool> changer(RKEY_MAP_PARALLEL_SAVING, true);
+        parallelResult = exportCurrentMap();
+    }
+
+    EXPECT_NE(serialResult.find("// primitive 1099\n"), std::string::npos) << "Not all primitives written";
+    EXPECT_NE(serialResult.find("patchDef2"), std::string::npos) << "Patches have not been written";
+    EXPECT_EQ(serialResult, parallelResult) << "Parallel saving produced a different output";
+}
+
+// The numbers must be written exactly as the stream-based formatting did
+TEST_F(MapSavingTest, SavedNumbersMatchStreamFormatting)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto brush = algorithm::createCubicBrush(worldspawn, Vector3(0.1, -0.3, 1.0 / 3), "textures/numbers/1");
+
+    auto* ibrush = Node_getIBrush(brush);
+    ibrush->evaluateBRep();
+
+    auto output = exportCurrentMap();
+
+    for (std::size_t i = 0; i < ibrush->getNumFaces(); ++i)
+    {
+        const auto& face = ibrush->getFace(i);
+        const auto& plane = face.getPlane3();
+        auto texdef = face.getProjectionMatrix();
+
+        auto expected = "( " + formatLikeStream(plane.normal().x()) + " " + formatLikeStream(plane.normal().y()) + " " +
+            formatLikeStream(plane.normal().z()) + " " + formatLikeStream(-plane.dist()) + " ) ( ( " +
+            formatLikeStream(texdef.xx()) + " " + formatLikeStream(texdef.yx()) + " " + formatLikeStream(texdef.zx()) + " ) ( " +
+            formatLikeStream(texdef.xy()) + " " + formatLikeStream(texdef.yy()) + " " + formatLikeStream(texdef.zy()) + " ) ) " +
+            "\"textures/numbers/1\" 0 0 0\n";
+
+        EXPECT_NE(output.find(expected), std::string::npos) << "Face not written as expected: " << expected;
+    }
+}
+
 }
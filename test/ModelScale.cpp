@@ -1,14 +1,20 @@
 #include "RadiantTest.h"
 
 #include "algorithm/Scene.h"
+#include "algorithm/Models.h"
 #include "iscenegraph.h"
 #include "imodel.h"
+#include "imodelcache.h"
+#include "imap.h"
 #include "itransformable.h"
 #include "icommandsystem.h"
 #include "iselectable.h"
 #include "iselection.h"
 #include "math/Vector3.h"
 #include "registry/registry.h"
+#include <functional>
+#include <mutex>
+#include <vector>
 
 namespace test
 {
@@ -60,4 +66,67 @@ TEST_F(RadiantTest, DuplicateScaledModel)
     ASSERT_TRUE(duplicatedModel->getModelScale() == scale);
 }
 
+// Models loaded in the background are represented by a placeholder right after
+// loading the map, the saved scale must be applied once the actual model is there
+TEST_F(RadiantTest, RestoreModelScaleAfterBackgroundLoad)
+{
+    registry::ScopedKeyChanger<bool> parallelLoading(RKEY_MAP_PARALLEL_LOADING, true);
+
+    // Collect the actions meant for the main thread, to run them after the map is loaded
+    std::mutex actionsLock;
+    std::vector<std::function<void()>> actions;
+
+    GlobalModelCache().setMainThreadDispatcher([&](const std::function<void()>& action)
+    {
+        std::lock_guard<std::mutex> lock(actionsLock);
+        actions.push_back(action);
+    });
+
+    // Hold the model back until the map is loaded
+    algorithm::ScopedBlockingModelImporter importer("ase");
+
+    loadMap("restore_model_scale.map");
+
+    auto func_static = algorithm::getEntityByName(GlobalSceneGraph().root(), "moss01");
+    ASSERT_TRUE(func_static);
+
+    auto model = algorithm::findChildModel(func_static);
+    ASSERT_TRUE(model);
+    EXPECT_EQ(model->getIModel().getPolyCount(), 0) << "Expected the placeholder";
+
+    // The placeholder can't be scaled, the spawnarg must not be lost
+    EXPECT_EQ(Node_getEntity(func_static)->getKeyValue("editor_modelScale"), "3 4 2")
+        << "Saved scale removed before the model was available";
+
+    // The missing model is not known to be missing before its load has failed
+    auto missing = algorithm::getEntityByName(GlobalSceneGraph().root(), "missing01");
+    ASSERT_TRUE(missing);
+    EXPECT_EQ(Node_getEntity(missing)->getKeyValue("editor_modelScale"), "2 2 2");
+
+    importer.release();
+    GlobalModelCache().waitForBackgroundLoads();
+
+    EXPECT_EQ(Node_getEntity(func_static)->getKeyValue("editor_modelScale"), "3 4 2")
+        << "Saved scale removed before the model has been announced";
+
+    for (const auto& action : actions)
+    {
+        action();
+    }
+
+    model = algorithm::findChildModel(func_static);
+    ASSERT_TRUE(model);
+    EXPECT_EQ(model->getIModel().getModelPath(), "models/moss_patch.ase");
+    EXPECT_TRUE(model->hasModifiedScale()) << "Model scale has not been restored";
+    EXPECT_EQ(model->getModelScale(), Vector3(3, 4, 2));
+    EXPECT_EQ(Node_getEntity(func_static)->getKeyValue("editor_modelScale"), "")
+        << "Saved scale should be removed after restoring it";
+
+    // The failed model is not waited for anymore, its scale is dropped like before
+    EXPECT_EQ(Node_getEntity(missing)->getKeyValue("editor_modelScale"), "")
+        << "Saved scale of the missing model should be removed";
+
+    GlobalModelCache().setMainThreadDispatcher({});
+}
+
 }
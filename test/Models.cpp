@@ -1,15 +1,27 @@
 #include "RadiantTest.h"
 
 #include <unordered_set>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <algorithm>
 #include "imodelsurface.h"
+#include "itraceable.h"
 #include "imodelcache.h"
+#include "ifilesystem.h"
 #include "scenelib.h"
 #include "algorithm/Entity.h"
 #include "algorithm/FileUtils.h"
 #include "algorithm/Scene.h"
+#include "algorithm/Models.h"
 #include "os/file.h"
 
 #include "render/VertexHashing.h"
+#include "render/MeshBVH.h"
+#include "math/Frustum.h"
 #include "string/replace.h"
 
 namespace test
@@ -710,4 +722,518 @@ TEST_F(ObjImportTest, UseMtlReferencingMaterial)
         << "OBJ Model loader should have taken the material from the usemtl keyword";
 }
 
+namespace
+{
+
+// Creates a bumpy sphere around the origin with 2 * segments * rings triangles
+void createSphereMesh(std::size_t segments, std::size_t rings, std::vector<MeshVertex>& vertices, std::vector<unsigned int>& indices)
+{
+    for (std::size_t ring = 0; ring <= rings; ++ring)
+    {
+        auto theta = math::PI * ring / rings;
+
+        for (std::size_t segment = 0; segment <= segments; ++segment)
+        {
+            auto phi = 2 * math::PI * segment / segments;
+            auto radius = 100 + 5 * sin(phi * 7) * sin(theta * 5);
+
+            Vector3 normal(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+            vertices.emplace_back(normal * radius, normal, TexCoord2f(0, 0));
+        }
+    }
+
+    for (std::size_t ring = 0; ring < rings; ++ring)
+    {
+        for (std::size_t segment = 0; segment < segments; ++segment)
+        {
+            auto first = static_cast<unsigned int>(ring * (segments + 1) + segment);
+            auto second = static_cast<unsigned int>(first + segments + 1);
+
+            indices.insert(indices.end(), { first, second, first + 1 });
+            indices.insert(indices.end(), { second, second + 1, first + 1 });
+        }
+    }
+}
+
+// The brute-force intersection of a ray with every triangle, transformed to world space
+bool getBruteForceIntersection(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices,
+    const Ray& ray, const Matrix4& localToWorld, Vector3& intersection)
+{
+    auto bestDistSquared = 0.0;
+    Vector3 triIntersection;
+
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        if (ray.intersectTriangle(localToWorld.transformPoint(vertices[indices[i]].vertex),
+            localToWorld.transformPoint(vertices[indices[i + 1]].vertex),
+            localToWorld.transformPoint(vertices[indices[i + 2]].vertex), triIntersection) != Ray::POINT)
+        {
+            continue;
+        }
+
+        auto distSquared = (triIntersection - ray.origin).getLengthSquared();
+
+        if (distSquared > 0 && (bestDistSquared == 0 || distSquared < bestDistSquared))
+        {
+            bestDistSquared = distSquared;
+            intersection = triIntersection;
+        }
+    }
+
+    return bestDistSquared > 0;
+}
+
+// Rays starting outside the given radius, aiming at points around the origin, some of them missing
+std::vector<Ray> createRandomRays(std::size_t count, double radius, const Matrix4& localToWorld)
+{
+    std::minstd_rand rand(17);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+
+    std::vector<Ray> rays;
+
+    while (rays.size() < count)
+    {
+        Vector3 start(distribution(rand), distribution(rand), distribution(rand));
+
+        if (start.getLengthSquared() < 0.01) continue;
+
+        Vector3 target(distribution(rand), distribution(rand), distribution(rand));
+
+        rays.emplace_back(Ray::createForPoints(localToWorld.transformPoint(start.getNormalised() * radius * 3),
+            localToWorld.transformPoint(target * radius * 1.2)));
+    }
+
+    return rays;
+}
+
+}
+
+TEST_F(ModelTest, MeshBVHIntersectionMatchesBruteForce)
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+    createSphereMesh(64, 32, vertices, indices);
+
+    render::MeshBVH bvh(vertices, indices);
+    EXPECT_FALSE(bvh.isEmpty());
+
+    auto localToWorld = Matrix4::getTranslation(Vector3(300, -40, 128));
+    localToWorld.multiplyBy(Matrix4::getRotationForEulerXYZDegrees(Vector3(10, 35, 70)));
+    localToWorld.multiplyBy(Matrix4::getScale(Vector3(1.5, 0.75, 2)));
+
+    auto worldToLocal = localToWorld.getFullInverse();
+    std::size_t numHits = 0;
+
+    for (const auto& ray : createRandomRays(500, 100, localToWorld))
+    {
+        Vector3 expected;
+        auto expectedHit = getBruteForceIntersection(vertices, indices, ray, localToWorld, expected);
+
+        Ray localRay(ray);
+        localRay.transform(worldToLocal);
+
+        Vector3 localIntersection;
+        auto hit = bvh.getIntersection(vertices, localRay, localIntersection);
+
+        EXPECT_EQ(hit, expectedHit) << "Hit mismatch for ray starting at " << ray.origin;
+
+        if (hit && expectedHit)
+        {
+            ++numHits;
+            auto intersection = localToWorld.transformPoint(localIntersection);
+            EXPECT_TRUE(math::isNear(intersection, expected, 0.01)) << "Expected " << expected << " but got " << intersection;
+        }
+    }
+
+    EXPECT_GT(numHits, 100) << "Most of the rays should hit the sphere";
+}
+
+TEST_F(ModelTest, MeshBVHFrustumRangesContainAllTouchedTriangles)
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+    createSphereMesh(64, 32, vertices, indices);
+
+    render::MeshBVH bvh(vertices, indices);
+
+    // A box-shaped volume touching one side of the sphere, mapped to the [-1..1] clip space
+    auto viewproj = Matrix4::getScale(Vector3(1.0 / 20, 1.0 / 20, 1.0 / 20));
+    viewproj.multiplyBy(Matrix4::getTranslation(Vector3(-100, 0, 0)));
+    auto frustum = Frustum::createFromViewproj(viewproj);
+
+    std::vector<bool> visited(indices.size() / 3, false);
+    std::size_t numTestedTriangles = 0;
+    const unsigned int* previousEnd = nullptr;
+
+    bvh.foreachTriangleRangeInFrustum(frustum, [&](const unsigned int* rangeIndices, std::size_t numIndices)
+    {
+        EXPECT_EQ(numIndices % 3, 0);
+        EXPECT_NE(rangeIndices, previousEnd) << "Adjacent ranges should have been merged";
+        previousEnd = rangeIndices + numIndices;
+
+        for (std::size_t i = 0; i < numIndices; i += 3)
+        {
+            // Find the triangle number in the original index array
+            for (std::size_t tri = 0; tri < visited.size(); ++tri)
+            {
+                if (std::equal(rangeIndices + i, rangeIndices + i + 3, indices.begin() + tri * 3))
+                {
+                    EXPECT_FALSE(visited[tri]) << "Triangle " << tri << " has been passed twice";
+                    visited[tri] = true;
+                    break;
+                }
+            }
+
+            ++numTestedTriangles;
+        }
+    });
+
+    std::size_t numTouchedTriangles = 0;
+
+    for (std::size_t tri = 0; tri < visited.size(); ++tri)
+    {
+        AABB bounds;
+        bounds.includePoint(vertices[indices[tri * 3]].vertex);
+        bounds.includePoint(vertices[indices[tri * 3 + 1]].vertex);
+        bounds.includePoint(vertices[indices[tri * 3 + 2]].vertex);
+
+        if (frustum.testIntersection(bounds) != VOLUME_OUTSIDE)
+        {
+            ++numTouchedTriangles;
+            EXPECT_TRUE(visited[tri]) << "Triangle " << tri << " touches the volume but hasn't been passed";
+        }
+    }
+
+    EXPECT_GT(numTouchedTriangles, 0);
+    EXPECT_LT(numTestedTriangles, visited.size() / 4) << "Most of the triangles should have been culled";
+}
+
+TEST_F(ModelTest, ModelNodeIntersectionMatchesBruteForce)
+{
+    auto funcStatic = algorithm::createEntityByClassName("func_static");
+    scene::addNodeToContainer(funcStatic, GlobalMapModule().getRoot());
+
+    funcStatic->getEntity().setKeyValue("origin", "120 -64 32");
+    funcStatic->getEntity().setKeyValue("rotation", "0 1 0 -1 0 0 0 0 1");
+    funcStatic->getEntity().setKeyValue("model", "models/ase/testsphere.ase");
+
+    auto modelNode = algorithm::findChildModelNode(funcStatic);
+    ASSERT_TRUE(modelNode);
+
+    auto traceable = std::dynamic_pointer_cast<ITraceable>(modelNode);
+    ASSERT_TRUE(traceable);
+
+    const auto& model = Node_getModel(modelNode)->getIModel();
+    const auto& localToWorld = modelNode->localToWorld();
+    auto radius = modelNode->localAABB().getRadius();
+
+    std::size_t numHits = 0;
+
+    for (const auto& ray : createRandomRays(200, radius, localToWorld))
+    {
+        Vector3 expected;
+        auto expectedHit = false;
+        auto expectedDistSquared = 0.0;
+
+        for (int i = 0; i < model.getSurfaceCount(); ++i)
+        {
+            auto& surface = static_cast<const model::IIndexedModelSurface&>(model.getSurface(i));
+            Vector3 surfaceIntersection;
+
+            if (getBruteForceIntersection(surface.getVertexArray(), surface.getIndexArray(), ray, localToWorld, surfaceIntersection))
+            {
+                auto distSquared = (surfaceIntersection - ray.origin).getLengthSquared();
+
+                if (!expectedHit || distSquared < expectedDistSquared)
+                {
+                    expectedHit = true;
+                    expectedDistSquared = distSquared;
+                    expected = surfaceIntersection;
+                }
+            }
+        }
+
+        Vector3 intersection;
+        auto hit = traceable->getIntersection(ray, intersection);
+
+        EXPECT_EQ(hit, expectedHit) << "Hit mismatch for ray starting at " << ray.origin;
+
+        if (hit && expectedHit)
+        {
+            ++numHits;
+            EXPECT_TRUE(math::isNear(intersection, expected, 0.01)) << "Expected " << expected << " but got " << intersection;
+        }
+    }
+
+    EXPECT_GT(numHits, 0) << "Some of the rays should hit the model";
+}
+
+// Timing comparison of the BVH and the brute force tests, run with --gtest_also_run_disabled_tests
+TEST_F(ModelTest, DISABLED_MeshBVHIntersectionBenchmark)
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+    createSphereMesh(256, 128, vertices, indices);
+
+    auto localToWorld = Matrix4::getTranslation(Vector3(-512, 256, 64));
+    localToWorld.multiplyBy(Matrix4::getRotationForEulerXYZDegrees(Vector3(0, 0, 30)));
+
+    auto rays = createRandomRays(100, 100, localToWorld);
+    auto worldToLocal = localToWorld.getFullInverse();
+
+    std::size_t bruteForceHits = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& ray : rays)
+    {
+        Vector3 intersection;
+        bruteForceHits += getBruteForceIntersection(vertices, indices, ray, localToWorld, intersection) ? 1 : 0;
+    }
+
+    auto bruteForceTime = std::chrono::steady_clock::now() - start;
+
+    // Surfaces build their BVH on the first test, include this in the measurement
+    start = std::chrono::steady_clock::now();
+
+    render::MeshBVH bvh(vertices, indices);
+    auto buildTime = std::chrono::steady_clock::now() - start;
+
+    std::size_t bvhHits = 0;
+
+    for (const auto& ray : rays)
+    {
+        Ray localRay(ray);
+        localRay.transform(worldToLocal);
+
+        Vector3 intersection;
+        bvhHits += bvh.getIntersection(vertices, localRay, intersection) ? 1 : 0;
+    }
+
+    auto bvhTime = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(bvhHits, bruteForceHits);
+
+    std::cout << indices.size() / 3 << " triangles, " << rays.size() << " rays" << std::endl;
+    std::cout << "Brute force: " << std::chrono::duration_cast<std::chrono::microseconds>(bruteForceTime).count()
+        << " usec" << std::endl;
+    std::cout << "BVH: " << std::chrono::duration_cast<std::chrono::microseconds>(bvhTime).count()
+        << " usec, including " << std::chrono::duration_cast<std::chrono::microseconds>(buildTime).count()
+        << " usec to build " << bvh.getNumNodes() << " nodes" << std::endl;
+}
+
+TEST_F(ModelTest, PrefetchedModelsAreCached)
+{
+    GlobalModelCache().prefetchModels({ "models/ase/testcube.ase", "models/torch.lwo", "models/md5/flag01.md5mesh" });
+
+    // Asking for a model while it's being loaded waits for the same load
+    auto cube = GlobalModelCache().getModel("models/ase/testcube.ase");
+    EXPECT_TRUE(cube);
+    EXPECT_EQ(cube->getPolyCount(), 12);
+
+    GlobalModelCache().waitForBackgroundLoads();
+
+    EXPECT_FALSE(GlobalModelCache().isLoadingInBackground("models/torch.lwo"));
+    EXPECT_EQ(GlobalModelCache().getModel("models/ase/testcube.ase"), cube) << "Model should have been loaded only once";
+
+    auto torch = GlobalModelCache().getModel("models/torch.lwo");
+    EXPECT_TRUE(torch);
+    EXPECT_EQ(torch->getPolyCount(), 258);
+
+    // Prefetching cached models is not loading them again
+    GlobalModelCache().prefetchModels({ "models/torch.lwo" });
+    GlobalModelCache().waitForBackgroundLoads();
+    EXPECT_EQ(GlobalModelCache().getModel("models/torch.lwo"), torch);
+}
+
+TEST_F(ModelTest, ModelsLoadedInBackgroundAreAnnouncedTogether)
+{
+    std::mutex actionsLock;
+    std::vector<std::function<void()>> actions;
+
+    GlobalModelCache().setMainThreadDispatcher([&](const std::function<void()>& action)
+    {
+        std::lock_guard<std::mutex> lock(actionsLock);
+        actions.push_back(action);
+    });
+
+    std::vector<std::set<std::string>> announcements;
+    auto handler = GlobalModelCache().signal_modelsLoaded().connect(
+        [&](const std::set<std::string>& modelPaths) { announcements.push_back(modelPaths); });
+
+    std::set<std::string> modelPaths{ "models/ase/testcube.ase", "models/torch.lwo", "models/md5/flag01.md5mesh" };
+    GlobalModelCache().prefetchModels(modelPaths);
+    GlobalModelCache().waitForBackgroundLoads();
+
+    // Nothing ran on the "main thread" yet, all models are waiting for the same notification
+    EXPECT_EQ(actions.size(), 1) << "Expected a single dispatched notification";
+
+    for (const auto& action : actions)
+    {
+        action();
+    }
+
+    EXPECT_EQ(announcements.size(), 1) << "Expected a single emission";
+
+    if (!announcements.empty())
+    {
+        EXPECT_EQ(announcements.front(), modelPaths);
+    }
+
+    handler.disconnect();
+    GlobalModelCache().setMainThreadDispatcher({});
+}
+
+TEST_F(ModelTest, ClearingTheCacheCancelsQueuedModels)
+{
+    // Models are only reported as loading in the background while a dispatcher is set
+    std::mutex actionsLock;
+    std::vector<std::function<void()>> actions;
+
+    GlobalModelCache().setMainThreadDispatcher([&](const std::function<void()>& action)
+    {
+        std::lock_guard<std::mutex> lock(actionsLock);
+        actions.push_back(action);
+    });
+
+    // Keep the workers busy with their first model until the cache has been cleared
+    algorithm::ScopedBlockingModelImporter importer("ase");
+
+    // There are more models than worker threads (at most 8), some of them are staying in the queue
+    std::set<std::string> modelPaths;
+    GlobalFileSystem().forEachFile("models/ase/", "ase",
+        [&](const vfs::FileInfo& fi) { modelPaths.insert(fi.fullPath()); });
+
+    ASSERT_GT(modelPaths.size(), 8) << "Not enough models to fill the queue";
+
+    GlobalModelCache().prefetchModels(modelPaths);
+
+    // clear() is dropping the queued models first, then waits for the loads which already started
+    auto clearing = std::async(std::launch::async, []() { GlobalModelCache().clear(); });
+
+    auto getNumLoadingModels = [&]()
+    {
+        return std::count_if(modelPaths.begin(), modelPaths.end(), [](const std::string& modelPath)
+        {
+            return GlobalModelCache().isLoadingInBackground(modelPath);
+        });
+    };
+
+    // Only the models that reached the importer are left once the queue is gone
+    while (static_cast<std::size_t>(getNumLoadingModels()) > importer.getNumLoadedPaths())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    importer.release();
+    clearing.get();
+
+    // The models which were loading while clearing are still announced
+    for (const auto& action : actions)
+    {
+        action();
+    }
+
+    EXPECT_LT(importer.getNumLoadedPaths(), modelPaths.size()) << "No model has been cancelled";
+
+    for (const auto& modelPath : modelPaths)
+    {
+        EXPECT_FALSE(GlobalModelCache().isLoadingInBackground(modelPath)) << modelPath << " is still queued";
+
+        auto numLoads = importer.getNumLoads(modelPath);
+        EXPECT_LE(numLoads, 1) << modelPath << " has been loaded more than once";
+
+        // The cache is empty, even the models which were loading while clearing are loaded again
+        EXPECT_TRUE(GlobalModelCache().getModel(modelPath)) << "Could not load " << modelPath;
+        EXPECT_EQ(importer.getNumLoads(modelPath), numLoads + 1) << modelPath << " should not be cached";
+    }
+
+    GlobalModelCache().setMainThreadDispatcher({});
+}
+
+TEST_F(ModelTest, ModelKeyShowsPlaceholderWhileLoadingInBackground)
+{
+    // Collect the actions meant for the main thread, to run them at a defined point
+    std::mutex actionsLock;
+    std::vector<std::function<void()>> actions;
+
+    GlobalModelCache().setMainThreadDispatcher([&](const std::function<void()>& action)
+    {
+        std::lock_guard<std::mutex> lock(actionsLock);
+        actions.push_back(action);
+    });
+
+    // The model is not done loading before the model key is set
+    algorithm::ScopedBlockingModelImporter importer("ase");
+
+    auto funcStatic = algorithm::createEntityByClassName("func_static");
+    scene::addNodeToContainer(funcStatic, GlobalMapModule().getRoot());
+
+    GlobalModelCache().prefetchModels({ "models/ase/testcube.ase" });
+    funcStatic->getEntity().setKeyValue("model", "models/ase/testcube.ase");
+
+    auto model = algorithm::findChildModel(funcStatic);
+    ASSERT_TRUE(model) << "Expected a model node, even while the model is loading";
+    EXPECT_EQ(model->getIModel().getPolyCount(), 0) << "Expected the placeholder";
+
+    importer.release();
+    GlobalModelCache().waitForBackgroundLoads();
+
+    EXPECT_EQ(actions.size(), 1) << "The loaded model should have been announced";
+    EXPECT_EQ(algorithm::findChildModel(funcStatic), model)
+        << "The placeholder must not be replaced outside the main thread";
+
+    for (const auto& action : actions)
+    {
+        action();
+    }
+
+    model = algorithm::findChildModel(funcStatic);
+    ASSERT_TRUE(model);
+    EXPECT_EQ(model->getIModel().getModelPath(), "models/ase/testcube.ase");
+    EXPECT_EQ(model->getIModel().getPolyCount(), 12);
+    EXPECT_EQ(importer.getNumLoads("models/ase/testcube.ase"), 1) << "Model should have been loaded only once";
+
+    GlobalModelCache().setMainThreadDispatcher({});
+}
+
+TEST_F(ModelTest, ModelKeyKeepsPlaceholderOfFailedBackgroundLoad)
+{
+    std::mutex actionsLock;
+    std::vector<std::function<void()>> actions;
+
+    GlobalModelCache().setMainThreadDispatcher([&](const std::function<void()>& action)
+    {
+        std::lock_guard<std::mutex> lock(actionsLock);
+        actions.push_back(action);
+    });
+
+    algorithm::ScopedBlockingModelImporter importer("ase");
+
+    auto funcStatic = algorithm::createEntityByClassName("func_static");
+    scene::addNodeToContainer(funcStatic, GlobalMapModule().getRoot());
+
+    std::string modelPath = "models/ase/this_model_does_not_exist.ase";
+    GlobalModelCache().prefetchModels({ modelPath });
+    funcStatic->getEntity().setKeyValue("model", modelPath);
+
+    auto placeholder = algorithm::findChildModel(funcStatic);
+    ASSERT_TRUE(placeholder) << "Expected a model node, even while the model is loading";
+
+    importer.release();
+    GlobalModelCache().waitForBackgroundLoads();
+
+    EXPECT_FALSE(GlobalModelCache().isLoadingInBackground(modelPath));
+    EXPECT_TRUE(actions.empty()) << "The failed model should not have been announced";
+
+    for (const auto& action : actions)
+    {
+        action();
+    }
+
+    EXPECT_EQ(algorithm::findChildModel(funcStatic), placeholder) << "The placeholder should have been kept";
+    EXPECT_EQ(importer.getNumLoads(modelPath), 1) << "The failed model should not have been parsed again";
+
+    GlobalModelCache().setMainThreadDispatcher({});
+}
+
 }
@@ -0,0 +1,351 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <functional>
+#include "image/PixelKernels.h"
+
+namespace test
+{
+
+using namespace image::kernels;
+
+namespace
+{
+
+// Odd sizes to exercise the scalar remainders of the vectorised loops
+const std::vector<std::pair<std::size_t, std::size_t>> ImageSizes =
+{
+    { 1, 1 }, { 2, 1 }, { 1, 2 }, { 3, 3 }, { 4, 4 }, { 5, 7 }, { 8, 8 }, { 13, 9 }, { 33, 17 }, { 64, 64 },
+};
+
+std::vector<uint8_t> createRandomPixels(std::size_t numPixels, unsigned int seed)
+{
+    std::minstd_rand rand(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    std::vector<uint8_t> pixels(numPixels * 4);
+
+    for (auto& value : pixels)
+    {
+        value = static_cast<uint8_t>(distribution(rand));
+    }
+
+    return pixels;
+}
+
+// Restores the instruction set that was active when this instance was created
+class InstructionSetGuard
+{
+private:
+    InstructionSet _previous;
+
+public:
+    InstructionSetGuard() :
+        _previous(getInstructionSet())
+    {}
+
+    ~InstructionSetGuard()
+    {
+        setInstructionSet(_previous);
+    }
+};
+
+// Runs the given kernel with the scalar and the vectorised implementation,
+// expecting both to produce the same output
+void expectSameOutput(std::size_t outputSize, const std::function<void(uint8_t*)>& kernel, const std::string& description)
+{
+    InstructionSetGuard guard;
+
+    std::vector<uint8_t> scalarOutput(outputSize);
+    std::vector<uint8_t> simdOutput(outputSize);
+
+    setInstructionSet(InstructionSet::Scalar);
+    kernel(scalarOutput.data());
+
+    setInstructionSet(getSupportedInstructionSet());
+    kernel(simdOutput.data());
+
+    EXPECT_EQ(scalarOutput, simdOutput) << description << " output differs from the scalar version";
+}
+
+std::string describe(const char* kernel, std::size_t width, std::size_t height)
+{
+    return std::string(kernel) + " " + std::to_string(width) + "x" + std::to_string(height);
+}
+
+}
+
+TEST(PixelKernelsTest, InstructionSetSelection)
+{
+    InstructionSetGuard guard;
+
+    setInstructionSet(InstructionSet::Scalar);
+    EXPECT_EQ(getInstructionSet(), InstructionSet::Scalar);
+
+    setInstructionSet(getSupportedInstructionSet());
+    EXPECT_EQ(getInstructionSet(), getSupportedInstructionSet());
+}
+
+TEST(PixelKernelsTest, ChannelOperations)
+{
+    for (const auto& size : ImageSizes)
+    {
+        auto width = size.first;
+        auto height = size.second;
+        auto numPixels = width * height;
+        auto first = createRandomPixels(numPixels, 1);
+        auto second = createRandomPixels(numPixels, 2);
+
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { addChannels(first.data(), second.data(), out, numPixels); },
+            describe("addChannels", width, height));
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { addNormals(first.data(), second.data(), out, numPixels); },
+            describe("addNormals", width, height));
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { scaleChannels(first.data(), out, numPixels, 0.3f, 1.7f, 2.5f, 0.0f); },
+            describe("scaleChannels", width, height));
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { invertColour(first.data(), out, numPixels); },
+            describe("invertColour", width, height));
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { invertAlpha(first.data(), out, numPixels); },
+            describe("invertAlpha", width, height));
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { makeIntensity(first.data(), out, numPixels); },
+            describe("makeIntensity", width, height));
+        expectSameOutput(numPixels * 4, [&](uint8_t* out) { makeAlpha(first.data(), out, numPixels); },
+            describe("makeAlpha", width, height));
+    }
+}
+
+TEST(PixelKernelsTest, ChannelOperationResults)
+{
+    const uint8_t in[8] = { 10, 20, 30, 40, 255, 128, 1, 0 };
+    const uint8_t other[8] = { 11, 20, 200, 41, 0, 255, 2, 255 };
+    uint8_t out[8];
+
+    addChannels(in, other, out, 2);
+    EXPECT_EQ(std::vector<uint8_t>(out, out + 8), std::vector<uint8_t>({ 10, 20, 115, 40, 128, 192, 2, 128 }));
+
+    addNormals(in, other, out, 2);
+    EXPECT_EQ(std::vector<uint8_t>(out, out + 8), std::vector<uint8_t>({ 10, 20, 115, 255, 128, 192, 2, 255 }));
+
+    scaleChannels(in, out, 2, 2.0f, 0.5f, 1.0f, 0.0f);
+    EXPECT_EQ(std::vector<uint8_t>(out, out + 8), std::vector<uint8_t>({ 20, 10, 30, 0, 255, 64, 1, 0 }));
+
+    makeAlpha(in, out, 2);
+    EXPECT_EQ(std::vector<uint8_t>(out, out + 8), std::vector<uint8_t>({ 255, 255, 255, 20, 255, 255, 255, 128 }));
+}
+
+TEST(PixelKernelsTest, NormalmapFilters)
+{
+    for (const auto& size : ImageSizes)
+    {
+        auto width = size.first;
+        auto height = size.second;
+        auto in = createRandomPixels(width * height, 3);
+
+        for (auto scale : { 0.5f, 1.0f, 3.7f })
+        {
+            expectSameOutput(width * height * 4,
+                [&](uint8_t* out) { heightmapToNormalmap(in.data(), out, width, height, scale); },
+                describe("heightmapToNormalmap", width, height));
+        }
+
+        expectSameOutput(width * height * 4, [&](uint8_t* out) { smoothNormals(in.data(), out, width, height); },
+            describe("smoothNormals", width, height));
+    }
+}
+
+TEST(PixelKernelsTest, FlatHeightmapPointsUp)
+{
+    std::vector<uint8_t> in(5 * 3 * 4, 100);
+    std::vector<uint8_t> out(in.size());
+
+    heightmapToNormalmap(in.data(), out.data(), 5, 3, 2.0f);
+
+    // The filter sums are not cancelling out exactly, x and y are off by one at most
+    for (std::size_t i = 0; i < out.size(); i += 4)
+    {
+        EXPECT_NEAR(out[i + 0], 128, 1);
+        EXPECT_NEAR(out[i + 1], 128, 1);
+        EXPECT_EQ(out[i + 2], 255);
+        EXPECT_EQ(out[i + 3], 255);
+    }
+}
+
+TEST(PixelKernelsTest, Resampling)
+{
+    for (const auto& size : ImageSizes)
+    {
+        auto width = size.first;
+        auto height = size.second;
+        auto first = createRandomPixels(width * height, 4);
+        auto second = createRandomPixels(width * height, 5);
+
+        for (auto lerp : { 0, 1, 0x7FFF, 0x8000, 0xFFFF })
+        {
+            expectSameOutput(width * height * 4,
+                [&](uint8_t* out) { blendRows(first.data(), second.data(), out, width * height * 4, lerp); },
+                describe("blendRows", width, height));
+        }
+
+        for (auto outWidth : { std::size_t(1), width * 2 + 1, std::size_t(64) })
+        {
+            expectSameOutput(outWidth * 4, [&](uint8_t* out) { lerpLine(first.data(), out, width, outWidth); },
+                describe("lerpLine", width, outWidth));
+        }
+    }
+}
+
+TEST(PixelKernelsTest, MipReduceInPlace)
+{
+    for (const auto& size : ImageSizes)
+    {
+        auto width = size.first;
+        auto height = size.second;
+        auto in = createRandomPixels(width * height, 6);
+
+        for (auto reduction : { std::make_pair(true, true), std::make_pair(true, false), std::make_pair(false, true) })
+        {
+            // The kernel is used in place, run it on a copy of the input
+            expectSameOutput(width * height * 4, [&](uint8_t* out)
+            {
+                std::copy(in.begin(), in.end(), out);
+                mipReduce(out, out, width, height, reduction.first, reduction.second);
+            }, describe("mipReduce", width, height));
+        }
+    }
+}
+
+// The scalar kernels are replacing the per-pixel loops of the map expressions and the
+// TextureManipulator, the expected values have been produced by these previous loops
+TEST(PixelKernelsTest, ScalarKernelsMatchPreviousLoops)
+{
+    InstructionSetGuard guard;
+    setInstructionSet(InstructionSet::Scalar);
+
+    // A 3x2 image
+    constexpr std::size_t Width = 3;
+    constexpr std::size_t Height = 2;
+    constexpr std::size_t NumPixels = Width * Height;
+
+    std::vector<uint8_t> in(NumPixels * 4);
+    std::vector<uint8_t> other(NumPixels * 4);
+
+    for (std::size_t i = 0; i < in.size(); ++i)
+    {
+        in[i] = static_cast<uint8_t>((i * 37 + 11) & 255);
+        other[i] = static_cast<uint8_t>((i * 91 + 200) & 255);
+    }
+
+    std::vector<uint8_t> out(NumPixels * 4);
+
+    addNormals(in.data(), other.data(), out.data(), NumPixels);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 106, 42, 106, 255, 106, 170, 234, 255, 106, 170, 106, 255,
+        106, 170, 106, 255, 106, 170, 106, 255, 234, 42, 106, 255 })) << "addNormals";
+
+    addChannels(in.data(), other.data(), out.data(), NumPixels);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 106, 42, 106, 170, 106, 170, 234, 42, 106, 170, 106, 170,
+        106, 170, 106, 42, 106, 170, 106, 170, 234, 42, 106, 170 })) << "addChannels";
+
+    scaleChannels(in.data(), out.data(), NumPixels, 0.3f, 1.7f, 2.5f, 0.5f);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 3, 82, 212, 61, 48, 255, 255, 7, 15, 150, 255, 81,
+        60, 255, 42, 27, 27, 218, 255, 101, 72, 34, 142, 47 })) << "scaleChannels";
+
+    invertAlpha(in.data(), out.data(), NumPixels);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 11, 48, 85, 133, 159, 196, 233, 241, 51, 88, 125, 93,
+        199, 236, 17, 201, 91, 128, 165, 53, 239, 20, 57, 161 })) << "invertAlpha";
+
+    invertColour(in.data(), out.data(), NumPixels);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 244, 207, 170, 122, 96, 59, 22, 14, 204, 167, 130, 162,
+        56, 19, 238, 54, 164, 127, 90, 202, 16, 235, 198, 94 })) << "invertColour";
+
+    makeIntensity(in.data(), out.data(), NumPixels);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 11, 11, 11, 11, 159, 159, 159, 159, 51, 51, 51, 51,
+        199, 199, 199, 199, 91, 91, 91, 91, 239, 239, 239, 239 })) << "makeIntensity";
+
+    makeAlpha(in.data(), out.data(), NumPixels);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 255, 255, 255, 48, 255, 255, 255, 196, 255, 255, 255, 88,
+        255, 255, 255, 150, 255, 255, 255, 128, 255, 255, 255, 105 })) << "makeAlpha";
+
+    heightmapToNormalmap(in.data(), out.data(), Width, Height, 2.0f);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 233, 127, 199, 255, 40, 128, 220, 255, 68, 128, 240, 255,
+        68, 128, 240, 255, 40, 128, 220, 255, 233, 128, 199, 255 })) << "heightmapToNormalmap";
+
+    smoothNormals(in.data(), out.data(), Width, Height);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 142, 122, 102, 255, 142, 122, 102, 255, 142, 122, 102, 255,
+        108, 116, 125, 255, 108, 116, 125, 255, 108, 116, 125, 255 })) << "smoothNormals";
+
+    blendRows(in.data(), other.data(), out.data(), in.size(), 0x6000);
+    EXPECT_EQ(out, std::vector<uint8_t>({ 81, 43, 100, 157, 118, 176, 233, 34, 91, 149, 110, 167,
+        128, 186, 83, 44, 101, 159, 120, 177, 234, 36, 93, 150 })) << "blendRows";
+
+    // Stretch the first row to 7 pixels
+    std::vector<uint8_t> line(7 * 4);
+    lerpLine(in.data(), line.data(), Width, 7);
+    EXPECT_EQ(line, std::vector<uint8_t>({ 11, 48, 85, 122, 74, 111, 148, 75, 137, 174, 211, 29,
+        128, 165, 202, 56, 81, 118, 155, 119, 51, 88, 125, 162, 51, 88, 125, 162 })) << "lerpLine";
+
+    // Reduce both dimensions of the data interpreted as 2x3 image, the odd row is dropped
+    std::vector<uint8_t> reduced(4);
+    mipReduce(in.data(), reduced.data(), 2, 3, true, true);
+    EXPECT_EQ(reduced, std::vector<uint8_t>({ 105, 142, 115, 88 })) << "mipReduce width and height";
+
+    reduced.resize(12);
+    mipReduce(in.data(), reduced.data(), 2, 3, true, false);
+    EXPECT_EQ(reduced, std::vector<uint8_t>({ 85, 122, 159, 68, 125, 162, 71, 108, 165, 74, 111, 148 }))
+        << "mipReduce width";
+
+    mipReduce(in.data(), reduced.data(), Width, Height, false, true);
+    EXPECT_EQ(reduced, std::vector<uint8_t>({ 105, 142, 51, 88, 125, 162, 199, 108, 145, 54, 91, 128 }))
+        << "mipReduce height";
+}
+
+// Timing comparison of the scalar and vectorised kernels, run with --gtest_also_run_disabled_tests
+TEST(PixelKernelsTest, DISABLED_KernelPerformance)
+{
+    constexpr std::size_t Width = 1024;
+    constexpr std::size_t Height = 1024;
+    constexpr int NumRuns = 5;
+
+    auto first = createRandomPixels(Width * Height, 7);
+    auto second = createRandomPixels(Width * Height, 8);
+    std::vector<uint8_t> out(Width * Height * 4);
+
+    auto measure = [&](const char* name, const std::function<void()>& kernel)
+    {
+        InstructionSetGuard guard;
+
+        for (auto instructionSet : { InstructionSet::Scalar, getSupportedInstructionSet() })
+        {
+            setInstructionSet(instructionSet);
+
+            auto start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < NumRuns; ++i)
+            {
+                kernel();
+            }
+
+            auto time = std::chrono::steady_clock::now() - start;
+
+            std::cout << name << (instructionSet == InstructionSet::Scalar ? " (scalar): " : " (SIMD): ")
+                << std::chrono::duration_cast<std::chrono::microseconds>(time).count() / NumRuns
+                << " usec per run" << std::endl;
+        }
+    };
+
+    measure("heightmapToNormalmap", [&] { heightmapToNormalmap(first.data(), out.data(), Width, Height, 2.0f); });
+    measure("smoothNormals", [&] { smoothNormals(first.data(), out.data(), Width, Height); });
+    measure("addNormals", [&] { addNormals(first.data(), second.data(), out.data(), Width * Height); });
+    measure("scaleChannels", [&] { scaleChannels(first.data(), out.data(), Width * Height, 0.5f, 0.5f, 0.5f, 1.0f); });
+    measure("makeAlpha", [&] { makeAlpha(first.data(), out.data(), Width * Height); });
+    measure("lerpLine", [&]
+    {
+        for (std::size_t y = 0; y < Height / 2; ++y)
+        {
+            lerpLine(first.data() + y * Width * 4, out.data() + y * Width * 8, Width, Width * 2);
+        }
+    });
+    measure("mipReduce", [&] { mipReduce(first.data(), out.data(), Width, Height, true, true); });
+}
+
+}
@@ -5,6 +5,16 @@
 #include "scene/EntityNode.h"
 #include "scenelib.h"
 #include "algorithm/Entity.h"
+#include "algorithm/Primitives.h"
+#include "algorithm/View.h"
+#include "imap.h"
+#include "ispacepartition.h"
+#include "itransformable.h"
+#include "iundo.h"
+#include <map>
+#include <chrono>
+#include <limits>
+#include <iostream>
 
 namespace test
 {
@@ -387,4 +397,291 @@ TEST_F(SceneNodeTest, SetRenderStateAffectsAttachments)
     });
 }
 
+// Counts the scene nodes linked into the given space partition subtree, checking that
+// every member is fully contained in the octree node it is linked to (except for the root)
+inline void countSpacePartitionMembers(const scene::ISPNode& spNode, std::map<scene::INode*, int>& memberCount)
+{
+    for (const auto& member : spNode.getMembers())
+    {
+        ++memberCount[member.get()];
+
+        if (spNode.getParent() != nullptr && member->worldAABB().isValid())
+        {
+            EXPECT_TRUE(spNode.getBounds().contains(member->worldAABB())) << "Member exceeds the bounds of its octree node";
+        }
+    }
+
+    for (std::size_t i = 0; i < spNode.getNumChildNodes(); ++i)
+    {
+        EXPECT_EQ(spNode.getChildNode(i).getParent(), &spNode) << "Parent pointer is wrong";
+        countSpacePartitionMembers(spNode.getChildNode(i), memberCount);
+    }
+}
+
+TEST_F(SceneNodeTest, SpacePartitionFollowsMovedNodes)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+
+    // Enough brushes to make the octree subdivide a few times
+    std::vector<scene::INodePtr> brushes;
+
+    for (int x = 0; x < 16; ++x)
+    {
+        for (int y = 0; y < 16; ++y)
+        {
+            brushes.push_back(algorithm::createCubicBrush(worldspawn, Vector3(x * 160, y * 160, 0)));
+        }
+    }
+
+    // Small movements keep the brushes in their cell, large ones are moving them elsewhere
+    for (std::size_t i = 0; i < brushes.size(); ++i)
+    {
+        auto translation = i % 3 == 0 ? Vector3(-9000, 4000, 2048) : Vector3(4, -4, 8);
+
+        scene::node_cast<ITransformable>(brushes[i])->setTranslation(translation);
+        scene::node_cast<ITransformable>(brushes[i])->freezeTransform();
+    }
+
+    // Evaluate all pending bounds changes
+    GlobalSceneGraph().root()->worldAABB();
+
+    std::map<scene::INode*, int> memberCount;
+    countSpacePartitionMembers(GlobalSceneGraph().getSpacePartition()->getRoot(), memberCount);
+
+    // Every brush must be linked exactly once
+    for (const auto& brush : brushes)
+    {
+        EXPECT_EQ(memberCount[brush.get()], 1) << "Brush should be linked exactly once";
+    }
+
+    // Removed brushes should be gone from the octree
+    for (std::size_t i = 0; i < brushes.size(); i += 2)
+    {
+        scene::removeNodeFromParent(brushes[i]);
+    }
+
+    memberCount.clear();
+    countSpacePartitionMembers(GlobalSceneGraph().getSpacePartition()->getRoot(), memberCount);
+
+    for (std::size_t i = 0; i < brushes.size(); ++i)
+    {
+        EXPECT_EQ(memberCount[brushes[i].get()], i % 2 == 0 ? 0 : 1);
+    }
+}
+
+TEST_F(SceneNodeTest, BoundsChangeBatchEmitsSignalOnce)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+
+    std::vector<scene::INodePtr> brushes;
+
+    for (int i = 0; i < 64; ++i)
+    {
+        brushes.push_back(algorithm::createCubicBrush(worldspawn, Vector3(i * 160, 0, 0)));
+    }
+
+    // Evaluate all pending bounds changes
+    GlobalSceneGraph().root()->worldAABB();
+
+    std::size_t signalCount = 0;
+    auto conn = GlobalSceneGraph().signal_boundsChanged().connect([&]() { ++signalCount; });
+
+    {
+        scene::ScopedBoundsChangeBatch batch(GlobalSceneGraph());
+
+        for (const auto& brush : brushes)
+        {
+            scene::node_cast<ITransformable>(brush)->setTranslation(Vector3(0, 5000, 0));
+            scene::node_cast<ITransformable>(brush)->freezeTransform();
+
+            // Evaluating the bounds reports the change to the scene graph, more than once for some nodes
+            brush->worldAABB();
+            GlobalSceneGraph().root()->worldAABB();
+        }
+
+        EXPECT_EQ(signalCount, 0) << "No signal should be emitted during the batch";
+    }
+
+    EXPECT_EQ(signalCount, 1) << "Signal should have been emitted exactly once";
+    conn.disconnect();
+
+    // All brushes must have been re-linked to match their new position
+    std::map<scene::INode*, int> memberCount;
+    countSpacePartitionMembers(GlobalSceneGraph().getSpacePartition()->getRoot(), memberCount);
+
+    for (const auto& brush : brushes)
+    {
+        EXPECT_EQ(memberCount[brush.get()], 1) << "Brush should be linked exactly once";
+    }
+}
+
+// Undo and redo are batching the bounds changes of the restored nodes,
+// regardless of whether they are invoked through the commands or the undo system
+TEST_F(SceneNodeTest, UndoRedoEmitBoundsChangedSignalOnce)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+
+    std::vector<scene::INodePtr> brushes;
+
+    for (int i = 0; i < 64; ++i)
+    {
+        brushes.push_back(algorithm::createCubicBrush(worldspawn, Vector3(i * 160, 0, 0)));
+    }
+
+    {
+        UndoableCommand cmd("moveBrushes");
+
+        for (const auto& brush : brushes)
+        {
+            scene::node_cast<ITransformable>(brush)->setTranslation(Vector3(0, 5000, 0));
+            scene::node_cast<ITransformable>(brush)->freezeTransform();
+        }
+    }
+
+    // Evaluate all pending bounds changes
+    GlobalSceneGraph().root()->worldAABB();
+
+    std::size_t signalCount = 0;
+    auto conn = GlobalSceneGraph().signal_boundsChanged().connect([&]() { ++signalCount; });
+
+    GlobalMapModule().getUndoSystem().undo();
+    EXPECT_EQ(signalCount, 1) << "Undo should have emitted the signal exactly once";
+
+    signalCount = 0;
+    GlobalMapModule().getUndoSystem().redo();
+    EXPECT_EQ(signalCount, 1) << "Redo should have emitted the signal exactly once";
+
+    conn.disconnect();
+
+    // The brushes should be back at their moved position
+    for (const auto& brush : brushes)
+    {
+        EXPECT_GT(brush->worldAABB().getOrigin().y(), 4000) << "Brush should have been moved by the redo";
+    }
+}
+
+// Walker recording the visited nodes, optionally with parallel culling
+class NodeRecordingWalker :
+    public scene::Graph::Walker
+{
+private:
+    bool _parallel;
+    std::size_t _maxNodes;
+
+public:
+    std::vector<scene::INode*> visitedNodes;
+
+    NodeRecordingWalker(bool parallel, std::size_t maxNodes = std::numeric_limits<std::size_t>::max()) :
+        _parallel(parallel),
+        _maxNodes(maxNodes)
+    {}
+
+    bool visit(const scene::INodePtr& node) override
+    {
+        visitedNodes.push_back(node.get());
+        return visitedNodes.size() < _maxNodes;
+    }
+
+    bool supportsParallelCulling() const override
+    {
+        return _parallel;
+    }
+};
+
+// Creates a grid of small brushes below the given worldspawn, hiding every seventh node
+// to check that these are culled in both the sequential and the parallel variant
+inline void createCullingTestScene(const scene::INodePtr& worldspawn, int sizeX, int sizeY, int sizeZ)
+{
+    for (int x = 0; x < sizeX; ++x)
+    {
+        for (int y = 0; y < sizeY; ++y)
+        {
+            for (int z = 0; z < sizeZ; ++z)
+            {
+                algorithm::createCubicBrush(worldspawn,
+                    Vector3(x * 96 - sizeX * 48, y * 96 - sizeY * 48, z * 96));
+            }
+        }
+    }
+
+    std::size_t counter = 0;
+    worldspawn->foreachNode([&](const scene::INodePtr& node)
+    {
+        if (++counter % 7 == 0)
+        {
+            node->enable(scene::Node::eHidden);
+        }
+        return true;
+    });
+}
+
+// A camera looking at part of the brush grid
+inline void constructCullingTestView(render::View& view)
+{
+    algorithm::constructCameraView(view, AABB(Vector3(-960, -960, 480), Vector3(512, 512, 512)),
+        Vector3(0, 0, -1), Vector3(-90, 0, 0));
+}
+
+TEST_F(SceneNodeTest, ParallelCullingVisitsSameNodes)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    createCullingTestScene(worldspawn, 24, 24, 4);
+
+    render::View view(true);
+    constructCullingTestView(view);
+
+    NodeRecordingWalker sequential(false);
+    NodeRecordingWalker parallel(true);
+
+    GlobalSceneGraph().foreachVisibleNodeInVolume(view, sequential);
+    GlobalSceneGraph().foreachVisibleNodeInVolume(view, parallel);
+
+    // Both variants must visit the same nodes in the same order
+    EXPECT_GT(sequential.visitedNodes.size(), 0) << "Nothing visible";
+    EXPECT_LT(sequential.visitedNodes.size(), 24 * 24 * 4) << "Nothing culled";
+    EXPECT_EQ(sequential.visitedNodes, parallel.visitedNodes) << "Parallel culling result differs";
+
+    // The walker must be able to stop the traversal
+    NodeRecordingWalker stoppingWalker(true, 100);
+    GlobalSceneGraph().foreachNodeInVolume(view, stoppingWalker);
+    EXPECT_EQ(stoppingWalker.visitedNodes.size(), 100);
+}
+
+// Timing comparison of sequential and parallel culling, run with --gtest_also_run_disabled_tests
+TEST_F(SceneNodeTest, DISABLED_ParallelCullingBenchmark)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    createCullingTestScene(worldspawn, 40, 40, 10);
+
+    render::View view(true);
+    constructCullingTestView(view);
+
+    constexpr int NumRuns = 20;
+    std::chrono::steady_clock::duration sequentialTime(0);
+    std::chrono::steady_clock::duration parallelTime(0);
+
+    for (int run = 0; run < NumRuns; ++run)
+    {
+        NodeRecordingWalker sequential(false);
+        NodeRecordingWalker parallel(true);
+
+        auto start = std::chrono::steady_clock::now();
+        GlobalSceneGraph().foreachVisibleNodeInVolume(view, sequential);
+        sequentialTime += std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        GlobalSceneGraph().foreachVisibleNodeInVolume(view, parallel);
+        parallelTime += std::chrono::steady_clock::now() - start;
+
+        EXPECT_EQ(sequential.visitedNodes, parallel.visitedNodes) << "Parallel culling result differs";
+    }
+
+    std::cout << "Sequential culling: "
+        << std::chrono::duration_cast<std::chrono::microseconds>(sequentialTime).count() / NumRuns
+        << " usec per run" << std::endl;
+    std::cout << "Parallel culling: "
+        << std::chrono::duration_cast<std::chrono::microseconds>(parallelTime).count() / NumRuns
+        << " usec per run" << std::endl;
+}
+
 }
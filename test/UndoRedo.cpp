@@ -3,6 +3,8 @@
 #include <sigc++/connection.h>
 #include "iundo.h"
 #include "ibrush.h"
+#include "ipatch.h"
+#include "itransformable.h"
 #include "ieclass.h"
 #include "scene/Entity.h"
 #include "iscenegraphfactory.h"
@@ -12,6 +14,7 @@
 #include "algorithm/Scene.h"
 #include "algorithm/Primitives.h"
 #include "scenelib.h"
+#include "registry/registry.h"
 #include "scene/BasicRootNode.h"
 #include "testutil/FileSelectionHelper.h"
 
@@ -872,4 +875,227 @@ TEST_F(UndoTest, OperationTracking)
     EXPECT_EQ(tracker.receivedOperationName, "") << "Nothing should fire, already detached";
 }
 
+
+namespace
+{
+
+std::vector<Plane3> getFacePlanes(const scene::INodePtr& brush)
+{
+    std::vector<Plane3> planes;
+    auto* ibrush = Node_getIBrush(brush);
+
+    for (std::size_t i = 0; i < ibrush->getNumFaces(); ++i)
+    {
+        planes.push_back(ibrush->getFace(i).getPlane3());
+    }
+
+    return planes;
+}
+
+// Plane3::operator== is using an epsilon, undo needs to restore the exact values
+void expectPlanesAreEqual(const std::vector<Plane3>& a, const std::vector<Plane3>& b)
+{
+    ASSERT_EQ(a.size(), b.size());
+
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        EXPECT_EQ(a[i].normal(), b[i].normal()) << "Plane normal not restored";
+        EXPECT_EQ(a[i].dist(), b[i].dist()) << "Plane distance not restored";
+    }
+}
+
+void translateNode(const scene::INodePtr& node, const Vector3& translation)
+{
+    scene::node_cast<ITransformable>(node)->setTranslation(translation);
+    scene::node_cast<ITransformable>(node)->freezeTransform();
+}
+
+}
+
+TEST_F(UndoTest, TranslatedBrushesRecordCompactState)
+{
+    constexpr std::size_t NumBrushes = 50;
+
+    // Texture lock would change the texture projections too
+    registry::setValue(RKEY_ENABLE_TEXTURE_LOCK, false);
+
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    std::vector<scene::INodePtr> brushes;
+
+    for (std::size_t i = 0; i < NumBrushes; ++i)
+    {
+        brushes.push_back(algorithm::createCubicBrush(worldspawn, Vector3(i * 64.0, 0, 0), "textures/numbers/1"));
+    }
+
+    std::vector<std::vector<Plane3>> planesBefore;
+
+    for (const auto& brush : brushes)
+    {
+        planesBefore.push_back(getFacePlanes(brush));
+    }
+
+    auto memoryBefore = GlobalUndoSystem().getMemoryUsage();
+
+    {
+        UndoableCommand cmd("translateBrushes");
+
+        // A translation not representable as binary fraction, changing all planes
+        for (const auto& brush : brushes)
+        {
+            translateNode(brush, Vector3(0.1, 0.3, 0.7));
+        }
+    }
+
+    // Only the changed face planes are recorded, no face lists, materials or texture projections
+    auto bytesPerBrush = (GlobalUndoSystem().getMemoryUsage() - memoryBefore) / NumBrushes;
+    EXPECT_LT(bytesPerBrush, 800) << "Translating a brush should record a few planes only";
+
+    std::vector<std::vector<Plane3>> planesAfter;
+
+    for (const auto& brush : brushes)
+    {
+        planesAfter.push_back(getFacePlanes(brush));
+    }
+
+    GlobalUndoSystem().undo();
+
+    for (std::size_t i = 0; i < NumBrushes; ++i)
+    {
+        expectPlanesAreEqual(getFacePlanes(brushes[i]), planesBefore[i]);
+        EXPECT_EQ(Node_getIBrush(brushes[i])->getFace(0).getShader(), "textures/numbers/1");
+    }
+
+    GlobalUndoSystem().redo();
+
+    for (std::size_t i = 0; i < NumBrushes; ++i)
+    {
+        expectPlanesAreEqual(getFacePlanes(brushes[i]), planesAfter[i]);
+    }
+}
+
+TEST_F(UndoTest, MaterialChangeIsRestoredFromCompactState)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto brush = algorithm::createCubicBrush(worldspawn, Vector3(0, 0, 0), "textures/numbers/1");
+    auto& face = Node_getIBrush(brush)->getFace(0);
+
+    auto projectionBefore = face.getProjectionMatrix();
+
+    {
+        UndoableCommand cmd("changeMaterial");
+        face.setShader("textures/numbers/2");
+        face.shiftTexdef(8, 16);
+    }
+
+    GlobalUndoSystem().undo();
+
+    EXPECT_EQ(face.getShader(), "textures/numbers/1") << "Material not restored";
+    EXPECT_EQ(face.getProjectionMatrix(), projectionBefore) << "Texture projection not restored";
+
+    GlobalUndoSystem().redo();
+    EXPECT_EQ(face.getShader(), "textures/numbers/2") << "Material not redone";
+}
+
+TEST_F(UndoTest, UnchangedStateIsNotRecorded)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto brush = algorithm::createCubicBrush(worldspawn, Vector3(0, 0, 0), "textures/numbers/1");
+    auto& face = Node_getIBrush(brush)->getFace(0);
+
+    GlobalUndoSystem().clear();
+
+    TestUndoTracker tracker;
+
+    sigc::connection handler = GlobalMapModule().getRoot()->getUndoSystem()
+        .signal_undoEvent().connect(sigc::mem_fun(tracker, &TestUndoTracker::onUndoEvent));
+
+    // The face is saving its state, but nothing is actually changed
+    {
+        UndoableCommand cmd("shiftByZero");
+        face.shiftTexdef(0, 0);
+    }
+
+    EXPECT_FALSE(tracker.recordedFired) << "An operation without changes should not be recorded";
+    EXPECT_EQ(GlobalUndoSystem().getMemoryUsage(), 0) << "The history should still be empty";
+
+    GlobalUndoSystem().undo();
+    EXPECT_FALSE(tracker.undoneFired) << "Nothing should be undone";
+
+    handler.disconnect();
+}
+
+TEST_F(UndoTest, TranslatedPatchRecordsCompactState)
+{
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    auto patchNode = algorithm::createPatchFromBounds(worldspawn);
+    auto* patch = Node_getIPatch(patchNode);
+
+    std::vector<PatchControl> controlsBefore;
+    algorithm::foreachPatchVertex(*patch, [&](const PatchControl& ctrl) { controlsBefore.push_back(ctrl); });
+
+    auto memoryBefore = GlobalUndoSystem().getMemoryUsage();
+
+    {
+        UndoableCommand cmd("translatePatch");
+        translateNode(patchNode, Vector3(16, 32, 8));
+    }
+
+    // The full state holds all control points, the translation is stored as single vector
+    auto bytesRecorded = GlobalUndoSystem().getMemoryUsage() - memoryBefore;
+    EXPECT_LT(bytesRecorded, controlsBefore.size() * sizeof(PatchControl)) << "Translation should be recorded as delta";
+
+    GlobalUndoSystem().undo();
+
+    std::size_t index = 0;
+    algorithm::foreachPatchVertex(*patch, [&](const PatchControl& ctrl)
+    {
+        EXPECT_EQ(ctrl.vertex, controlsBefore[index].vertex) << "Control vertex not restored exactly";
+        EXPECT_EQ(ctrl.texcoord, controlsBefore[index].texcoord) << "Texcoord not restored";
+        ++index;
+    });
+}
+
+
+TEST_F(UndoTest, HistoryIsLimitedByMemoryBudget)
+{
+    constexpr std::size_t NumBrushes = 500;
+    constexpr std::size_t NumOperations = 8;
+
+    registry::setValue(RKEY_ENABLE_TEXTURE_LOCK, false);
+    registry::setValue("user/ui/undo/memoryBudget", 1); // MB
+
+    auto worldspawn = GlobalMapModule().findOrInsertWorldspawn();
+    std::vector<scene::INodePtr> brushes;
+
+    for (std::size_t i = 0; i < NumBrushes; ++i)
+    {
+        brushes.push_back(algorithm::createCubicBrush(worldspawn, Vector3(i * 64.0, 0, 0), "textures/numbers/1"));
+    }
+
+    auto originalBounds = brushes.front()->worldAABB();
+
+    for (std::size_t i = 0; i < NumOperations; ++i)
+    {
+        UndoableCommand cmd("translateBrushes");
+
+        for (const auto& brush : brushes)
+        {
+            translateNode(brush, Vector3(0, 0, 16));
+        }
+    }
+
+    EXPECT_LE(GlobalUndoSystem().getMemoryUsage(), 1024 * 1024) << "Undo history exceeds the memory budget";
+
+    // The oldest operations have been discarded, undoing everything can't restore the original state
+    for (std::size_t i = 0; i < NumOperations; ++i)
+    {
+        GlobalUndoSystem().undo();
+    }
+
+    EXPECT_GT(brushes.front()->worldAABB().getOrigin().z(), originalBounds.getOrigin().z())
+        << "The first operations should not be undoable anymore";
+    EXPECT_LT(brushes.front()->worldAABB().getOrigin().z(), originalBounds.getOrigin().z() + NumOperations * 16)
+        << "The recent operations should have been undone";
+}
+
 }
@@ -1,8 +1,15 @@
 #include "RadiantTest.h"
 
 #include "ifilesystem.h"
+#include "icommandsystem.h"
 #include "os/path.h"
 #include "os/file.h"
+#include "testutil/TemporaryFile.h"
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 
 namespace test
 {
@@ -240,4 +247,177 @@ TEST_F(VfsTest, GetFileInfo)
     EXPECT_EQ(info.visibility, vfs::Visibility::HIDDEN);
 }
 
+// Large loose files are memory-mapped and expose their data directly
+TEST_F(VfsTest, OpenLargePhysicalFileIsMapped)
+{
+    std::string largeFile = "def/tdm_ai.def";
+    std::string smallFile = "def/func.def";
+
+    fs::path largeFilePath = _context.getTestProjectPath();
+    largeFilePath /= largeFile;
+    auto expectedSize = os::getFileSize(largeFilePath.string());
+
+    auto file = GlobalFileSystem().openFile(largeFile);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->size(), expectedSize);
+    EXPECT_NE(file->getMappedData(), nullptr) << "Large file should be memory-mapped";
+
+    // Reading through the stream should deliver the same data as the mapping
+    std::vector<unsigned char> streamData(file->size());
+    EXPECT_EQ(file->getInputStream().read(streamData.data(), streamData.size()), expectedSize);
+    EXPECT_EQ(std::memcmp(streamData.data(), file->getMappedData(), streamData.size()), 0);
+
+    auto textFile = GlobalFileSystem().openTextFile(largeFile);
+    ASSERT_TRUE(textFile);
+    EXPECT_EQ(textFile->getMappedData().size(), expectedSize);
+
+    std::istream stream(&textFile->getInputStream());
+    std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(contents, textFile->getMappedData());
+
+    // Small files are using the regular file streams
+    auto smallTextFile = GlobalFileSystem().openTextFile(smallFile);
+    ASSERT_TRUE(smallTextFile);
+    EXPECT_TRUE(smallTextFile->getMappedData().empty());
+}
+
+// Memory-mapped text files are delivered with LF line endings, like the ones in pk4 archives
+TEST_F(VfsTest, MappedTextFileStripsCarriageReturns)
+{
+    std::string crlfContents;
+    std::string expectedContents;
+
+    // Make the file large enough to be memory-mapped
+    while (crlfContents.size() < 128 * 1024)
+    {
+        crlfContents += "textures/common/caulk { qer_editorimage textures/common/caulk }\r\n";
+        expectedContents += "textures/common/caulk { qer_editorimage textures/common/caulk }\n";
+    }
+
+    TemporaryFile tempFile(_context.getTestProjectPath() + "materials/temp_crlf.mtr", crlfContents);
+
+    auto textFile = GlobalFileSystem().openTextFile("materials/temp_crlf.mtr");
+    ASSERT_TRUE(textFile);
+    EXPECT_FALSE(textFile->getMappedData().empty()) << "Large file should be memory-mapped";
+    EXPECT_EQ(textFile->getMappedData(), expectedContents);
+
+    std::istream stream(&textFile->getInputStream());
+    std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(contents, expectedContents);
+}
+
+// Files in pk4 archives are looked up case-insensitively through the pak file index
+TEST_F(VfsTest, FindFilesInPakArchives)
+{
+    EXPECT_EQ(GlobalFileSystem().getFileCount("models/darkmod/test/unit_cube.ase"), 1);
+    EXPECT_EQ(GlobalFileSystem().getFileCount("Models/DarkMod/test/Unit_Cube.ASE"), 1);
+    EXPECT_TRUE(GlobalFileSystem().openFile("Models/DarkMod/test/Unit_Cube.ASE"));
+    EXPECT_TRUE(GlobalFileSystem().openTextFile("particles/PRECEDENCE.prt"));
+
+    // Folders are not files
+    EXPECT_EQ(GlobalFileSystem().getFileCount("models/darkmod/test"), 0);
+    EXPECT_FALSE(GlobalFileSystem().openFile("models/darkmod/test/"));
+
+    // Files in pk4s are reported as non-physical
+    auto info = GlobalFileSystem().getFileInfo("models/darkmod/test/unit_cube.lwo");
+    EXPECT_FALSE(info.isEmpty());
+    EXPECT_FALSE(info.getIsPhysicalFile());
+    EXPECT_EQ(os::getFilename(info.getArchivePath()), "test_models.pk4");
+
+    // Loose files are still found
+    info = GlobalFileSystem().getFileInfo("materials/example.mtr");
+    EXPECT_FALSE(info.isEmpty());
+    EXPECT_TRUE(info.getIsPhysicalFile());
+}
+
+// Measures the lookup of files the way the image loader does it,
+// probing several extensions and prefixes for every texture
+TEST_F(VfsTest, FileLookupPerformance)
+{
+    const std::vector<std::string> existingFiles =
+    {
+        "models/darkmod/test/unit_cube.ase",
+        "models/darkmod/test/unit_cube.lwo",
+        "materials/tdm_ai_nobles.mtr",
+        "particles/precedence.prt",
+        "lights/biground1.tga",
+        "materials/example.mtr",
+    };
+
+    const std::vector<std::string> prefixes = { "", "dds/" };
+    const std::vector<std::string> extensions = { ".tga", ".dds", ".png", ".jpg" };
+
+    const std::size_t numRounds = 2000;
+    std::size_t numLookups = 0;
+    std::size_t numFound = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t round = 0; round < numRounds; ++round)
+    {
+        for (const auto& file : existingFiles)
+        {
+            numFound += GlobalFileSystem().getFileCount(file) > 0 ? 1 : 0;
+            ++numLookups;
+
+            // Misses, as produced by the image loader trying various extensions
+            auto baseName = os::removeExtension(file);
+
+            for (const auto& prefix : prefixes)
+            {
+                for (const auto& extension : extensions)
+                {
+                    numFound += GlobalFileSystem().getFileCount(prefix + baseName + extension + "_missing") > 0 ? 1 : 0;
+                    ++numLookups;
+                }
+            }
+        }
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "Performed " << numLookups << " VFS lookups in " << duration.count() << " us ("
+        << (static_cast<double>(duration.count()) / numLookups) << " us per lookup)" << std::endl;
+
+    // Only the existing files should have been found, in every round
+    EXPECT_EQ(numFound, numRounds * existingFiles.size());
+}
+
+// Files in pk4 archives are decompressed once and shared between subsequent openers
+TEST_F(VfsTest, ReopenedPakFilesShareDecompressedData)
+{
+    // This file is stored with CRLF line endings in altar.pk4
+    const std::string fileInPak = "models/window.ase";
+
+    auto file = GlobalFileSystem().openFile(fileInPak);
+    ASSERT_TRUE(file);
+    ASSERT_NE(file->getMappedData(), nullptr) << "Small pk4 files should expose their data";
+
+    auto secondFile = GlobalFileSystem().openFile(fileInPak);
+    ASSERT_TRUE(secondFile);
+    EXPECT_EQ(secondFile->getMappedData(), file->getMappedData()) << "Data should be shared";
+    EXPECT_EQ(secondFile->size(), file->size());
+
+    // Reading through the stream should deliver the same data
+    std::vector<unsigned char> streamData(file->size());
+    EXPECT_EQ(file->getInputStream().read(streamData.data(), streamData.size()), file->size());
+    EXPECT_EQ(std::memcmp(streamData.data(), file->getMappedData(), streamData.size()), 0);
+
+    // Text files have their carriage returns removed
+    std::string binaryContents(reinterpret_cast<const char*>(file->getMappedData()), file->size());
+    ASSERT_NE(binaryContents.find('\r'), std::string::npos) << "Test file should have CRLF line endings";
+    binaryContents.erase(std::remove(binaryContents.begin(), binaryContents.end(), '\r'), binaryContents.end());
+
+    auto textFile = GlobalFileSystem().openTextFile(fileInPak);
+    ASSERT_TRUE(textFile);
+    EXPECT_EQ(textFile->getMappedData(), binaryContents);
+
+    std::istream stream(&textFile->getInputStream());
+    std::string contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(contents, binaryContents);
+
+    // The statistics command should be available
+    EXPECT_NO_THROW(GlobalCommandSystem().executeCommand("ShowVfsCacheStats"));
+}
+
 }
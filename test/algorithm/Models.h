@@ -0,0 +1,132 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include "imodel.h"
+#include "imodelcache.h"
+
+namespace test::algorithm
+{
+
+/**
+ * Takes the place of the model importer for the given extension, all models
+ * requested from it are held back until release() is called. This is putting
+ * the tests in control of the point in time background loads are finishing.
+ * The original importer is restored on destruction.
+ */
+class ScopedBlockingModelImporter
+{
+private:
+    class BlockingImporter :
+        public model::IModelImporter
+    {
+    private:
+        model::IModelImporterPtr _importer;
+
+        std::mutex _lock;
+        std::condition_variable _releasedCondition;
+        bool _released;
+
+        // The number of times each path has been passed to loadModelFromPath
+        std::map<std::string, std::size_t> _numLoads;
+
+    public:
+        BlockingImporter(const model::IModelImporterPtr& importer) :
+            _importer(importer),
+            _released(false)
+        {}
+
+        const std::string& getExtension() const override
+        {
+            return _importer->getExtension();
+        }
+
+        scene::INodePtr loadModel(const std::string& modelName) override
+        {
+            // The importers acquire their models through the cache, which calls loadModelFromPath
+            return _importer->loadModel(modelName);
+        }
+
+        model::IModelPtr loadModelFromPath(const std::string& path) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+
+                ++_numLoads[path];
+                _releasedCondition.wait(lock, [this]() { return _released; });
+            }
+
+            return _importer->loadModelFromPath(path);
+        }
+
+        void release()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _released = true;
+            }
+
+            _releasedCondition.notify_all();
+        }
+
+        std::size_t getNumLoads(const std::string& path)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            auto found = _numLoads.find(path);
+            return found != _numLoads.end() ? found->second : 0;
+        }
+
+        std::size_t getNumLoadedPaths()
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            return _numLoads.size();
+        }
+
+        const model::IModelImporterPtr& getOriginalImporter() const
+        {
+            return _importer;
+        }
+    };
+
+    std::shared_ptr<BlockingImporter> _importer;
+
+public:
+    ScopedBlockingModelImporter(const std::string& extension) :
+        _importer(std::make_shared<BlockingImporter>(GlobalModelFormatManager().getImporter(extension)))
+    {
+        GlobalModelFormatManager().unregisterImporter(_importer->getOriginalImporter());
+        GlobalModelFormatManager().registerImporter(_importer);
+    }
+
+    ~ScopedBlockingModelImporter()
+    {
+        // Let the workers run to the end before they lose their importer
+        _importer->release();
+        GlobalModelCache().waitForBackgroundLoads();
+
+        GlobalModelFormatManager().unregisterImporter(_importer);
+        GlobalModelFormatManager().registerImporter(_importer->getOriginalImporter());
+    }
+
+    // Lets the held back models and all further requests pass
+    void release()
+    {
+        _importer->release();
+    }
+
+    // Returns how many times the given model has been loaded (or has been waiting to be loaded)
+    std::size_t getNumLoads(const std::string& path)
+    {
+        return _importer->getNumLoads(path);
+    }
+
+    // Returns the number of distinct paths that have been passed to the importer
+    std::size_t getNumLoadedPaths()
+    {
+        return _importer->getNumLoadedPaths();
+    }
+};
+
+}